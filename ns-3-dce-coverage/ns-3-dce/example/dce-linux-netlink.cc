@@ -0,0 +1,94 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+//
+// Time taken by the host to configure the addresses of a chain of Linux
+// nodes:
+//
+//   n0 --- n1 --- n2 --- ... --- n(nNodes-1)
+//
+// By default the addresses are assigned with Ipv4AddressHelper and reach
+// the kernels with rtnetlink. With --ip, they are configured by starting
+// one "ip" process per command, as LinuxStackHelper::RunIp does.
+//
+//   ./waf --run "dce-linux-netlink --nNodes=1000"
+//   ./waf --run "dce-linux-netlink --nNodes=1000 --ip=1"
+//
+#include "ns3/network-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/dce-module.h"
+#include "ns3/point-to-point-module.h"
+#include <sys/time.h>
+
+using namespace ns3;
+
+static double
+WallTime (void)
+{
+  struct timeval tv;
+  gettimeofday (&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static std::string
+LinkAddress (uint32_t link, uint32_t host)
+{
+  std::ostringstream oss;
+  oss << "10." << link / 256 << "." << link % 256 << "." << host;
+  return oss.str ();
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t nNodes = 1000;
+  bool useIp = false;
+  CommandLine cmd;
+  cmd.AddValue ("nNodes", "Number of nodes in the chain", nNodes);
+  cmd.AddValue ("ip", "Configure the addresses with ip processes instead of rtnetlink", useIp);
+  cmd.Parse (argc, argv);
+  NS_ABORT_MSG_IF (nNodes < 2 || nNodes > 65537, "nNodes must be in [2,65537]");
+
+  double start = WallTime ();
+  NodeContainer nodes;
+  nodes.Create (nNodes);
+  DceManagerHelper dceManager;
+  dceManager.SetNetworkStack ("ns3::LinuxSocketFdFactory",
+                              "Library", StringValue ("liblinux.so"));
+  dceManager.Install (nodes);
+  LinuxStackHelper stack;
+  stack.Install (nodes);
+
+  PointToPointHelper pointToPoint;
+  pointToPoint.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  pointToPoint.SetChannelAttribute ("Delay", StringValue ("1ms"));
+  Ipv4AddressHelper address;
+  for (uint32_t link = 0; link + 1 < nNodes; link++)
+    {
+      NetDeviceContainer devices = pointToPoint.Install (nodes.Get (link), nodes.Get (link + 1));
+      if (!useIp)
+        {
+          address.SetBase (LinkAddress (link, 0).c_str (), "255.255.255.0");
+          address.Assign (devices);
+          continue;
+        }
+      // the devices of a node are named in the order of the links: the
+      // left one is sim0, the right one sim1 (sim0 on the first node).
+      std::string left = link == 0 ? "sim0" : "sim1";
+      LinuxStackHelper::RunIp (nodes.Get (link), Seconds (0.1),
+                               "-f inet addr add " + LinkAddress (link, 1) + "/24 dev " + left);
+      LinuxStackHelper::RunIp (nodes.Get (link), Seconds (0.2), "link set " + left + " up");
+      LinuxStackHelper::RunIp (nodes.Get (link + 1), Seconds (0.1),
+                               "-f inet addr add " + LinkAddress (link, 2) + "/24 dev sim0");
+      LinuxStackHelper::RunIp (nodes.Get (link + 1), Seconds (0.2), "link set sim0 up");
+    }
+  double setup = WallTime ();
+
+  Simulator::Stop (Seconds (2.0));
+  Simulator::Run ();
+  double end = WallTime ();
+  Simulator::Destroy ();
+
+  std::cout << (useIp ? "ip" : "rtnetlink") << ": " << nNodes << " nodes, "
+            << 2 * (nNodes - 1) << " interfaces, setup " << setup - start
+            << "s, configuration " << end - setup << "s" << std::endl;
+  return 0;
+}
@@ -32,7 +32,7 @@ CcnClientHelper::Install (NodeContainer c)
       CreateKeystore ();
       std::stringstream oss;
 
-      oss << "files-" << nodeId << "/root/.ccnx/";
+      oss << UtilsGetRootDirectory () << "files-" << nodeId << "/root/.ccnx/";
       UtilsEnsureAllDirectoriesExist (oss.str ());
       oss << ".ccnx_keystore";
 
@@ -41,7 +41,7 @@ CcnClientHelper::Install (NodeContainer c)
       oss.str ("");
       oss.clear ();
 
-      oss << "files-" << nodeId;
+      oss << UtilsGetRootDirectory () << "files-" << nodeId;
       UtilsEnsureDirectoryExists (oss.str ());
 
       oss << "/var/";
@@ -68,7 +68,7 @@ CcnClientHelper::InstallInNode (Ptr<Node> node)
       CreateKeystore ();
       std::stringstream oss;
 
-      oss << "files-" << nodeId << "/root/.ccnx/";
+      oss << UtilsGetRootDirectory () << "files-" << nodeId << "/root/.ccnx/";
       UtilsEnsureAllDirectoriesExist (oss.str ());
       oss << ".ccnx_keystore";
 
@@ -77,7 +77,7 @@ CcnClientHelper::InstallInNode (Ptr<Node> node)
       oss.str ("");
       oss.clear ();
 
-      oss << "files-" << nodeId;
+      oss << UtilsGetRootDirectory () << "files-" << nodeId;
       UtilsEnsureDirectoryExists (oss.str ());
 
       oss << "/var/";
@@ -206,7 +206,7 @@ CcnClientHelper::CopyRealFileToVirtual (int nodeId, std::string from, std::strin
 {
   std::stringstream oss;
 
-  oss << "files-" << nodeId << to;
+  oss << UtilsGetRootDirectory () << "files-" << nodeId << to;
 
   std::string vto = oss.str ();
 
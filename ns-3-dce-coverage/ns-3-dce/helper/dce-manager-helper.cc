@@ -5,6 +5,9 @@
 #include "task-scheduler.h"
 #include "task-manager.h"
 #include "loader-factory.h"
+#include "memory-file-system.h"
+#include "process-log.h"
+#include "utils.h"
 #include "ns3/random-variable-stream.h"
 #include "ns3/uinteger.h"
 #include "ns3/string.h"
@@ -53,6 +56,8 @@ DceManagerHelper::DceManagerHelper ()
   m_managerFactory.SetTypeId ("ns3::DceManager");
   m_networkStackFactory.SetTypeId ("ns3::Ns3SocketFdFactory");
   m_delayFactory.SetTypeId ("ns3::RandomProcessDelayModel");
+  m_fileSystemFactory.SetTypeId ("ns3::MemoryFileSystem");
+  m_memoryFileSystem = false;
   m_virtualPath = "";
 }
 void
@@ -74,6 +79,14 @@ DceManagerHelper::SetDelayModel (std::string type,
   m_delayFactory.Set (n1, v1);
 }
 void
+DceManagerHelper::EnableMemoryFileSystem (std::string n0, const AttributeValue &v0,
+                                          std::string n1, const AttributeValue &v1)
+{
+  m_memoryFileSystem = true;
+  m_fileSystemFactory.Set (n0, v0);
+  m_fileSystemFactory.Set (n1, v1);
+}
+void
 DceManagerHelper::SetTaskManagerAttribute (std::string n0, const AttributeValue &v0)
 {
   m_taskManagerFactory.Set (n0, v0);
@@ -124,6 +137,10 @@ DceManagerHelper::Install (Ptr<Node> node)
       node->AggregateObject (manager);
       node->AggregateObject (networkStack);
       node->AggregateObject (CreateObject<LocalSocketFdFactory> ());
+      if (m_memoryFileSystem)
+        {
+          node->AggregateObject (m_fileSystemFactory.Create<MemoryFileSystem> ());
+        }
       manager->AggregateObject (CreateObject<DceNodeContext> ());
       manager->SetVirtualPath (GetVirtualPath ());
 }
@@ -141,8 +158,31 @@ DceManagerHelper::GetVirtualPath () const
 std::vector<ProcStatus>
 DceManagerHelper::GetProcStatus (void)
 {
-  FILE *f = fopen ("exitprocs","r");
   std::vector<ProcStatus> res;
+  std::vector<ProcessLog::Record> records = ProcessLog::GetRecords ();
+  if (records.empty () && ProcessLog::IsBinary ())
+    {
+      // the simulation was destroyed, and its records written in the
+      // binary format only.
+      records = ProcessLog::Read (UtilsGetRootDirectory () + "exitprocs.bin");
+    }
+  if (!records.empty ())
+    {
+      // the processes of this simulation, exitprocs may not be written yet.
+      for (std::vector<ProcessLog::Record>::const_iterator i = records.begin (); i != records.end (); ++i)
+        {
+          if (i->cause == ProcessLog::EXIT)
+            {
+              res.push_back (ProcStatus (i->nodeId, i->exitCode, i->pid, i->ns3Start, i->ns3End,
+                                         i->realStart, i->realEnd,
+                                         (i->ns3End - i->ns3Start) / (double) 1000000000,
+                                         i->realEnd - i->realStart, i->cmdLine));
+            }
+        }
+      return res;
+    }
+  std::string filename = UtilsGetRootDirectory () + "exitprocs";
+  FILE *f = fopen (filename.c_str (),"r");
 
   if (f)
     {
@@ -92,6 +92,8 @@ public:
 
   /**
    * \param type the name of the TaskScheduler to set
+   * (ns3::RrTaskScheduler, the default, and ns3::CfsTaskScheduler which
+   * honors the nice values of the tasks are available)
    * \param n0 the name of the attribute to set to the TaskScheduler
    * \param v0 the value of the attribute to set to the TaskScheduler
    * \param n1 the name of the attribute to set to the TaskScheduler
@@ -105,7 +107,8 @@ public:
 
   /**
    * \param type the name of the ProcessDelayModel to set
-   * (ns3::RandomProcessDelayModel and ns3::TimeOfDayProcessDelayModel are available)
+   * (ns3::RandomProcessDelayModel, ns3::TimeOfDayProcessDelayModel and
+   * ns3::CpuTimeProcessDelayModel are available)
    * \param n0 the name of the attribute to set to the ProcessDelayModel
    * \param v0 the value of the attribute to set to the ProcessDelayModel
    * \param n1 the name of the attribute to set to the ProcessDelayModel
@@ -151,6 +154,18 @@ public:
    */
   void SetAttribute (std::string n1, const AttributeValue &v1);
 
+  /**
+   * \param n0 the name of the attribute to set to the ns3::MemoryFileSystem
+   * \param v0 the value of the attribute to set to the ns3::MemoryFileSystem
+   * \param n1 the name of the attribute to set to the ns3::MemoryFileSystem
+   * \param v1 the value of the attribute to set to the ns3::MemoryFileSystem
+   *
+   * Keep the regular files written by the applications of the nodes in
+   * memory instead of files-X directories. Disabled by default.
+   */
+  void EnableMemoryFileSystem (std::string n0 = "", const AttributeValue &v0 = EmptyAttributeValue (),
+                               std::string n1 = "", const AttributeValue &v1 = EmptyAttributeValue ());
+
   /**
    * \param nodes a set of nodes
    *
@@ -188,6 +203,8 @@ private:
   ObjectFactory m_managerFactory;
   ObjectFactory m_networkStackFactory;
   ObjectFactory m_delayFactory;
+  ObjectFactory m_fileSystemFactory;
+  bool m_memoryFileSystem;
   std::string m_virtualPath;
   static unsigned long nanoCpt;
 };
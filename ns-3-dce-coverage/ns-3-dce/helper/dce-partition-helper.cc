@@ -0,0 +1,224 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "dce-partition-helper.h"
+#include "dce-parallel-simulator-impl.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/fatal-error.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("DcePartitionHelper");
+
+namespace ns3 {
+
+namespace {
+
+struct Link
+{
+  uint32_t a;
+  uint32_t b;
+  double weight;
+};
+
+// heaviest first, then by node: the result does not depend on the order
+// of AddTraffic.
+bool
+HeavierLink (const struct Link &x, const struct Link &y)
+{
+  if (x.weight != y.weight)
+    {
+      return x.weight > y.weight;
+    }
+  if (x.a != y.a)
+    {
+      return x.a < y.a;
+    }
+  return x.b < y.b;
+}
+
+uint32_t
+FindCluster (std::vector<uint32_t> &parent, uint32_t node)
+{
+  while (parent[node] != node)
+    {
+      parent[node] = parent[parent[node]];
+      node = parent[node];
+    }
+  return node;
+}
+
+} // namespace
+
+DcePartitionHelper::DcePartitionHelper ()
+{
+}
+
+void
+DcePartitionHelper::AddTraffic (uint32_t a, uint32_t b, double weight)
+{
+  NS_LOG_FUNCTION (this << a << b << weight);
+  if (a == b)
+    {
+      return;
+    }
+  m_traffic[std::make_pair (std::min (a, b), std::max (a, b))] += weight;
+}
+
+std::vector<uint32_t>
+DcePartitionHelper::Partition (uint32_t nNodes, uint32_t nPartitions) const
+{
+  NS_LOG_FUNCTION (this << nNodes << nPartitions);
+  NS_ASSERT (nPartitions > 0);
+  uint32_t capacity = (nNodes + nPartitions - 1) / nPartitions;
+  std::vector<struct Link> links;
+  std::vector<std::vector<std::pair<uint32_t, double> > > neighbours (nNodes);
+  for (Traffic::const_iterator i = m_traffic.begin (); i != m_traffic.end (); ++i)
+    {
+      if (i->first.second >= nNodes)
+        {
+          continue;
+        }
+      struct Link link;
+      link.a = i->first.first;
+      link.b = i->first.second;
+      link.weight = i->second;
+      links.push_back (link);
+      neighbours[link.a].push_back (std::make_pair (link.b, link.weight));
+      neighbours[link.b].push_back (std::make_pair (link.a, link.weight));
+    }
+  std::sort (links.begin (), links.end (), &HeavierLink);
+
+  // group the nodes along the heaviest links, up to the size of a
+  // partition.
+  std::vector<uint32_t> parent (nNodes);
+  std::vector<uint32_t> size (nNodes, 1);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      parent[i] = i;
+    }
+  for (std::vector<struct Link>::const_iterator i = links.begin (); i != links.end (); ++i)
+    {
+      uint32_t a = FindCluster (parent, i->a);
+      uint32_t b = FindCluster (parent, i->b);
+      if (a != b && size[a] + size[b] <= capacity)
+        {
+          if (b < a)
+            {
+              std::swap (a, b);
+            }
+          parent[b] = a;
+          size[a] += size[b];
+        }
+    }
+
+  // the largest groups first, each in the least loaded partition. The
+  // partitions hold nNodes / nPartitions nodes, and the nPartitions
+  // first to fill up one more: a group which does not fit is split, its
+  // last nodes go to the next least loaded partition.
+  std::vector<std::pair<uint32_t, uint32_t> > clusters;
+  std::vector<std::vector<uint32_t> > members (nNodes);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      uint32_t cluster = FindCluster (parent, i);
+      if (cluster == i)
+        {
+          // negated size: std::sort puts the largest first.
+          clusters.push_back (std::make_pair (nNodes - size[i], i));
+        }
+      members[cluster].push_back (i);
+    }
+  std::sort (clusters.begin (), clusters.end ());
+  uint32_t base = nNodes / nPartitions;
+  uint32_t extra = nNodes % nPartitions;
+  std::vector<uint32_t> load (nPartitions, 0);
+  std::vector<uint32_t> partition (nNodes, 0);
+  for (std::vector<std::pair<uint32_t, uint32_t> >::const_iterator i = clusters.begin ();
+       i != clusters.end (); ++i)
+    {
+      const std::vector<uint32_t> &nodes = members[i->second];
+      uint32_t best = std::min_element (load.begin (), load.end ()) - load.begin ();
+      for (uint32_t j = 0; j < nodes.size (); j++)
+        {
+          bool full = load[best] > base || (load[best] == base && extra == 0);
+          if (full)
+            {
+              best = std::min_element (load.begin (), load.end ()) - load.begin ();
+            }
+          partition[nodes[j]] = best;
+          load[best]++;
+          if (load[best] == base + 1)
+            {
+              extra--;
+            }
+        }
+    }
+
+  // then move the nodes which talk more to a partition with one node
+  // less: the two partitions swap their sizes, which stay balanced.
+  for (uint32_t pass = 0; pass < 4; pass++)
+    {
+      bool moved = false;
+      for (uint32_t i = 0; i < nNodes; i++)
+        {
+          std::vector<double> affinity (nPartitions, 0.0);
+          for (uint32_t j = 0; j < neighbours[i].size (); j++)
+            {
+              affinity[partition[neighbours[i][j].first]] += neighbours[i][j].second;
+            }
+          uint32_t from = partition[i];
+          uint32_t to = from;
+          for (uint32_t p = 0; p < nPartitions; p++)
+            {
+              if (affinity[p] > affinity[to] && load[p] < load[from])
+                {
+                  to = p;
+                }
+            }
+          if (to != from)
+            {
+              partition[i] = to;
+              load[from]--;
+              load[to]++;
+              moved = true;
+            }
+        }
+      if (!moved)
+        {
+          break;
+        }
+    }
+  return partition;
+}
+
+NodeContainer
+DcePartitionHelper::Create (uint32_t nNodes, uint32_t nSystems) const
+{
+  NS_LOG_FUNCTION (this << nNodes << nSystems);
+  std::vector<uint32_t> partition = Partition (nNodes, nSystems);
+  NodeContainer nodes;
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      nodes.Add (CreateObject<Node> (partition[i]));
+    }
+  return nodes;
+}
+
+void
+DcePartitionHelper::Install (NodeContainer nodes) const
+{
+  NS_LOG_FUNCTION (this);
+  Ptr<DceParallelSimulatorImpl> impl =
+    DynamicCast<DceParallelSimulatorImpl> (Simulator::GetImplementation ());
+  if (impl == 0)
+    {
+      NS_FATAL_ERROR ("DcePartitionHelper::Install needs the DceParallelSimulatorImpl simulator");
+    }
+  std::vector<uint32_t> partition = Partition (nodes.GetN (), impl->GetNPartitions ());
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      impl->SetPartition (nodes.Get (i)->GetId (), partition[i]);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,65 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef DCE_PARTITION_HELPER_H
+#define DCE_PARTITION_HELPER_H
+
+#include "ns3/node-container.h"
+#include <vector>
+#include <map>
+
+namespace ns3 {
+
+/**
+ * \brief Split the nodes of a simulation between the ranks of a
+ * distributed simulation, or the threads of DceParallelSimulatorImpl,
+ * so that the nodes which talk the most share a partition.
+ *
+ * The nodes are numbered from 0 in the order they are created (Create)
+ * or in the order of the container (Install). The expected traffic
+ * between two nodes is declared with AddTraffic; the partitions have
+ * the same number of nodes, give or take one.
+ */
+class DcePartitionHelper
+{
+public:
+  DcePartitionHelper ();
+
+  /**
+   * \param a a node
+   * \param b another node
+   * \param weight the relative amount of traffic between them.
+   */
+  void AddTraffic (uint32_t a, uint32_t b, double weight = 1.0);
+
+  /**
+   * \param nNodes the number of nodes
+   * \param nPartitions the number of partitions
+   * \returns the partition of each node.
+   */
+  std::vector<uint32_t> Partition (uint32_t nNodes, uint32_t nPartitions) const;
+
+  /**
+   * Create the nodes of a distributed simulation, each with the system id
+   * of its partition.
+   *
+   * \param nNodes the number of nodes
+   * \param nSystems the number of ranks, MpiInterface::GetSize ()
+   * \returns the nodes, in order.
+   */
+  NodeContainer Create (uint32_t nNodes, uint32_t nSystems) const;
+
+  /**
+   * Assign the nodes to the partitions of the DceParallelSimulatorImpl
+   * of the simulation. Must be called before the first Run.
+   *
+   * \param nodes the nodes, in order.
+   */
+  void Install (NodeContainer nodes) const;
+
+private:
+  typedef std::map<std::pair<uint32_t, uint32_t>, double> Traffic;
+  Traffic m_traffic;
+};
+
+} // namespace ns3
+
+#endif /* DCE_PARTITION_HELPER_H */
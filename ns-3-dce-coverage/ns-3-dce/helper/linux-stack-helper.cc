@@ -113,6 +113,11 @@ LinuxStackHelper::PopulateRoutingTables ()
         {
           ipv4->PopulateRoutingTable ();
         }
+      Ptr<Ipv6Linux> ipv6 = node->GetObject<Ipv6Linux> ();
+      if (ipv6)
+        {
+          ipv6->PopulateRoutingTable ();
+        }
     }
 #endif
 }
@@ -172,8 +177,75 @@ LinuxStackHelper::SysctlGet (Ptr<Node> node, Time at, std::string path,
   return;
 #endif
 }
+void
+LinuxStackHelper::SysctlSnapshotCallback (Ptr<Node> node, std::string prefix,
+                                          void (*callback)(Ptr<Node>, std::map<std::string, std::string>))
+{
+#ifdef KERNEL_STACK
+  Ptr<LinuxSocketFdFactory> sock = node->GetObject<LinuxSocketFdFactory> ();
+  callback (node, sock->GetAll (prefix));
+#endif
+}
+
+void
+LinuxStackHelper::SysctlSnapshot (Ptr<Node> node, Time at, std::string prefix,
+                                  void (*callback)(Ptr<Node>, std::map<std::string, std::string>))
+{
+#ifdef KERNEL_STACK
+  Ptr<LinuxSocketFdFactory> sock = node->GetObject<LinuxSocketFdFactory> ();
+  if (!sock)
+    {
+      NS_ASSERT_MSG (0, "No LinuxSocketFdFactory is installed. "
+                     "You may need to do it via DceManagerHelper::Install ()");
+      return;
+    }
+  Simulator::ScheduleWithContext (node->GetId (), at,
+                                  &LinuxSocketFdFactory::ScheduleTask, sock,
+                                  MakeEvent (&LinuxStackHelper::SysctlSnapshotCallback,
+                                             node, prefix, callback));
+#endif
+}
+
+std::map<std::string, std::pair<std::string, std::string> >
+LinuxStackHelper::SysctlDiff (const std::map<std::string, std::string> &before,
+                              const std::map<std::string, std::string> &after)
+{
+  std::map<std::string, std::pair<std::string, std::string> > diff;
+  std::map<std::string, std::string>::const_iterator b = before.begin ();
+  std::map<std::string, std::string>::const_iterator a = after.begin ();
+  while (b != before.end () || a != after.end ())
+    {
+      if (a == after.end () || (b != before.end () && b->first < a->first))
+        {
+          diff[b->first] = std::make_pair (b->second, std::string ());
+          ++b;
+        }
+      else if (b == before.end () || a->first < b->first)
+        {
+          diff[a->first] = std::make_pair (std::string (), a->second);
+          ++a;
+        }
+      else
+        {
+          if (a->second != b->second)
+            {
+              diff[a->first] = std::make_pair (b->second, a->second);
+            }
+          ++a;
+          ++b;
+        }
+    }
+  return diff;
+}
+
 void
 LinuxStackHelper::SysctlSet (NodeContainer c, std::string path, std::string value)
+{
+  SysctlSet (c, std::vector<std::pair<std::string, std::string> > (1, std::make_pair (path, value)));
+}
+
+void
+LinuxStackHelper::SysctlSet (NodeContainer c, std::vector<std::pair<std::string, std::string> > values)
 {
 #ifdef KERNEL_STACK
   for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
@@ -187,8 +259,8 @@ LinuxStackHelper::SysctlSet (NodeContainer c, std::string path, std::string valu
         }
       // i.e., TaskManager::Current() needs it.
       Simulator::ScheduleWithContext (node->GetId (), Seconds (0.1),
-                                      MakeEvent (&LinuxSocketFdFactory::Set, sock,
-                                                 path, value));
+                                      MakeEvent (&LinuxSocketFdFactory::SetAll, sock,
+                                                 values));
     }
 #endif
 }
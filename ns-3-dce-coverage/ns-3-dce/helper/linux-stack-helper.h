@@ -21,6 +21,10 @@
 #define LINUX_STACK_HELPER_H
 
 #include "ns3/object.h"
+#include <map>
+#include <vector>
+#include <string>
+#include <utility>
 
 namespace ns3 {
 
@@ -99,6 +103,18 @@ public:
    */
   void SysctlSet (NodeContainer c, std::string path, std::string value);
 
+  /**
+   * Configure many Linux kernel parameters at once.
+   *
+   * \param c NodeContainer that holds the set of nodes to configure these parameters.
+   * \param values the (sysctl path, value) pairs to set, e.g. (".net.dccp.default.rx_ccid", "2")
+   *
+   * The parameters of a node are set by a single kernel task, in the order of values:
+   * e.g. ".net.ipv4.tcp_allowed_congestion_control" goes before the
+   * ".net.ipv4.tcp_congestion_control" it allows.
+   */
+  void SysctlSet (NodeContainer c, std::vector<std::pair<std::string, std::string> > values);
+
   /**
    * Obtain Linux kernel state with traditional 'sysctl' interface.
    *
@@ -112,12 +128,37 @@ public:
                          void (*callback)(std::string, std::string));
 
   /**
-   * Populate routing information to all the nodes in network from GlobalRoutingTable.
+   * Read all the Linux kernel parameters below a sysctl path.
+   *
+   * \param node The node pointer Ptr<Node> that will ask the status.
+   * \param at the delta from the begining of simulation to ask this query.
+   * \param prefix the sysctl path to read, e.g. ".net" for the whole /proc/sys/net tree.
+   * \param callback a callback function receiving the node and the values indexed by path.
+   */
+  static void SysctlSnapshot (Ptr<Node> node, Time at, std::string prefix,
+                              void (*callback)(Ptr<Node>, std::map<std::string, std::string>));
+
+  /**
+   * Compare two results of SysctlSnapshot.
+   *
+   * \returns the (before, after) values of the parameters which differ, indexed by path.
+   * The value of a parameter missing from a snapshot is empty.
+   */
+  static std::map<std::string, std::pair<std::string, std::string> >
+  SysctlDiff (const std::map<std::string, std::string> &before,
+              const std::map<std::string, std::string> &after);
+
+  /**
+   * Populate routing information to all the nodes in network from GlobalRoutingTable
+   * for IPv4 and from the Ipv6StaticRouting of the nodes for IPv6.
+   *
+   * The routes are sent to the kernels with rtnetlink, in batches.
    *
    * Limitation:
    * 1) This method SHOULD call after Ipv4GlobalRoutingHelper::PopulateRoutingTables () so that
    * LinuxStackHelper can obtain the route information.
-   * 2) This feature is only available for IPv4 route information. IPv6 is not implemented.
+   * 2) There is no global routing for IPv6: the IPv6 routes are the ones set up with
+   * Ipv6StaticRoutingHelper. Link local and multicast routes are left to the kernel.
    *
    */
   static void PopulateRoutingTables ();
@@ -125,6 +166,10 @@ public:
   /**
    * Execute "ip" command (of Linux) on a specific node to configure the ip address/route/etc information.
    *
+   * This starts a DCE process running the ip binary for each command. The addresses
+   * assigned with the ns-3 helpers and the routes of PopulateRoutingTables do not need
+   * it: they are sent to the kernel with rtnetlink by LinuxSocketFdFactory.
+   *
    * \param node The node pointer Ptr<Node> to configure.
    * \param at the delta from the begining of simulation to execute this command.
    * \param str a string for the command line argument of ip command. e.g., "route add 10.0.1.0/24 via 10.0.0.1"
@@ -136,6 +181,8 @@ private:
   const Ipv4RoutingHelper *m_routing;
   static void SysctlGetCallback (Ptr<Node> node, std::string path,
                                  void (*callback)(std::string, std::string));
+  static void SysctlSnapshotCallback (Ptr<Node> node, std::string prefix,
+                                      void (*callback)(Ptr<Node>, std::map<std::string, std::string>));
 
 
 };
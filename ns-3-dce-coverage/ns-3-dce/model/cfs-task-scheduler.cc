@@ -0,0 +1,119 @@
+/* -*-	Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "cfs-task-scheduler.h"
+#include "task-manager.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("CfsTaskScheduler");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (CfsTaskScheduler);
+
+// Same table as the linux kernel (sched_prio_to_weight): each nice
+// level is worth about 10% of cpu time.
+static const uint32_t g_niceToWeight[40] = {
+  /* -20 */ 88761, 71755, 56483, 46273, 36291,
+  /* -15 */ 29154, 23254, 18705, 14949, 11916,
+  /* -10 */ 9548, 7620, 6100, 4904, 3906,
+  /*  -5 */ 3121, 2501, 1991, 1586, 1277,
+  /*   0 */ 1024, 820, 655, 526, 423,
+  /*   5 */ 335, 272, 215, 172, 137,
+  /*  10 */ 110, 87, 70, 56, 45,
+  /*  15 */ 36, 29, 23, 18, 15,
+};
+
+TypeId
+CfsTaskScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CfsTaskScheduler")
+    .SetParent<TaskScheduler> ()
+    .AddConstructor<CfsTaskScheduler> ()
+    .AddAttribute ("SleeperCredit",
+                   "The amount of virtual runtime a task waking up may be ahead of "
+                   "the run queue is the half of this value.",
+                   TimeValue (MilliSeconds (6)),
+                   MakeTimeAccessor (&CfsTaskScheduler::m_sleeperCredit),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+CfsTaskScheduler::CfsTaskScheduler ()
+  : m_minVruntime (0),
+    m_sequence (0)
+{
+}
+
+uint32_t
+CfsTaskScheduler::GetWeight (int nice)
+{
+  nice = std::min (std::max (nice, -20), 19);
+  return g_niceToWeight[nice + 20];
+}
+
+bool
+CfsTaskScheduler::Order::operator () (const Task *a, const Task *b) const
+{
+  if (a->m_vruntime != b->m_vruntime)
+    {
+      return a->m_vruntime < b->m_vruntime;
+    }
+  return a->m_sequence < b->m_sequence;
+}
+
+void
+CfsTaskScheduler::Update (Task *task)
+{
+  // charge the cpu time consumed since the last enqueue.
+  int64_t delta = (task->m_cpuTime - task->m_accounted).GetNanoSeconds ();
+  task->m_accounted = task->m_cpuTime;
+  if (delta > 0)
+    {
+      task->m_vruntime += delta * 1024 / GetWeight (task->m_nice);
+    }
+  int64_t floor = m_minVruntime - m_sleeperCredit.GetNanoSeconds () / 2;
+  task->m_vruntime = std::max (task->m_vruntime, floor);
+}
+
+struct Task *
+CfsTaskScheduler::PeekNext (void)
+{
+  if (m_active.empty ())
+    {
+      return 0;
+    }
+  struct Task *task = *m_active.begin ();
+  NS_LOG_DEBUG ("next=" << task << " vruntime=" << task->m_vruntime);
+  return task;
+}
+void
+CfsTaskScheduler::DequeueNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!m_active.empty ());
+  struct Task *task = *m_active.begin ();
+  m_active.erase (m_active.begin ());
+  // the leftmost task is the smallest vruntime of the run queue.
+  m_minVruntime = std::max (m_minVruntime, task->m_vruntime);
+}
+void
+CfsTaskScheduler::Enqueue (struct Task *task)
+{
+  NS_LOG_FUNCTION (this << task);
+  Update (task);
+  task->m_sequence = m_sequence++;
+  m_active.insert (task);
+}
+void
+CfsTaskScheduler::Dequeue (struct Task *task)
+{
+  NS_LOG_FUNCTION (this << task);
+  std::set<Task *, Order>::iterator i = m_active.find (task);
+  if (i != m_active.end () && *i == task)
+    {
+      m_active.erase (i);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,59 @@
+/* -*-	Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef CFS_TASK_SCHEDULER_H
+#define CFS_TASK_SCHEDULER_H
+
+#include "task-scheduler.h"
+#include "ns3/nstime.h"
+#include <stdint.h>
+#include <set>
+
+namespace ns3 {
+
+/**
+ * \brief Fair share scheduler modeled after the Linux CFS.
+ *
+ * Each task accumulates a virtual runtime: the cpu time charged to it
+ * by the ProcessDelayModel, weighted by its nice value (see
+ * Task::SetPriority). The active task with the smallest virtual runtime
+ * runs next, ties being broken in FIFO order so that, with a delay model
+ * which charges nothing, this scheduler behaves like RrTaskScheduler.
+ *
+ * Tasks waking up after a sleep get their virtual runtime raised to
+ * at least the minimum virtual runtime of the run queue minus half
+ * of the SleeperCredit attribute: they run soon but cannot hog the
+ * cpu to catch up the time they spent sleeping.
+ *
+ * All operations are O(log n) in the number of active tasks.
+ */
+class CfsTaskScheduler : public TaskScheduler
+{
+public:
+  static TypeId GetTypeId (void);
+  CfsTaskScheduler ();
+
+  virtual Task * PeekNext (void);
+  virtual void DequeueNext (void);
+  virtual void Enqueue (Task *task);
+  virtual void Dequeue (Task *task);
+
+  /**
+   * \param nice a nice value between -20 and 19
+   * \returns the load weight of this nice value, 1024 for nice 0.
+   */
+  static uint32_t GetWeight (int nice);
+private:
+  struct Order
+  {
+    bool operator () (const Task *a, const Task *b) const;
+  };
+  void Update (Task *task);
+
+  std::set<Task *, Order> m_active;
+  int64_t m_minVruntime;
+  uint64_t m_sequence;
+  Time m_sleeperCredit;
+};
+
+} // namespace ns3
+
+#endif /* CFS_TASK_SCHEDULER_H */
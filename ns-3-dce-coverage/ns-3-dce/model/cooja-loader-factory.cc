@@ -3,6 +3,10 @@
 #include "elf-cache.h"
 #include "elf-dependencies.h"
 #include "ns3/log.h"
+#include "ns3/fatal-error.h"
+#include "ns3/thread-safety.h"
+#include "ns3/global-value.h"
+#include "ns3/string.h"
 #ifdef DCE_MPI
 #include "ns3/mpi-interface.h"
 #endif
@@ -37,6 +41,21 @@ namespace ns3 {
 NS_LOG_COMPONENT_DEFINE ("CoojaLoaderFactory");
 NS_OBJECT_ENSURE_REGISTERED (CoojaLoaderFactory);
 
+static GlobalValue g_elfCacheDirectory = GlobalValue ("DceElfCacheDirectory",
+                                                      "The directory of the edited copies of the "
+                                                      "binaries, shared by the ranks of a distributed "
+                                                      "simulation. It may be read only.",
+                                                      StringValue ("elf-cache"),
+                                                      MakeStringChecker ());
+
+static std::string
+GetElfCacheDirectory (void)
+{
+  StringValue directory;
+  g_elfCacheDirectory.GetValue (directory);
+  return directory.Get ();
+}
+
 struct SharedModules
 {
   SharedModules ();
@@ -79,9 +98,9 @@ private:
 
 SharedModules::SharedModules ()
 #ifdef DCE_MPI
-  : cache ("elf-cache", MpiInterface::GetSystemId ())
+  : cache (GetElfCacheDirectory (), MpiInterface::GetSystemId ())
 #else
-  : cache ("elf-cache", 0)
+  : cache (GetElfCacheDirectory (), 0)
 #endif
 {
 }
@@ -420,6 +439,12 @@ CoojaLoaderFactory::~CoojaLoaderFactory ()
 Loader *
 CoojaLoaderFactory::Create (int argc, char **argv, char **envp)
 {
+  if (ThreadSafety::IsEnabled ())
+    {
+      // the loader swaps the data of the nodes in place in one process
+      // wide image: only one node may run at a time.
+      NS_FATAL_ERROR ("CoojaLoaderFactory cannot run with several simulation threads: use DlmLoaderFactory");
+    }
   CoojaLoader *loader = new CoojaLoader ();
   return loader;
 }
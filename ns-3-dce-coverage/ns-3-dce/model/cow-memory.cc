@@ -0,0 +1,644 @@
+#include "cow-memory.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <map>
+#include <algorithm>
+#include <new>
+#include <pthread.h>
+#include "ns3/assert.h"
+#include "ns3/thread-safety.h"
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+NS_LOG_COMPONENT_DEFINE ("CowMemory");
+
+namespace {
+
+// The free lists and the index of the memories are shared by the nodes,
+// which may run on several simulation threads. The lock is recursive: a
+// page fault may happen while the faulting thread holds it.
+pthread_mutex_t g_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+class Lock
+{
+public:
+  Lock () : m_locked (ns3::ThreadSafety::IsEnabled ())
+  {
+    if (m_locked)
+      {
+        pthread_mutex_lock (&g_lock);
+      }
+  }
+  ~Lock ()
+  {
+    if (m_locked)
+      {
+        pthread_mutex_unlock (&g_lock);
+      }
+  }
+private:
+  bool m_locked;
+};
+
+// Page faults allocate memory from a signal handler so, page structures
+// and page copies come from free lists refilled with mmap rather than
+// from malloc.
+class Pool
+{
+public:
+  Pool (size_t size) : m_size (size), m_free (0) {}
+  void * Alloc (void)
+  {
+    Lock lock;
+    if (m_free == 0)
+      {
+        size_t slab = 64 * 4096;
+        uint8_t *buffer = (uint8_t *)::mmap (0, slab, PROT_READ | PROT_WRITE,
+                                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        NS_ASSERT_MSG (buffer != MAP_FAILED, "Unable to mmap memory buffer");
+        for (size_t i = 0; i + m_size <= slab; i += m_size)
+          {
+            Free (buffer + i);
+          }
+      }
+    struct Free *free = m_free;
+    m_free = free->next;
+    return free;
+  }
+  void Free (void *buffer)
+  {
+    Lock lock;
+    struct Free *free = (struct Free *)buffer;
+    free->next = m_free;
+    m_free = free;
+  }
+private:
+  struct Free
+  {
+    struct Free *next;
+  };
+  size_t m_size;
+  struct Free *m_free;
+};
+
+size_t g_pageSize = sysconf (_SC_PAGESIZE);
+Pool g_buffers (g_pageSize);
+const size_t NODE_SIZE = 64;
+Pool g_nodes (NODE_SIZE);
+
+// The nodes of the page maps of the layers, which a page fault inserts.
+template <typename T>
+class NodeAllocator
+{
+public:
+  typedef T value_type;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  template <typename U>
+  struct rebind
+  {
+    typedef NodeAllocator<U> other;
+  };
+
+  NodeAllocator () {}
+  template <typename U>
+  NodeAllocator (const NodeAllocator<U> &) {}
+  pointer address (reference x) const { return &x; }
+  const_pointer address (const_reference x) const { return &x; }
+  pointer allocate (size_type n, const void * = 0)
+  {
+    NS_ASSERT (n == 1 && sizeof (T) <= NODE_SIZE);
+    return (pointer)g_nodes.Alloc ();
+  }
+  void deallocate (pointer p, size_type) { g_nodes.Free (p); }
+  size_type max_size () const { return size_type (-1) / sizeof (T); }
+  void construct (pointer p, const T &v) { new (p) T (v); }
+  void destroy (pointer p) { p->~T (); }
+};
+template <typename T, typename U>
+bool operator == (const NodeAllocator<T> &, const NodeAllocator<U> &) { return true; }
+template <typename T, typename U>
+bool operator != (const NodeAllocator<T> &, const NodeAllocator<U> &) { return false; }
+
+// Tracked memories indexed by start address.
+std::map<uint8_t *, CowMemory *> g_memories;
+struct sigaction g_previous;
+
+} // namespace
+
+// The images form a tree: an image sees the version of a page of the
+// nearest layer, from its top layer to the root, which has this page.
+// Clone freezes the top layer of an image and puts a new empty layer
+// above it for each of the two images, so the pages written since then
+// are the pages of the layers between them and their common ancestor.
+struct CowMemory::Layer
+{
+  typedef std::map<uint32_t, uint8_t *, std::less<uint32_t>,
+                   NodeAllocator<std::pair<const uint32_t, uint8_t *> > > Pages;
+  // the layers above, the images on top and m_memory.
+  uint32_t refcount;
+  Layer *parent;
+  // the saved content of the pages of this layer, zero for the content
+  // which is only in memory. The root has all the pages it does not list
+  // in memory.
+  Pages pages;
+};
+
+struct CowMemory::Image
+{
+  CowMemory::Layer *top;
+};
+
+CowMemory::CowMemory (void *start, size_t size)
+  : m_current (0),
+    m_tracked (false),
+    m_memory (0),
+    m_copiedPages (0)
+{
+  NS_LOG_FUNCTION (this << start << size);
+  uintptr_t first = (uintptr_t)start & ~(g_pageSize - 1);
+  uintptr_t last = ((uintptr_t)start + size + g_pageSize - 1) & ~(g_pageSize - 1);
+  m_start = (uint8_t *)first;
+  m_pages = (last - first) / g_pageSize;
+}
+CowMemory::~CowMemory ()
+{
+  NS_LOG_FUNCTION (this);
+  while (!m_images.empty ())
+    {
+      Release (m_images.back ());
+    }
+}
+
+uint8_t *
+CowMemory::GetPage (uint32_t index) const
+{
+  return m_start + index * g_pageSize;
+}
+
+void
+CowMemory::Protect (uint32_t first, uint32_t count, int prot)
+{
+  if (count == 0)
+    {
+      return;
+    }
+  int status = ::mprotect (GetPage (first), count * g_pageSize, prot);
+  NS_ASSERT_MSG (status == 0, "Unable to change the protection of " << (void *)GetPage (first));
+}
+
+void
+CowMemory::Protect (const std::vector<uint32_t> &pages, int prot)
+{
+  // one call per run of consecutive pages.
+  uint32_t first = 0;
+  uint32_t count = 0;
+  for (std::vector<uint32_t>::const_iterator i = pages.begin (); i != pages.end (); ++i)
+    {
+      if (count != 0 && *i == first + count)
+        {
+          count++;
+          continue;
+        }
+      Protect (first, count, prot);
+      first = *i;
+      count = 1;
+    }
+  Protect (first, count, prot);
+}
+
+CowMemory::Layer *
+CowMemory::NewLayer (Layer *parent)
+{
+  Layer *layer = new Layer ();
+  layer->refcount = 1;
+  layer->parent = parent;
+  if (parent != 0)
+    {
+      parent->refcount++;
+    }
+  return layer;
+}
+
+void
+CowMemory::Unref (Layer *layer)
+{
+  while (layer != 0)
+    {
+      layer->refcount--;
+      if (layer->refcount != 0)
+        {
+          return;
+        }
+      for (Layer::Pages::iterator i = layer->pages.begin (); i != layer->pages.end (); ++i)
+        {
+          if (i->second != 0)
+            {
+              g_buffers.Free (i->second);
+            }
+        }
+      Layer *parent = layer->parent;
+      delete layer;
+      layer = parent;
+    }
+}
+
+void
+CowMemory::Compact (Layer *layer)
+{
+  // a layer only kept by this one, e.g., the layer of a fork which
+  // exited, is merged into it so that the chains stay short.
+  while (layer->parent != 0 && layer->parent->refcount == 1)
+    {
+      Layer *parent = layer->parent;
+      for (Layer::Pages::iterator i = parent->pages.begin (); i != parent->pages.end (); ++i)
+        {
+          // the layer is not in memory: its parent neither.
+          NS_ASSERT (i->second != 0);
+          if (!layer->pages.insert (*i).second)
+            {
+              g_buffers.Free (i->second);
+            }
+        }
+      layer->parent = parent->parent;
+      delete parent;
+    }
+}
+
+CowMemory::Layer *
+CowMemory::GetOwner (Layer *layer, uint32_t index)
+{
+  while (layer->parent != 0 && layer->pages.find (index) == layer->pages.end ())
+    {
+      layer = layer->parent;
+    }
+  return layer;
+}
+
+CowMemory::Layer *
+CowMemory::GetCommonAncestor (Layer *a, Layer *b)
+{
+  std::vector<Layer *> chain;
+  for (Layer *layer = a; layer != 0; layer = layer->parent)
+    {
+      chain.push_back (layer);
+    }
+  while (std::find (chain.begin (), chain.end (), b) == chain.end ())
+    {
+      b = b->parent;
+    }
+  return b;
+}
+
+void
+CowMemory::GetPages (Layer *layer, Layer *ancestor, std::vector<uint32_t> *pages)
+{
+  for (; layer != ancestor; layer = layer->parent)
+    {
+      for (Layer::Pages::iterator i = layer->pages.begin (); i != layer->pages.end (); ++i)
+        {
+          pages->push_back (i->first);
+        }
+    }
+}
+
+void
+CowMemory::Save (Layer *layer, uint32_t index)
+{
+  uint8_t *&data = layer->pages[index];
+  NS_ASSERT (data == 0);
+  data = (uint8_t *)g_buffers.Alloc ();
+  memcpy (data, GetPage (index), g_pageSize);
+  m_copiedPages++;
+}
+
+uint64_t
+CowMemory::GetCopiedPages (void) const
+{
+  return m_copiedPages;
+}
+
+CowMemory::Image *
+CowMemory::Attach (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_images.empty ());
+  Image *image = new Image ();
+  image->top = 0;
+  m_images.push_back (image);
+  m_current = image;
+  return image;
+}
+
+void
+CowMemory::Track (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_images.size () == 1 && m_current == m_images.front ());
+  SetupSignalHandler ();
+  // the root has every page, in memory.
+  m_memory = NewLayer (0);
+  m_memory->refcount++;
+  m_current->top = m_memory;
+  {
+    Lock lock;
+    g_memories[m_start] = this;
+  }
+  m_tracked = true;
+}
+
+void
+CowMemory::Untrack (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_images.size () == 1 && m_current == m_images.front ());
+  // the last image is in memory: its page copies are useless.
+  Unref (m_current->top);
+  m_current->top = 0;
+  Unref (m_memory);
+  m_memory = 0;
+  Protect (0, m_pages, PROT_READ | PROT_WRITE);
+  {
+    Lock lock;
+    g_memories.erase (m_start);
+  }
+  m_tracked = false;
+}
+
+CowMemory::Image *
+CowMemory::Clone (Image *image)
+{
+  NS_LOG_FUNCTION (this << image);
+  bool first = !m_tracked;
+  if (first)
+    {
+      Track ();
+    }
+  Layer *frozen = image->top;
+  image->top = NewLayer (frozen);
+  Image *clone = new Image ();
+  clone->top = NewLayer (frozen);
+  frozen->refcount--;
+  if (m_memory == frozen)
+    {
+      // the pages written since the last clone are shared now.
+      m_memory = image->top;
+      m_memory->refcount++;
+      frozen->refcount--;
+      if (first)
+        {
+          Protect (0, m_pages, PROT_READ);
+        }
+      else
+        {
+          std::vector<uint32_t> written;
+          GetPages (frozen, frozen->parent, &written);
+          Protect (written, PROT_READ);
+        }
+    }
+  m_images.push_back (clone);
+  return clone;
+}
+
+void
+CowMemory::SwitchTo (Image *image)
+{
+  if (image == m_current)
+    {
+      return;
+    }
+  NS_LOG_FUNCTION (this << image);
+  if (!m_tracked)
+    {
+      // the only image, nobody used the memory since it was detached.
+      NS_ASSERT (image == m_images.front ());
+      m_current = image;
+      return;
+    }
+  NS_ASSERT_MSG (image->top != m_memory, "Switch to a detached image");
+  Layer *top = image->top;
+  Compact (top);
+  // the other pages are the same in both images.
+  Layer *ancestor = GetCommonAncestor (m_memory, top);
+  std::vector<uint32_t> pages;
+  GetPages (m_memory, ancestor, &pages);
+  GetPages (top, ancestor, &pages);
+  std::sort (pages.begin (), pages.end ());
+  pages.erase (std::unique (pages.begin (), pages.end ()), pages.end ());
+
+  std::vector<uint32_t> readOnly;
+  for (std::vector<uint32_t>::const_iterator i = pages.begin (); i != pages.end (); ++i)
+    {
+      if (m_memory->pages.find (*i) == m_memory->pages.end ())
+        {
+          readOnly.push_back (*i);
+        }
+    }
+  Protect (readOnly, PROT_READ | PROT_WRITE);
+  for (std::vector<uint32_t>::const_iterator i = pages.begin (); i != pages.end (); ++i)
+    {
+      Layer *from = GetOwner (m_memory, *i);
+      Layer::Pages::iterator saved = from->pages.find (*i);
+      if (saved == from->pages.end () || saved->second == 0)
+        {
+          if (from != m_memory || m_current != 0)
+            {
+              // save the page of the previous image.
+              Save (from, *i);
+            }
+          else if (saved != from->pages.end ())
+            {
+              // the previous image was detached: drop what it wrote.
+              from->pages.erase (saved);
+            }
+        }
+      Layer *to = GetOwner (top, *i);
+      Layer::Pages::iterator restored = to->pages.find (*i);
+      NS_ASSERT (restored != to->pages.end () && restored->second != 0);
+      memcpy (GetPage (*i), restored->second, g_pageSize);
+      m_copiedPages++;
+      if (to == top)
+        {
+          // memory is the reference for the pages of the new image.
+          g_buffers.Free (restored->second);
+          restored->second = 0;
+        }
+    }
+  Layer *previous = m_memory;
+  m_memory = top;
+  m_memory->refcount++;
+  Unref (previous);
+  m_current = image;
+  if (m_images.size () == 1)
+    {
+      Untrack ();
+      return;
+    }
+  // only the pages of the new image are writable.
+  readOnly.clear ();
+  for (std::vector<uint32_t>::const_iterator i = pages.begin (); i != pages.end (); ++i)
+    {
+      if (top->pages.find (*i) == top->pages.end ())
+        {
+          readOnly.push_back (*i);
+        }
+    }
+  Protect (readOnly, PROT_READ);
+}
+
+void
+CowMemory::Detach (Image *image)
+{
+  NS_LOG_FUNCTION (this << image);
+  if (image != m_current)
+    {
+      return;
+    }
+  // what this image wrote is dropped by the next switch.
+  m_current = 0;
+}
+
+bool
+CowMemory::Release (Image *image)
+{
+  NS_LOG_FUNCTION (this << image);
+  Detach (image);
+  for (std::vector<Image *>::iterator i = m_images.begin (); i != m_images.end (); ++i)
+    {
+      if (*i == image)
+        {
+          m_images.erase (i);
+          break;
+        }
+    }
+  // m_memory keeps the top layer of the image if it is in memory.
+  Unref (image->top);
+  delete image;
+  if (m_images.empty ())
+    {
+      if (m_tracked)
+        {
+          Protect (0, m_pages, PROT_READ | PROT_WRITE);
+          Unref (m_memory);
+          m_memory = 0;
+          Lock lock;
+          g_memories.erase (m_start);
+          m_tracked = false;
+        }
+      return true;
+    }
+  if (m_images.size () == 1 && m_images.front () == m_current)
+    {
+      Untrack ();
+    }
+  return false;
+}
+
+bool
+CowMemory::HandleFault (uint8_t *address)
+{
+  uint32_t i = (address - m_start) / g_pageSize;
+  if (m_memory->pages.find (i) != m_memory->pages.end ())
+    {
+      // already written since the last switch.
+      return false;
+    }
+  NS_ASSERT (m_memory->parent != 0);
+  Layer *owner = GetOwner (m_memory->parent, i);
+  Layer::Pages::iterator saved = owner->pages.find (i);
+  if (saved == owner->pages.end () || saved->second == 0)
+    {
+      // the other images still need the current content.
+      Save (owner, i);
+    }
+  m_memory->pages[i] = 0;
+  Protect (i, 1, PROT_READ | PROT_WRITE);
+  return true;
+}
+
+CowMemory *
+CowMemory::Lookup (uint8_t *address)
+{
+  Lock lock;
+  std::map<uint8_t *, CowMemory *>::iterator i = g_memories.upper_bound (address);
+  if (i == g_memories.begin ())
+    {
+      return 0;
+    }
+  --i;
+  CowMemory *memory = i->second;
+  if (address >= memory->m_start + memory->m_pages * g_pageSize)
+    {
+      return 0;
+    }
+  return memory;
+}
+
+void
+CowMemory::PrepareWrite (void *buffer, size_t size)
+{
+  if (g_memories.empty () || size == 0)
+    {
+      return;
+    }
+  uint8_t *first = (uint8_t *)((uintptr_t)buffer & ~(g_pageSize - 1));
+  uint8_t *end = (uint8_t *)buffer + size;
+  for (uint8_t *page = first; page < end; page += g_pageSize)
+    {
+      CowMemory *memory = Lookup (page);
+      if (memory != 0)
+        {
+          memory->HandleFault (page);
+        }
+    }
+}
+
+void
+CowMemory::SegfaultHandler (int signo, siginfo_t *info, void *context)
+{
+  uint8_t *address = (uint8_t *)info->si_addr;
+  CowMemory *memory = Lookup (address);
+  if (memory != 0 && memory->HandleFault (address))
+    {
+      return;
+    }
+  // not a copy on write fault.
+  if (g_previous.sa_flags & SA_SIGINFO)
+    {
+      g_previous.sa_sigaction (signo, info, context);
+    }
+  else if (g_previous.sa_handler != SIG_DFL && g_previous.sa_handler != SIG_IGN)
+    {
+      g_previous.sa_handler (signo);
+    }
+  else
+    {
+      // the faulting instruction runs again and gets the default action.
+      sigaction (SIGSEGV, &g_previous, 0);
+    }
+}
+
+void
+CowMemory::SetupSignalHandler (void)
+{
+  static bool alreadySetup = false;
+  if (alreadySetup)
+    {
+      return;
+    }
+  alreadySetup = true;
+  struct sigaction sa;
+  sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+  sigemptyset (&sa.sa_mask);
+  sa.sa_sigaction = &CowMemory::SegfaultHandler;
+  int status = sigaction (SIGSEGV, &sa, &g_previous);
+  if (status == -1)
+    {
+      NS_FATAL_ERROR ("Unable to setup copy on write fault handler");
+    }
+}
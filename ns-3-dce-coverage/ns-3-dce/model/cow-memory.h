@@ -0,0 +1,82 @@
+#ifndef COW_MEMORY_H
+#define COW_MEMORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <signal.h>
+#include <vector>
+
+/**
+ * A range of memory shared by several images (a process and its forks,
+ * or the processes which loaded the same module), only one of which is
+ * mapped at a time.
+ *
+ * Cloning an image copies nothing and its bookkeeping does not depend on
+ * the size of the range: the pages are shared and the pages written since
+ * the last clone are made read only. The first write to a shared page
+ * (trapped through SIGSEGV) gives the writer its own copy of this page.
+ * Switching to another image only saves and restores the pages which
+ * either image wrote since they last shared them.
+ *
+ * Host system calls fail with EFAULT instead of faulting when they write
+ * to a read only page so, the callers which hand a buffer of a process
+ * to the host kernel must call PrepareWrite first.
+ */
+class CowMemory
+{
+public:
+  struct Image;
+
+  // The pages which cover [start, start + size) must not hold anything else.
+  CowMemory (void *start, size_t size);
+  ~CowMemory ();
+
+  // The first image, which owns the current content of the range.
+  Image * Attach (void);
+  Image * Clone (Image *image);
+  void SwitchTo (Image *image);
+  // The content of this image is not needed anymore.
+  void Detach (Image *image);
+  // Returns true when no image is left.
+  bool Release (Image *image);
+
+  // The number of pages saved or restored so far.
+  uint64_t GetCopiedPages (void) const;
+
+  // Give the current images their own copy of the pages of this buffer.
+  static void PrepareWrite (void *buffer, size_t size);
+
+private:
+  struct Layer;
+
+  bool HandleFault (uint8_t *address);
+  void Track (void);
+  void Untrack (void);
+  void Protect (uint32_t first, uint32_t count, int prot);
+  void Protect (const std::vector<uint32_t> &pages, int prot);
+  uint8_t * GetPage (uint32_t index) const;
+  void Save (Layer *layer, uint32_t index);
+
+  static Layer * NewLayer (Layer *parent);
+  static void Unref (Layer *layer);
+  static void Compact (Layer *layer);
+  static Layer * GetOwner (Layer *layer, uint32_t index);
+  static Layer * GetCommonAncestor (Layer *a, Layer *b);
+  static void GetPages (Layer *layer, Layer *ancestor, std::vector<uint32_t> *pages);
+
+  static CowMemory * Lookup (uint8_t *address);
+  static void SegfaultHandler (int signo, siginfo_t *info, void *context);
+  static void SetupSignalHandler (void);
+
+  uint8_t *m_start;
+  uint32_t m_pages;
+  Image *m_current;
+  std::vector<Image *> m_images;
+  // Once an image has been cloned, the layer whose content is in memory:
+  // the top layer of m_current, or of the image detached last.
+  bool m_tracked;
+  Layer *m_memory;
+  uint64_t m_copiedPages;
+};
+
+#endif /* COW_MEMORY_H */
@@ -22,6 +22,7 @@
 #include "sys/dce-stat.h"
 #include "process.h"
 #include "utils.h"
+#include "cow-memory.h"
 #include "ns3/log.h"
 #include "errno.h"
 #include <string.h>
@@ -49,6 +50,7 @@ int dce___fxstatat (int ver, int fd, const char *pathname, struct stat *buf, int
       current->err = ENOENT;
       return -1;
     }
+  CowMemory::PrepareWrite (buf, sizeof (*buf));
   if (fd != AT_FDCWD && pathname[0] != '/')
     {
       int realFd = getRealFd (fd, current);
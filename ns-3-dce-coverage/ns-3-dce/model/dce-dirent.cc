@@ -30,6 +30,8 @@
 #include "ns3/log.h"
 #include "errno.h"
 #include "dce-stdlib.h"
+#include "dce-manager.h"
+#include "memory-file-system.h"
 #include <string.h>
 
 NS_LOG_COMPONENT_DEFINE ("DceDirent");
@@ -50,6 +52,7 @@ remove_dir (DIR *d, Thread *current)
       if (*i == d)
         {
           current->process->openDirs.erase (i);
+          current->process->memoryDirs.erase (d);
           found = true;
           break;
         }
@@ -103,6 +106,61 @@ int dce_internalClosedir (DIR *dirp, struct Thread *cur)
     }
   return ret;
 }
+
+// The files only in memory of the directory, zero if the node has no
+// MemoryFileSystem or the directory was opened by fdopendir.
+static struct MemoryDirectory *
+LookupMemoryDirectory (DIR *dirp, Thread *current)
+{
+  std::map<DIR *, struct MemoryDirectory>::iterator i = current->process->memoryDirs.find (dirp);
+  if (i == current->process->memoryDirs.end ())
+    {
+      return 0;
+    }
+  return &i->second;
+}
+
+// Read the entries of the host directory, without the lower files
+// which the MemoryFileSystem hides, then the files only in memory.
+static int
+ReadMemoryDirectory (DIR *dirp, struct MemoryDirectory *dir, Thread *current,
+                     struct dirent *entry, struct dirent **result)
+{
+  Ptr<MemoryFileSystem> fs = current->process->manager->GetObject<MemoryFileSystem> ();
+  if (dir->next == 0)
+    {
+      int ret;
+      do
+        {
+          ret = readdir_r (dirp, entry, result);
+        }
+      while (ret == 0 && *result != 0 && fs->IsHidden (dir->path + "/" + (*result)->d_name));
+      if (ret != 0 || *result != 0)
+        {
+          return ret;
+        }
+    }
+  while (dir->next < dir->names.size ())
+    {
+      std::string name = dir->names[dir->next++];
+      Ptr<MemoryFile> file = fs->Lookup (dir->path + "/" + name);
+      if (file == 0)
+        {
+          // unlinked since listed.
+          continue;
+        }
+      memset (entry, 0, sizeof (*entry));
+      entry->d_ino = file->ino;
+      entry->d_off = dir->next;
+      entry->d_reclen = sizeof (*entry);
+      entry->d_type = DT_REG;
+      strncpy (entry->d_name, name.c_str (), sizeof (entry->d_name) - 1);
+      *result = entry;
+      return 0;
+    }
+  *result = 0;
+  return 0;
+}
 }
 
 using namespace ns3;
@@ -122,6 +180,15 @@ DIR * dce_opendir (const char *name)
   if (res == 0)
     {
       dce_close (fd);
+      return 0;
+    }
+  Ptr<MemoryFileSystem> fs = current->process->manager->GetObject<MemoryFileSystem> ();
+  if (fs != 0)
+    {
+      struct MemoryDirectory &dir = current->process->memoryDirs[res];
+      dir.path = UtilsGetRealFilePath (name);
+      dir.names = fs->List (dir.path);
+      dir.next = 0;
     }
   return res;
 }
@@ -166,7 +233,21 @@ struct dirent * dce_readdir (DIR *dirp)
       return 0;
     }
   ds->fd = realFd;
-  struct dirent *ret = readdir (dirp);
+  struct dirent *ret;
+  struct MemoryDirectory *dir = LookupMemoryDirectory (dirp, current);
+  if (dir != 0)
+    {
+      int err = ReadMemoryDirectory (dirp, dir, current, &dir->entry, &ret);
+      if (err != 0)
+        {
+          current->err = err;
+          ret = 0;
+        }
+    }
+  else
+    {
+      ret = readdir (dirp);
+    }
   ds->fd = saveFd;
 
   return ret;
@@ -193,7 +274,16 @@ int dce_readdir_r (DIR *dirp, struct dirent *entry, struct dirent **result)
       return -1;
     }
   ds->fd = realFd;
-  int ret = readdir_r (dirp, entry, result);
+  int ret;
+  struct MemoryDirectory *dir = LookupMemoryDirectory (dirp, current);
+  if (dir != 0)
+    {
+      ret = ReadMemoryDirectory (dirp, dir, current, entry, result);
+    }
+  else
+    {
+      ret = readdir_r (dirp, entry, result);
+    }
   ds->fd = saveFd;
 
   return ret;
@@ -234,6 +324,13 @@ void dce_rewinddir (DIR *dirp)
   ds->fd = realFd;
   rewinddir (dirp);
   ds->fd = saveFd;
+  struct MemoryDirectory *dir = LookupMemoryDirectory (dirp, current);
+  if (dir != 0)
+    {
+      Ptr<MemoryFileSystem> fs = current->process->manager->GetObject<MemoryFileSystem> ();
+      dir->names = fs->List (dir->path);
+      dir->next = 0;
+    }
 }
 int dce_scandir (const char *dirp, struct dirent ***namelist,
                  int (*filter)(const struct dirent *),
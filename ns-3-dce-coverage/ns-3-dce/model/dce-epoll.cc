@@ -0,0 +1,159 @@
+#include "sys/dce-epoll.h"
+#include "utils.h"
+#include "process.h"
+#include "unix-epoll-fd.h"
+#include "file-usage.h"
+#include "wait-queue.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+
+NS_LOG_COMPONENT_DEFINE ("DceEpoll");
+
+using namespace ns3;
+
+int dce_epoll_create (int size)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (current << UtilsGetNodeId () << size);
+  NS_ASSERT (current != 0);
+
+  if (size <= 0)
+    {
+      current->err = EINVAL;
+      return -1;
+    }
+  return dce_epoll_create1 (0);
+}
+
+int dce_epoll_create1 (int flags)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (current << UtilsGetNodeId () << flags);
+  NS_ASSERT (current != 0);
+
+  if (flags & ~EPOLL_CLOEXEC)
+    {
+      current->err = EINVAL;
+      return -1;
+    }
+  int fd = UtilsAllocateFd ();
+  if (fd == -1)
+    {
+      current->err = EMFILE;
+      return -1;
+    }
+
+  UnixFd *unixFd = new UnixEpollFd ();
+  unixFd->IncFdCount ();
+  current->process->openFiles[fd] = new FileUsage (fd, unixFd);
+  return fd;
+}
+
+static UnixEpollFd *
+LookupEpollFd (Thread *current, int epfd)
+{
+  if (!CheckFdExists (current->process, epfd, true))
+    {
+      current->err = EBADF;
+      return 0;
+    }
+  UnixEpollFd *epollFd =
+    dynamic_cast<UnixEpollFd *> (current->process->openFiles[epfd]->GetFile ());
+  if (epollFd == 0)
+    {
+      current->err = EINVAL;
+    }
+  return epollFd;
+}
+
+int dce_epoll_ctl (int epfd, int op, int fd, struct epoll_event *event)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (current << UtilsGetNodeId () << epfd << op << fd << event);
+  NS_ASSERT (current != 0);
+
+  UnixEpollFd *epollFd = LookupEpollFd (current, epfd);
+  if (epollFd == 0)
+    {
+      return -1;
+    }
+  if (!CheckFdExists (current->process, fd, true))
+    {
+      current->err = EBADF;
+      return -1;
+    }
+  UnixFd *file = current->process->openFiles[fd]->GetFile ();
+  return epollFd->Ctl (op, fd, file, event);
+}
+
+int dce_epoll_wait (int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (current << UtilsGetNodeId () << epfd << events << maxevents << timeout);
+  NS_ASSERT (current != 0);
+
+  if (maxevents <= 0)
+    {
+      current->err = EINVAL;
+      return -1;
+    }
+  UnixEpollFd *epollFd = LookupEpollFd (current, epfd);
+  if (epollFd == 0)
+    {
+      return -1;
+    }
+  FileUsage *fu = current->process->openFiles[epfd];
+  fu->IncUsage ();
+
+  // Only the ready list of the epoll file is looked at: the interest set
+  // itself is registered once for all by epoll_ctl.
+  int count = epollFd->Collect (events, maxevents);
+  if (count == 0 && timeout != 0)
+    {
+      Time endtime = Now () + MilliSeconds (timeout);
+      PollTable *table = new PollTable ();
+      table->SetEventMask (POLLIN);
+      epollFd->Poll (table);
+      while (count == 0 && !fu->IsClosed ())
+        {
+          WaitPoint::Result res;
+          current->pollTable = table;
+          if (timeout < 0)
+            {
+              res = table->Wait (Seconds (0));
+            }
+          else
+            {
+              Time diff = endtime - Now ();
+              if (!diff.IsStrictlyPositive ())
+                {
+                  current->pollTable = 0;
+                  break;
+                }
+              res = table->Wait (diff);
+            }
+          current->pollTable = 0;
+          count = epollFd->Collect (events, maxevents);
+          if (count == 0 && res == WaitPoint::INTERRUPTED)
+            {
+              current->err = EINTR;
+              count = -1;
+            }
+        }
+      table->FreeWait ();
+      delete table;
+    }
+
+  FdDecUsage (epfd);
+
+  // Try to break infinite loop in epoll_wait with a 0 timeout !
+  if ((0 == count) && (0 == timeout))
+    {
+      UtilsAdvanceTime (current);
+    }
+
+  return count;
+}
@@ -3,6 +3,7 @@
 
 #include <stdarg.h>
 #include <fcntl.h>
+#include <sys/types.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,6 +14,8 @@ int dce_open64 (const char *path, int flags, ...);
 int dce_creat (const char *path, mode_t mode);
 int dce_fcntl (int fd, int cmd, ...);
 int dce_unlinkat (int dirfd, const char *pathname, int flags);
+ssize_t dce_splice (int fd_in, loff_t *off_in, int fd_out, loff_t *off_out,
+                    size_t len, unsigned int flags);
 
 #ifdef __cplusplus
 }
@@ -25,12 +25,17 @@
 #include <linux/rtnetlink.h>
 #include <sys/mman.h>
 #include <sys/types.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
 #include "ns3/node.h"
 #include "local-socket-fd-factory.h"
 #include "ns3-socket-fd-factory.h"
 #include "file-usage.h"
 #include "dce-stdlib.h"
 #include "pipe-fd.h"
+#include "memory-file-system.h"
+#include "unix-memory-file-fd.h"
+#include "cow-memory.h"
 
 NS_LOG_COMPONENT_DEFINE ("SimuFd");
 
@@ -112,22 +117,41 @@ int dce_open (const char *path, int flags, ...)
   else
     {
       std::string fullpath = UtilsGetRealFilePath (path);
+      Ptr<MemoryFileSystem> fs = current->process->manager->GetObject<MemoryFileSystem> ();
 
-      int realFd = ::open (fullpath.c_str (), flags, mode);
-      if (realFd == -1)
+      if (fs != 0)
         {
-          current->err = errno;
-          return -1;
-        }
-
-      if (((2 == fd) || (1 == fd)) && (Current ()->process->minimizeFiles))
-        {
-          unixFd = new UnixFileFdLight (fullpath);
-          close (realFd);
+          int err = 0;
+          Ptr<MemoryFile> file = fs->Open (fullpath, flags, mode & ~(current->process->uMask), &err);
+          if (file != 0)
+            {
+              unixFd = new UnixMemoryFileFd (fs, file, flags);
+            }
+          else if (err != 0)
+            {
+              current->err = err;
+              return -1;
+            }
+          fullpath = fs->GetLowerPath (fullpath);
         }
-      else
+      if (unixFd == 0)
         {
-          unixFd = new UnixFileFd (realFd);
+          int realFd = ::open (fullpath.c_str (), flags, mode);
+          if (realFd == -1)
+            {
+              current->err = errno;
+              return -1;
+            }
+
+          if (((2 == fd) || (1 == fd)) && (Current ()->process->minimizeFiles))
+            {
+              unixFd = new UnixFileFdLight (fullpath);
+              close (realFd);
+            }
+          else
+            {
+              unixFd = new UnixFileFd (realFd);
+            }
         }
     }
   unixFd->IncFdCount ();
@@ -165,7 +189,23 @@ void unlink_notify (std::string fullpath)
 int dce_unlink (const char *pathname)
 {
   NS_LOG_FUNCTION (pathname);
-  int ret = dce_unlink_real (pathname);
+  Thread *current = Current ();
+  Ptr<MemoryFileSystem> fs = current->process->manager->GetObject<MemoryFileSystem> ();
+  int ret = -1;
+
+  if ((fs != 0) && (std::string (pathname) != ""))
+    {
+      ret = fs->Unlink (UtilsGetRealFilePath (pathname));
+      if (ret > 0)
+        {
+          current->err = ret;
+          return -1;
+        }
+    }
+  if (ret == -1)
+    {
+      ret = dce_unlink_real (pathname);
+    }
 
   if (0 == ret)
     {
@@ -187,7 +227,32 @@ int dce_rmdir (const char *pathname)
 }
 int dce_access (const char *pathname, int mode)
 {
-  DEFINE_FORWARDER_PATH (access, pathname, mode);
+  Thread *current = Current ();
+  Ptr<MemoryFileSystem> fs = current->process->manager->GetObject<MemoryFileSystem> ();
+
+  if ((fs == 0) || (std::string (pathname) == ""))
+    {
+      DEFINE_FORWARDER_PATH (access, pathname, mode);
+    }
+  NS_LOG_FUNCTION (current << UtilsGetNodeId () << pathname << mode);
+
+  std::string fullpath = UtilsGetRealFilePath (pathname);
+  if (fs->Lookup (fullpath) != 0)
+    {
+      return 0;
+    }
+  if (fs->IsHidden (fullpath))
+    {
+      current->err = ENOENT;
+      return -1;
+    }
+  int retval = ::access (fs->GetLowerPath (fullpath).c_str (), mode);
+  if (retval == -1)
+    {
+      current->err = errno;
+      return -1;
+    }
+  return retval;
 }
 int dce_close (int fd)
 {
@@ -209,6 +274,7 @@ int dce_close (int fd)
     {
       // If only one process point to file we can really close it
       // else we be closed while the last process close it
+      fu->GetFile ()->ReleasePersistentWaits ();
       retval = fu->GetFile ()->Close ();
     }
   if (fu->CanForget ())
@@ -282,6 +348,19 @@ int dce_ioctl (int fd, long unsigned int request, ...)
   Thread *current = Current ();
   NS_LOG_FUNCTION (current << UtilsGetNodeId () << fd << request << argp);
   NS_ASSERT (current != 0);
+  // copy the pages of the result before it is written instead of
+  // trapping the writes. Its size is in the request, else it is a struct
+  // ifreq for the socket requests and an int for the others (FIONREAD...).
+  size_t size = sizeof (int);
+  if (_IOC_DIR (request) & _IOC_READ)
+    {
+      size = _IOC_SIZE (request);
+    }
+  else if ((request & 0xff00) == 0x8900)
+    {
+      size = sizeof (struct ifreq);
+    }
+  CowMemory::PrepareWrite (argp, size);
 
   OPENED_FD_METHOD (int, Ioctl (request, argp))
 }
@@ -696,11 +775,19 @@ int dce_truncate (const char *path, off_t length)
   int fd = dce_open (path, O_WRONLY, 0);
   if (fd == -1)
     {
-      current->err = errno;
       return -1;
     }
 
-  return dce_ftruncate (fd, length);
+  int retval = dce_ftruncate (fd, length);
+  if (retval == -1)
+    {
+      int err = current->err;
+      dce_close (fd);
+      current->err = err;
+      return -1;
+    }
+  dce_close (fd);
+  return retval;
 }
 
 int dce_ftruncate (int fd, off_t length)
@@ -786,6 +873,40 @@ int dce_pipe (int pipefd[2])
 
   return 0;
 }
+ssize_t dce_splice (int fd_in, loff_t *off_in, int fd_out, loff_t *off_out,
+                    size_t len, unsigned int flags)
+{
+  Thread *current = Current ();
+  NS_ASSERT (current != 0);
+  NS_LOG_FUNCTION (current << UtilsGetNodeId () << fd_in << fd_out << len << flags);
+
+  if (!CheckFdExists (current->process, fd_in, true)
+      || !CheckFdExists (current->process, fd_out, true))
+    {
+      current->err = EBADF;
+      return -1;
+    }
+  // Only pipe to pipe transfers are supported.
+  PipeFd *in = dynamic_cast<PipeFd *> (current->process->openFiles[fd_in]->GetFile ());
+  PipeFd *out = dynamic_cast<PipeFd *> (current->process->openFiles[fd_out]->GetFile ());
+  if ((0 == in) || (0 == out))
+    {
+      current->err = EINVAL;
+      return -1;
+    }
+  if ((0 != off_in) || (0 != off_out))
+    {
+      current->err = ESPIPE;
+      return -1;
+    }
+  current->process->openFiles[fd_in]->IncUsage ();
+  current->process->openFiles[fd_out]->IncUsage ();
+  ssize_t retval = in->Splice (out, len, flags & SPLICE_F_NONBLOCK);
+  FdDecUsage (fd_in);
+  FdDecUsage (fd_out);
+
+  return retval;
+}
 ssize_t dce_pread (int fd, void *buf, size_t count, off_t offset)
 {
   Thread *current = Current ();
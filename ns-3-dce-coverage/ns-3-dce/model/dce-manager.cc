@@ -19,6 +19,7 @@
  */
 #include "dce-manager.h"
 #include "process.h"
+#include "process-log.h"
 #include "task-manager.h"
 #include "libc-dce.h"
 #include "unix-fd.h"
@@ -58,6 +59,7 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 NS_LOG_COMPONENT_DEFINE ("DceManager");
 
@@ -90,6 +92,7 @@ DceManager::GetTypeId (void)
 }
 
 DceManager::DceManager ()
+  : m_nextGeneration (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -102,7 +105,7 @@ DceManager::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
   struct Process *tmp;
-  std::map<uint16_t, Process*> mapCopy = m_processes;
+  std::map<uint16_t, Process*> mapCopy = GetProcs ();
 
   m_processes.clear ();
   for (std::map<uint16_t, Process*>::iterator it = mapCopy.begin (); it != mapCopy.end (); it++)
@@ -110,6 +113,7 @@ DceManager::DoDispose (void)
       tmp = it->second;
       std::string statusWord = "Never ended.";
       AppendStatusFile (tmp->pid, tmp->nodeId, statusWord);
+      ProcessLog::AddRecord (tmp, ProcessLog::NEVER_ENDED);
       DeleteProcess (tmp, PEC_NS3_END);
     }
   mapCopy.clear ();
@@ -119,12 +123,22 @@ DceManager::DoDispose (void)
 struct ::Libc *
 DceManager::GetLibc (void)
 {
-  static struct ::Libc *libc = 0;
+  static struct ::Libc * volatile libc = 0;
   if (libc != 0)
     {
       return libc;
     }
-  libc_dce (&libc);
+  // the first processes may start on several simulation threads.
+  static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  pthread_mutex_lock (&mutex);
+  if (libc == 0)
+    {
+      struct ::Libc *table;
+      libc_dce (&table);
+      __sync_synchronize ();
+      libc = table;
+    }
+  pthread_mutex_unlock (&mutex);
   return libc;
 }
 
@@ -360,7 +374,7 @@ DceManager::CreateProcess (std::string name, std::string stdinfilename, std::vec
 
   if (!pid)
     {
-      m_processes[process->pid] = process;
+      InsertProcess (process);
     }
 
   return process;
@@ -497,19 +511,9 @@ DceManager::AllocatePid (void)
 uint16_t
 DceManager::AllocateTid (const struct Process *process) const
 {
-  for (uint16_t tid = 0; tid < 0xffff; tid++)
+  for (uint32_t tid = 0; tid < 0xffff; tid++)
     {
-      bool found = false;
-      for (std::vector<struct Thread *>::const_iterator i = process->threads.begin (); i != process->threads.end (); ++i)
-        {
-          struct Thread *tmp = *i;
-          if (tmp->tid == tid)
-            {
-              found = true;
-              break;
-            }
-        }
-      if (!found)
+      if (tid >= process->tids.size () || process->tids[tid] == 0)
         {
           return tid;
         }
@@ -527,6 +531,7 @@ DceManager::CreateThread (struct Process *process)
   NS_LOG_DEBUG ("Create " << thread);
   thread->err = 0;
   thread->tid = AllocateTid (process);
+  thread->generation = m_nextGeneration++;
   thread->process = process;
   thread->isDetached = false;
   thread->hasExitValue = false;
@@ -549,6 +554,11 @@ DceManager::CreateThread (struct Process *process)
         }
     }
   process->threads.push_back (thread);
+  if (thread->tid >= process->tids.size ())
+    {
+      process->tids.resize (thread->tid + 1, 0);
+    }
+  process->tids[thread->tid] = thread;
   return thread;
 }
 
@@ -572,17 +582,7 @@ DceManager::ThreadExists (Thread *thread)
 
   Process *process = thread->process;
 
-  for (std::vector<Thread *>::const_iterator j = process->threads.begin ();
-       j != process->threads.end (); ++j)
-    {
-      Thread *cur = *j;
-      if (cur == thread)
-        {
-          return true;
-        }
-    }
-
-  return false;
+  return thread->tid < process->tids.size () && process->tids[thread->tid] == thread;
 }
 
 uint16_t
@@ -644,7 +644,7 @@ DceManager::Clone (Thread *thread)
   clone->rndVariable = CreateObject<UniformRandomVariable> ();
   clone->rndVariable->SetAttribute ("Min", DoubleValue (0));
   clone->rndVariable->SetAttribute ("Max", DoubleValue (RAND_MAX));
-  m_processes[clone->pid] = clone;
+  InsertProcess (clone);
   Thread *cloneThread = CreateThread (clone);
 
   clone->loader = thread->process->loader->Clone ();
@@ -709,6 +709,7 @@ DceManager::Stop (uint16_t pid)
     }
   std::string statusWord = "Stopped by NS3.";
   AppendStatusFile (process->pid, process->nodeId, statusWord);
+  ProcessLog::AddRecord (process, ProcessLog::STOPPED);
   DeleteProcess (process, PEC_NS3_STOP);
 }
 void
@@ -765,6 +766,11 @@ DceManager::DeleteThread (struct Thread *thread)
           break;
         }
     }
+  std::vector<Thread *> &tids = thread->process->tids;
+  if (thread->tid < tids.size () && tids[thread->tid] == thread)
+    {
+      tids[thread->tid] = 0;
+    }
   if (0 != thread->childWaiter)
     {
       Waiter *lb = thread->childWaiter;
@@ -833,6 +839,7 @@ DceManager::DeleteProcess (struct Process *process, ProcessEndCause type)
       dce_internalClosedir (process->openDirs[i], 0);
     }
   process->openDirs.clear ();
+  process->memoryDirs.clear ();
 
   if (!process->finished.IsNull ())
     {
@@ -905,7 +912,7 @@ DceManager::DeleteProcess (struct Process *process, ProcessEndCause type)
               child->ppid = 1;
               if ((child->pid > 1) && !child->loader && !child->alloc)
                 {
-                  m_processes.erase (child->pid);
+                  RemoveProcess (child->pid);
                   delete child;
                 }
             }
@@ -914,6 +921,16 @@ DceManager::DeleteProcess (struct Process *process, ProcessEndCause type)
     }
   delete process->loader;
   process->loader = 0;
+  if (process->alloc)
+    {
+      struct KingsleyAlloc::Statistics stats = process->alloc->GetStatistics ();
+      std::ostringstream oss;
+      oss << "Heap: peak " << stats.peakMapped << " bytes, mapped " << stats.mapped
+          << " bytes, in use " << stats.requested << " bytes, fragmentation "
+          << (process->alloc->GetFragmentation () * 100) << "%";
+      std::string line = oss.str ();
+      AppendStatusFile (process->pid, process->nodeId, line);
+    }
   if (type == PEC_EXIT)
     {
       // Only dispose from good context
@@ -933,7 +950,7 @@ DceManager::DeleteProcess (struct Process *process, ProcessEndCause type)
         {
           // ppid == 0 have no father, perhaps DCE, else ppid = 1 init : have lost it's real father.
           // remove ourselves from list of processes
-          m_processes.erase (process->pid);
+          RemoveProcess (process->pid);
           // delete process data structure.
           delete process;
         }
@@ -957,34 +974,43 @@ DceManager::SearchThread (uint16_t pid, uint16_t tid)
   NS_LOG_FUNCTION (this << pid << tid);
   NS_ASSERT (CheckProcessContext ());
   Process *process = SearchProcess (pid);
-  if (process == 0)
+  if (process == 0 || tid >= process->tids.size ())
     {
       return 0;
     }
-  for (std::vector<Thread *>::const_iterator j = process->threads.begin ();
-       j != process->threads.end (); ++j)
-    {
-      Thread *thread = *j;
-      if (thread->tid == tid)
-        {
-          return thread;
-        }
-    }
-  return 0;
+  return process->tids[tid];
 }
 Process *
 DceManager::SearchProcess (uint16_t pid)
 {
   NS_LOG_FUNCTION (this << pid);
 
-  std::map<uint16_t, Process *>::iterator it = m_processes.find (pid);
-
-  if (it !=  m_processes.end ())
+  if (pid < m_processes.size ())
     {
-      return it->second;
+      return m_processes[pid];
     }
   return 0;
 }
+void
+DceManager::InsertProcess (struct Process *process)
+{
+  NS_LOG_FUNCTION (this << process->pid);
+  if (process->pid >= m_processes.size ())
+    {
+      m_processes.resize (process->pid + 1, 0);
+    }
+  NS_ASSERT (m_processes[process->pid] == 0);
+  m_processes[process->pid] = process;
+}
+void
+DceManager::RemoveProcess (uint16_t pid)
+{
+  NS_LOG_FUNCTION (this << pid);
+  if (pid < m_processes.size ())
+    {
+      m_processes[pid] = 0;
+    }
+}
 
 void
 DceManager::SetArgv (struct Process *process, std::string filename, std::vector<std::string> args)
@@ -1033,23 +1059,7 @@ DceManager::SetEnvp (struct Process *process,
 void
 DceManager::AppendStatusFile (uint16_t pid, uint32_t nodeId,  std::string &line)
 {
-  std::ostringstream oss;
-  oss << "files-" << nodeId << "/var/log/" << pid << "/status";
-  std::string s = oss.str ();
-
-  int fd = ::open (s.c_str (), O_WRONLY | O_APPEND, 0);
-
-  if (fd >= 0) // XXX: When fork is used the pid directory is not created, I plan to fix it when I will work on fork/exec/wait...
-    {
-      oss.str ("");
-      oss.clear ();
-      oss << "      Time: " << GetTimeStamp () << " --> " << line << std::endl;
-      std::string wholeLine = oss.str ();
-      int l =  wholeLine.length ();
-      const char *str = wholeLine.c_str ();
-      ::write (fd, str, l);
-      ::close (fd);
-    }
+  ProcessLog::AddStatus (pid, nodeId, line);
 }
 void
 DceManager::AppendProcFile (Process *p)
@@ -1058,41 +1068,21 @@ DceManager::AppendProcFile (Process *p)
     {
       return;
     }
-  std::ostringstream oss;
-  int fd = ::open ("exitprocs", O_WRONLY | O_APPEND | O_CREAT, 0644);
-
-  if (fd >= 0)
-    {
-      struct stat st;
-      if ((!fstat (fd, &st)) && (0 == st.st_size))
-        {
-          const char *header =  "NODE EXIT-CODE PID NS3-START-TIME NS3-END-TIME REAL-START-TIME REAL-END-TIME NS3-DURATION REAL-DURATION CMDLINE\n";
-
-          ::write (fd, header, strlen (header));
-        }
-
-      oss << p->nodeId
-          << ' ' << p->timing.exitValue
-          << ' ' << p->pid
-          << ' ' <<  p->timing.ns3Start
-          << ' ' <<  p->timing.ns3End
-          << ' ' <<  p->timing.realStart
-          << ' ' <<  p->timing.realEnd
-          << ' ' <<  ((p->timing.ns3End - p->timing.ns3Start) / (double) 1000000000)
-          << ' ' <<  (p->timing.realEnd - p->timing.realStart)
-          << ' ' <<  p->timing.cmdLine  << std::endl;
-      std::string wholeLine = oss.str ();
-      int l =  wholeLine.length ();
-      const char *str = wholeLine.c_str ();
-      ::write (fd, str, l);
-      ::close (fd);
-    }
+  ProcessLog::AddRecord (p, ProcessLog::EXIT);
 }
 
 std::map<uint16_t, Process *>
 DceManager::GetProcs ()
 {
-  return m_processes;
+  std::map<uint16_t, Process *> processes;
+  for (uint32_t pid = 0; pid < m_processes.size (); pid++)
+    {
+      if (m_processes[pid] != 0)
+        {
+          processes[pid] = m_processes[pid];
+        }
+    }
+  return processes;
 }
 
 void
@@ -1111,7 +1101,7 @@ DceManager::ChildFinished (uint16_t pid)
         {
           p->children.erase (it);
         }
-      m_processes.erase (pid);
+      RemoveProcess (pid);
       delete child;
     }
 }
@@ -1139,7 +1129,7 @@ DceManager::FinishChild (uint16_t pid)
   Process *child = SearchProcess (pid);
   if (child)
     {
-      m_processes.erase (pid);
+      RemoveProcess (pid);
       delete child;
     }
 }
@@ -1452,11 +1442,13 @@ DceManager::Execve (const char *path, const char *argv0, char *const argv[], cha
   // save old threads.
   std::vector<Thread *> Oldthreads = process->threads;
   process->threads.clear ();
+  process->tids.clear ();
 
   struct Thread *thread = CreateThread (process);
 
   Task *task = TaskManager::Current ()->Start (&DceManager::DoExecProcess, main,
                                                TaskManager::Current ()->GetStackSize (Current ()->task));
+  task->SetPriority (Current ()->task->GetPriority ());
   task->SetContext (thread);
   task->SetSwitchNotifier (&DceManager::TaskSwitch, process);
   thread->task = task;
@@ -138,6 +138,8 @@ private:
   static void SigkillHandler (int signal);
   static void SigabrtHandler (int signal);
   bool ThreadExists (Thread *thread);
+  void InsertProcess (struct Process *process);
+  void RemoveProcess (uint16_t pid);
   static struct ::Libc * GetLibc (void);
   void SetArgv (struct Process *process, std::string filename, std::vector<std::string> args);
   void SetEnvp (struct Process *process, std::vector<std::pair<std::string,std::string> > envp);
@@ -155,8 +157,9 @@ private:
   static void DoExecProcess (void *c);
   static void SetDefaultSigHandler (std::vector<SignalHandler> &signalHandlers);
 
-  std::map<uint16_t, Process *> m_processes; // Key is the pid
+  std::vector<Process *> m_processes; // indexed by pid, zero when unused.
   uint16_t m_nextPid;
+  uint32_t m_nextGeneration;
   TracedCallback<uint16_t, int> m_processExit;
   // If true close stderr and stdout between writes .
   bool m_minimizeFiles;
@@ -0,0 +1,763 @@
+/* -*-	Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "dce-parallel-simulator-impl.h"
+#include "ns3/simulator.h"
+#include "ns3/system-thread.h"
+#include "ns3/thread-safety.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/channel-list.h"
+#include "ns3/channel.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/uinteger.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/fatal-error.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("DceParallelSimulatorImpl");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DceParallelSimulatorImpl);
+
+struct DceParallelSimulatorImpl::Partition
+{
+  uint32_t id;
+  Ptr<Scheduler> events;
+  uint64_t currentTs;
+  uint32_t currentContext;
+  uint32_t currentUid;
+  uint32_t uid;
+  int unscheduledEvents;
+  // end of the window for the partition, excluded: the end of the
+  // window, or the time at which an event of the partition stopped it.
+  uint64_t windowEnd;
+  // events scheduled during the window for the nodes of the other
+  // partitions, by partition.
+  std::vector<std::vector<struct CrossEvent> > outbox;
+  Ptr<SystemThread> thread;
+  // the next automatic stream of the random variables created by the
+  // events of the partition, and the counter used, zero for the global
+  // one.
+  uint64_t nextStream;
+  uint64_t *streamIndex;
+};
+
+// The partition run by the calling thread.
+static __thread void *g_partition = 0;
+
+TypeId
+DceParallelSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DceParallelSimulatorImpl")
+    .SetParent<SimulatorImpl> ()
+    .AddConstructor<DceParallelSimulatorImpl> ()
+    .AddAttribute ("Threads",
+                   "The number of partitions of the nodes, each run by its own thread.",
+                   TypeId::ATTR_CONSTRUCT,
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&DceParallelSimulatorImpl::m_threads),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Lookahead",
+                   "The length of the windows of simulated time which the partitions run "
+                   "in parallel. Zero to use the smallest Delay of the channels which link "
+                   "nodes of different partitions.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&DceParallelSimulatorImpl::m_lookahead),
+                   MakeTimeChecker (Seconds (0)))
+  ;
+  return tid;
+}
+
+DceParallelSimulatorImpl::DceParallelSimulatorImpl ()
+  : m_threads (1),
+    m_started (false),
+    m_running (false),
+    m_stop (false),
+    m_exit (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+DceParallelSimulatorImpl::~DceParallelSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DceParallelSimulatorImpl::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_started && m_partitions.size () > 1)
+    {
+      m_exit = true;
+      pthread_barrier_wait (&m_barrier);
+      for (uint32_t i = 1; i < m_partitions.size (); i++)
+        {
+          m_partitions[i]->thread->Join ();
+        }
+      pthread_barrier_destroy (&m_barrier);
+    }
+  MergeCrossEvents ();
+  for (std::vector<struct Partition *>::iterator i = m_partitions.begin ();
+       i != m_partitions.end (); ++i)
+    {
+      struct Partition *partition = *i;
+      while (!partition->events->IsEmpty ())
+        {
+          Scheduler::Event next = partition->events->RemoveNext ();
+          next.impl->Unref ();
+        }
+      delete partition;
+    }
+  m_partitions.clear ();
+  SimulatorImpl::DoDispose ();
+}
+
+void
+DceParallelSimulatorImpl::Destroy ()
+{
+  NS_LOG_FUNCTION (this);
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+}
+
+void
+DceParallelSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  NS_LOG_FUNCTION (this << schedulerFactory);
+  NS_ASSERT (!m_running);
+  if (m_partitions.empty ())
+    {
+      for (uint32_t i = 0; i < m_threads; i++)
+        {
+          struct Partition *partition = new Partition ();
+          partition->id = i;
+          // uids are allocated from 4, like in DefaultSimulatorImpl.
+          partition->uid = 4;
+          partition->currentUid = 0;
+          partition->currentTs = 0;
+          partition->currentContext = 0xffffffff;
+          partition->unscheduledEvents = 0;
+          partition->windowEnd = 0;
+          partition->outbox.resize (m_threads);
+          // with several threads, the streams of a partition do not depend
+          // on when the other partitions run.
+          partition->nextStream = (uint64_t)(i + 1) << 48;
+          partition->streamIndex = m_threads > 1 ? &partition->nextStream : 0;
+          m_partitions.push_back (partition);
+        }
+    }
+  for (std::vector<struct Partition *>::iterator i = m_partitions.begin ();
+       i != m_partitions.end (); ++i)
+    {
+      Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler> ();
+      if ((*i)->events != 0)
+        {
+          while (!(*i)->events->IsEmpty ())
+            {
+              scheduler->Insert ((*i)->events->RemoveNext ());
+            }
+        }
+      (*i)->events = scheduler;
+    }
+}
+
+void
+DceParallelSimulatorImpl::SetPartition (uint32_t nodeId, uint32_t partition)
+{
+  NS_LOG_FUNCTION (this << nodeId << partition);
+  NS_ASSERT_MSG (!m_started, "The partitions are fixed by the first Run");
+  NS_ASSERT (partition < m_partitions.size ());
+  if (nodeId >= m_nodePartitions.size ())
+    {
+      m_nodePartitions.resize (nodeId + 1, -1);
+    }
+  m_nodePartitions[nodeId] = partition;
+}
+
+uint32_t
+DceParallelSimulatorImpl::GetPartition (uint32_t context) const
+{
+  if (context < m_nodePartitions.size () && m_nodePartitions[context] >= 0)
+    {
+      return m_nodePartitions[context];
+    }
+  if (context == 0xffffffff)
+    {
+      return 0;
+    }
+  return context % m_partitions.size ();
+}
+
+uint32_t
+DceParallelSimulatorImpl::GetNPartitions (void) const
+{
+  return m_partitions.size ();
+}
+
+Time
+DceParallelSimulatorImpl::GetLookahead (void) const
+{
+  return m_lookahead;
+}
+
+void *
+DceParallelSimulatorImpl::GetThreadPartition (void)
+{
+  return g_partition;
+}
+
+void
+DceParallelSimulatorImpl::SetThreadPartition (void *partition)
+{
+  g_partition = partition;
+  struct Partition *p = (struct Partition *)partition;
+  RngSeedManager::SetThreadStreamIndex (p != 0 ? p->streamIndex : 0);
+}
+
+struct DceParallelSimulatorImpl::Partition *
+DceParallelSimulatorImpl::Current (void) const
+{
+  struct Partition *partition = (struct Partition *)g_partition;
+  if (partition != 0)
+    {
+      return partition;
+    }
+  NS_ASSERT_MSG (!m_running, "Simulator called from a thread which runs no partition");
+  // the main thread, out of Run.
+  return m_partitions[0];
+}
+
+struct DceParallelSimulatorImpl::Partition *
+DceParallelSimulatorImpl::Owner (uint32_t context) const
+{
+  if (!m_started)
+    {
+      return m_partitions[0];
+    }
+  return m_partitions[GetPartition (context)];
+}
+
+uint32_t
+DceParallelSimulatorImpl::Insert (struct Partition *partition, uint64_t ts,
+                                  uint32_t context, EventImpl *event)
+{
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = ts;
+  ev.key.m_context = context;
+  ev.key.m_uid = partition->uid;
+  partition->uid++;
+  partition->unscheduledEvents++;
+  partition->events->Insert (ev);
+  return ev.key.m_uid;
+}
+
+// System ID for non-distributed simulation is always zero
+uint32_t
+DceParallelSimulatorImpl::GetSystemId (void) const
+{
+  return 0;
+}
+
+void
+DceParallelSimulatorImpl::ComputeLookahead (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_lookahead.IsZero ())
+    {
+      return;
+    }
+  // without link between the partitions, a window runs everything.
+  m_lookahead = GetMaximumSimulationTime ();
+  for (uint32_t i = 0; i < ChannelList::GetNChannels (); i++)
+    {
+      Ptr<Channel> channel = ChannelList::GetChannel (i);
+      std::vector<uint32_t> partitions;
+      for (uint32_t j = 0; j < channel->GetNDevices (); j++)
+        {
+          Ptr<NetDevice> device = channel->GetDevice (j);
+          if (device != 0 && device->GetNode () != 0)
+            {
+              partitions.push_back (GetPartition (device->GetNode ()->GetId ()));
+            }
+        }
+      std::sort (partitions.begin (), partitions.end ());
+      if (partitions.empty () || partitions.front () == partitions.back ())
+        {
+          continue;
+        }
+      struct TypeId::AttributeInformation info;
+      if (!channel->GetInstanceTypeId ().LookupAttributeByName ("Delay", &info))
+        {
+          NS_FATAL_ERROR ("Channel " << channel->GetInstanceTypeId ().GetName ()
+                                     << " links partitions but has no Delay: set the "
+                                     "Lookahead of DceParallelSimulatorImpl");
+        }
+      TimeValue delay;
+      channel->GetAttribute ("Delay", delay);
+      m_lookahead = std::min (m_lookahead, delay.Get ());
+    }
+  if (!m_lookahead.IsStrictlyPositive ())
+    {
+      NS_FATAL_ERROR ("A channel without delay links partitions: nothing can run in parallel");
+    }
+  NS_LOG_DEBUG ("lookahead=" << m_lookahead);
+}
+
+void
+DceParallelSimulatorImpl::Start (void)
+{
+  NS_LOG_FUNCTION (this << m_partitions.size ());
+  m_started = true;
+  if (m_partitions.size () > 1)
+    {
+      ComputeLookahead ();
+    }
+  else
+    {
+      m_lookahead = GetMaximumSimulationTime ();
+    }
+  // the first partition kept the events scheduled so far.
+  struct Partition *first = m_partitions[0];
+  std::vector<Scheduler::Event> events;
+  while (!first->events->IsEmpty ())
+    {
+      events.push_back (first->events->RemoveNext ());
+    }
+  first->unscheduledEvents -= events.size ();
+  for (std::vector<Scheduler::Event>::const_iterator i = events.begin (); i != events.end (); ++i)
+    {
+      struct Partition *partition = Owner (i->key.m_context);
+      partition->events->Insert (*i);
+      partition->unscheduledEvents++;
+    }
+  for (std::vector<struct Partition *>::iterator i = m_partitions.begin ();
+       i != m_partitions.end (); ++i)
+    {
+      // the uids of the events which moved stay unique.
+      (*i)->uid = first->uid;
+    }
+  if (m_partitions.size () == 1)
+    {
+      return;
+    }
+  ThreadSafety::Enable ();
+  pthread_barrier_init (&m_barrier, 0, m_partitions.size ());
+  for (uint32_t i = 1; i < m_partitions.size (); i++)
+    {
+      struct Partition *partition = m_partitions[i];
+      partition->thread = Create<SystemThread> (MakeCallback (&DceParallelSimulatorImpl::Worker, this)
+                                                .Bind (partition));
+      partition->thread->Start ();
+    }
+}
+
+void
+DceParallelSimulatorImpl::ProcessOneEvent (struct Partition *partition)
+{
+  Scheduler::Event next = partition->events->RemoveNext ();
+
+  NS_ASSERT (next.key.m_ts >= partition->currentTs);
+  partition->unscheduledEvents--;
+
+  NS_LOG_LOGIC ("handle " << next.key.m_ts);
+  partition->currentTs = next.key.m_ts;
+  partition->currentContext = next.key.m_context;
+  partition->currentUid = next.key.m_uid;
+  next.impl->Invoke ();
+  next.impl->Unref ();
+}
+
+void
+DceParallelSimulatorImpl::RunWindow (struct Partition *partition)
+{
+  while (!partition->events->IsEmpty ()
+         && partition->events->PeekNext ().key.m_ts < partition->windowEnd)
+    {
+      ProcessOneEvent (partition);
+    }
+}
+
+void
+DceParallelSimulatorImpl::Worker (struct Partition *partition)
+{
+  NS_LOG_FUNCTION (this << partition->id);
+  SetThreadPartition (partition);
+  while (true)
+    {
+      pthread_barrier_wait (&m_barrier);
+      if (m_exit)
+        {
+          break;
+        }
+      RunWindow (partition);
+      pthread_barrier_wait (&m_barrier);
+    }
+  SetThreadPartition (0);
+}
+
+void
+DceParallelSimulatorImpl::MergeCrossEvents (void)
+{
+  // the order depends on the partitions, not on the threads.
+  for (uint32_t to = 0; to < m_partitions.size (); to++)
+    {
+      for (uint32_t from = 0; from < m_partitions.size (); from++)
+        {
+          std::vector<struct CrossEvent> &events = m_partitions[from]->outbox[to];
+          for (std::vector<struct CrossEvent>::const_iterator i = events.begin ();
+               i != events.end (); ++i)
+            {
+              Insert (m_partitions[to], i->ts, i->context, i->event);
+            }
+          events.clear ();
+        }
+    }
+}
+
+bool
+DceParallelSimulatorImpl::IsFinished (void) const
+{
+  if (m_stop)
+    {
+      return true;
+    }
+  for (std::vector<struct Partition *>::const_iterator i = m_partitions.begin ();
+       i != m_partitions.end (); ++i)
+    {
+      if (!(*i)->events->IsEmpty ())
+        {
+          return false;
+        }
+      for (uint32_t j = 0; j < (*i)->outbox.size (); j++)
+        {
+          if (!(*i)->outbox[j].empty ())
+            {
+              return false;
+            }
+        }
+    }
+  return true;
+}
+
+void
+DceParallelSimulatorImpl::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_started)
+    {
+      Start ();
+    }
+  m_stop = false;
+  m_running = true;
+  SetThreadPartition (m_partitions[0]);
+  uint64_t maxTs = GetMaximumSimulationTime ().GetTimeStep ();
+  uint64_t lookahead = m_lookahead.GetTimeStep ();
+  // the time the partitions reached.
+  uint64_t end = 0;
+  bool endKnown = false;
+  while (true)
+    {
+      MergeCrossEvents ();
+      if (m_stop)
+        {
+          break;
+        }
+      bool empty = true;
+      uint64_t next = 0;
+      for (std::vector<struct Partition *>::const_iterator i = m_partitions.begin ();
+           i != m_partitions.end (); ++i)
+        {
+          if (!(*i)->events->IsEmpty ())
+            {
+              uint64_t ts = (*i)->events->PeekNext ().key.m_ts;
+              next = empty ? ts : std::min (next, ts);
+              empty = false;
+            }
+        }
+      if (empty)
+        {
+          break;
+        }
+      uint64_t windowEnd = next >= maxTs - lookahead ? maxTs : next + lookahead;
+      if (!m_stopTimes.empty ())
+        {
+          uint64_t stop = *m_stopTimes.begin ();
+          if (next >= stop)
+            {
+              m_stopTimes.erase (m_stopTimes.begin ());
+              end = stop;
+              endKnown = true;
+              break;
+            }
+          windowEnd = std::min (windowEnd, stop);
+        }
+      // the barrier publishes it to the other threads.
+      for (std::vector<struct Partition *>::iterator i = m_partitions.begin ();
+           i != m_partitions.end (); ++i)
+        {
+          (*i)->windowEnd = windowEnd;
+        }
+      if (m_partitions.size () == 1)
+        {
+          RunWindow (m_partitions[0]);
+        }
+      else
+        {
+          pthread_barrier_wait (&m_barrier);
+          RunWindow (m_partitions[0]);
+          pthread_barrier_wait (&m_barrier);
+        }
+    }
+  if (!m_stop && !endKnown)
+    {
+      // no event left: like with DefaultSimulatorImpl, the time is the
+      // time of the last event.
+      for (std::vector<struct Partition *>::const_iterator i = m_partitions.begin ();
+           i != m_partitions.end (); ++i)
+        {
+          end = std::max (end, (*i)->currentTs);
+        }
+      endKnown = true;
+    }
+  if (endKnown)
+    {
+      // the partitions which ran ahead stopped earlier: move their clock
+      // to the end, before their next events.
+      for (std::vector<struct Partition *>::iterator i = m_partitions.begin ();
+           i != m_partitions.end (); ++i)
+        {
+          if ((*i)->currentTs < end)
+            {
+              (*i)->currentTs = end;
+              (*i)->currentUid = 0;
+            }
+        }
+    }
+  SetThreadPartition (0);
+  m_running = false;
+
+  // If the simulator stopped naturally by lack of events, make a
+  // consistency test to check that we didn't lose any events along the way.
+  for (std::vector<struct Partition *>::const_iterator i = m_partitions.begin ();
+       i != m_partitions.end (); ++i)
+    {
+      NS_ASSERT (!(*i)->events->IsEmpty () || (*i)->unscheduledEvents == 0);
+    }
+}
+
+void
+DceParallelSimulatorImpl::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  // the partition stops after this event, the others at the barrier.
+  struct Partition *partition = Current ();
+  partition->windowEnd = partition->currentTs;
+  CriticalSection cs (m_mutex);
+  m_stop = true;
+}
+
+void
+DceParallelSimulatorImpl::Stop (Time const &delay)
+{
+  NS_LOG_FUNCTION (this << delay.GetTimeStep ());
+  struct Partition *partition = Current ();
+  uint64_t ts = partition->currentTs + delay.GetTimeStep ();
+  // below the lookahead, the window of the partition ends at the stop;
+  // only its own thread reads it during the window.
+  partition->windowEnd = std::min (partition->windowEnd, ts);
+  CriticalSection cs (m_mutex);
+  m_stopTimes.insert (ts);
+}
+
+EventId
+DceParallelSimulatorImpl::Schedule (Time const &delay, EventImpl *event)
+{
+  struct Partition *partition = Current ();
+  Time tAbsolute = delay + TimeStep (partition->currentTs);
+
+  NS_ASSERT (tAbsolute.IsPositive ());
+  NS_ASSERT (tAbsolute >= TimeStep (partition->currentTs));
+  uint64_t ts = tAbsolute.GetTimeStep ();
+  uint32_t uid = Insert (partition, ts, partition->currentContext, event);
+  return EventId (event, ts, partition->currentContext, uid);
+}
+
+void
+DceParallelSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &delay, EventImpl *event)
+{
+  struct Partition *from = Current ();
+  struct Partition *to = Owner (context);
+  uint64_t ts = from->currentTs + delay.GetTimeStep ();
+  if (to == from)
+    {
+      Insert (from, ts, context, event);
+    }
+  else if (!m_running)
+    {
+      // from the main thread, out of Run: since a Stop, the clock of the
+      // other partition may be ahead.
+      Insert (to, std::max (ts, to->currentTs), context, event);
+    }
+  else
+    {
+      if (delay < m_lookahead)
+        {
+          NS_FATAL_ERROR ("Event scheduled for node " << context << " in " << delay
+                                                      << ", below the lookahead " << m_lookahead
+                                                      << " of its partition");
+        }
+      struct CrossEvent cross;
+      cross.ts = ts;
+      cross.context = context;
+      cross.event = event;
+      from->outbox[to->id].push_back (cross);
+    }
+}
+
+EventId
+DceParallelSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  return Schedule (TimeStep (0), event);
+}
+
+EventId
+DceParallelSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  CriticalSection cs (m_mutex);
+  EventId id (Ptr<EventImpl> (event, false), Current ()->currentTs, 0xffffffff, 2);
+  m_destroyEvents.push_back (id);
+  return id;
+}
+
+Time
+DceParallelSimulatorImpl::Now (void) const
+{
+  // Do not add function logging here, to avoid stack overflow
+  return TimeStep (Current ()->currentTs);
+}
+
+Time
+DceParallelSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  else
+    {
+      return TimeStep (id.GetTs () - Current ()->currentTs);
+    }
+}
+
+void
+DceParallelSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      CriticalSection cs (m_mutex);
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      return;
+    }
+  if (IsExpired (id))
+    {
+      return;
+    }
+  struct Partition *partition = Owner (id.GetContext ());
+  if (m_running && partition != g_partition)
+    {
+      // the scheduler of another partition is busy: the event stays
+      // there, cancelled.
+      id.PeekEventImpl ()->Cancel ();
+      return;
+    }
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_context = id.GetContext ();
+  event.key.m_uid = id.GetUid ();
+  partition->events->Remove (event);
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+
+  partition->unscheduledEvents--;
+}
+
+void
+DceParallelSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+DceParallelSimulatorImpl::IsExpired (const EventId &id) const
+{
+  if (id.GetUid () == 2)
+    {
+      if (id.PeekEventImpl () == 0
+          || id.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      CriticalSection cs (m_mutex);
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+  // an event is checked against the clock of the partition which runs it.
+  const struct Partition *partition = Owner (id.GetContext ());
+  if (id.PeekEventImpl () == 0
+      || id.GetTs () < partition->currentTs
+      || (id.GetTs () == partition->currentTs
+          && id.GetUid () <= partition->currentUid)
+      || id.PeekEventImpl ()->IsCancelled ())
+    {
+      return true;
+    }
+  else
+    {
+      return false;
+    }
+}
+
+Time
+DceParallelSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  return TimeStep (0x7fffffffffffffffLL);
+}
+
+uint32_t
+DceParallelSimulatorImpl::GetContext (void) const
+{
+  return Current ()->currentContext;
+}
+
+} // namespace ns3
@@ -0,0 +1,147 @@
+/* -*-	Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef DCE_PARALLEL_SIMULATOR_IMPL_H
+#define DCE_PARALLEL_SIMULATOR_IMPL_H
+
+#include "ns3/simulator-impl.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/object-factory.h"
+#include "ns3/system-mutex.h"
+#include "ns3/nstime.h"
+#include <pthread.h>
+#include <vector>
+#include <list>
+#include <set>
+
+namespace ns3 {
+
+/**
+ * \brief Simulator which runs the events of independent nodes on several
+ * threads.
+ *
+ * The nodes are split in partitions, one per thread (node i goes to
+ * partition i % Threads unless SetPartition says otherwise). Each
+ * partition has its own scheduler and clock, and runs the events of its
+ * nodes, their TaskManager and the fibers of their processes, on its
+ * own thread.
+ *
+ * Like DistributedSimulatorImpl, the synchronization is conservative:
+ * the partitions meet at a barrier, and the next window of simulated
+ * time is [t, t + lookahead[, where t is the earliest event of all the
+ * partitions. During a window, each partition runs its events of the
+ * window alone. An event scheduled for a node of another partition must
+ * be at least lookahead ahead: it is kept aside and given to the other
+ * partition at the next barrier, in a deterministic order. The
+ * lookahead is the Lookahead attribute or, by default, the smallest
+ * Delay attribute of the channels which link nodes of different
+ * partitions.
+ *
+ * Set "SimulatorImplementationType" to "ns3::DceParallelSimulatorImpl"
+ * to use it, and Threads before the simulator is created. With one
+ * thread, it behaves like DefaultSimulatorImpl. With more, it enables
+ * ThreadSafety, and the simultaneous events of a node are ordered as in
+ * DefaultSimulatorImpl except those which come from other partitions.
+ * The random variables created by the events of a partition then number
+ * their automatic streams from a block of the partition (see
+ * RngSeedManager::SetThreadStreamIndex), so that a run does not depend
+ * on the order in which the threads run.
+ *
+ * Stop, or Stop with a delay below the lookahead, called by an event
+ * stops the partition of the event at once: it runs none of its events
+ * of the window from the time of the stop. The other partitions cannot
+ * see the stop before the barrier, so they end the window whatever the
+ * order of the threads, and Run returns at the barrier.
+ *
+ * Before the first Run, all the events are kept by the first partition,
+ * which also runs the events without node (the context 0xffffffff) and
+ * the calls made out of Run from the main thread.
+ */
+class DceParallelSimulatorImpl : public SimulatorImpl
+{
+public:
+  static TypeId GetTypeId (void);
+
+  DceParallelSimulatorImpl ();
+  virtual ~DceParallelSimulatorImpl ();
+
+  // Run the events of the node in the partition. Must be called before
+  // the first Run.
+  void SetPartition (uint32_t nodeId, uint32_t partition);
+  // The partition which runs the events of the context.
+  uint32_t GetPartition (uint32_t context) const;
+  uint32_t GetNPartitions (void) const;
+  // The length of the windows, known from the first Run.
+  Time GetLookahead (void) const;
+
+  // The partition whose events the calling thread runs, zero if the
+  // thread runs no simulation event. The threads which run code on behalf
+  // of a partition (the threads of the pthread fibers) take it from the
+  // thread which wakes them up.
+  static void * GetThreadPartition (void);
+  static void SetThreadPartition (void *partition);
+
+  // Inherited
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual void Stop (void);
+  virtual void Stop (Time const &delay);
+  virtual EventId Schedule (Time const &delay, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, Time const &delay, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &id);
+  virtual void Cancel (const EventId &id);
+  virtual bool IsExpired (const EventId &id) const;
+  virtual void Run (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+
+private:
+  struct Partition;
+  struct CrossEvent
+  {
+    uint64_t ts;
+    uint32_t context;
+    EventImpl *event;
+  };
+
+  virtual void DoDispose (void);
+  struct Partition * Current (void) const;
+  struct Partition * Owner (uint32_t context) const;
+  uint32_t Insert (struct Partition *partition, uint64_t ts, uint32_t context, EventImpl *event);
+  void ProcessOneEvent (struct Partition *partition);
+  void RunWindow (struct Partition *partition);
+  void Worker (struct Partition *partition);
+  void Start (void);
+  void ComputeLookahead (void);
+  void MergeCrossEvents (void);
+
+  uint32_t m_threads;
+  Time m_lookahead;
+  std::vector<struct Partition *> m_partitions;
+  // partition of each node, -1 for the default one.
+  std::vector<int32_t> m_nodePartitions;
+  // the partitions are distributed and the threads started.
+  bool m_started;
+  // Run is running: the partitions may run on their threads.
+  bool m_running;
+  // Stop was called: Run returns at the next barrier.
+  bool m_stop;
+  // Run returns when the partitions reach the first of these times
+  // (Stop with a delay).
+  std::multiset<uint64_t> m_stopTimes;
+  bool m_exit;
+  pthread_barrier_t m_barrier;
+
+  typedef std::list<EventId> DestroyEvents;
+  DestroyEvents m_destroyEvents;
+  mutable SystemMutex m_mutex; // destroy events, m_stop and stop times.
+};
+
+} // namespace ns3
+
+#endif /* DCE_PARALLEL_SIMULATOR_IMPL_H */
@@ -33,14 +33,32 @@ PthreadToPid (pthread_t thread_handle)
   return thread_handle & 0xffff;
 }
 
+// When pthread_t is large enough, the generation of the thread is kept
+// in the upper bits so that a stale handle whose tid was reused is
+// detected.
 static pthread_t
-PidTidToPthread (uint16_t pid, uint16_t tid)
+PidTidToPthread (uint16_t pid, uint16_t tid, uint32_t generation)
 {
   NS_ASSERT (sizeof (pthread_t) >= 4);
-  uint32_t th = tid;
+  uint64_t th = generation;
+  th <<= 16;
+  th |= tid;
   th <<= 16;
   th |= pid;
-  return th;
+  return (pthread_t)th;
+}
+
+static Thread *
+PthreadToThread (Thread *current, pthread_t thread_handle)
+{
+  Thread *thread = current->process->manager->SearchThread (PthreadToPid (thread_handle),
+                                                            PthreadToTid (thread_handle));
+  if (thread == 0
+      || PidTidToPthread (thread->process->pid, thread->tid, thread->generation) != thread_handle)
+    {
+      return 0;
+    }
+  return thread;
 }
 
 static void
@@ -133,13 +151,14 @@ int dce_pthread_create (pthread_t *thread_handle,
   NS_LOG_FUNCTION (current << UtilsGetNodeId () << arg);
   NS_ASSERT (current != 0);
   Thread *thread = current->process->manager->CreateThread (current->process);
-  *thread_handle = PidTidToPthread (thread->process->pid, thread->tid);
+  *thread_handle = PidTidToPthread (thread->process->pid, thread->tid, thread->generation);
   TaskManager *manager = TaskManager::Current ();
   PthreadStartContext *startContext = new PthreadStartContext ();
   startContext->start_routine = start_routine;
   startContext->arg = arg;
   uint32_t mainStackSize = manager->GetStackSize (current->process->threads[0]->task);
   Task *task = manager->Start (&pthread_do_start, startContext, mainStackSize);
+  task->SetPriority (current->task->GetPriority ());
   task->SetContext (thread);
   task->SetSwitchNotifier (&PthreadTaskSwitch, current->process);
   thread->task = task;
@@ -189,8 +208,7 @@ int dce_pthread_join (pthread_t thread_handle, void **value_ptr)
       return EDEADLK;
     }
 
-  Thread *thread = current->process->manager->SearchThread (PthreadToPid (thread_handle),
-                                                            PthreadToTid (thread_handle));
+  Thread *thread = PthreadToThread (current, thread_handle);
   if (thread == 0)
     {
       return ESRCH;
@@ -224,8 +242,7 @@ int dce_pthread_detach (pthread_t thread_handle)
   Thread *current = Current ();
   NS_LOG_FUNCTION (current << UtilsGetNodeId () << PthreadToPid (thread_handle) << PthreadToTid (thread_handle));
   NS_ASSERT (current != 0);
-  Thread *thread = current->process->manager->SearchThread (PthreadToPid (thread_handle),
-                                                            PthreadToTid (thread_handle));
+  Thread *thread = PthreadToThread (current, thread_handle);
   if (thread == 0)
     {
       return ESRCH;
@@ -254,7 +271,7 @@ pthread_t dce_pthread_self (void)
   Thread *current = Current ();
   NS_LOG_FUNCTION (current << UtilsGetNodeId ());
   NS_ASSERT (current != 0);
-  return PidTidToPthread (current->process->pid, current->tid);
+  return PidTidToPthread (current->process->pid, current->tid, current->generation);
 }
 
 int dce_pthread_once (pthread_once_t *once_control, void (*init_routine)(void))
@@ -384,12 +401,15 @@ int dce_pthread_kill (pthread_t th, int sig)
   Thread *current = Current ();
   NS_LOG_FUNCTION (current << UtilsGetNodeId () << PthreadToPid (th) << PthreadToTid (th) << sig);
   NS_ASSERT (current != 0);
-  Thread *thread = current->process->manager->SearchThread (PthreadToPid (th),
-                                                            PthreadToTid (th));
+  Thread *thread = PthreadToThread (current, th);
   if (thread == 0)
     {
       return ESRCH;
     }
+  if (sig == 0)
+    {
+      return 0;
+    }
 
   sigaddset (&thread->pendingSignals, sig);
   if (sigismember (&thread->signalMask, sig) == 0)
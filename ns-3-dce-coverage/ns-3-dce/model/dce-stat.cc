@@ -7,11 +7,42 @@
 #include "ns3/assert.h"
 #include <errno.h>
 #include "file-usage.h"
+#include "dce-manager.h"
+#include "memory-file-system.h"
+#include "cow-memory.h"
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("SimuStat");
 
+// Look path up in the in memory file system of the node if any.
+// Return 1 if buf was filled, -1 on error, or 0 if the host must be
+// asked for realPath.
+template <typename S>
+static int
+MemoryStat (Thread *current, const char *path, S *buf, std::string *realPath)
+{
+  *realPath = UtilsGetRealFilePath (path);
+  Ptr<MemoryFileSystem> fs = current->process->manager->GetObject<MemoryFileSystem> ();
+  if (fs == 0)
+    {
+      return 0;
+    }
+  Ptr<MemoryFile> file = fs->Lookup (*realPath);
+  if (file != 0)
+    {
+      file->Stat (buf);
+      return 1;
+    }
+  if (fs->IsHidden (*realPath))
+    {
+      current->err = ENOENT;
+      return -1;
+    }
+  *realPath = fs->GetLowerPath (*realPath);
+  return 0;
+}
+
 int dce___xstat (int ver, const char *path, struct stat *buf)
 {
   Thread *current = Current ();
@@ -22,7 +53,14 @@ int dce___xstat (int ver, const char *path, struct stat *buf)
       current->err = ENOENT;
       return -1;
     }
-  int retval = ::__xstat (ver, UtilsGetRealFilePath (path).c_str (), buf);
+  std::string realPath;
+  int found = MemoryStat (current, path, buf, &realPath);
+  if (found != 0)
+    {
+      return (found > 0) ? 0 : -1;
+    }
+  CowMemory::PrepareWrite (buf, sizeof (*buf));
+  int retval = ::__xstat (ver, realPath.c_str (), buf);
   if (retval == -1)
     {
       current->err = errno;
@@ -40,7 +78,14 @@ int dce___xstat64 (int ver, const char *path, struct stat64 *buf)
       current->err = ENOENT;
       return -1;
     }
-  int retval = ::__xstat64 (ver, UtilsGetRealFilePath (path).c_str (), buf);
+  std::string realPath;
+  int found = MemoryStat (current, path, buf, &realPath);
+  if (found != 0)
+    {
+      return (found > 0) ? 0 : -1;
+    }
+  CowMemory::PrepareWrite (buf, sizeof (*buf));
+  int retval = ::__xstat64 (ver, realPath.c_str (), buf);
   if (retval == -1)
     {
       current->err = errno;
@@ -74,7 +119,14 @@ int dce___lxstat (int ver, const char *pathname, struct stat *buf)
       current->err = ENOENT;
       return -1;
     }
-  int retval = ::__lxstat (ver, UtilsGetRealFilePath (pathname).c_str (), buf);
+  std::string realPath;
+  int found = MemoryStat (current, pathname, buf, &realPath);
+  if (found != 0)
+    {
+      return (found > 0) ? 0 : -1;
+    }
+  CowMemory::PrepareWrite (buf, sizeof (*buf));
+  int retval = ::__lxstat (ver, realPath.c_str (), buf);
   if (retval == -1)
     {
       current->err = errno;
@@ -92,7 +144,14 @@ int dce___lxstat64 (int ver, const char *pathname, struct stat64 *buf)
       current->err = ENOENT;
       return -1;
     }
-  int retval = ::__lxstat64 (ver, UtilsGetRealFilePath (pathname).c_str (), buf);
+  std::string realPath;
+  int found = MemoryStat (current, pathname, buf, &realPath);
+  if (found != 0)
+    {
+      return (found > 0) ? 0 : -1;
+    }
+  CowMemory::PrepareWrite (buf, sizeof (*buf));
+  int retval = ::__lxstat64 (ver, realPath.c_str (), buf);
   if (retval == -1)
     {
       current->err = errno;
@@ -7,6 +7,8 @@
 #include "process.h"
 #include "utils.h"
 #include "unix-fd.h"
+#include "dce-manager.h"
+#include "memory-file-system.h"
 #include "ns3/log.h"
 #include <errno.h>
 #include <fcntl.h>
@@ -697,6 +699,20 @@ int dce_remove (const char *pathname)
       return -1;
     }
   std::string fullpath = UtilsGetRealFilePath (pathname);
+  Ptr<MemoryFileSystem> fs = current->process->manager->GetObject<MemoryFileSystem> ();
+  if (fs != 0)
+    {
+      int err = fs->Unlink (fullpath);
+      if (err == 0)
+        {
+          return 0;
+        }
+      if (err > 0)
+        {
+          current->err = err;
+          return -1;
+        }
+    }
   int status = ::remove (fullpath.c_str ());
   if (status == -1)
     {
@@ -5,6 +5,7 @@
 #include "unix-fd.h"
 #include "unix-file-fd.h"
 #include "file-usage.h"
+#include "memory-file-system.h"
 #include "ns3/log.h"
 #include <errno.h>
 #include <limits.h>
@@ -132,6 +133,21 @@ int dce_rename (const char *oldpath, const char *newpath)
   std::string oldFullpath = UtilsGetRealFilePath (oldpath);
   std::string newFullpath = UtilsGetRealFilePath (newpath);
 
+  Ptr<MemoryFileSystem> fs = current->process->manager->GetObject<MemoryFileSystem> ();
+  if (fs != 0)
+    {
+      int err = fs->Rename (oldFullpath, newFullpath);
+      if (err == 0)
+        {
+          return 0;
+        }
+      if (err > 0)
+        {
+          current->err = err;
+          return -1;
+        }
+    }
+
   int ret = rename (oldFullpath.c_str (), newFullpath.c_str ());
   if (ret == -1)
     {
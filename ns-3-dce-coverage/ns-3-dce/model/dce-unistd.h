@@ -37,6 +37,7 @@ int dce_setresgid (gid_t rgid, gid_t egid, gid_t sgid);
 
 int dce_isatty (int desc);
 char* dce_ttyname (int fd);
+int dce_nice (int inc);
 char * dce_getcwd (char *buf, size_t size);
 char * dce_getwd (char *buf);
 char * dce_get_current_dir_name (void);
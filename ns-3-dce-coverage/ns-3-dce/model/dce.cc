@@ -16,6 +16,7 @@
 #include "dce-locale.h"
 #include "sys/dce-ioctl.h"
 #include "dce-sched.h"
+#include "sys/dce-resource.h"
 #include "arpa/dce-inet.h"
 #include <stdlib.h>
 #include <string.h>
@@ -24,7 +25,9 @@
 #include <fcntl.h>
 #include <net/if.h>
 #include <sys/ioctl.h>
+#include <algorithm>
 #include "dce-random.h"
+#include "cow-memory.h"
 #include "net/dce-if.h"
 #include "ns3/node.h"
 #include "ns3/log.h"
@@ -248,6 +251,11 @@ int dce_kill (pid_t pid, int sig)
       current->err = ESRCH;
       return -1;
     }
+  if (sig == 0)
+    {
+      // only checks that the process exists.
+      return 0;
+    }
 
   UtilsSendSignal (process, SIGKILL);
 
@@ -509,6 +517,104 @@ int dce_sched_yield (void)
   current->process->manager->Yield ();
   return 0;
 }
+static Process * PriorityProcess (Thread *current, int which, id_t who)
+{
+  if (which != PRIO_PROCESS)
+    {
+      // process groups and users are not modeled.
+      current->err = EINVAL;
+      return 0;
+    }
+  Process *process = current->process;
+  if (who != 0)
+    {
+      process = current->process->manager->SearchProcess (who);
+    }
+  if (process == 0 || process->threads.empty ())
+    {
+      current->err = ESRCH;
+      return 0;
+    }
+  return process;
+}
+int dce_getpriority (int which, id_t who)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (current << UtilsGetNodeId () << which << who);
+  NS_ASSERT (current != 0);
+  Process *process = PriorityProcess (current, which, who);
+  if (process == 0)
+    {
+      return -1;
+    }
+  return process->threads[0]->task->GetPriority ();
+}
+int dce_setpriority (int which, id_t who, int prio)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (current << UtilsGetNodeId () << which << who << prio);
+  NS_ASSERT (current != 0);
+  Process *process = PriorityProcess (current, which, who);
+  if (process == 0)
+    {
+      return -1;
+    }
+  prio = std::min (std::max (prio, -20), 19);
+  if (prio < process->threads[0]->task->GetPriority ()
+      && current->process->euid != 0)
+    {
+      current->err = EACCES;
+      return -1;
+    }
+  for (std::vector<Thread *>::iterator i = process->threads.begin ();
+       i != process->threads.end (); ++i)
+    {
+      (*i)->task->SetPriority (prio);
+    }
+  return 0;
+}
+int dce_nice (int inc)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (current << UtilsGetNodeId () << inc);
+  NS_ASSERT (current != 0);
+  int prio = current->task->GetPriority () + inc;
+  if (dce_setpriority (PRIO_PROCESS, 0, prio) == -1)
+    {
+      if (current->err == EACCES)
+        {
+          current->err = EPERM;
+        }
+      return -1;
+    }
+  return current->task->GetPriority ();
+}
+int dce_getrusage (int who, struct rusage *usage)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (current << UtilsGetNodeId () << who << usage);
+  NS_ASSERT (current != 0);
+  CowMemory::PrepareWrite (usage, sizeof (*usage));
+  int ret = getrusage (who, usage);
+  if (ret == -1)
+    {
+      current->err = errno;
+    }
+  return ret;
+}
+int dce_getrlimit (int resource, struct rlimit *rlim)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (current << UtilsGetNodeId () << resource << rlim);
+  NS_ASSERT (current != 0);
+  CowMemory::PrepareWrite (rlim, sizeof (*rlim));
+  int ret = getrlimit (resource, rlim);
+  if (ret == -1)
+    {
+      current->err = errno;
+    }
+  return ret;
+}
 static void Itimer (Process *process)
 {
   if (!process->itimerInterval.IsZero ())
@@ -975,6 +1081,7 @@ ssize_t dce_readlink (const char *path, char *buf, size_t bufsize)
 
   std::string fullpath = UtilsGetRealFilePath (path);
 
+  CowMemory::PrepareWrite (buf, bufsize);
   ssize_t ret = readlink (fullpath.c_str (), buf, bufsize);
 
   if (ret)
@@ -1,6 +1,7 @@
 #include "dlm-loader-factory.h"
 #include "ns3/log.h"
 #include "ns3/fatal-error.h"
+#include "ns3/system-mutex.h"
 #include <list>
 #include <dlfcn.h>
 
@@ -23,6 +24,10 @@ namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (DlmLoaderFactory);
 
+// The elf loader keeps one state for all the link maps: the nodes which
+// run on different simulation threads must not enter it together.
+static SystemMutex g_loaderMutex;
+
 class DlmLoader : public Loader
 {
 public:
@@ -44,6 +49,7 @@ private:
 DlmLoader::DlmLoader (int argc, char **argv, char **envp)
 {
   NS_LOG_FUNCTION (this << argc);
+  CriticalSection cs (g_loaderMutex);
   void *libvdl = dlopen ("libvdl.so", RTLD_LAZY | RTLD_LOCAL);
   DlLmidNew dlLmidNew = (DlLmidNew) dlsym (libvdl, "dl_lmid_new");
   dlclose (libvdl);
@@ -63,6 +69,7 @@ DlmLoader::~DlmLoader ()
 {
   NS_LOG_FUNCTION (this);
   m_loaded.clear ();
+  CriticalSection cs (g_loaderMutex);
   void *libvdl = dlopen ("libvdl.so", RTLD_LAZY | RTLD_LOCAL);
   DlLmidDelete dlLmidDelete = (DlLmidDelete) dlsym (libvdl, "dl_lmid_delete");
   dlclose (libvdl);
@@ -80,6 +87,7 @@ void
 DlmLoader::UnloadAll (void)
 {
   NS_LOG_FUNCTION (this);
+  CriticalSection cs (g_loaderMutex);
   for (std::list<void *>::const_iterator i = m_loaded.begin ();
        i != m_loaded.end (); ++i)
     {
@@ -90,6 +98,7 @@ void *
 DlmLoader::Load (std::string filename, int flag, bool failsafe)
 {
   NS_LOG_FUNCTION (this << filename << flag);
+  CriticalSection cs (g_loaderMutex);
   void *module = dlmopen (m_lmid, (filename != "") ? filename.c_str () : NULL, flag);
   if (!module)
     {
@@ -105,6 +114,7 @@ void
 DlmLoader::Unload (void *module)
 {
   NS_LOG_FUNCTION (this << module);
+  CriticalSection cs (g_loaderMutex);
   ::dlclose (module);
   m_loaded.remove (module);
 }
@@ -112,6 +122,7 @@ void *
 DlmLoader::Lookup (void *module, std::string symbol)
 {
   NS_LOG_FUNCTION (this << module << symbol);
+  CriticalSection cs (g_loaderMutex);
   void *p = dlsym (module, symbol.c_str ());
   if (!p)
     {
@@ -1,4 +1,5 @@
 #include "elf-cache.h"
+#include "utils.h"
 #include "ns3/log.h"
 #include "ns3/assert.h"
 #include "ns3/fatal-error.h"
@@ -9,6 +10,7 @@
 #include <errno.h>
 #include <sstream>
 #include <string.h>
+#include <stdio.h>
 #include <sys/mman.h>
 
 namespace ns3 {
@@ -48,27 +50,51 @@ ElfCache::GetBasename (std::string filename) const
   return filename.substr (tmp + 1, filename.size () - (tmp + 1));
 }
 
-void
-ElfCache::CopyFile (std::string source, std::string destination) const
+// Write the file under a temporary name then rename it: the other ranks
+// see the whole file or nothing.
+bool
+ElfCache::WriteFile (std::string filename, const uint8_t *buffer, uint64_t size) const
 {
-  NS_LOG_FUNCTION (this << source << destination);
-  int src = open (source.c_str (), O_RDONLY);
-  int dst = open (destination.c_str (), O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
-  uint8_t buffer[1024];
-  ssize_t bytes_read = read (src, buffer, 1024);
-  while (bytes_read > 0)
+  NS_LOG_FUNCTION (this << filename << size);
+  std::ostringstream oss;
+  oss << filename << "." << getpid ();
+  std::string temporary = oss.str ();
+  int fd = ::open (temporary.c_str (), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IXUSR);
+  if (fd == -1)
+    {
+      return false;
+    }
+  uint64_t written = 0;
+  while (written < size)
     {
-      ssize_t bytes_written = 0;
-      while (bytes_written != bytes_read)
+      ssize_t bytes = ::write (fd, buffer + written, size - written);
+      if (bytes <= 0)
         {
-          ssize_t written = write (dst, buffer + bytes_written, bytes_read - bytes_written);
-          bytes_written += written;
+          break;
         }
-      bytes_read = read (src, buffer, 1024);
+      written += bytes;
+    }
+  ::close (fd);
+  if (written != size || ::rename (temporary.c_str (), filename.c_str ()) == -1)
+    {
+      ::unlink (temporary.c_str ());
+      return false;
+    }
+  NS_LOG_DEBUG ("wrote " << filename);
+  return true;
+}
+
+uint64_t
+ElfCache::Hash (const uint8_t *buffer, uint64_t size)
+{
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (uint64_t i = 0; i < size; i++)
+    {
+      hash ^= buffer[i];
+      hash *= 1099511628211ULL;
     }
-  close (src);
-  close (dst);
-  NS_LOG_DEBUG ("copied " << source << " to " << destination);
+  return hash;
 }
 
 long
@@ -252,36 +278,56 @@ ElfCache::EditBuffer (uint8_t *map, uint32_t selfId) const
   return fileInfo;
 }
 
-struct ElfCache::FileInfo
-ElfCache::EditFile (std::string filename, uint32_t selfId) const
+std::string
+ElfCache::Store (std::string filename, uint32_t selfId, struct FileInfo *fileInfo) const
 {
-  NS_LOG_FUNCTION (this << filename);
-  int fd = ::open (filename.c_str (), O_RDWR);
+  NS_LOG_FUNCTION (this << filename << selfId);
+  int fd = ::open (filename.c_str (), O_RDONLY);
   NS_ASSERT_MSG (fd != -1, "unable to open file=" << filename << " error=" << strerror (errno));
   struct stat st;
   int retval = ::fstat (fd, &st);
   NS_ASSERT_MSG (retval == 0, "unable to fstat file=" << filename << " error=" << strerror (errno));
   uint64_t size = st.st_size;
-  uint8_t *buffer = (uint8_t *) ::mmap (0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  // edit a private copy of the pages: the binary itself is untouched.
+  uint8_t *buffer = (uint8_t *) ::mmap (0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
   NS_ASSERT_MSG (buffer != MAP_FAILED, "unable to mmap file=" << filename << " error=" << strerror (errno));
   close (fd);
 
-  struct FileInfo fileInfo = EditBuffer (buffer, selfId);
-  if (fileInfo.p_vaddr == -1)
+  *fileInfo = EditBuffer (buffer, selfId);
+  if (fileInfo->p_vaddr == -1)
     {
       NS_LOG_UNCOND ("*** unable to open non-shared object file=" << filename << " ***");
       NS_ASSERT_MSG (false, "make it sure that DCE binrary file " << filename 
                      << " was built with correct options: (CFLAGS=-fPIC, LDFLAGS=-pie -rdynamic)");
     }
 
-  // write back changes to hard disk
-  retval = ::msync (buffer, size, MS_SYNC);
-  NS_ASSERT_MSG (retval == 0, "msync failed " << strerror (errno));
+  std::ostringstream oss;
+  oss << GetBasename (filename) << "." << std::hex << Hash (buffer, size);
+  std::string name = oss.str ();
+  std::string cached = m_directory + "/" + name;
+  if (::stat (cached.c_str (), &st) == 0 && (uint64_t)st.st_size == size)
+    {
+      NS_LOG_DEBUG ("found " << cached);
+    }
+  else
+    {
+      ::mkdir (m_directory.c_str (), S_IRWXU);
+      if (!WriteFile (cached, buffer, size))
+        {
+          // the shared cache is read only.
+          cached = EnsurePrivateDirectory () + "/" + name;
+          if (::stat (cached.c_str (), &st) != 0 || (uint64_t)st.st_size != size)
+            {
+              bool ok = WriteFile (cached, buffer, size);
+              NS_ASSERT_MSG (ok, "unable to write file=" << cached << " error=" << strerror (errno));
+            }
+        }
+    }
 
   retval = ::munmap (buffer, size);
   NS_ASSERT_MSG (retval == 0, "munmap failed " << strerror (errno));
 
-  return fileInfo;
+  return cached;
 }
 
 uint32_t
@@ -317,19 +363,14 @@ ElfCache::GetDepId (std::string depname) const
 }
 
 std::string
-ElfCache::EnsureCacheDirectory (void) const
+ElfCache::EnsurePrivateDirectory (void) const
 {
-  int retval = ::mkdir (m_directory.c_str (), S_IRWXU);
-  if (retval == 0)
-    {
-      NS_LOG_DEBUG ("Created elf loader cache directory.");
-    }
   std::ostringstream oss;
-  oss << m_directory << "/" << m_uid;
-  retval = ::mkdir (oss.str ().c_str (), S_IRWXU);
+  oss << UtilsGetRootDirectory () << "elf-cache-" << m_uid;
+  int retval = ::mkdir (oss.str ().c_str (), S_IRWXU);
   if (retval == 0)
     {
-      NS_LOG_DEBUG ("Created elf loader cache directory.");
+      NS_LOG_DEBUG ("Created private elf loader cache directory.");
     }
   return oss.str ();
 }
@@ -366,13 +407,10 @@ ElfCache::Add (std::string filename)
         }
     }
 
-  std::string directory = EnsureCacheDirectory ();
-  std::string fileCopy = directory + "/" + basename;
-  CopyFile (filename, fileCopy);
-
   uint32_t selfId = AllocateId ();
 
-  struct FileInfo fileInfo = EditFile (fileCopy, selfId);
+  struct FileInfo fileInfo;
+  std::string fileCopy = Store (filename, selfId, &fileInfo);
 
   struct ElfCachedFile cached;
   cached.cachedFilename = fileCopy;
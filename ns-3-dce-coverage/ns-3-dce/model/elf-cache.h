@@ -9,6 +9,17 @@
 
 namespace ns3 {
 
+/**
+ * The copies of the loaded binaries, edited so that every process gets
+ * its own instance of their code and data.
+ *
+ * An edited copy only depends on the binary and on the order of the
+ * loads, so it is named after a hash of its content and shared: the
+ * ranks of a distributed simulation, and the next runs, find it in the
+ * directory and do not write it again. The directory may be read only,
+ * filled by a previous run: the copies which are missing then go to the
+ * private elf-cache-<uid> directory of the rank.
+ */
 class ElfCache
 {
 public:
@@ -38,14 +49,15 @@ private:
     std::string to;
   };
   std::string GetBasename (std::string filename) const;
-  void CopyFile (std::string source, std::string destination) const;
+  bool WriteFile (std::string filename, const uint8_t *buffer, uint64_t size) const;
+  std::string Store (std::string filename, uint32_t selfId, struct FileInfo *fileInfo) const;
+  static uint64_t Hash (const uint8_t *buffer, uint64_t size);
   void WriteString (char *str, uint32_t uid) const;
   uint8_t NumberToChar (uint8_t c) const;
   static uint32_t AllocateId (void);
   struct FileInfo EditBuffer (uint8_t *map, uint32_t selfId) const;
-  struct FileInfo EditFile (std::string filename, uint32_t selfId) const;
   uint32_t GetDepId (std::string depname) const;
-  std::string EnsureCacheDirectory (void) const;
+  std::string EnsurePrivateDirectory (void) const;
   unsigned long GetBaseAddress (ElfW (Phdr) * phdr, long phnum) const;
   long GetDtStrTab (ElfW (Dyn) * dyn, long baseAddress) const;
 
@@ -25,110 +25,150 @@
 
 NS_LOG_COMPONENT_DEFINE ("FifoBuffer");
 
-#define MIN_ALLOC 1024
-
 namespace ns3 {
 FifoBuffer::FifoBuffer (size_t mxSz) : m_maxSize (mxSz),
-                                       m_buffer (0),
-                                       m_read (0)
-                                       ,
-                                       m_fill (0),
+                                       m_spare (0),
                                        m_size (0)
 {
 }
 FifoBuffer::~FifoBuffer (void)
 {
-  if (m_buffer)
+  Clear ();
+  if (m_spare)
+    {
+      free (m_spare);
+      m_spare = 0;
+    }
+}
+uint8_t *
+FifoBuffer::AllocPage (void)
+{
+  if (m_spare)
     {
-      free (m_buffer);
-      m_buffer = 0;
+      uint8_t *data = m_spare;
+      m_spare = 0;
+      return data;
+    }
+  return (uint8_t*) malloc (PAGE_LENGTH);
+}
+void
+FifoBuffer::FreePage (uint8_t *data)
+{
+  if (m_spare)
+    {
+      free (data);
+    }
+  else
+    {
+      m_spare = data;
     }
 }
 ssize_t
 FifoBuffer::Write (uint8_t *buf, size_t len)
 {
-  NS_LOG_FUNCTION ("r:" << m_read << " f:" << m_fill << " s:" <<  m_size);
-  size_t capa = m_size - m_fill;
+  NS_LOG_FUNCTION ("s:" << m_size << " p:" << m_pages.size () << " len:" << len);
+  len = std::min (len, m_maxSize - m_size);
 
-  if (len <= capa)
+  size_t done = 0;
+  while (done < len)
     {
-      memcpy (m_buffer + m_fill, buf, len);
-      m_fill += len;
-      return len;
-    }
-  if ((m_read > 0) && (m_size <= m_maxSize))
-    {
-      if (m_fill > m_read)
+      if (m_pages.empty () || m_pages.back ().end == PAGE_LENGTH)
         {
-          memmove (m_buffer, m_buffer + m_read, m_fill - m_read);
+          struct Page page;
+          page.data = AllocPage ();
+          if (!page.data)
+            {
+              break;
+            }
+          page.start = 0;
+          page.end = 0;
+          m_pages.push_back (page);
         }
-      m_fill -= m_read;
-      m_read = 0;
-      return Write (buf, len);
+      struct Page &tail = m_pages.back ();
+      size_t l = std::min (len - done, PAGE_LENGTH - tail.end);
+      memcpy (tail.data + tail.end, buf + done, l);
+      tail.end += l;
+      done += l;
     }
-  if (m_size == m_maxSize)
+  m_size += done;
+  if ((0 == done) && (len > 0))
     {
-      if (capa > 0)
-        {
-          memcpy (m_buffer + m_fill, buf, capa);
-          m_fill += capa;
-          return capa;
-        }
+      return -1;
     }
-  else
+  return done;
+}
+ssize_t
+FifoBuffer::Read (uint8_t *buf, size_t len)
+{
+  NS_LOG_FUNCTION ("s:" << m_size << " p:" << m_pages.size () << " len:" << len);
+  size_t done = 0;
+  while ((done < len) && !m_pages.empty ())
     {
-      size_t newSize = len + m_fill;
-
-      if (newSize - m_size < MIN_ALLOC)
-        {
-          newSize = m_size + MIN_ALLOC;
-        }
-      if (newSize > m_maxSize)
+      struct Page &head = m_pages.front ();
+      size_t l = std::min (len - done, head.end - head.start);
+      memcpy (buf + done, head.data + head.start, l);
+      head.start += l;
+      done += l;
+      if (head.start == head.end)
         {
-          newSize = m_maxSize;
+          FreePage (head.data);
+          m_pages.pop_front ();
         }
-
-      uint8_t *newBuf = (uint8_t*) malloc (newSize);
-      if (!newBuf)
-        {
-          return -1;
-        }
-      memcpy (newBuf, m_buffer + m_read, m_fill - m_read);
-      free (m_buffer);
-      m_buffer = newBuf;
-      m_fill -= m_read;
-      m_read = 0;
-      m_size = newSize;
-
-      return Write (buf, len);
     }
-  return 0;
+  m_size -= done;
+  return done;
 }
 ssize_t
-FifoBuffer::Read (uint8_t *buf, size_t len)
+FifoBuffer::Splice (FifoBuffer *from, size_t len)
 {
-  NS_LOG_FUNCTION ("r:" << m_read << " f:" << m_fill << " s:" <<  m_size);
-  size_t capa = m_fill - m_read;
+  NS_LOG_FUNCTION ("s:" << m_size << " from:" << from->m_size << " len:" << len);
+  len = std::min (len, m_maxSize - m_size);
 
-  if (capa > 0)
+  size_t done = 0;
+  while ((done < len) && !from->m_pages.empty ())
     {
-      size_t l = std::min (len, capa);
-
-      memcpy (buf, m_buffer + m_read, l);
-      m_read += l;
-
-      return l;
+      struct Page &head = from->m_pages.front ();
+      size_t l = head.end - head.start;
+      if (l > len - done)
+        {
+          // Only a part of this page is wanted, copy it.
+          ssize_t r = Write (head.data + head.start, len - done);
+          if (r <= 0)
+            {
+              break;
+            }
+          m_size -= r; // already accounted by Write
+          head.start += r;
+          done += r;
+          break;
+        }
+      // Hand the whole page over.
+      m_pages.push_back (head);
+      from->m_pages.pop_front ();
+      done += l;
     }
-  return 0;
+  m_size += done;
+  from->m_size -= done;
+  return done;
 }
 ssize_t
-FifoBuffer::GetSize ()
+FifoBuffer::GetSize () const
 {
-  return m_fill - m_read;
+  return m_size;
 }
 ssize_t
-FifoBuffer::GetSpace ()
+FifoBuffer::GetSpace () const
 {
   return m_maxSize - GetSize ();
 }
+void
+FifoBuffer::Clear (void)
+{
+  while (!m_pages.empty ())
+    {
+      free (m_pages.front ().data);
+      m_pages.pop_front ();
+    }
+  m_size = 0;
+}
 } // namespace ns3
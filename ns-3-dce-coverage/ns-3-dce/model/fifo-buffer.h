@@ -23,24 +23,51 @@
 
 #include <stdint.h>
 #include <unistd.h>
+#include <deque>
 
 namespace ns3 {
+/**
+ * Byte FIFO made of a ring of fixed size pages.
+ *
+ * Pages are allocated when needed and recycled when drained so that
+ * data is never moved inside the buffer: Write and Read each copy it
+ * once. Splice moves whole pages from one FifoBuffer to another without
+ * copying their content.
+ */
 class FifoBuffer
 {
 public:
+  enum
+  {
+    PAGE_LENGTH = 4096
+  };
+
   FifoBuffer (size_t mxSz);
   ~FifoBuffer (void);
 
   ssize_t Write (uint8_t *buf, size_t len);
   ssize_t Read (uint8_t *buf, size_t len);
-  ssize_t GetSize ();
-  ssize_t GetSpace ();
+  // Move up to len bytes from the head of from to the tail of this.
+  ssize_t Splice (FifoBuffer *from, size_t len);
+  ssize_t GetSize () const;
+  ssize_t GetSpace () const;
+  void Clear (void);
 
 private:
+  struct Page
+  {
+    uint8_t *data;
+    size_t start; // first unread byte
+    size_t end;   // first free byte
+  };
+
+  uint8_t * AllocPage (void);
+  void FreePage (uint8_t *data);
+
   const size_t m_maxSize;
-  uint8_t *m_buffer;
-  size_t m_read;
-  size_t m_fill;
+  std::deque<struct Page> m_pages;
+  // Drained page kept to avoid a malloc/free pair per page of data.
+  uint8_t *m_spare;
   size_t m_size;
 };
 }
@@ -18,6 +18,9 @@
 #include "ns3/string.h"
 #include "ns3/double.h"
 #include "ns3/pointer.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/integer.h"
 #include "ns3/node.h"
 #include "ns3/net-device.h"
 #include "ns3/random-variable-stream.h"
@@ -82,6 +85,36 @@ KernelSocketFdFactory::GetTypeId (void)
                    StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=1.0]"),
                    MakePointerAccessor (&KernelSocketFdFactory::m_ranvar),
                    MakePointerChecker<RandomVariableStream> ())
+    .AddAttribute ("MaxIdleWorkers", "The maximum number of idle worker tasks kept around "
+                   "to run deferred kernel callbacks.",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&KernelSocketFdFactory::m_maxIdleWorkers),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("TaskPriority", "The nice value of the kernel tasks, only used by "
+                   "schedulers which support priorities such as ns3::CfsTaskScheduler.",
+                   IntegerValue (-10),
+                   MakeIntegerAccessor (&KernelSocketFdFactory::m_taskPriority),
+                   MakeIntegerChecker<int32_t> (-20, 19))
+    .AddAttribute ("TxHeadroom", "The bytes reserved in front of the packets sent by the "
+                   "kernel, so that the headers of the device go in place.",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&KernelSocketFdFactory::m_txHeadroom),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("TxTailroom", "The bytes reserved after the packets sent by the "
+                   "kernel, for the trailers of the device.",
+                   UintegerValue (16),
+                   MakeUintegerAccessor (&KernelSocketFdFactory::m_txTailroom),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("TxBatch", "Queue the packets sent by the kernel on each device and "
+                   "give them to the device in bursts, from one event of the main thread.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&KernelSocketFdFactory::m_txBatch),
+                   MakeBooleanChecker ())
+    .AddAttribute ("TxMaxBurst", "The maximum number of packets queued on a device "
+                   "when TxBatch is set.",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&KernelSocketFdFactory::m_txMaxBurst),
+                   MakeUintegerChecker<uint32_t> (1))
   ;
   return tid;
 }
@@ -101,7 +134,7 @@ KernelSocketFdFactory::~KernelSocketFdFactory ()
     {
       // Note: we don't really destroy devices from here
       // because calling destroy requires a task context
-      // m_exported->dev_destroy(m_devices[i].second);
+      // m_exported->dev_destroy(m_devices[i].dev);
     }
   delete m_exported;
   delete m_loader;
@@ -124,6 +157,16 @@ KernelSocketFdFactory::DoDispose (void)
       m_manager->Stop (*i);
     }
   m_kernelTasks.clear ();
+  m_idleWorkers.clear ();
+  for (std::list<EventImpl *>::const_iterator i = m_pendingTasks.begin (); i != m_pendingTasks.end (); ++i)
+    {
+      (*i)->Unref ();
+    }
+  m_pendingTasks.clear ();
+  for (uint32_t i = 0; i < m_devices.size (); i++)
+    {
+      m_devices[i].txQueue.clear ();
+    }
   m_manager = 0;
   m_listeners.clear ();
 }
@@ -263,33 +306,42 @@ KernelSocketFdFactory::Random (struct SimKernel *kernel)
   return u.v;
 }
 void
-KernelSocketFdFactory::EventTrampoline (void (*fn)(void *context),
-                                       void *context, void (*pre_fn)(void),
-                                       Ptr<EventIdHolder> event)
-{
-  m_loader->NotifyStartExecute ();
+KernelSocketFdFactory::EventTrampoline (struct KernelTimer *timer)
+{
+  Loader *loader = timer->factory->m_loader;
+  void (*fn)(void *context) = timer->fn;
+  void *context = timer->context;
+  void (*pre_fn)(void) = timer->pre_fn;
+  // expired: the kernel will not cancel it.
+  delete timer;
+  loader->NotifyStartExecute ();
   pre_fn ();
   fn (context);
-  m_loader->NotifyEndExecute ();
+  loader->NotifyEndExecute ();
 }
 void *
 KernelSocketFdFactory::EventScheduleNs (struct SimKernel *kernel, __u64 ns, void (*fn)(void *context), void *context,
                                        void (*pre_fn)(void))
 {
   KernelSocketFdFactory *self = (KernelSocketFdFactory *)kernel;
-  Ptr<EventIdHolder> ev = Create<EventIdHolder> ();
-  TaskManager *manager = TaskManager::Current ();
-
-  ev->id = manager->ScheduleMain (NanoSeconds (ns),
-                                  MakeEvent (&KernelSocketFdFactory::EventTrampoline, self, fn, context, pre_fn, ev));
-
-  return &ev->id;
+  struct KernelTimer *timer = new KernelTimer ();
+  timer->factory = self;
+  timer->fn = fn;
+  timer->context = context;
+  timer->pre_fn = pre_fn;
+  timer->timer.SetFunction (MakeBoundCallback (&KernelSocketFdFactory::EventTrampoline, timer));
+  // the kernel re-arms its timers all the time: keep them in the timer
+  // wheel of the node rather than in the simulator, and do not switch to
+  // the main thread to arm them.
+  self->m_manager->ScheduleTimer (&timer->timer, NanoSeconds (ns));
+  return timer;
 }
 void
 KernelSocketFdFactory::EventCancel (struct SimKernel *kernel, void *ev)
 {
-  EventId *event = (EventId *)ev;
-  Simulator::Remove (*event);
+  struct KernelTimer *timer = (struct KernelTimer *)ev;
+  // the destructor cancels the timer.
+  delete timer;
 }
 static __u64 CurrentNs (struct SimKernel *kernel)
 {
@@ -317,6 +369,7 @@ KernelSocketFdFactory::TaskStart (struct SimKernel *kernel, void (*callback)(voi
 {
   KernelSocketFdFactory *self = (KernelSocketFdFactory *)kernel;
   Task *task = self->m_manager->Start (callback, context, 1 << 17);
+  task->SetPriority (self->m_taskPriority);
   struct SimTask *simTask = self->m_exported->task_create (task, 0);
   task->SetExtraContext (simTask);
   task->SetSwitchNotifier (&KernelSocketFdFactory::TaskSwitch, self->m_loader);
@@ -378,6 +431,30 @@ KernelSocketFdFactory::SendMain (bool *r, NetDevice *dev, Ptr<Packet> p, const A
   *r = dev->Send (p, d, pro);
 }
 void
+KernelSocketFdFactory::ScheduleTxFlush (uint32_t ifIndex)
+{
+  Simulator::ScheduleNow (&KernelSocketFdFactory::TxFlushEvent, this, ifIndex);
+}
+void
+KernelSocketFdFactory::TxFlushEvent (uint32_t ifIndex)
+{
+  m_devices[ifIndex].txFlushPending = false;
+  FlushTx (ifIndex);
+}
+void
+KernelSocketFdFactory::FlushTx (uint32_t ifIndex)
+{
+  struct Device *device = &m_devices[ifIndex];
+  // the device may call back into the kernel and queue more packets: they
+  // go to the next burst.
+  std::vector<struct TxFrame> burst;
+  burst.swap (device->txQueue);
+  for (std::vector<struct TxFrame>::iterator i = burst.begin (); i != burst.end (); ++i)
+    {
+      device->device->Send (i->packet, i->dest, i->protocol);
+    }
+}
+void
 KernelSocketFdFactory::DevXmit (struct SimKernel *kernel, struct SimDevice *dev, unsigned char *data, int len)
 {
   NS_LOG_FUNCTION (dev);
@@ -393,13 +470,39 @@ KernelSocketFdFactory::DevXmit (struct SimKernel *kernel, struct SimDevice *dev,
   } *hdr = (struct ethhdr *)data;
   data += 14;
   len -= 14;
-  Ptr<Packet> p = Create<Packet> (data, len);
+  // the frame is copied once: with room for the headers and trailers of
+  // the device, they do not move it again.
+  Ptr<Packet> p = Create<Packet> (data, len, self->m_txHeadroom, self->m_txTailroom);
   uint16_t protocol = ntohs (hdr->h_proto);
   Mac48Address dest;
   dest.CopyFrom (hdr->h_dest);
   TaskManager *manager = TaskManager::Current ();
-  bool r = false;
 
+  if (self->m_txBatch)
+    {
+      // the first packet of a burst posts an event which sends the queue
+      // once the kernel gives the hand back: one switch to the main thread
+      // and one event per burst instead of per packet.
+      uint32_t ifIndex = nsDev->GetIfIndex ();
+      struct Device *device = &self->m_devices[ifIndex];
+      struct TxFrame frame;
+      frame.packet = p;
+      frame.dest = dest;
+      frame.protocol = protocol;
+      device->txQueue.push_back (frame);
+      if (device->txQueue.size () >= self->m_txMaxBurst)
+        {
+          manager->ExecOnMain (MakeEvent (&KernelSocketFdFactory::FlushTx, self, ifIndex));
+        }
+      else if (!device->txFlushPending)
+        {
+          device->txFlushPending = true;
+          manager->ExecOnMain (MakeEvent (&KernelSocketFdFactory::ScheduleTxFlush, self, ifIndex));
+        }
+      return;
+    }
+
+  bool r = false;
   manager->ExecOnMain (MakeEvent (&KernelSocketFdFactory::SendMain, &r, nsDev, p, dest, protocol));
 }
 
@@ -412,13 +515,10 @@ KernelSocketFdFactory::SignalRaised (struct SimKernel *kernel, struct SimTask *t
 struct SimDevice *
 KernelSocketFdFactory::DevToDev (Ptr<NetDevice> device)
 {
-  for (uint32_t i = 0; i < m_devices.size (); i++)
+  uint32_t ifIndex = device->GetIfIndex ();
+  if (ifIndex < m_devices.size () && m_devices[ifIndex].device == device)
     {
-      if (m_devices[i].first == device)
-        {
-          struct SimDevice *dev = m_devices[i].second;
-          return dev;
-        }
+      return m_devices[ifIndex].dev;
     }
   return 0;
 }
@@ -481,26 +581,56 @@ KernelSocketFdFactory::NotifyDeviceStateChangeTask (Ptr<NetDevice> device)
 void
 KernelSocketFdFactory::ScheduleTaskTrampoline (void *context)
 {
-  Task *current = TaskManager::Current ()->CurrentTask ();
-  KernelSocketFdFactory *self = (KernelSocketFdFactory *) current->GetExtraContext ();
-  current->SetExtraContext (0);
-  EventImpl *event = (EventImpl *)context;
-  event->Invoke ();
-  event->Unref ();
+  KernelSocketFdFactory *self = (KernelSocketFdFactory *) context;
+  Task *current = self->m_manager->CurrentTask ();
+  while (true)
+    {
+      while (!self->m_pendingTasks.empty ())
+        {
+          EventImpl *event = self->m_pendingTasks.front ();
+          self->m_pendingTasks.pop_front ();
+          event->Invoke ();
+          event->Unref ();
+        }
+      if (self->m_idleWorkers.size () >= self->m_maxIdleWorkers)
+        {
+          break;
+        }
+      // wait for ScheduleTask to hand us more work.
+      self->m_idleWorkers.push_back (current);
+      self->m_manager->Sleep ();
+      // the kernel may have woken us up on its own.
+      self->m_idleWorkers.remove (current);
+    }
   self->m_kernelTasks.remove (current);
   TaskManager::Current ()->Exit ();
 }
 
 void
-KernelSocketFdFactory::ScheduleTask (EventImpl *event)
+KernelSocketFdFactory::StartWorkerTask (void)
 {
   Task *task = m_manager->Start (&KernelSocketFdFactory::ScheduleTaskTrampoline,
-                                 event, 1 << 17);
-  task->SetExtraContext (this);
+                                 this, 1 << 17);
+  task->SetPriority (m_taskPriority);
   task->SetSwitchNotifier (&KernelSocketFdFactory::TaskSwitch, m_loader);
   m_kernelTasks.push_back (task);
 }
 
+void
+KernelSocketFdFactory::ScheduleTask (EventImpl *event)
+{
+  m_pendingTasks.push_back (event);
+  if (m_idleWorkers.empty ())
+    {
+      // all the workers are either busy or blocked in the kernel.
+      StartWorkerTask ();
+      return;
+    }
+  Task *worker = m_idleWorkers.front ();
+  m_idleWorkers.pop_front ();
+  m_manager->Wakeup (worker);
+}
+
 void
 KernelSocketFdFactory::NotifyAddDevice (Ptr<NetDevice> device)
 {
@@ -538,7 +668,14 @@ KernelSocketFdFactory::NotifyAddDeviceTask (Ptr<NetDevice> device)
   m_listeners.push_back (listener);
   device->AddLinkChangeCallback (MakeCallback (&KernelDeviceStateListener::NotifyDeviceStateChange, listener));
 
-  m_devices.push_back (std::make_pair (device,dev));
+  // the devices are indexed by their index in the node.
+  uint32_t ifIndex = device->GetIfIndex ();
+  if (ifIndex >= m_devices.size ())
+    {
+      m_devices.resize (ifIndex + 1);
+    }
+  m_devices[ifIndex].device = device;
+  m_devices[ifIndex].dev = dev;
   Ptr<Node> node = GetObject<Node> ();
   if (device->GetInstanceTypeId () == m_lteUeTid)
     {
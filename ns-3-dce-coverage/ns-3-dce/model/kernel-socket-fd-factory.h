@@ -5,6 +5,8 @@
 #include "task-manager.h"
 #include "ns3/net-device.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/mac48-address.h"
+#include "ns3/packet.h"
 #include <sys/socket.h>
 #include <vector>
 #include <string>
@@ -43,6 +45,13 @@ public:
 
   virtual UnixFd * CreateSocket (int domain, int type, int protocol);
 
+  /**
+   * Run a callback from a kernel task, in the context of the node.
+   *
+   * The callbacks start in the order they were scheduled. A callback which
+   * blocks in the kernel does not hold back the next ones: they run on
+   * another worker task and may end before it.
+   */
   void ScheduleTask (EventImpl *event);
   std::string m_library;
 
@@ -56,9 +65,14 @@ protected:
 private:
   friend class KernelSocketFd;
   friend class KernelDeviceStateListener;
-  struct EventIdHolder : public SimpleRefCount<EventIdHolder>
+  // A timer of the kernel, kept in the timer wheel of the node.
+  struct KernelTimer
   {
-    EventId id;
+    TimerWheel::Timer timer;
+    KernelSocketFdFactory *factory;
+    void (*fn)(void *context);
+    void *context;
+    void (*pre_fn)(void);
   };
 
   // called from KernelSocketFd
@@ -135,13 +149,44 @@ private:
   void DoSet (std::string path, std::string value);
   static void TaskSwitch (enum Task::SwitchType type, void *context);
   static void ScheduleTaskTrampoline (void *context);
-  void EventTrampoline (void (*fn)(void *context),
-                        void *context, void (*pre_fn)(void),
-                        Ptr<EventIdHolder> event);
+  void StartWorkerTask (void);
+  static void EventTrampoline (struct KernelTimer *timer);
   static void SendMain (bool *r, NetDevice *d, Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber);
+  void ScheduleTxFlush (uint32_t ifIndex);
+  void TxFlushEvent (uint32_t ifIndex);
+  void FlushTx (uint32_t ifIndex);
 
-  std::vector<std::pair<Ptr<NetDevice>,struct SimDevice *> > m_devices;
+  // A packet sent by the kernel, queued when TxBatch is set.
+  struct TxFrame
+  {
+    Ptr<Packet> packet;
+    Mac48Address dest;
+    uint16_t protocol;
+  };
+  struct Device
+  {
+    Device () : dev (0), txFlushPending (false) {}
+    Ptr<NetDevice> device;
+    struct SimDevice *dev;
+    std::vector<struct TxFrame> txQueue;
+    // an event which sends the queue is posted.
+    bool txFlushPending;
+  };
+
+  // indexed by the index of the device in the node, dev is zero for the
+  // devices the kernel does not know.
+  std::vector<struct Device> m_devices;
   std::list<Task *> m_kernelTasks;
+  // Deferred kernel callbacks are run by a pool of worker tasks
+  // instead of one new task per callback.
+  std::list<EventImpl *> m_pendingTasks;
+  std::list<Task *> m_idleWorkers;
+  uint32_t m_maxIdleWorkers;
+  int32_t m_taskPriority;
+  uint32_t m_txHeadroom;
+  uint32_t m_txTailroom;
+  bool m_txBatch;
+  uint32_t m_txMaxBurst;
   Ptr<UniformRandomVariable> m_variable;
   KingsleyAlloc *m_alloc;
   std::vector<Ptr<KernelDeviceStateListener> > m_listeners;
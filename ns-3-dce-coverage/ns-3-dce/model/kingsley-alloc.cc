@@ -30,53 +30,58 @@ KingsleyAlloc::KingsleyAlloc ()
   : m_defaultMmapSize (1 << 15)
 {
   NS_LOG_FUNCTION (this);
-  memset (m_buckets, 0, sizeof(m_buckets));
+  NS_ASSERT (SizeToClass (m_defaultMmapSize) < MAX_CLASSES);
+  m_arena = m_chunks.end ();
+  memset (m_classes, 0, sizeof(m_classes));
+  memset (&m_stats, 0, sizeof(m_stats));
 }
 KingsleyAlloc::~KingsleyAlloc ()
 {
   NS_LOG_FUNCTION (this);
   // return;
-  for (std::list<struct KingsleyAlloc::MmapChunk>::iterator i = m_chunks.begin ();
-       i != m_chunks.end (); ++i)
+  for (Chunks::iterator i = m_chunks.begin (); i != m_chunks.end (); ++i)
     {
-      if (i->copy)
-        {
-          // ok, this means that _our_ buffer is not the
-          // original mmap buffer which means that we were
-          // cloned once so, we need to free our local
-          // buffer.
-          free (i->copy);
-
-          if (i->copy == i->mmap->current)
-            {
-              // Current must be nullify because we the next switch of context do not need to save our heap.
-              i->mmap->current = 0;
-            }
-          i->copy = 0;
-        }
-      i->mmap->refcount--;
-      if (i->mmap->refcount == 0)
+      ReleaseChunk (&i->second);
+    }
+  m_chunks.clear ();
+  m_arena = m_chunks.end ();
+}
+void
+KingsleyAlloc::ReleaseChunk (struct MmapChunk *chunk)
+{
+  NS_LOG_FUNCTION (this << (void*)chunk->mmap->buffer);
+  if (chunk->image)
+    {
+      // we were cloned once so, give our pages back.
+      if (chunk->mmap->memory->Release (chunk->image))
         {
-          // we are the last to release this chunk.
-          // so, release the mmaped data.
-          MmapFree (i->mmap->buffer, i->mmap->size);
-          delete i->mmap;
+          delete chunk->mmap->memory;
+          chunk->mmap->memory = 0;
         }
+      chunk->image = 0;
     }
-  m_chunks.clear ();
+  m_stats.mapped -= chunk->mmap->size;
+  chunk->mmap->refcount--;
+  if (chunk->mmap->refcount == 0)
+    {
+      // we are the last to release this chunk.
+      // so, release the mmaped data.
+      MmapFree (chunk->mmap->buffer, chunk->mmap->size);
+      delete chunk->mmap;
+    }
+  chunk->mmap = 0;
 }
 // Call me only from my context
 void
 KingsleyAlloc::Dispose ()
 {
   NS_LOG_FUNCTION (this);
-  for (std::list<struct KingsleyAlloc::MmapChunk>::iterator i = m_chunks.begin ();
-       i != m_chunks.end (); ++i)
+  for (Chunks::iterator i = m_chunks.begin (); i != m_chunks.end (); ++i)
     {
-      if (i->copy == i->mmap->current)
+      if (i->second.image)
         {
-          // Current must be nullify because we the next switch of context do not need to save our heap.
-          i->mmap->current = 0;
+          // the next switch of context does not need to save our heap.
+          i->second.mmap->memory->Detach (i->second.image);
         }
     }
 }
@@ -85,24 +90,29 @@ KingsleyAlloc::Clone (void)
 {
   NS_LOG_FUNCTION (this << "begin");
   KingsleyAlloc *clone = new KingsleyAlloc ();
-  *clone->m_buckets = *m_buckets;
-  for (std::list<struct KingsleyAlloc::MmapChunk>::iterator i = m_chunks.begin ();
-       i != m_chunks.end (); ++i)
+  // The free lists are threaded through the heap itself which the clone
+  // shares, so all the list heads remain valid for the clone.
+  memcpy (clone->m_classes, m_classes, sizeof(m_classes));
+  clone->m_stats = m_stats;
+  for (Chunks::iterator i = m_chunks.begin (); i != m_chunks.end (); ++i)
     {
-      struct KingsleyAlloc::MmapChunk chunk = *i;
+      struct KingsleyAlloc::MmapChunk &chunk = i->second;
       chunk.mmap->refcount++;
-      if ((chunk.mmap->refcount == 2)&&(0 == chunk.copy))
+      if (chunk.mmap->memory == 0)
         {
-          // this is the first clone of this heap so, we first
-          // create buffer copies for ourselves
-          chunk.mmap->current = i->copy = (uint8_t *)malloc (chunk.mmap->size);
+          // this is the first clone of this heap so, we start
+          // sharing its pages.
+          chunk.mmap->memory = new CowMemory (chunk.mmap->buffer, chunk.mmap->size);
+          chunk.image = chunk.mmap->memory->Attach ();
         }
-      // now, we create a buffer copy for the clone
+      // the clone gets our pages, they are copied on write.
       struct KingsleyAlloc::MmapChunk chunkClone = chunk;
-      chunkClone.copy = (uint8_t *)malloc (chunkClone.mmap->size);
-      // Save the heap in the clone copy memory
-      memcpy (chunkClone.copy, chunk.mmap->buffer, chunk.mmap->size);
-      clone->m_chunks.push_back (chunkClone);
+      chunkClone.image = chunk.mmap->memory->Clone (chunk.image);
+      clone->m_chunks.insert (clone->m_chunks.end (), std::make_pair (i->first, chunkClone));
+    }
+  if (m_arena != m_chunks.end ())
+    {
+      clone->m_arena = clone->m_chunks.find (m_arena->first);
     }
   NS_LOG_FUNCTION (this << "end");
   return clone;
@@ -112,24 +122,12 @@ void
 KingsleyAlloc::SwitchTo (void)
 {
   NS_LOG_FUNCTION (this);
-  for (std::list<struct KingsleyAlloc::MmapChunk>::const_iterator i = m_chunks.begin ();
-       i != m_chunks.end (); ++i)
+  for (Chunks::const_iterator i = m_chunks.begin (); i != m_chunks.end (); ++i)
     {
-      struct KingsleyAlloc::MmapChunk chunk = *i;
-
-      // save the previous user's heap if necessary
-      if (chunk.mmap->current && (chunk.mmap->current != chunk.mmap->buffer))
-        {
-          memcpy (chunk.mmap->current, chunk.mmap->buffer, chunk.mmap->size);
-        }
-
-      // swap in our own copy of the heap if necessary
-      if (chunk.copy && (chunk.mmap->buffer != chunk.copy))
+      if (i->second.image)
         {
-          memcpy (chunk.mmap->buffer, chunk.copy, chunk.mmap->size);
+          i->second.mmap->memory->SwitchTo (i->second.image);
         }
-      // and, now, remember that _we_ own the heap
-      chunk.mmap->current = chunk.copy;
     }
 }
 
@@ -141,7 +139,7 @@ KingsleyAlloc::MmapFree (uint8_t *buffer, uint32_t size)
   status = ::munmap (buffer, size);
   NS_ASSERT_MSG (status == 0, "Unable to release mmaped buffer");
 }
-void
+KingsleyAlloc::Chunks::iterator
 KingsleyAlloc::MmapAlloc (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
@@ -151,90 +149,129 @@ KingsleyAlloc::MmapAlloc (uint32_t size)
   mmap_struct->buffer = (uint8_t*)::mmap (0, size, PROT_READ | PROT_WRITE,
                                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
   NS_ASSERT_MSG (mmap_struct->buffer != MAP_FAILED, "Unable to mmap memory buffer");
-  mmap_struct->current = mmap_struct->buffer;
+  mmap_struct->memory = 0;
   struct MmapChunk chunk;
   chunk.mmap = mmap_struct;
   chunk.brk = 0;
-  chunk.copy = 0; // no clone yet, no copy yet.
+  chunk.image = 0; // no clone yet.
 
-  m_chunks.push_front (chunk);
+  m_stats.mapped += size;
+  if (m_stats.mapped > m_stats.peakMapped)
+    {
+      m_stats.peakMapped = m_stats.mapped;
+    }
   NS_LOG_DEBUG ("mmap alloced=" << size << " at=" << (void*)mmap_struct->buffer);
   MARK_UNDEFINED (mmap_struct->buffer, size);
+  return m_chunks.insert (std::make_pair (mmap_struct->buffer, chunk)).first;
+}
+
+void
+KingsleyAlloc::Push (uint8_t sizeClass, uint8_t *buffer)
+{
+  struct Available *avail = (struct Available *)buffer;
+  MARK_DEFINED (avail, sizeof(void*));
+  avail->next = m_classes[sizeClass];
+  MARK_UNDEFINED (avail, sizeof(void*));
+  m_classes[sizeClass] = avail;
+}
+
+void
+KingsleyAlloc::RecycleTail (struct MmapChunk *chunk)
+{
+  NS_LOG_FUNCTION (this << (void*)chunk->mmap->buffer << chunk->brk);
+  // Hand out what is left at the end of a retired arena to the free
+  // lists rather than walking every chunk on each Brk.
+  while (chunk->mmap->size - chunk->brk >= ClassToSize (0))
+    {
+      uint32_t left = chunk->mmap->size - chunk->brk;
+      uint8_t sizeClass = SizeToClass (left);
+      if (ClassToSize (sizeClass) > left)
+        {
+          sizeClass--;
+        }
+      Push (sizeClass, chunk->mmap->buffer + chunk->brk);
+      chunk->brk += ClassToSize (sizeClass);
+    }
 }
 
 uint8_t *
 KingsleyAlloc::Brk (uint32_t needed)
 {
   NS_LOG_FUNCTION (this << needed);
-  for (std::list<struct KingsleyAlloc::MmapChunk>::iterator i = m_chunks.begin ();
-       i != m_chunks.end (); ++i)
+  NS_ASSERT_MSG (needed <= m_defaultMmapSize, needed << " " << m_defaultMmapSize);
+  if (m_arena == m_chunks.end ()
+      || m_arena->second.mmap->size - m_arena->second.brk < needed)
     {
-      NS_ASSERT (i->mmap->size >= i->brk);
-      if (i->mmap->size - i->brk >= needed)
+      if (m_arena != m_chunks.end ())
         {
-          uint8_t *buffer = i->mmap->buffer + i->brk;
-          i->brk += needed;
-          NS_LOG_DEBUG ("brk: needed=" << needed << ", left=" << i->mmap->size - i->brk);
-          return buffer;
+          RecycleTail (&m_arena->second);
         }
+      m_arena = MmapAlloc (m_defaultMmapSize);
     }
-  NS_ASSERT_MSG (needed <= m_defaultMmapSize, needed << " " << m_defaultMmapSize);
-  MmapAlloc (m_defaultMmapSize);
-  return Brk (needed);
+  struct MmapChunk *chunk = &m_arena->second;
+  NS_ASSERT (chunk->mmap->size >= chunk->brk);
+  uint8_t *buffer = chunk->mmap->buffer + chunk->brk;
+  chunk->brk += needed;
+  NS_LOG_DEBUG ("brk: needed=" << needed << ", left=" << chunk->mmap->size - chunk->brk);
+  return buffer;
 }
 uint8_t
-KingsleyAlloc::SizeToBucket (uint32_t sz)
+KingsleyAlloc::SizeToClass (uint32_t size)
 {
-  NS_LOG_FUNCTION (this << sz);
-  uint8_t bucket = 0;
-  uint32_t size = sz;
-  size--;
-  while (size > 7)
+  if (size <= SMALL_CLASS_MAX)
     {
-      size >>= 1;
-      bucket++;
+      return size == 0 ? 0 : (size - 1) >> SMALL_CLASS_SHIFT;
     }
-  NS_ASSERT (bucket < 32);
-  NS_LOG_DEBUG ("size=" << sz << ", bucket=" << (uint32_t)bucket << ", size=" <<
-                BucketToSize (bucket));
-  return bucket;
+  // size - 1 lies in [2^order, 2^(order+1)) and its two bits below the
+  // leading one select the class within that group.
+  uint32_t order = 31 - __builtin_clz (size - 1);
+  uint32_t index = ((size - 1) >> (order - 2)) & (CLASSES_PER_GROUP - 1);
+  return SMALL_CLASSES + (order - 7) * CLASSES_PER_GROUP + index;
 }
 uint32_t
-KingsleyAlloc::BucketToSize (uint8_t bucket)
+KingsleyAlloc::ClassToSize (uint8_t sizeClass)
 {
-  uint32_t size = (1 << (bucket + 3));
-  return size;
+  if (sizeClass < SMALL_CLASSES)
+    {
+      return (sizeClass + 1) << SMALL_CLASS_SHIFT;
+    }
+  uint32_t group = sizeClass - SMALL_CLASSES;
+  uint32_t order = 7 + group / CLASSES_PER_GROUP;
+  uint32_t index = group % CLASSES_PER_GROUP;
+  return (1 << order) + ((index + 1) << (order - 2));
 }
 
 uint8_t *
 KingsleyAlloc::Malloc (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
+  m_stats.mallocs++;
+  m_stats.requested += size;
   if (size < m_defaultMmapSize)
     {
-      uint8_t bucket = SizeToBucket (size);
-      if (m_buckets[bucket] == 0)
+      uint8_t sizeClass = SizeToClass (size);
+      m_stats.allocated += ClassToSize (sizeClass);
+      if (m_classes[sizeClass] == 0)
         {
-          struct Available *avail = (struct Available *)Brk (BucketToSize (bucket));
-          MARK_DEFINED (avail, sizeof(void*));
-          avail->next = 0;
-          MARK_UNDEFINED (avail, sizeof(void*));
-          m_buckets[bucket] = avail;
+          uint8_t *buffer = Brk (ClassToSize (sizeClass));
+          REPORT_MALLOC (buffer, size);
+          return buffer;
         }
       // fast path.
-      struct Available *avail = m_buckets[bucket];
+      struct Available *avail = m_classes[sizeClass];
       MARK_DEFINED (avail, sizeof(void*));
-      m_buckets[bucket] = avail->next;
+      m_classes[sizeClass] = avail->next;
       MARK_UNDEFINED (avail, sizeof(void*));
       REPORT_MALLOC (avail, size);
       return (uint8_t*)avail;
     }
   else
     {
-      MmapAlloc (size);
-      uint8_t *buffer = Brk (size);
-      REPORT_MALLOC (buffer, size);
-      return buffer;
+      m_stats.allocated += size;
+      Chunks::iterator i = MmapAlloc (size);
+      i->second.brk = size;
+      REPORT_MALLOC (i->first, size);
+      return i->first;
     }
 }
 void
@@ -243,25 +280,26 @@ KingsleyAlloc::Free (uint8_t *buffer, uint32_t size)
   NS_LOG_FUNCTION (this << (void*)buffer << size);
   if (size < m_defaultMmapSize)
     {
-      // return to bucket list.
-      uint8_t bucket = SizeToBucket (size);
-      struct Available *avail = (struct Available *)buffer;
-      avail->next = m_buckets[bucket];
-      m_buckets[bucket] = avail;
+      // return to size class list.
+      uint8_t sizeClass = SizeToClass (size);
+      Push (sizeClass, buffer);
+      m_stats.frees++;
+      m_stats.requested -= size;
+      m_stats.allocated -= ClassToSize (sizeClass);
       REPORT_FREE (buffer);
     }
   else
     {
-      for (std::list<struct KingsleyAlloc::MmapChunk>::iterator i = m_chunks.begin ();
-           i != m_chunks.end (); ++i)
+      Chunks::iterator i = m_chunks.find (buffer);
+      if (i != m_chunks.end () && i->second.mmap->size == size)
         {
-          if (i->mmap->buffer == buffer && i->mmap->size == size)
-            {
-              REPORT_FREE (buffer);
-              MmapFree (buffer, size);
-              m_chunks.erase (i);
-              return;
-            }
+          REPORT_FREE (buffer);
+          ReleaseChunk (&i->second);
+          m_chunks.erase (i);
+          m_stats.frees++;
+          m_stats.requested -= size;
+          m_stats.allocated -= size;
+          return;
         }
       // this should never happen but it happens in case of a double-free
       REPORT_FREE (buffer);
@@ -275,8 +313,28 @@ KingsleyAlloc::Realloc (uint8_t *oldBuffer, uint32_t oldSize, uint32_t newSize)
     {
       return oldBuffer;
     }
+  if (newSize < m_defaultMmapSize && SizeToClass (oldSize) == SizeToClass (newSize))
+    {
+      // still fits in the same size class: grow in place.
+      m_stats.requested += newSize - oldSize;
+      return oldBuffer;
+    }
   uint8_t *newBuffer = Malloc (newSize);
   memcpy (newBuffer, oldBuffer, oldSize);
   Free (oldBuffer, oldSize);
   return newBuffer;
 }
+struct KingsleyAlloc::Statistics
+KingsleyAlloc::GetStatistics (void) const
+{
+  return m_stats;
+}
+double
+KingsleyAlloc::GetFragmentation (void) const
+{
+  if (m_stats.mapped == 0)
+    {
+      return 0.0;
+    }
+  return 1.0 - (double)m_stats.requested / m_stats.mapped;
+}
@@ -2,11 +2,23 @@
 #define KINGSLEY_ALLOC_H
 
 #include <stdint.h>
-#include <list>
+#include <map>
+#include "cow-memory.h"
 
 class KingsleyAlloc
 {
 public:
+  // Heap usage counters, kept per allocator (i.e. per process or kernel).
+  struct Statistics
+  {
+    uint64_t requested;  // bytes currently asked for by the user
+    uint64_t allocated;  // bytes currently handed out, size class rounding included
+    uint64_t mapped;     // bytes currently mmaped for this heap
+    uint64_t peakMapped; // high watermark of mapped
+    uint64_t mallocs;
+    uint64_t frees;
+  };
+
   KingsleyAlloc (void);
   ~KingsleyAlloc ();
 
@@ -17,39 +29,63 @@ public:
   uint8_t * Realloc (uint8_t *oldBuffer, uint32_t oldSize, uint32_t newSize);
   // Call me only from my context
   void Dispose ();
+  struct Statistics GetStatistics (void) const;
+  // Fraction of the mapped memory which is not used to hold user data.
+  double GetFragmentation (void) const;
 
 private:
   // The following structure is unique for all clone of this.
   struct Mmap
   {
-    uint32_t refcount; // TODO think about what is happen when refcount come back to one ?
-                       // Perhaps free copy ?
+    uint32_t refcount;
     uint32_t size;
     uint8_t *buffer;
-    uint8_t *current; // Where to save current context , is used when another context is coming up
-                      // Zero if there is no clone yet(refcount == 1)
+    CowMemory *memory; // Pages shared with the clones, zero if there is no clone yet.
   };
 
   // But this one is differente between the clones.
   struct MmapChunk
   {
     struct Mmap *mmap;
-    uint8_t *copy; // My own copy of mmap->buffer used when there is at less one clone else ZERO.
+    CowMemory::Image *image; // My own version of mmap->buffer, zero if there is no clone yet.
     uint32_t brk; // Amount of memory used.
   };
   struct Available
   {
     struct Available *next;
   };
-  void MmapAlloc (uint32_t size);
+  // Chunks are indexed by their mmap->buffer address which is the same
+  // for all clones.
+  typedef std::map<uint8_t *, struct MmapChunk> Chunks;
+
+  // Size classes: 16 bytes steps up to 128 bytes, then four classes
+  // per power of two up to m_defaultMmapSize (32KB, i.e. 8 groups).
+  // Rounding waste is thus bounded by 25% instead of 50% with pure
+  // power of two buckets.
+  enum
+  {
+    SMALL_CLASS_MAX = 128,
+    SMALL_CLASS_SHIFT = 4,
+    SMALL_CLASSES = SMALL_CLASS_MAX >> SMALL_CLASS_SHIFT,
+    CLASSES_PER_GROUP = 4,
+    MAX_CLASSES = SMALL_CLASSES + CLASSES_PER_GROUP * 8
+  };
+
+  Chunks::iterator MmapAlloc (uint32_t size);
   void MmapFree (uint8_t *buffer, uint32_t size);
+  void ReleaseChunk (struct MmapChunk *chunk);
   uint8_t * Brk (uint32_t needed);
-  uint8_t SizeToBucket (uint32_t size);
-  uint32_t BucketToSize (uint8_t bucket);
+  void RecycleTail (struct MmapChunk *chunk);
+  static uint8_t SizeToClass (uint32_t size);
+  static uint32_t ClassToSize (uint8_t sizeClass);
+  void Push (uint8_t sizeClass, uint8_t *buffer);
 
-  std::list<struct KingsleyAlloc::MmapChunk> m_chunks;
-  struct Available *m_buckets[32];
+  Chunks m_chunks;
+  // Chunk currently used to carve new small buffers, m_chunks.end () if none.
+  Chunks::iterator m_arena;
+  struct Available *m_classes[MAX_CLASSES];
   uint32_t m_defaultMmapSize;
+  struct Statistics m_stats;
 };
 
 
@@ -13,6 +13,8 @@
 #include "sys/dce-stat.h"
 #include "sys/dce-select.h"
 #include "sys/dce-timerfd.h"
+#include "sys/dce-epoll.h"
+#include "sys/dce-resource.h"
 #include "dce-unistd.h"
 #include "dce-netdb.h"
 #include "dce-pthread.h"
@@ -71,6 +73,7 @@
 #include <sys/io.h>
 #include <sys/mman.h>
 #include <sys/timerfd.h>
+#include <sys/epoll.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/resource.h>
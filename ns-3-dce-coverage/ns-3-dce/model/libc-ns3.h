@@ -238,6 +238,7 @@ DCE (ftruncate)
 DCE (ftruncate64)
 NATIVE (sysconf)
 DCE (ttyname)
+DCE (nice)
 DCE (sbrk)
 DCE (getpagesize)
 DCE (getgid)
@@ -328,6 +329,7 @@ DCE (fcntl)
 DCE (open)
 DCE (open64)
 DCE (unlinkat)
+DCE (splice)
 
 // TIME.H
 DCE (nanosleep)
@@ -480,6 +482,12 @@ DCE (timerfd_create)
 DCE (timerfd_settime)
 DCE (timerfd_gettime)
 
+// SYS/EPOLL.H
+DCE (epoll_create)
+DCE (epoll_create1)
+DCE (epoll_ctl)
+DCE (epoll_wait)
+
 // NET/IF.H
 DCE (if_nametoindex)
 DCE (if_indextoname)
@@ -513,9 +521,11 @@ NATIVE (__xpg_basename)
 NATIVE (getgrnam)
 
 // SYS/RESOURCE.H
-NATIVE (getrusage) // not sure if native call will give stats about the requested process..
-NATIVE (getrlimit)
+DCE (getrusage) // not sure if native call will give stats about the requested process..
+DCE (getrlimit)
 NATIVE (setrlimit)
+DCE (getpriority)
+DCE (setpriority)
 
 // SYSLOG.H
 DCE (openlog)
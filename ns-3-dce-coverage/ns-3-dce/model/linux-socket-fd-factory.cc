@@ -8,6 +8,13 @@
 #include "ns3/simulator.h"
 #include "ns3/event-id.h"
 #include "ns3/node.h"
+#include <string.h>
+#include <sstream>
+#include <map>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 
 
 NS_LOG_COMPONENT_DEFINE ("LinuxSocketFdFactory");
@@ -29,6 +36,7 @@ LinuxSocketFdFactory::GetTypeId (void)
   return tid;
 }
 LinuxSocketFdFactory::LinuxSocketFdFactory ()
+  : m_netlinkScheduled (false)
 {
 }
 
@@ -65,16 +73,33 @@ void
 LinuxSocketFdFactory::SetTask (std::string path, std::string value)
 {
   NS_LOG_FUNCTION (path << value);
-  std::vector<std::pair<std::string,struct SimSysFile *> > files = GetSysFileList ();
-  for (uint32_t i = 0; i < files.size (); i++)
+  SetAllTask (std::vector<std::pair<std::string,std::string> > (1, std::make_pair (path, value)));
+}
+
+void
+LinuxSocketFdFactory::SetAllTask (std::vector<std::pair<std::string,std::string> > values)
+{
+  NS_LOG_FUNCTION (values.size ());
+  std::vector<std::pair<std::string,struct SimSysFile *> > list = GetSysFileList ();
+  std::map<std::string,struct SimSysFile *> files (list.begin (), list.end ());
+  // some values depend on others, e.g. tcp_congestion_control must be
+  // in tcp_allowed_congestion_control: keep the order of the caller.
+  for (std::vector<std::pair<std::string,std::string> >::const_iterator v = values.begin ();
+       v != values.end (); ++v)
     {
-      if (files[i].first == path)
+      std::map<std::string,struct SimSysFile *>::const_iterator file = files.find (v->first);
+      if (file == files.end ())
         {
-          const char *s = value.c_str ();
-          int toWrite = value.size ();
-          int written;
-          written = m_exported->sys_file_write (files[i].second, s, toWrite, 0);
-          break;
+          NS_LOG_WARN ("sysctl " << v->first << " not found");
+          continue;
+        }
+      const char *s = v->second.c_str ();
+      int toWrite = v->second.size ();
+      int written;
+      written = m_exported->sys_file_write (file->second, s, toWrite, 0);
+      if (written < 0)
+        {
+          NS_LOG_WARN ("sysctl " << v->first << " = " << v->second << " failed");
         }
     }
 }
@@ -113,6 +138,43 @@ LinuxSocketFdFactory::Get (std::string path)
   return ret;
 }
 
+void
+LinuxSocketFdFactory::SetAll (std::vector<std::pair<std::string,std::string> > values)
+{
+  if (m_manager == 0)
+    {
+      m_earlySysfs.insert (m_earlySysfs.end (), values.begin (), values.end ());
+    }
+  else
+    {
+      KernelSocketFdFactory::ScheduleTask (MakeEvent (&LinuxSocketFdFactory::SetAllTask, this, values));
+    }
+}
+
+std::map<std::string,std::string>
+LinuxSocketFdFactory::GetAll (std::string prefix)
+{
+  NS_LOG_FUNCTION (prefix);
+  std::map<std::string,std::string> ret;
+  std::vector<std::pair<std::string,struct SimSysFile *> > files = GetSysFileList ();
+  for (uint32_t i = 0; i < files.size (); i++)
+    {
+      if (files[i].first.compare (0, prefix.size (), prefix) != 0)
+        {
+          continue;
+        }
+      char buffer[512];
+      memset (buffer, 0, sizeof(buffer));
+      int read = m_exported->sys_file_read (files[i].second, buffer, sizeof(buffer) - 1, 0);
+      // some files, e.g. .net.ipv4.route.flush, are write only.
+      if (read >= 0)
+        {
+          ret[files[i].first] = std::string (buffer);
+        }
+    }
+  return ret;
+}
+
 std::vector<std::pair<std::string,struct SimSysFile *> >
 LinuxSocketFdFactory::GetSysFileList (void)
 {
@@ -154,15 +216,369 @@ void
 LinuxSocketFdFactory::InitializeStack (void)
 {
   KernelSocketFdFactory::InitializeStack ();
-  Set (".net.ipv4.conf.all.forwarding", "1");
-  Set (".net.ipv4.conf.all.log_martians", "1");
-  Set (".net.ipv6.conf.all.forwarding", "0");
+  std::vector<std::pair<std::string,std::string> > values;
+  values.push_back (std::make_pair (".net.ipv4.conf.all.forwarding", "1"));
+  values.push_back (std::make_pair (".net.ipv4.conf.all.log_martians", "1"));
+  values.push_back (std::make_pair (".net.ipv6.conf.all.forwarding", "0"));
+
+  // the values set by the user before the stack was up are written
+  // after the defaults, and win.
+  values.insert (values.end (), m_earlySysfs.begin (), m_earlySysfs.end ());
+  m_earlySysfs.clear ();
+  SetAll (values);
+  // The devices are created by tasks scheduled above: configure them after.
+  if (!m_netlinkRequests.empty ())
+    {
+      m_netlinkScheduled = true;
+      KernelSocketFdFactory::ScheduleTask (MakeEvent (&LinuxSocketFdFactory::NetlinkTask, this));
+    }
+}
+
+void
+LinuxSocketFdFactory::AddAddress (std::string ifname, Ipv4Address address, Ipv4Mask mask)
+{
+  NS_LOG_FUNCTION (this << ifname << address << mask);
+  struct NetlinkRequest request;
+  memset (request.address, 0, sizeof (request.address));
+  request.type = RTM_NEWADDR;
+  request.family = AF_INET;
+  request.prefixLength = mask.GetPrefixLength ();
+  request.gateway = false;
+  address.Serialize (request.address);
+  request.ifname = ifname;
+  AddNetlinkRequest (request);
+}
+
+void
+LinuxSocketFdFactory::AddAddress (std::string ifname, Ipv6Address address, Ipv6Prefix prefix)
+{
+  NS_LOG_FUNCTION (this << ifname << address << prefix);
+  struct NetlinkRequest request;
+  request.type = RTM_NEWADDR;
+  request.family = AF_INET6;
+  request.prefixLength = prefix.GetPrefixLength ();
+  request.gateway = false;
+  address.Serialize (request.address);
+  request.ifname = ifname;
+  AddNetlinkRequest (request);
+}
+
+void
+LinuxSocketFdFactory::SetLinkUp (std::string ifname, bool arp)
+{
+  NS_LOG_FUNCTION (this << ifname << arp);
+  struct NetlinkRequest request;
+  request.type = RTM_NEWLINK;
+  request.family = AF_UNSPEC;
+  request.prefixLength = 0;
+  request.arp = arp;
+  request.gateway = false;
+  request.ifname = ifname;
+  AddNetlinkRequest (request);
+}
+
+void
+LinuxSocketFdFactory::AddRoute (Ipv4Address dest, Ipv4Mask mask, Ipv4Address gateway, std::string ifname)
+{
+  NS_LOG_FUNCTION (this << dest << mask << gateway << ifname);
+  struct NetlinkRequest request;
+  memset (request.address, 0, sizeof (request.address));
+  memset (request.via, 0, sizeof (request.via));
+  request.type = RTM_NEWROUTE;
+  request.family = AF_INET;
+  request.prefixLength = mask.GetPrefixLength ();
+  request.gateway = (gateway != Ipv4Address::GetZero ());
+  dest.CombineMask (mask).Serialize (request.address);
+  gateway.Serialize (request.via);
+  request.ifname = ifname;
+  AddNetlinkRequest (request);
+}
+
+void
+LinuxSocketFdFactory::AddRoute (Ipv6Address dest, Ipv6Prefix prefix, Ipv6Address gateway, std::string ifname)
+{
+  NS_LOG_FUNCTION (this << dest << prefix << gateway << ifname);
+  struct NetlinkRequest request;
+  request.type = RTM_NEWROUTE;
+  request.family = AF_INET6;
+  request.prefixLength = prefix.GetPrefixLength ();
+  request.gateway = !gateway.IsAny ();
+  dest.CombinePrefix (prefix).Serialize (request.address);
+  gateway.Serialize (request.via);
+  request.ifname = ifname;
+  AddNetlinkRequest (request);
+}
+
+void
+LinuxSocketFdFactory::AddNetlinkRequest (const struct NetlinkRequest &request)
+{
+  m_netlinkRequests.push_back (request);
+  if (m_exported == 0 || m_netlinkScheduled)
+    {
+      // sent by InitializeStack or by the pending task.
+      return;
+    }
+  m_netlinkScheduled = true;
+  Ptr<Node> node = GetObject<Node> ();
+  Simulator::ScheduleWithContext (node->GetId (), Seconds (0.0),
+                                  &LinuxSocketFdFactory::ScheduleTask, this,
+                                  MakeEvent (&LinuxSocketFdFactory::NetlinkTask, this));
+}
+
+void
+LinuxSocketFdFactory::NetlinkAppend (std::vector<char> *batch, const struct NetlinkRequest &request,
+                                     int ifindex, uint32_t seq)
+{
+  union
+  {
+    struct ifaddrmsg addr;
+    struct ifinfomsg link;
+    struct rtmsg route;
+  } body;
+  size_t bodyLength;
+  uint16_t flags = NLM_F_REQUEST;
+  memset (&body, 0, sizeof (body));
+  switch (request.type)
+    {
+    case RTM_NEWADDR:
+      body.addr.ifa_family = request.family;
+      body.addr.ifa_prefixlen = request.prefixLength;
+      body.addr.ifa_scope = RT_SCOPE_UNIVERSE;
+      body.addr.ifa_index = ifindex;
+      bodyLength = sizeof (struct ifaddrmsg);
+      flags |= NLM_F_CREATE | NLM_F_EXCL;
+      break;
+    case RTM_NEWLINK:
+      body.link.ifi_family = AF_UNSPEC;
+      body.link.ifi_index = ifindex;
+      body.link.ifi_flags = IFF_UP | (request.arp ? 0 : IFF_NOARP);
+      body.link.ifi_change = IFF_UP | IFF_NOARP;
+      bodyLength = sizeof (struct ifinfomsg);
+      break;
+    default:
+      body.route.rtm_family = request.family;
+      body.route.rtm_dst_len = request.prefixLength;
+      body.route.rtm_table = RT_TABLE_MAIN;
+      body.route.rtm_protocol = RTPROT_BOOT;
+      body.route.rtm_scope = request.gateway ? RT_SCOPE_UNIVERSE : RT_SCOPE_LINK;
+      body.route.rtm_type = RTN_UNICAST;
+      bodyLength = sizeof (struct rtmsg);
+      // like "ip route replace": the kernel may already know the
+      // routes of the directly connected networks.
+      flags |= NLM_F_CREATE | NLM_F_REPLACE;
+      break;
+    }
 
-  while (!m_earlySysfs.empty ())
+  size_t addressLength = (request.family == AF_INET) ? 4 : 16;
+  struct
+  {
+    uint16_t type;
+    const void *data;
+    size_t length;
+  } attributes[3];
+  int nAttributes = 0;
+  if (request.type == RTM_NEWADDR)
     {
-      std::pair<std::string,std::string> op = m_earlySysfs.front ();
-      Set (op.first, op.second);
-      m_earlySysfs.pop_front ();
+      attributes[nAttributes].type = IFA_LOCAL;
+      attributes[nAttributes].data = request.address;
+      attributes[nAttributes++].length = addressLength;
+      attributes[nAttributes].type = IFA_ADDRESS;
+      attributes[nAttributes].data = request.address;
+      attributes[nAttributes++].length = addressLength;
+    }
+  else if (request.type == RTM_NEWROUTE)
+    {
+      attributes[nAttributes].type = RTA_DST;
+      attributes[nAttributes].data = request.address;
+      attributes[nAttributes++].length = addressLength;
+      if (request.gateway)
+        {
+          attributes[nAttributes].type = RTA_GATEWAY;
+          attributes[nAttributes].data = request.via;
+          attributes[nAttributes++].length = addressLength;
+        }
+      if (ifindex != 0)
+        {
+          attributes[nAttributes].type = RTA_OIF;
+          attributes[nAttributes].data = &ifindex;
+          attributes[nAttributes++].length = sizeof (ifindex);
+        }
+    }
+
+  size_t length = NLMSG_LENGTH (bodyLength);
+  for (int i = 0; i < nAttributes; i++)
+    {
+      length = NLMSG_ALIGN (length) + RTA_SPACE (attributes[i].length);
+    }
+  size_t offset = batch->size ();
+  batch->resize (offset + NLMSG_ALIGN (length), 0);
+  struct nlmsghdr *hdr = (struct nlmsghdr *)&(*batch)[offset];
+  hdr->nlmsg_len = length;
+  hdr->nlmsg_type = request.type;
+  hdr->nlmsg_flags = flags;
+  hdr->nlmsg_seq = seq;
+  hdr->nlmsg_pid = 0;
+  memcpy (NLMSG_DATA (hdr), &body, bodyLength);
+  char *next = (char *)hdr + NLMSG_ALIGN (NLMSG_LENGTH (bodyLength));
+  for (int i = 0; i < nAttributes; i++)
+    {
+      struct rtattr *rta = (struct rtattr *)next;
+      rta->rta_type = attributes[i].type;
+      rta->rta_len = RTA_LENGTH (attributes[i].length);
+      memcpy (RTA_DATA (rta), attributes[i].data, attributes[i].length);
+      next += RTA_SPACE (attributes[i].length);
+    }
+}
+
+std::string
+LinuxSocketFdFactory::NetlinkPrint (const struct NetlinkRequest &request)
+{
+  std::ostringstream oss;
+  if (request.type == RTM_NEWLINK)
+    {
+      oss << "link set " << request.ifname << " up";
+      return oss.str ();
+    }
+  oss << ((request.type == RTM_NEWADDR) ? "addr add " : "route replace ");
+  if (request.family == AF_INET)
+    {
+      oss << Ipv4Address::Deserialize (request.address);
+    }
+  else
+    {
+      oss << Ipv6Address::Deserialize (request.address);
+    }
+  oss << '/' << (int)request.prefixLength;
+  if (request.gateway && request.family == AF_INET)
+    {
+      oss << " via " << Ipv4Address::Deserialize (request.via);
+    }
+  else if (request.gateway)
+    {
+      oss << " via " << Ipv6Address::Deserialize (request.via);
+    }
+  if (!request.ifname.empty ())
+    {
+      oss << " dev " << request.ifname;
+    }
+  return oss.str ();
+}
+
+void
+LinuxSocketFdFactory::NetlinkTask (void)
+{
+  std::vector<struct NetlinkRequest> requests;
+  requests.swap (m_netlinkRequests);
+  m_netlinkScheduled = false;
+  NS_LOG_FUNCTION (this << requests.size ());
+
+  struct SimSocket *netlink;
+  struct SimSocket *inet;
+  int retval = m_exported->sock_socket (AF_NETLINK, SOCK_RAW, NETLINK_ROUTE, &netlink);
+  if (retval < 0)
+    {
+      NS_LOG_WARN ("Could not open a netlink socket: " << strerror (-retval));
+      return;
+    }
+  // to look the device indexes up.
+  retval = m_exported->sock_socket (AF_INET, SOCK_DGRAM, 0, &inet);
+  if (retval < 0)
+    {
+      NS_LOG_WARN ("Could not open an inet socket: " << strerror (-retval));
+      m_exported->sock_close (netlink);
+      return;
+    }
+
+  // Keep the batches well below the default socket send buffer.
+  const size_t batchSize = 16384;
+  std::map<std::string, int> indexes;
+  std::vector<char> batch;
+  batch.reserve (batchSize + 256);
+  for (uint32_t i = 0; i < requests.size (); i++)
+    {
+      int ifindex = 0;
+      if (!requests[i].ifname.empty ())
+        {
+          std::map<std::string, int>::iterator found = indexes.find (requests[i].ifname);
+          if (found == indexes.end ())
+            {
+              struct ifreq ifr;
+              memset (&ifr, 0, sizeof (ifr));
+              strncpy (ifr.ifr_name, requests[i].ifname.c_str (), IFNAMSIZ - 1);
+              retval = m_exported->sock_ioctl (inet, SIOCGIFINDEX, (char *)&ifr);
+              found = indexes.insert (std::make_pair (requests[i].ifname,
+                                                      (retval < 0) ? 0 : ifr.ifr_ifindex)).first;
+            }
+          ifindex = found->second;
+          if (ifindex == 0)
+            {
+              NS_LOG_WARN ("ip " << NetlinkPrint (requests[i]) << ": no such device");
+              continue;
+            }
+        }
+      if (batch.size () >= batchSize)
+        {
+          NetlinkSend (netlink, &batch, requests);
+        }
+      NetlinkAppend (&batch, requests[i], ifindex, i + 1);
+    }
+  NetlinkSend (netlink, &batch, requests);
+
+  m_exported->sock_close (inet);
+  m_exported->sock_close (netlink);
+}
+
+void
+LinuxSocketFdFactory::NetlinkSend (struct SimSocket *socket, std::vector<char> *batch,
+                                   const std::vector<struct NetlinkRequest> &requests)
+{
+  if (batch->empty ())
+    {
+      return;
+    }
+  struct sockaddr_nl kernel;
+  memset (&kernel, 0, sizeof (kernel));
+  kernel.nl_family = AF_NETLINK;
+  struct iovec iov;
+  iov.iov_base = &(*batch)[0];
+  iov.iov_len = batch->size ();
+  struct msghdr msg;
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_name = &kernel;
+  msg.msg_namelen = sizeof (kernel);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  ssize_t sent = m_exported->sock_sendmsg (socket, &msg, 0);
+  if (sent < 0)
+    {
+      NS_LOG_WARN ("netlink batch of " << batch->size () << " bytes failed: " << strerror (-sent));
+    }
+  batch->clear ();
+
+  // Without NLM_F_ACK, the kernel only answers to the failed requests.
+  char buffer[4096];
+  while (true)
+    {
+      iov.iov_base = buffer;
+      iov.iov_len = sizeof (buffer);
+      msg.msg_name = 0;
+      msg.msg_namelen = 0;
+      int len = m_exported->sock_recvmsg (socket, &msg, MSG_DONTWAIT);
+      if (len <= 0)
+        {
+          break;
+        }
+      for (struct nlmsghdr *hdr = (struct nlmsghdr *)buffer; NLMSG_OK (hdr, len); hdr = NLMSG_NEXT (hdr, len))
+        {
+          struct nlmsgerr *err = (struct nlmsgerr *)NLMSG_DATA (hdr);
+          if (hdr->nlmsg_type != NLMSG_ERROR || err->error == 0
+              || hdr->nlmsg_seq == 0 || hdr->nlmsg_seq > requests.size ())
+            {
+              continue;
+            }
+          NS_LOG_WARN ("ip " << NetlinkPrint (requests[hdr->nlmsg_seq - 1])
+                             << ": " << strerror (-err->error));
+        }
     }
 }
 
@@ -2,7 +2,10 @@
 #define LINUX_SOCKET_FD_FACTORY_H
 
 #include "kernel-socket-fd-factory.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
 #include <vector>
+#include <map>
 
 extern "C" {
 struct SimExported;
@@ -24,14 +27,59 @@ public:
 
   void Set (std::string path, std::string value);
   std::string Get (std::string path);
+  // Same as Set for many paths, with a single kernel task and a single
+  // walk of the sysctl tree. The values are written in the given order.
+  void SetAll (std::vector<std::pair<std::string,std::string> > values);
+  // Read all the sysctl files whose path starts with prefix, e.g. ".net".
+  std::map<std::string,std::string> GetAll (std::string prefix);
+
+  /**
+   * rtnetlink configuration of the kernel, i.e. what "ip addr add",
+   * "ip link set up" and "ip route replace" do, without starting an
+   * ip process per command. The requests issued during the same
+   * event are sent in batches by a single kernel task, or when the
+   * stack is initialized if it is not yet. Failures are logged.
+   *
+   * \param ifname the name of the kernel device, e.g. "sim0"
+   */
+  void AddAddress (std::string ifname, Ipv4Address address, Ipv4Mask mask);
+  void AddAddress (std::string ifname, Ipv6Address address, Ipv6Prefix prefix);
+  void SetLinkUp (std::string ifname, bool arp);
+  /**
+   * \param ifname the output device, may be empty when there is a gateway.
+   */
+  void AddRoute (Ipv4Address dest, Ipv4Mask mask, Ipv4Address gateway, std::string ifname);
+  void AddRoute (Ipv6Address dest, Ipv6Prefix prefix, Ipv6Address gateway, std::string ifname);
 
 private:
+  struct NetlinkRequest
+  {
+    uint16_t type;        // RTM_NEWADDR, RTM_NEWLINK or RTM_NEWROUTE
+    uint8_t family;
+    uint8_t prefixLength;
+    bool arp;
+    bool gateway;
+    uint8_t address[16];  // local address or route destination
+    uint8_t via[16];      // route gateway
+    std::string ifname;
+  };
+
   virtual void NotifyNewAggregate (void);
   void InitializeStack (void);
   std::vector<std::pair<std::string,struct SimSysFile *> > GetSysFileList (void);
   void SetTask (std::string path, std::string value);
+  void SetAllTask (std::vector<std::pair<std::string,std::string> > values);
+  void AddNetlinkRequest (const struct NetlinkRequest &request);
+  void NetlinkTask (void);
+  void NetlinkSend (struct SimSocket *socket, std::vector<char> *batch,
+                    const std::vector<struct NetlinkRequest> &requests);
+  static void NetlinkAppend (std::vector<char> *batch, const struct NetlinkRequest &request,
+                             int ifindex, uint32_t seq);
+  static std::string NetlinkPrint (const struct NetlinkRequest &request);
 
   std::list<std::pair<std::string,std::string> > m_earlySysfs;
+  std::vector<struct NetlinkRequest> m_netlinkRequests;
+  bool m_netlinkScheduled;
 };
 
 } // namespace ns3
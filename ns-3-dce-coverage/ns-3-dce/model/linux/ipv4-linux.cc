@@ -29,6 +29,7 @@
 #include "ns3/ipv4-global-routing.h"
 #include "ns3/ipv4-routing-table-entry.h"
 #include "linux-stack-helper.h"
+#include "linux-socket-fd-factory.h"
 #include "linux-ipv4-raw-socket-factory-impl.h"
 #include "linux-udp-socket-factory-impl.h"
 #include "linux-tcp-socket-factory-impl.h"
@@ -266,8 +267,18 @@ Ipv4Linux::AddAddress (uint32_t i, Ipv4InterfaceAddress address)
       m_routingProtocol->NotifyAddAddress (i, address);
     }
 
-  std::ostringstream oss;
   Ptr<Node> node = this->GetObject<Node> ();
+  Ptr<LinuxSocketFdFactory> kernel = node->GetObject<LinuxSocketFdFactory> ();
+  if (kernel != 0)
+    {
+      std::ostringstream ifname;
+      ifname << "sim" << i;
+      kernel->AddAddress (ifname.str (), address.GetLocal (), address.GetMask ());
+      kernel->SetLinkUp (ifname.str (), interface->GetDevice ()->NeedsArp ());
+      return retVal;
+    }
+
+  std::ostringstream oss;
   oss << "-f inet addr add ";
   address.GetLocal ().Print (oss);
   oss << '/' << address.GetMask ().GetPrefixLength () << " dev sim" << i;
@@ -561,6 +572,24 @@ Ipv4Linux::PopulateRoutingTable ()
   Ptr<Ipv4GlobalRouting> globalRouting = DynamicCast<Ipv4GlobalRouting> (GetRoutingProtocol ());
   NS_ASSERT_MSG (globalRouting, "No global routing");
 
+  Ptr<LinuxSocketFdFactory> kernel = node->GetObject<LinuxSocketFdFactory> ();
+  if (kernel != 0)
+    {
+      for (uint32_t i = 0; i < globalRouting->GetNRoutes (); i++)
+        {
+          Ipv4RoutingTableEntry route = globalRouting->GetRoute (i);
+          std::ostringstream ifname;
+          if (route.GetGateway () == Ipv4Address::GetZero ())
+            {
+              ifname << "sim" << route.GetInterface ();
+            }
+          kernel->AddRoute (route.GetDest (), route.GetDestNetworkMask (),
+                            route.GetGateway (), ifname.str ());
+        }
+      kernel->SetLinkUp ("lo", false);
+      return;
+    }
+
   for (uint32_t i = 0; i < globalRouting->GetNRoutes (); i++)
     {
       Ipv4RoutingTableEntry route = globalRouting->GetRoute (i);
@@ -22,10 +22,13 @@
 #include "ns3/log.h"
 #include "ns3/node.h"
 #include "linux-stack-helper.h"
+#include "linux-socket-fd-factory.h"
 #include "ns3/ipv6-list-routing-helper.h"
 #include "ns3/ipv6-static-routing-helper.h"
 //#include "ns3/ipv6-global-routing-helper.h"
 #include "ns3/ipv6-interface.h"
+#include "ns3/ipv6-static-routing.h"
+#include "ns3/ipv6-routing-table-entry.h"
 #include "linux-ipv6-raw-socket-factory-impl.h"
 #include "linux-udp6-socket-factory-impl.h"
 #include "linux-tcp6-socket-factory-impl.h"
@@ -203,8 +206,18 @@ Ipv6Linux::AddAddress (uint32_t i, Ipv6InterfaceAddress address)
       m_routingProtocol->NotifyAddAddress (i, address);
     }
 
-  std::ostringstream oss;
   Ptr<Node> node = this->GetObject<Node> ();
+  Ptr<LinuxSocketFdFactory> kernel = node->GetObject<LinuxSocketFdFactory> ();
+  if (kernel != 0)
+    {
+      std::ostringstream ifname;
+      ifname << "sim" << i;
+      kernel->AddAddress (ifname.str (), address.GetAddress (), address.GetPrefix ());
+      kernel->SetLinkUp (ifname.str (), interface->GetDevice ()->NeedsArp ());
+      return retVal;
+    }
+
+  std::ostringstream oss;
   oss << "-f inet6 addr add ";
   address.GetAddress ().Print (oss);
   oss << address.GetPrefix () << " dev sim" << i;
@@ -460,6 +473,40 @@ Ipv6Linux::InstallNode (Ptr<Node> node)
   Ptr<LinuxSctp6SocketFactoryImpl> sctp6Factory = CreateObject<LinuxSctp6SocketFactoryImpl> ();
   node->AggregateObject (sctp6Factory);
 }
+void
+Ipv6Linux::PopulateRoutingTable ()
+{
+  // Only support Ipv6StaticRouting
+  Ptr<Node> node = this->GetObject<Node> ();
+  Ipv6StaticRoutingHelper helper;
+  Ptr<Ipv6StaticRouting> staticRouting = helper.GetStaticRouting (Ptr<Ipv6> (this));
+  NS_ASSERT_MSG (staticRouting, "No static routing");
+  Ptr<LinuxSocketFdFactory> kernel = node->GetObject<LinuxSocketFdFactory> ();
+  if (kernel == 0)
+    {
+      NS_LOG_WARN ("No LinuxSocketFdFactory on node " << node->GetId ());
+      return;
+    }
+
+  for (uint32_t i = 0; i < staticRouting->GetNRoutes (); i++)
+    {
+      Ipv6RoutingTableEntry route = staticRouting->GetRoute (i);
+      // the kernel sets these up by itself.
+      if (route.GetDest ().IsLinkLocal () || route.GetDest ().IsMulticast ()
+          || route.GetDest ().IsLocalhost ())
+        {
+          continue;
+        }
+      std::ostringstream ifname;
+      if (route.GetGateway ().IsAny ())
+        {
+          ifname << "sim" << route.GetInterface ();
+        }
+      kernel->AddRoute (route.GetDest (), route.GetDestNetworkPrefix (),
+                        route.GetGateway (), ifname.str ());
+    }
+}
+
 Ptr<Ipv6Interface>
 Ipv6Linux::GetInterface (uint32_t index) const
 {
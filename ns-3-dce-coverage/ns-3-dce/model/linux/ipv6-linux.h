@@ -276,6 +276,7 @@ public:
   virtual void DeleteRawSocket (Ptr<Socket> socket);
 
   static void InstallNode (Ptr<Node> node);
+  void PopulateRoutingTable ();
 
   /**
    * \brief Register the IPv6 Extensions.
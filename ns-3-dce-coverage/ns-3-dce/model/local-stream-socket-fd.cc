@@ -52,7 +52,8 @@ LocalStreamSocketFd::GetInstanceTypeId (void) const
 }
 LocalStreamSocketFd::LocalStreamSocketFd (Ptr<LocalSocketFdFactory> f)
   : m_state (CREATED),
-    m_backLog (0)
+    m_backLog (0),
+    m_buffer (LOCAL_SOCKET_MAX_BUFFER)
 {
   NS_LOG_FUNCTION (this);
   m_factory = f;
@@ -61,7 +62,8 @@ LocalStreamSocketFd::LocalStreamSocketFd (Ptr<LocalSocketFdFactory> f)
 LocalStreamSocketFd::LocalStreamSocketFd (LocalStreamSocketFd *peer, std::string bindPath)
   : m_state (CONNECTED),
     m_backLog (0),
-    m_peer (peer)
+    m_peer (peer),
+    m_buffer (LOCAL_SOCKET_MAX_BUFFER)
 {
   NS_LOG_FUNCTION (this);
   m_bindPath = bindPath;
@@ -274,9 +276,10 @@ LocalStreamSocketFd::Read (void *buf, size_t count)
   size_t filled = 0;
   WaitQueueEntryTimeout *wq = 0;
 
-  while ((filled < count) && ((m_state == CONNECTED) || ((REMOTECLOSED == m_state) && (m_readBufferSize > 0))))
+  while ((filled < count) && ((m_state == CONNECTED) || ((REMOTECLOSED == m_state) && (m_buffer.GetSize () > 0))))
     {
-      size_t lg = ReadData ((uint8_t*) buf + filled, count - filled, false);
+      ssize_t space = m_buffer.GetSpace ();
+      size_t lg = m_buffer.Read ((uint8_t*) buf + filled, count - filled);
       if (0 == lg)
         {
           if (m_statusFlags & O_NONBLOCK)
@@ -337,7 +340,10 @@ LocalStreamSocketFd::Read (void *buf, size_t count)
       else if (lg > 0)
         {
           filled += lg;
-          if  (0 != m_peer)
+          // Wake up the writer only when a whole page became free, not
+          // for each small read: see also CanSend.
+          if ((0 != m_peer) && (space < FifoBuffer::PAGE_LENGTH)
+              && (m_buffer.GetSpace () >= FifoBuffer::PAGE_LENGTH))
             {
               short po = POLLOUT;
               m_peer->WakeWaiters (&po);
@@ -988,7 +994,7 @@ LocalStreamSocketFd::CanRecv (void) const
     case CONNECTED:
     case REMOTECLOSED:
       {
-        return (m_readBufferSize > 0);
+        return (m_buffer.GetSize () > 0);
       }
 
     case LISTENING:
@@ -1004,7 +1010,7 @@ LocalStreamSocketFd::CanRecv (void) const
 bool
 LocalStreamSocketFd::CanSend (void) const
 {
-  return ((CONNECTED == m_state) && (0 != m_peer) && (m_peer->m_readBufferSize < LOCAL_SOCKET_MAX_BUFFER))
+  return ((CONNECTED == m_state) && (0 != m_peer) && (m_peer->m_buffer.GetSpace () >= FifoBuffer::PAGE_LENGTH))
          || (CONNECTED != m_state);
 }
 bool
@@ -1089,6 +1095,7 @@ LocalStreamSocketFd::ClearAll (bool andWakeUp)
   m_cnxQueue.clear ();
 
   ClearReadBuffer ();
+  m_buffer.Clear ();
 
   if (andWakeUp)
     {
@@ -1103,6 +1110,31 @@ LocalStreamSocketFd::IsShutWrite (void) const
   return m_shutWrite;
 }
 
+ssize_t
+LocalStreamSocketFd::DoRecvPacket (uint8_t* buf, size_t len)
+{
+  NS_LOG_FUNCTION (this << len << " shutRead:" << m_shutRead << "Closed:" << IsClosed ());
+
+  if ((m_shutRead)|| IsClosed ())
+    {
+      return -2;
+    }
+  ssize_t l = m_buffer.Write (buf, len);
+  if (l < 0)
+    {
+      Thread *current = Current ();
+      NS_ASSERT (current != 0);
+      current->err = ENOMEM;
+      return -1;
+    }
+  if (l > 0)
+    {
+      short pi = POLLIN;
+      WakeWaiters (&pi); // WakeUp reader or poller for read or select for read
+    }
+  return l;
+}
+
 bool
 LocalStreamSocketFd::IsClosed (void) const
 {
@@ -27,6 +27,7 @@
 #include "ns3/nstime.h"
 #include "ns3/object.h"
 #include "local-socket-fd.h"
+#include "fifo-buffer.h"
 #include "wait-queue.h"
 
 namespace ns3 {
@@ -96,6 +97,10 @@ private:
   void SetPeer (LocalStreamSocketFd *sock);
   void PeerClosed (void);
   bool IsShutWrite (void) const;
+  // Same contract as LocalSocketFd::DoRecvPacket, but stream data does not
+  // need to keep write boundaries: it goes to m_buffer instead of
+  // LocalSocketFd::m_readBuffer.
+  ssize_t DoRecvPacket (uint8_t* buf, size_t len);
 
   enum State
   {
@@ -114,7 +119,7 @@ private:
   FifoCnx m_cnxQueue;
   int m_backLog;
   LocalStreamSocketFd *m_peer;
-
+  FifoBuffer m_buffer;
 };
 
 } // namespace ns3
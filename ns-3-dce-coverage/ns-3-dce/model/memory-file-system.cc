@@ -0,0 +1,524 @@
+#include "memory-file-system.h"
+#include "utils.h"
+#include "process.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/string.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE ("MemoryFileSystem");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (MemoryFileSystem);
+
+MemoryFile::MemoryFile (ino_t i, mode_t m, uid_t u, gid_t g)
+  : ino (i),
+    mode (m),
+    uid (u),
+    gid (g),
+    nlink (1),
+    dirty (false)
+{
+  Touch (true);
+}
+void
+MemoryFile::Touch (bool modified)
+{
+  Time now = UtilsSimulationTimeToTime (Simulator::Now ());
+  atime = now;
+  if (modified)
+    {
+      mtime = ctime = now;
+      dirty = true;
+    }
+}
+template <typename T>
+static void
+FillStat (const MemoryFile *file, T *buf)
+{
+  memset (buf, 0, sizeof (*buf));
+  buf->st_dev = 0;
+  buf->st_ino = file->ino;
+  buf->st_mode = S_IFREG | file->mode;
+  buf->st_nlink = file->nlink;
+  buf->st_uid = file->uid;
+  buf->st_gid = file->gid;
+  buf->st_size = file->data.size ();
+  buf->st_blksize = 4096;
+  buf->st_blocks = (file->data.size () + 511) / 512;
+  buf->st_atim = UtilsTimeToTimespec (file->atime);
+  buf->st_mtim = UtilsTimeToTimespec (file->mtime);
+  buf->st_ctim = UtilsTimeToTimespec (file->ctime);
+}
+void
+MemoryFile::Stat (struct ::stat *buf) const
+{
+  FillStat (this, buf);
+}
+void
+MemoryFile::Stat (struct ::stat64 *buf) const
+{
+  FillStat (this, buf);
+}
+
+TypeId
+MemoryFileSystem::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MemoryFileSystem")
+    .SetParent<Object> ()
+    .AddConstructor<MemoryFileSystem> ()
+    .AddAttribute ("BaseDirectory",
+                   "Read only image shared by the nodes. Files missing from the "
+                   "files-<node> directory of the node are looked for in it.",
+                   StringValue (""),
+                   MakeStringAccessor (&MemoryFileSystem::m_baseDirectory),
+                   MakeStringChecker ())
+    .AddAttribute ("FlushOnDispose",
+                   "Write the files modified in memory to the node directory "
+                   "at the end of the simulation.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&MemoryFileSystem::m_flushOnDispose),
+                   MakeBooleanChecker ())
+  ;
+  return tid;
+}
+
+MemoryFileSystem::MemoryFileSystem ()
+  : m_flushOnDispose (false),
+    m_nextIno (1 << 30)
+{
+  NS_LOG_FUNCTION (this);
+  memset (&m_stats, 0, sizeof (m_stats));
+}
+
+MemoryFileSystem::~MemoryFileSystem ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+MemoryFileSystem::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_flushOnDispose)
+    {
+      Flush ();
+    }
+  struct Statistics stats = GetStatistics ();
+  NS_LOG_INFO ("opens " << stats.opens << " lower opens " << stats.lowerOpens
+                        << " copy ups " << stats.copyUps << " read " << stats.bytesRead
+                        << " written " << stats.bytesWritten << " files " << stats.files
+                        << " memory " << stats.memory);
+  m_files.clear ();
+  m_hidden.clear ();
+  Object::DoDispose ();
+}
+
+std::string
+MemoryFileSystem::Normalize (std::string path)
+{
+  // Keep the node directory (first component), resolve . and .. after.
+  std::string::size_type slash = path.find ('/');
+  if (slash == std::string::npos)
+    {
+      return path;
+    }
+  std::vector<std::string> parts;
+  std::string::size_type start = slash + 1;
+  while (start <= path.length ())
+    {
+      std::string::size_type end = path.find ('/', start);
+      if (end == std::string::npos)
+        {
+          end = path.length ();
+        }
+      std::string part = path.substr (start, end - start);
+      if (part == "..")
+        {
+          if (!parts.empty ())
+            {
+              parts.pop_back ();
+            }
+        }
+      else if (part != "" && part != ".")
+        {
+          parts.push_back (part);
+        }
+      start = end + 1;
+    }
+  std::string result = path.substr (0, slash);
+  for (std::vector<std::string>::iterator i = parts.begin (); i != parts.end (); ++i)
+    {
+      result += "/" + *i;
+    }
+  return result;
+}
+
+bool
+MemoryFileSystem::IsPassThrough (std::string path)
+{
+  // Process logs are read by the users and appended to by DceManager
+  // from outside of the processes, devices are host files.
+  static const char *hostDirs[] = { "/var/log/", "/dev/", "/proc/", "/sys/", 0 };
+  std::string::size_type slash = path.find ('/');
+  if (slash == std::string::npos)
+    {
+      return true;
+    }
+  for (int i = 0; hostDirs[i] != 0; i++)
+    {
+      if (path.compare (slash, strlen (hostDirs[i]), hostDirs[i]) == 0)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+std::string
+MemoryFileSystem::GetLowerPath (std::string path) const
+{
+  path = Normalize (path);
+  if (m_baseDirectory == "")
+    {
+      return path;
+    }
+  struct ::stat st;
+  if (::stat (path.c_str (), &st) == 0)
+    {
+      return path;
+    }
+  std::string::size_type slash = path.find ('/');
+  if (slash == std::string::npos)
+    {
+      return m_baseDirectory;
+    }
+  return m_baseDirectory + path.substr (slash);
+}
+
+bool
+MemoryFileSystem::LowerExists (std::string path, struct ::stat *st) const
+{
+  if (IsHidden (path))
+    {
+      return false;
+    }
+  return ::stat (GetLowerPath (path).c_str (), st) == 0;
+}
+
+Ptr<MemoryFile>
+MemoryFileSystem::AddFile (std::string path, mode_t mode)
+{
+  Thread *current = Current ();
+  uid_t uid = current ? current->process->euid : 0;
+  gid_t gid = current ? current->process->egid : 0;
+  Ptr<MemoryFile> file = Create<MemoryFile> (m_nextIno++, mode & 07777, uid, gid);
+  m_files[path] = file;
+  m_hidden.erase (path);
+  return file;
+}
+
+bool
+MemoryFileSystem::CopyUp (std::string path, Ptr<MemoryFile> file)
+{
+  NS_LOG_FUNCTION (this << path);
+  int fd = ::open (GetLowerPath (path).c_str (), O_RDONLY);
+  if (fd == -1)
+    {
+      return false;
+    }
+  uint8_t buf[8192];
+  ssize_t r;
+  while ((r = ::read (fd, buf, sizeof (buf))) > 0)
+    {
+      file->data.insert (file->data.end (), buf, buf + r);
+    }
+  ::close (fd);
+  m_stats.copyUps++;
+  return r == 0;
+}
+
+void
+MemoryFileSystem::Forget (Files::iterator i)
+{
+  i->second->nlink = 0;
+  m_files.erase (i);
+}
+
+Ptr<MemoryFile>
+MemoryFileSystem::Open (std::string path, int flags, mode_t mode, int *err)
+{
+  NS_LOG_FUNCTION (this << path << flags << mode);
+  *err = 0;
+  path = Normalize (path);
+  if (IsPassThrough (path) || (flags & O_DIRECTORY))
+    {
+      return 0;
+    }
+  bool write = ((flags & O_ACCMODE) != O_RDONLY) || (flags & O_TRUNC);
+  bool exclusive = (flags & O_CREAT) && (flags & O_EXCL);
+
+  Ptr<MemoryFile> file = Lookup (path);
+  if (file != 0)
+    {
+      if (exclusive)
+        {
+          *err = EEXIST;
+          return 0;
+        }
+    }
+  else
+    {
+      struct ::stat st;
+      if (LowerExists (path, &st))
+        {
+          if (exclusive)
+            {
+              *err = EEXIST;
+              return 0;
+            }
+          if (!S_ISREG (st.st_mode) || !write)
+            {
+              // Served by the lower layer as long as it is not modified.
+              m_stats.lowerOpens++;
+              return 0;
+            }
+          file = AddFile (path, st.st_mode);
+          file->uid = st.st_uid;
+          file->gid = st.st_gid;
+          if (!(flags & O_TRUNC) && !CopyUp (path, file))
+            {
+              *err = errno;
+              Forget (m_files.find (path));
+              return 0;
+            }
+        }
+      else
+        {
+          if (!(flags & O_CREAT))
+            {
+              *err = ENOENT;
+              return 0;
+            }
+          std::string parent = path.substr (0, path.rfind ('/'));
+          struct ::stat pst;
+          if ((::stat (parent.c_str (), &pst) != 0)
+              && (::stat (GetLowerPath (parent).c_str (), &pst) != 0))
+            {
+              *err = ENOENT;
+              return 0;
+            }
+          if (!S_ISDIR (pst.st_mode))
+            {
+              *err = ENOTDIR;
+              return 0;
+            }
+          file = AddFile (path, mode);
+        }
+    }
+  if ((flags & O_TRUNC) && write)
+    {
+      file->data.clear ();
+      file->Touch (true);
+    }
+  m_stats.opens++;
+  return file;
+}
+
+Ptr<MemoryFile>
+MemoryFileSystem::Lookup (std::string path) const
+{
+  Files::const_iterator i = m_files.find (Normalize (path));
+  if (i == m_files.end ())
+    {
+      return 0;
+    }
+  return i->second;
+}
+
+bool
+MemoryFileSystem::IsHidden (std::string path) const
+{
+  return m_hidden.find (Normalize (path)) != m_hidden.end ();
+}
+
+std::vector<std::string>
+MemoryFileSystem::List (std::string directory) const
+{
+  std::string prefix = Normalize (directory) + "/";
+  std::vector<std::string> names;
+  for (Files::const_iterator i = m_files.lower_bound (prefix);
+       i != m_files.end () && i->first.compare (0, prefix.length (), prefix) == 0; ++i)
+    {
+      std::string name = i->first.substr (prefix.length ());
+      struct ::stat st;
+      if (name.find ('/') == std::string::npos && !LowerExists (i->first, &st))
+        {
+          names.push_back (name);
+        }
+    }
+  return names;
+}
+
+int
+MemoryFileSystem::Unlink (std::string path)
+{
+  NS_LOG_FUNCTION (this << path);
+  path = Normalize (path);
+  if (IsPassThrough (path))
+    {
+      return -1;
+    }
+  Files::iterator i = m_files.find (path);
+  struct ::stat st;
+  bool lower = LowerExists (path, &st);
+  if (lower && S_ISDIR (st.st_mode))
+    {
+      return -1;
+    }
+  if (i == m_files.end () && !lower)
+    {
+      return ENOENT;
+    }
+  if (i != m_files.end ())
+    {
+      Forget (i);
+    }
+  if (lower)
+    {
+      m_hidden.insert (path);
+    }
+  return 0;
+}
+
+int
+MemoryFileSystem::Rename (std::string from, std::string to)
+{
+  NS_LOG_FUNCTION (this << from << to);
+  from = Normalize (from);
+  to = Normalize (to);
+  if (IsPassThrough (from) || IsPassThrough (to))
+    {
+      return -1;
+    }
+  Ptr<MemoryFile> file = Lookup (from);
+  struct ::stat st;
+  bool lower = LowerExists (from, &st);
+  if (file == 0)
+    {
+      if (!lower)
+        {
+          return ENOENT;
+        }
+      if (!S_ISREG (st.st_mode))
+        {
+          return -1;
+        }
+      file = AddFile (from, st.st_mode);
+      file->uid = st.st_uid;
+      file->gid = st.st_gid;
+      if (!CopyUp (from, file))
+        {
+          int err = errno;
+          Forget (m_files.find (from));
+          return err;
+        }
+    }
+  if (from == to)
+    {
+      return 0;
+    }
+  struct ::stat tst;
+  if (LowerExists (to, &tst) && S_ISDIR (tst.st_mode))
+    {
+      return EISDIR;
+    }
+  Files::iterator i = m_files.find (to);
+  if (i != m_files.end ())
+    {
+      Forget (i);
+    }
+  m_files.erase (from);
+  if (lower)
+    {
+      m_hidden.insert (from);
+    }
+  m_files[to] = file;
+  m_hidden.erase (to);
+  file->dirty = true;
+  return 0;
+}
+
+void
+MemoryFileSystem::NotifyRead (size_t bytes)
+{
+  m_stats.reads++;
+  m_stats.bytesRead += bytes;
+}
+
+void
+MemoryFileSystem::NotifyWrite (size_t bytes)
+{
+  m_stats.writes++;
+  m_stats.bytesWritten += bytes;
+}
+
+struct MemoryFileSystem::Statistics
+MemoryFileSystem::GetStatistics (void) const
+{
+  struct Statistics stats = m_stats;
+  stats.files = m_files.size ();
+  stats.memory = 0;
+  for (Files::const_iterator i = m_files.begin (); i != m_files.end (); ++i)
+    {
+      stats.memory += i->second->data.capacity ();
+    }
+  return stats;
+}
+
+void
+MemoryFileSystem::Flush (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (std::set<std::string>::iterator i = m_hidden.begin (); i != m_hidden.end (); ++i)
+    {
+      // Only the node directory is written, never the base image.
+      ::unlink (i->c_str ());
+    }
+  for (Files::iterator i = m_files.begin (); i != m_files.end (); ++i)
+    {
+      Ptr<MemoryFile> file = i->second;
+      if (!file->dirty)
+        {
+          continue;
+        }
+      UtilsEnsureAllDirectoriesExist (i->first);
+      int fd = ::open (i->first.c_str (), O_WRONLY | O_CREAT | O_TRUNC, file->mode);
+      if (fd == -1)
+        {
+          NS_LOG_WARN ("Could not flush " << i->first << ": " << strerror (errno));
+          continue;
+        }
+      size_t done = 0;
+      while (done < file->data.size ())
+        {
+          ssize_t w = ::write (fd, &file->data[done], file->data.size () - done);
+          if (w <= 0)
+            {
+              NS_LOG_WARN ("Could not flush " << i->first << ": " << strerror (errno));
+              break;
+            }
+          done += w;
+        }
+      ::close (fd);
+      file->dirty = false;
+      m_stats.flushed++;
+    }
+}
+
+} // namespace ns3
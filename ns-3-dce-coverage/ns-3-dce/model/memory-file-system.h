@@ -0,0 +1,138 @@
+#ifndef MEMORY_FILE_SYSTEM_H
+#define MEMORY_FILE_SYSTEM_H
+
+#include "ns3/object.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/nstime.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+namespace ns3 {
+
+/**
+ * A regular file kept in memory by a MemoryFileSystem.
+ *
+ * It stays alive while a process has it opened, even once unlinked.
+ */
+struct MemoryFile : public SimpleRefCount<MemoryFile>
+{
+  MemoryFile (ino_t ino, mode_t mode, uid_t uid, gid_t gid);
+
+  void Stat (struct ::stat *buf) const;
+  void Stat (struct ::stat64 *buf) const;
+  void Touch (bool modified);
+
+  std::vector<uint8_t> data;
+  ino_t ino;
+  mode_t mode;
+  uid_t uid;
+  gid_t gid;
+  nlink_t nlink;
+  Time atime;
+  Time mtime;
+  Time ctime;
+  // Modified since loaded from the lower layer.
+  bool dirty;
+};
+
+/**
+ * \brief Optional in memory backend for the regular files of a node.
+ *
+ * When aggregated to a node (see
+ * DceManagerHelper::EnableMemoryFileSystem), the regular files written
+ * by the processes of the node are kept in memory instead of the
+ * files-<node> directory of the host.
+ *
+ * The files-<node> directory, or the BaseDirectory image shared by all
+ * the nodes, is a read only lower layer: files only read are opened from
+ * there, a file is copied in memory the first time it is opened for
+ * writing, and unlinked lower files are hidden but never removed.
+ * Directories, and the process logs of /var/log, stay on the host:
+ * readdir adds the files of the directory which are only in memory to
+ * the host entries, and skips the unlinked lower files; scandir and the
+ * directories opened by fdopendir only list the host.
+ *
+ * Paths are the ones returned by UtilsGetRealFilePath.
+ */
+class MemoryFileSystem : public Object
+{
+public:
+  struct Statistics
+  {
+    uint64_t opens;        // opens served from memory
+    uint64_t lowerOpens;   // read only opens left to the lower layer
+    uint64_t copyUps;      // lower files copied in memory
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+    uint64_t files;        // files currently in memory
+    uint64_t memory;       // bytes currently held by these files
+    uint64_t flushed;      // files written back by Flush
+  };
+
+  static TypeId GetTypeId (void);
+
+  MemoryFileSystem ();
+  virtual ~MemoryFileSystem ();
+
+  /**
+   * \param path the file to open
+   * \param flags open flags
+   * \param mode the mode of the file if created, umask applied.
+   * \param err set to the errno value on failure
+   * \returns the file, or 0. If 0 is returned and err is 0, the caller
+   *          opens the file from GetLowerPath (path) by itself.
+   */
+  Ptr<MemoryFile> Open (std::string path, int flags, mode_t mode, int *err);
+  // Return the file if path is in memory, 0 otherwise.
+  Ptr<MemoryFile> Lookup (std::string path) const;
+  // True if the lower file of path was unlinked.
+  bool IsHidden (std::string path) const;
+  // The names of the files of the directory which are only in memory:
+  // the host lists the others.
+  std::vector<std::string> List (std::string directory) const;
+  // Where to find path in the lower layer.
+  std::string GetLowerPath (std::string path) const;
+  // Return 0, an errno value, or -1 if the host must do it (directories,
+  // files outside of this file system).
+  int Unlink (std::string path);
+  int Rename (std::string from, std::string to);
+
+  void NotifyRead (size_t bytes);
+  void NotifyWrite (size_t bytes);
+  struct Statistics GetStatistics (void) const;
+
+  // Write the modified files to the node directory and remove the
+  // unlinked ones from it.
+  void Flush (void);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  typedef std::map<std::string, Ptr<MemoryFile> > Files;
+
+  static std::string Normalize (std::string path);
+  static bool IsPassThrough (std::string path);
+  bool LowerExists (std::string path, struct ::stat *st) const;
+  Ptr<MemoryFile> AddFile (std::string path, mode_t mode);
+  bool CopyUp (std::string path, Ptr<MemoryFile> file);
+  void Forget (Files::iterator i);
+
+  Files m_files;
+  std::set<std::string> m_hidden;
+  std::string m_baseDirectory;
+  bool m_flushOnDispose;
+  ino_t m_nextIno;
+  struct Statistics m_stats;
+};
+
+} // namespace ns3
+
+#endif /* MEMORY_FILE_SYSTEM_H */
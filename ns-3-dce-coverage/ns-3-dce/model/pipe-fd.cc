@@ -158,17 +158,11 @@ PipeFd::Read (void *buf, size_t count)
 
   while (true)
     {
+      ssize_t space = m_buf.GetSpace ();
       ssize_t r = m_buf.Read ((uint8_t*)buf, count);
       if (r > 0)
         {
-          short po = POLLOUT;
-          if (m_peer)
-            {
-              // WakeUp
-              m_peer->WakeWaiters (&po);
-            }
-          WakeWaiters (&po);
-
+          NotifyReadDone (space);
           RETURNFREE (r);
         }
       if (0 == m_peer)
@@ -210,6 +204,100 @@ PipeFd::Read (void *buf, size_t count)
     }
 }
 
+void
+PipeFd::NotifyReadDone (ssize_t spaceBefore)
+{
+  // Wake up the writers only when a whole page became free, not for
+  // each small read: see also Poll.
+  if ((spaceBefore >= FifoBuffer::PAGE_LENGTH)
+      || (m_buf.GetSpace () < FifoBuffer::PAGE_LENGTH))
+    {
+      return;
+    }
+  short po = POLLOUT;
+  if (m_peer)
+    {
+      // WakeUp
+      m_peer->WakeWaiters (&po);
+    }
+  WakeWaiters (&po);
+}
+
+ssize_t
+PipeFd::Splice (PipeFd *out, size_t len, bool nonBlock)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << out << len << nonBlock);
+  NS_ASSERT (current != 0);
+
+  if (!m_readSide || out->m_readSide)
+    {
+      current->err = EBADF;
+      return -1;
+    }
+  if (out->m_peer == this)
+    {
+      // Both ends of the same pipe.
+      current->err = EINVAL;
+      return -1;
+    }
+  WaitQueueEntryTimeout *wq = 0;
+
+  while (true)
+    {
+      PipeFd *reader = out->m_peer;
+      if (0 == reader)
+        {
+          UtilsSendSignal (current->process, SIGPIPE);
+          UtilsDoSignal ();
+          current->err = EPIPE;
+          RETURNFREE (-1);
+        }
+      ssize_t space = m_buf.GetSpace ();
+      // Pages go from one pipe to the other without being copied.
+      ssize_t r = reader->m_buf.Splice (&m_buf, len);
+      if (r > 0)
+        {
+          NotifyReadDone (space);
+          short pi = POLLIN;
+          reader->WakeWaiters (&pi);
+          RETURNFREE (r);
+        }
+      if ((0 == m_buf.GetSize ()) && (0 == m_peer))
+        {
+          RETURNFREE (0);
+        }
+      if (nonBlock || (m_statusFlags & O_NONBLOCK))
+        {
+          current->err = EAGAIN;
+          RETURNFREE (-1);
+        }
+      // Either there is nothing to read or there is no room to write.
+      PipeFd *waitOn = this;
+      short events = POLLIN | POLLHUP;
+      if (m_buf.GetSize () > 0)
+        {
+          waitOn = reader;
+          events = POLLOUT | POLLHUP;
+        }
+      if (wq)
+        {
+          delete wq;
+        }
+      wq = new WaitQueueEntryTimeout (events, Time (0));
+      waitOn->AddWaitQueue (wq, true);
+      PollTable::Result res = wq->Wait ();
+      waitOn->RemoveWaitQueue (wq, true);
+
+      if (PollTable::INTERRUPTED == res)
+        {
+          UtilsDoSignal ();
+          current->err = EINTR;
+          RETURNFREE (-1);
+        }
+    }
+}
+
 ssize_t
 PipeFd::Recvmsg (struct msghdr *msg, int flags)
 {
@@ -448,7 +536,7 @@ PipeFd::Poll (PollTable* ptable)
     }
   else
     {
-      if (m_peer && (m_peer->m_buf.GetSpace () > 0))
+      if (m_peer && (m_peer->m_buf.GetSpace () >= FifoBuffer::PAGE_LENGTH))
         {
           ret |= POLLOUT;
         }
@@ -78,8 +78,13 @@ public:
   virtual int Poll (PollTable* ptable);
   virtual int Fsync (void);
 
+  // Move up to len bytes from this pipe (read side) to out (write side
+  // of another pipe). Whole pages are handed over, not copied.
+  ssize_t Splice (PipeFd *out, size_t len, bool nonBlock);
+
 private:
   ssize_t DoRecvPacket (uint8_t* buf, size_t len);
+  void NotifyReadDone (ssize_t spaceBefore);
 
   PipeFd* m_peer;
   bool m_readSide;
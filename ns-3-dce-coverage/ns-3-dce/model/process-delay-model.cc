@@ -21,6 +21,8 @@
 #include "ns3/log.h"
 #include "ns3/string.h"
 #include "ns3/pointer.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
 #include <sys/time.h>
 #include <time.h>
 
@@ -120,4 +122,118 @@ TimeOfDayProcessDelayModel::RecordEnd (void)
 }
 
 
+NS_OBJECT_ENSURE_REGISTERED (CpuTimeProcessDelayModel);
+
+// The THREAD clock of the host thread at its last RecordStart or
+// RecordEnd. With the PthreadFiberManager, RecordStart runs on the main
+// thread while the task, and its RecordEnd, run on a thread of its own
+// which is idle between two slices of the task.
+static __thread int64_t g_threadLast = 0;
+
+TypeId
+CpuTimeProcessDelayModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CpuTimeProcessDelayModel")
+    .SetParent<ProcessDelayModel> ()
+    .AddConstructor<CpuTimeProcessDelayModel> ()
+    .AddAttribute ("Clock", "The host clock used to measure the CPU time of the tasks.",
+                   EnumValue (CpuTimeProcessDelayModel::THREAD),
+                   MakeEnumAccessor (&CpuTimeProcessDelayModel::m_clock),
+                   MakeEnumChecker (CpuTimeProcessDelayModel::THREAD, "Thread",
+                                    CpuTimeProcessDelayModel::PROCESS, "Process"))
+    .AddAttribute ("Factor", "Multiply the measured CPU time by this factor.",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&CpuTimeProcessDelayModel::m_factor),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("ReferenceTime",
+                   "If not zero, the result of MeasureReference on the machine to model: "
+                   "the factor is then scaled by the speed of this host relative to it.",
+                   TimeValue (Seconds (0.0)),
+                   MakeTimeAccessor (&CpuTimeProcessDelayModel::m_referenceTime),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+CpuTimeProcessDelayModel::CpuTimeProcessDelayModel ()
+  : m_calibrated (false)
+{
+}
+
+Time
+CpuTimeProcessDelayModel::GetCpuTime (enum Clock clock)
+{
+  struct timespec ts;
+  clock_gettime ((clock == THREAD) ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return Seconds (ts.tv_sec) + NanoSeconds (ts.tv_nsec);
+}
+
+Time
+CpuTimeProcessDelayModel::MeasureReference (void)
+{
+  // Keep the best of a few runs to filter out the preemptions.
+  Time best;
+  for (int run = 0; run < 5; run++)
+    {
+      Time start = GetCpuTime (PROCESS);
+      volatile uint32_t x = 1;
+      for (uint32_t i = 0; i < 10000000; i++)
+        {
+          x = x * 1103515245 + 12345;
+        }
+      Time t = GetCpuTime (PROCESS) - start;
+      if (run == 0 || t < best)
+        {
+          best = t;
+        }
+    }
+  return best;
+}
+
+double
+CpuTimeProcessDelayModel::GetFactor (void)
+{
+  if (!m_calibrated)
+    {
+      m_calibrated = true;
+      if (!m_referenceTime.IsZero ())
+        {
+          // shared by all the nodes, and by all the runs of a sweep.
+          static Time local = MeasureReference ();
+          m_factor *= m_referenceTime.GetSeconds () / local.GetSeconds ();
+          NS_LOG_INFO ("calibrated factor " << m_factor);
+        }
+    }
+  return m_factor;
+}
+
+void
+CpuTimeProcessDelayModel::RecordStart (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_start = GetCpuTime (m_clock);
+  if (m_clock == THREAD)
+    {
+      g_threadLast = m_start.GetNanoSeconds ();
+    }
+}
+Time
+CpuTimeProcessDelayModel::RecordEnd (void)
+{
+  NS_LOG_FUNCTION (this);
+  Time now = GetCpuTime (m_clock);
+  Time delay = now - m_start;
+  if (m_clock == THREAD)
+    {
+      delay = now - NanoSeconds (g_threadLast);
+      g_threadLast = now.GetNanoSeconds ();
+    }
+  delay = NanoSeconds ((int64_t)(delay.GetNanoSeconds () * GetFactor ()));
+  if (delay.IsZero ())
+    {
+      delay = MicroSeconds (1);
+    }
+  return delay;
+}
+
 } // namespace ns3
@@ -65,6 +65,51 @@ private:
   Time m_start;
 };
 
+/**
+ * Charge the CPU time consumed by the host to run the task, scaled by a
+ * calibration factor. Unlike TimeOfDayProcessDelayModel, the delays do
+ * not depend on the load of the host.
+ */
+class CpuTimeProcessDelayModel : public ProcessDelayModel
+{
+public:
+  enum Clock
+  {
+    // CPU time of the host thread which runs the task, with both fiber
+    // managers. Other threads, those of the DceParallelSimulatorImpl
+    // for instance, are not charged to the task.
+    THREAD,
+    // CPU time of the whole simulation process: everything the host
+    // does during the task, on every thread, is charged to it.
+    PROCESS
+  };
+
+  static TypeId GetTypeId (void);
+
+  CpuTimeProcessDelayModel ();
+
+  virtual void RecordStart (void);
+  virtual Time RecordEnd (void);
+
+  /**
+   * \returns the CPU time taken by the calibration workload on this host.
+   *
+   * Run this on the reference machine and give the result to the
+   * ReferenceTime attribute to scale the delays measured on other
+   * machines to the speed of the reference one.
+   */
+  static Time MeasureReference (void);
+private:
+  static Time GetCpuTime (enum Clock clock);
+  double GetFactor (void);
+
+  enum Clock m_clock;
+  double m_factor;
+  Time m_referenceTime;
+  bool m_calibrated;
+  Time m_start;
+};
+
 } // namespace ns3
 
 #endif /* PROCESS_DELAY_MODEL_H */
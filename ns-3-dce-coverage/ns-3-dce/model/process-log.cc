@@ -0,0 +1,383 @@
+#include "process-log.h"
+#include "process.h"
+#include "task-manager.h"
+#include "utils.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/global-value.h"
+#include "ns3/enum.h"
+#include "ns3/fatal-impl.h"
+#include <sstream>
+#include <fstream>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+NS_LOG_COMPONENT_DEFINE ("ProcessLog");
+
+namespace ns3 {
+
+enum ProcessLogFormat
+{
+  PROCESS_LOG_TEXT,
+  PROCESS_LOG_BINARY,
+};
+
+static GlobalValue g_processLogFormat = GlobalValue ("ProcessLogFormat",
+                                                     "The format of the process records written at "
+                                                     "the end of the simulation.",
+                                                     EnumValue (PROCESS_LOG_TEXT),
+                                                     MakeEnumChecker (PROCESS_LOG_TEXT, "text",
+                                                                      PROCESS_LOG_BINARY, "binary"));
+
+static const char g_magic[8] = { 'D', 'C', 'E', 'P', 'L', 'O', 'G', '1' };
+
+ProcessLog::Log::Log ()
+  : flushed (0),
+    flushScheduled (false),
+    atExit (false)
+{
+}
+
+// Registered with FatalImpl::RegisterStream, so that the records are
+// written when NS_FATAL_ERROR or NS_ASSERT flush the streams before
+// they abort.
+class ProcessLogFatalBuffer : public std::streambuf
+{
+protected:
+  virtual int sync (void)
+  {
+    ProcessLog::Flush ();
+    return 0;
+  }
+};
+
+static std::ostream *
+PeekFatalStream (void)
+{
+  static ProcessLogFatalBuffer buffer;
+  static std::ostream stream (&buffer);
+  return &stream;
+}
+
+struct ProcessLog::Log *
+ProcessLog::Peek (void)
+{
+  static Log log;
+  return &log;
+}
+
+void
+ProcessLog::ScheduleFlush (struct Log *log)
+{
+  if (!log->flushScheduled)
+    {
+      log->flushScheduled = true;
+      Simulator::ScheduleDestroy (&ProcessLog::Destroy);
+      FatalImpl::RegisterStream (PeekFatalStream ());
+    }
+  if (!log->atExit)
+    {
+      // registered after the construction of the log, hence called
+      // before its destruction.
+      log->atExit = true;
+      atexit (&ProcessLog::Flush);
+    }
+}
+
+void
+ProcessLog::Destroy (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Flush ();
+  FatalImpl::UnregisterStream (PeekFatalStream ());
+  struct Log *log = Peek ();
+  CriticalSection cs (log->mutex);
+  log->records.clear ();
+  log->flushed = 0;
+  log->flushScheduled = false;
+}
+
+void
+ProcessLog::AddRecord (const struct Process *process, enum EndCause cause)
+{
+  NS_LOG_FUNCTION (process->pid << process->nodeId << cause);
+  struct Record record;
+  record.nodeId = process->nodeId;
+  record.pid = process->pid;
+  record.ppid = process->ppid;
+  record.cause = cause;
+  record.exitCode = process->timing.exitValue;
+  record.ns3Start = process->timing.ns3Start;
+  record.realStart = process->timing.realStart;
+  if (cause == EXIT)
+    {
+      record.ns3End = process->timing.ns3End;
+      record.realEnd = process->timing.realEnd;
+    }
+  else
+    {
+      record.ns3End = Now ().GetNanoSeconds ();
+      record.realEnd = time (0);
+    }
+  record.cpuTime = 0;
+  for (std::vector<Thread *>::const_iterator i = process->threads.begin ();
+       i != process->threads.end (); ++i)
+    {
+      if ((*i)->task != 0)
+        {
+          record.cpuTime += (*i)->task->GetCpuTime ().GetNanoSeconds ();
+        }
+    }
+  record.cmdLine = process->timing.cmdLine;
+  AddRecord (record);
+}
+
+void
+ProcessLog::AddRecord (const struct Record &record)
+{
+  struct Log *log = Peek ();
+  CriticalSection cs (log->mutex);
+  log->records.push_back (record);
+  ScheduleFlush (log);
+}
+
+void
+ProcessLog::AddStatus (uint16_t pid, uint32_t nodeId, const std::string &line)
+{
+  NS_LOG_FUNCTION (pid << nodeId << line);
+  std::ostringstream oss;
+  oss << "      Time: " << GetTimeStamp () << " --> " << line << std::endl;
+  struct Log *log = Peek ();
+  CriticalSection cs (log->mutex);
+  log->status[std::make_pair (nodeId, pid)] += oss.str ();
+  ScheduleFlush (log);
+}
+
+const std::vector<struct ProcessLog::Record> &
+ProcessLog::GetRecords (void)
+{
+  return Peek ()->records;
+}
+
+void
+ProcessLog::Flush (void)
+{
+  struct Log *log = Peek ();
+  NS_LOG_FUNCTION (log->records.size () - log->flushed << log->status.size ());
+  if (log->flushed == log->records.size () && log->status.empty ())
+    {
+      // the binary file would be rewritten with the records of the
+      // previous flush only.
+      return;
+    }
+  for (std::map<std::pair<uint32_t, uint16_t>, std::string>::const_iterator i = log->status.begin ();
+       i != log->status.end (); ++i)
+    {
+      std::ostringstream oss;
+      oss << UtilsGetRootDirectory () << "files-" << i->first.first << "/var/log/" << i->first.second << "/status";
+      // the directory is missing if the process never started.
+      int fd = ::open (oss.str ().c_str (), O_WRONLY | O_APPEND, 0);
+      if (fd >= 0)
+        {
+          ::write (fd, i->second.c_str (), i->second.length ());
+          ::close (fd);
+        }
+    }
+  log->status.clear ();
+
+  if (IsBinary ())
+    {
+      WriteBinary (log);
+    }
+  else
+    {
+      WriteText (log);
+    }
+  log->flushed = log->records.size ();
+}
+
+bool
+ProcessLog::IsBinary (void)
+{
+  EnumValue format;
+  g_processLogFormat.GetValue (format);
+  return format.Get () == PROCESS_LOG_BINARY;
+}
+
+void
+ProcessLog::WriteText (struct Log *log)
+{
+  std::ostringstream oss;
+  for (uint32_t i = log->flushed; i < log->records.size (); i++)
+    {
+      const struct Record &r = log->records[i];
+      if (r.cause != EXIT)
+        {
+          continue;
+        }
+      oss << r.nodeId
+          << ' ' << r.exitCode
+          << ' ' << r.pid
+          << ' ' <<  r.ns3Start
+          << ' ' <<  r.ns3End
+          << ' ' <<  r.realStart
+          << ' ' <<  r.realEnd
+          << ' ' <<  ((r.ns3End - r.ns3Start) / (double) 1000000000)
+          << ' ' <<  (r.realEnd - r.realStart)
+          << ' ' <<  r.cmdLine  << std::endl;
+    }
+  std::string lines = oss.str ();
+  if (lines.empty ())
+    {
+      return;
+    }
+  std::string filename = UtilsGetRootDirectory () + "exitprocs";
+  int fd = ::open (filename.c_str (), O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (fd < 0)
+    {
+      NS_LOG_WARN ("Unable to open exitprocs");
+      return;
+    }
+  struct stat st;
+  if ((!fstat (fd, &st)) && (0 == st.st_size))
+    {
+      const char *header =  "NODE EXIT-CODE PID NS3-START-TIME NS3-END-TIME REAL-START-TIME REAL-END-TIME NS3-DURATION REAL-DURATION CMDLINE\n";
+
+      ::write (fd, header, strlen (header));
+    }
+  ::write (fd, lines.c_str (), lines.length ());
+  ::close (fd);
+}
+
+// Each column is written as an array in host byte order.
+template <typename T, typename F>
+static void
+WriteColumn (std::ostream &os, const std::vector<struct ProcessLog::Record> &records, F field)
+{
+  std::vector<T> column (records.size ());
+  for (uint32_t i = 0; i < records.size (); i++)
+    {
+      column[i] = records[i].*field;
+    }
+  if (!column.empty ())
+    {
+      os.write ((const char *)&column[0], column.size () * sizeof (T));
+    }
+}
+
+template <typename T, typename F>
+static void
+ReadColumn (std::istream &is, std::vector<struct ProcessLog::Record> &records, F field)
+{
+  std::vector<T> column (records.size ());
+  if (!column.empty ())
+    {
+      is.read ((char *)&column[0], column.size () * sizeof (T));
+    }
+  for (uint32_t i = 0; i < records.size (); i++)
+    {
+      records[i].*field = column[i];
+    }
+}
+
+void
+ProcessLog::WriteBinary (struct Log *log)
+{
+  // the whole log is rewritten: the file always holds every record of
+  // this run.
+  std::string filename = UtilsGetRootDirectory () + "exitprocs.bin";
+  std::ofstream os (filename.c_str (), std::ios::binary | std::ios::trunc);
+  if (!os)
+    {
+      NS_LOG_WARN ("Unable to open exitprocs.bin");
+      return;
+    }
+  const std::vector<struct Record> &records = log->records;
+  uint32_t count = records.size ();
+  os.write (g_magic, sizeof (g_magic));
+  os.write ((const char *)&count, sizeof (count));
+  WriteColumn<uint32_t> (os, records, &Record::nodeId);
+  WriteColumn<uint16_t> (os, records, &Record::pid);
+  WriteColumn<uint16_t> (os, records, &Record::ppid);
+  WriteColumn<uint8_t> (os, records, &Record::cause);
+  WriteColumn<int32_t> (os, records, &Record::exitCode);
+  WriteColumn<int64_t> (os, records, &Record::ns3Start);
+  WriteColumn<int64_t> (os, records, &Record::ns3End);
+  WriteColumn<int64_t> (os, records, &Record::realStart);
+  WriteColumn<int64_t> (os, records, &Record::realEnd);
+  WriteColumn<int64_t> (os, records, &Record::cpuTime);
+  std::vector<uint32_t> lengths (count);
+  for (uint32_t i = 0; i < count; i++)
+    {
+      lengths[i] = records[i].cmdLine.length ();
+    }
+  if (count != 0)
+    {
+      os.write ((const char *)&lengths[0], count * sizeof (uint32_t));
+    }
+  for (uint32_t i = 0; i < count; i++)
+    {
+      os.write (records[i].cmdLine.c_str (), lengths[i]);
+    }
+}
+
+std::vector<struct ProcessLog::Record>
+ProcessLog::Read (std::string filename)
+{
+  NS_LOG_FUNCTION (filename);
+  std::vector<struct Record> records;
+  std::ifstream is (filename.c_str (), std::ios::binary);
+  char magic[sizeof (g_magic)];
+  uint32_t count = 0;
+  is.read (magic, sizeof (magic));
+  is.read ((char *)&count, sizeof (count));
+  if (!is || memcmp (magic, g_magic, sizeof (magic)) != 0)
+    {
+      NS_LOG_WARN ("Not a process log: " << filename);
+      return records;
+    }
+  records.resize (count);
+  ReadColumn<uint32_t> (is, records, &Record::nodeId);
+  ReadColumn<uint16_t> (is, records, &Record::pid);
+  ReadColumn<uint16_t> (is, records, &Record::ppid);
+  std::vector<uint8_t> causes (count);
+  if (count != 0)
+    {
+      is.read ((char *)&causes[0], count);
+    }
+  for (uint32_t i = 0; i < count; i++)
+    {
+      records[i].cause = (enum EndCause)causes[i];
+    }
+  ReadColumn<int32_t> (is, records, &Record::exitCode);
+  ReadColumn<int64_t> (is, records, &Record::ns3Start);
+  ReadColumn<int64_t> (is, records, &Record::ns3End);
+  ReadColumn<int64_t> (is, records, &Record::realStart);
+  ReadColumn<int64_t> (is, records, &Record::realEnd);
+  ReadColumn<int64_t> (is, records, &Record::cpuTime);
+  std::vector<uint32_t> lengths (count);
+  if (count != 0)
+    {
+      is.read ((char *)&lengths[0], count * sizeof (uint32_t));
+    }
+  for (uint32_t i = 0; i < count && is; i++)
+    {
+      std::vector<char> cmdLine (lengths[i]);
+      if (lengths[i] != 0)
+        {
+          is.read (&cmdLine[0], lengths[i]);
+          records[i].cmdLine.assign (&cmdLine[0], lengths[i]);
+        }
+    }
+  if (!is)
+    {
+      NS_LOG_WARN ("Truncated process log: " << filename);
+      records.clear ();
+    }
+  return records;
+}
+
+} // namespace ns3
@@ -0,0 +1,94 @@
+#ifndef PROCESS_LOG_H
+#define PROCESS_LOG_H
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <map>
+#include "ns3/system-mutex.h"
+
+namespace ns3 {
+
+struct Process;
+
+/**
+ * \brief In memory record of the life of the DCE processes.
+ *
+ * The end of every process, and the lines of the status files of the
+ * processes (files-<node>/var/log/<pid>/status), are kept in memory and
+ * written to the host once, when the simulator is destroyed, instead of
+ * being appended to the host files each time a process ends.
+ *
+ * The records of the exited processes are appended to the exitprocs
+ * file, in the text format read by DceManagerHelper::GetProcStatus,
+ * or, when the global value ProcessLogFormat is "binary", the records of
+ * all the processes are written to exitprocs.bin, one column after the
+ * other (see Read). Both are in the directory of the rank with the
+ * global value DceRankRoots.
+ *
+ * The records of a simulation stay available from GetRecords until
+ * Simulator::Destroy, which writes them and empties the log for the next
+ * simulation. They are also written when the program exits without
+ * destroying the simulator, and by NS_FATAL_ERROR and NS_ASSERT before
+ * they abort.
+ */
+class ProcessLog
+{
+public:
+  enum EndCause
+  {
+    EXIT,        // called exit or returned from main.
+    STOPPED,     // stopped by DceManager::Stop.
+    NEVER_ENDED, // still alive at the end of the simulation.
+  };
+  struct Record
+  {
+    uint32_t nodeId;
+    uint16_t pid;
+    uint16_t ppid;
+    enum EndCause cause;
+    int exitCode;
+    int64_t ns3Start; // nanoseconds.
+    int64_t ns3End;
+    time_t realStart;
+    time_t realEnd;
+    int64_t cpuTime; // nanoseconds charged to the threads still alive at the end.
+    std::string cmdLine;
+  };
+
+  static void AddRecord (const struct Process *process, enum EndCause cause);
+  static void AddRecord (const struct Record &record);
+  static void AddStatus (uint16_t pid, uint32_t nodeId, const std::string &line);
+  static const std::vector<struct Record> & GetRecords (void);
+  // Write what was recorded since the last flush.
+  static void Flush (void);
+  // True if the records are written in the binary format.
+  static bool IsBinary (void);
+  // Read a file written in the binary format.
+  static std::vector<struct Record> Read (std::string filename);
+
+private:
+  struct Log
+  {
+    Log ();
+    std::vector<struct Record> records;
+    uint32_t flushed; // records already written.
+    // status lines not yet written, by node and pid.
+    std::map<std::pair<uint32_t, uint16_t>, std::string> status;
+    bool flushScheduled;
+    bool atExit; // Flush is registered with atexit.
+    // the processes of the nodes may end on several simulation threads.
+    SystemMutex mutex;
+  };
+  static struct Log * Peek (void);
+  static void ScheduleFlush (struct Log *log);
+  // Flush, then forget this simulation.
+  static void Destroy (void);
+  static void WriteText (struct Log *log);
+  static void WriteBinary (struct Log *log);
+};
+
+} // namespace ns3
+
+#endif /* PROCESS_LOG_H */
@@ -124,6 +124,15 @@ struct ProcessActivity
   std::string cmdLine;
 };
 
+// The files only in memory of a directory being read, see dce_readdir.
+struct MemoryDirectory
+{
+  std::string path;
+  std::vector<std::string> names;
+  uint32_t next;
+  struct dirent entry;
+};
+
 struct Process
 {
   uid_t euid;
@@ -141,8 +150,11 @@ struct Process
   std::map<int,FileUsage *> openFiles;
   std::vector<FILE *> openStreams;
   std::vector<DIR *> openDirs;
+  // Of the open directories, those of a node with a MemoryFileSystem.
+  std::map<DIR *, struct MemoryDirectory> memoryDirs;
   std::vector<SignalHandler> signalHandlers;
   std::vector<Thread *> threads;
+  std::vector<Thread *> tids; // threads indexed by tid, zero when unused.
   std::vector<Mutex *> mutexes;
   std::vector<Semaphore *> semaphores;
   std::vector<Condition *> conditions;
@@ -215,6 +227,8 @@ struct Thread
   int err;
   /* thread id. */
   uint16_t tid;
+  /* tells apart the threads which successively used this tid. */
+  uint32_t generation;
   Task *task;
   Thread *joinWaiter;
   Process *process;
@@ -18,6 +18,7 @@
  *          Mathieu Lacage <mathieu.lacage@inria.fr>
  */
 #include "pthread-fiber-manager.h"
+#include "dce-parallel-simulator-impl.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
 #include <pthread.h>
@@ -112,6 +113,8 @@ struct PthreadFiberThread
   struct PthreadFiber *previous;
   struct PthreadFiber *next;
   MemoryBounds stack_bounds;
+  // the simulation partition of the thread which woke it up last.
+  void *partition;
 };
 
 class StackTrampoline
@@ -331,6 +334,7 @@ PthreadFiberManager::Wakeup (struct PthreadFiber *fiber)
   pthread_mutex_lock (&fiber->thread->mutex);
   fiber->state = RUNNING;
   fiber->thread->next = fiber;
+  fiber->thread->partition = DceParallelSimulatorImpl::GetThreadPartition ();
   if (fiber->thread->thread_started)
     {
       // and now we can wakup the target thread. yay !
@@ -381,6 +385,7 @@ PthreadFiberManager::Yield (struct PthreadFiber *fiber)
               pthread_cond_wait (&((PthreadFiberThread *)thread)->condvar,
                                  &((PthreadFiberThread *)thread)->mutex);
               NS_LOG_DEBUG ("Yield after wait");
+              DceParallelSimulatorImpl::SetThreadPartition (((PthreadFiberThread *)thread)->partition);
               // finally, jump back where we want to go within this thread
               ((PthreadFiberThread *)thread)->trampoline->Jump ((PthreadFiberThread *)thread);
             }
@@ -397,6 +402,7 @@ PthreadFiberManager::Run (void *arg)
   thread->stack_bounds.AddBound (__builtin_frame_address (0));
   thread->stack_bounds.AddBound (SelfStackBottom ());
   pthread_mutex_lock (&thread->mutex);
+  DceParallelSimulatorImpl::SetThreadPartition (thread->partition);
   if (setjmp (thread->initial_env) == 0)
     {
       thread->func (thread->context);
@@ -436,6 +442,7 @@ PthreadFiberManager::CreateFromCaller (void)
   thread->func = NULL;
   thread->stack_size = 0;
   thread->previous = 0;
+  thread->partition = 0;
   pthread_mutex_init (&thread->mutex, NULL);
   pthread_cond_init (&thread->condvar, NULL);
   struct PthreadFiber *fiber = new PthreadFiber ();
@@ -0,0 +1,19 @@
+#ifndef DCE_EPOLL_H
+#define DCE_EPOLL_H
+
+#include <sys/epoll.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int dce_epoll_create (int size);
+int dce_epoll_create1 (int flags);
+int dce_epoll_ctl (int epfd, int op, int fd, struct epoll_event *event);
+int dce_epoll_wait (int epfd, struct epoll_event *events, int maxevents, int timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DCE_EPOLL_H */
@@ -0,0 +1,19 @@
+#ifndef DCE_RESOURCE_H
+#define DCE_RESOURCE_H
+
+#include <sys/resource.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int dce_getpriority (int which, id_t who);
+int dce_setpriority (int which, id_t who, int prio);
+int dce_getrusage (int who, struct rusage *usage);
+int dce_getrlimit (int resource, struct rlimit *rlim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DCE_RESOURCE_H */
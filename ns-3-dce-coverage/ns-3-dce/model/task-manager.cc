@@ -6,15 +6,16 @@
 #include "ns3/log.h"
 #include "ns3/uinteger.h"
 #include "ns3/enum.h"
+#include "ns3/nstime.h"
 #include "ns3/simulator.h"
 #include "ns3/node.h"
-#include "ns3/node-list.h"
 #include "dce-manager.h"
 #include "dce-stdio.h"
 #include "process.h"
 #include "utils.h"
 #include "process-delay-model.h"
 #include "dce-cxa.h"
+#include <algorithm>
 
 namespace ns3 {
 
@@ -71,6 +72,22 @@ Task::SetSwitchNotifier (void (*fn)(enum SwitchType, void *), void *context)
   m_switchNotifierContext = context;
 }
 
+Time
+Task::GetCpuTime (void) const
+{
+  return m_cpuTime;
+}
+void
+Task::SetPriority (int nice)
+{
+  m_nice = std::min (std::max (nice, -20), 19);
+}
+int
+Task::GetPriority (void) const
+{
+  return m_nice;
+}
+
 Task::~Task ()
 {
 }
@@ -95,6 +112,13 @@ TaskManager::GetTypeId (void)
                    MakeEnumAccessor (&TaskManager::SetFiberManagerType),
                    MakeEnumChecker (PTHREAD_FIBER_MANAGER, "PthreadFiberManager",
                                     UCONTEXT_FIBER_MANAGER, "UcontextFiberManager"))
+    .AddAttribute ("TimerResolution",
+                   "The length of the ticks of the timer wheel which keeps the "
+                   "timers of the tasks (timerfd, nanosleep, kernel timers). "
+                   "The timers expire at their exact deadline whatever the resolution.",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&TaskManager::m_timerResolution),
+                   MakeTimeChecker (NanoSeconds (1)))
   ;
   return tid;
 }
@@ -107,14 +131,26 @@ TaskManager::TaskManager ()
     m_disposing (0),
     m_todoOnMain (0),
     m_noSignal (0),
-    m_hightask (0)
+    m_hightask (0),
+    m_nodeId (0xffffffff),
+    m_timers (0),
+    m_timerDeadline (-1),
+    m_timerPost (-1)
 {
   NS_LOG_FUNCTION (this);
 }
 TaskManager::~TaskManager ()
 {
   NS_LOG_FUNCTION (this);
+  std::vector<TaskManager *> *managers = PeekManagers ();
+  if (m_nodeId < managers->size () && (*managers)[m_nodeId] == this)
+    {
+      (*managers)[m_nodeId] = 0;
+    }
   GarbageCollectDeadTasks ();
+  // the timers still pending are cancelled.
+  delete m_timers;
+  m_timers = 0;
   m_fiberManager->Delete (m_mainFiber);
   delete m_fiberManager;
 
@@ -130,6 +166,7 @@ void TaskManager::DoDispose (void)
       return;
     }
   m_disposing = 1;
+  m_timerEvent.Cancel ();
 
   // Flush every FILEs in every processes.
   Ptr<DceManager> dceManager = this->GetObject<DceManager> ();
@@ -163,6 +200,33 @@ void TaskManager::DoDispose (void)
   Object::DoDispose ();
 }
 
+void
+TaskManager::NotifyNewAggregate (void)
+{
+  Ptr<Node> node = GetObject<Node> ();
+  if (node != 0 && m_nodeId == 0xffffffff)
+    {
+      // Current is called by every libc call: index the managers by
+      // node id rather than looking them up in the aggregates of the node.
+      m_nodeId = node->GetId ();
+      std::vector<TaskManager *> *managers = PeekManagers ();
+      if (m_nodeId >= managers->size ())
+        {
+          managers->resize (m_nodeId + 1, 0);
+        }
+      (*managers)[m_nodeId] = this;
+    }
+  Object::NotifyNewAggregate ();
+}
+
+std::vector<TaskManager *> *
+TaskManager::PeekManagers (void)
+{
+  // never deleted: task managers may outlive the static destructors.
+  static std::vector<TaskManager *> *managers = new std::vector<TaskManager *> ();
+  return managers;
+}
+
 void
 TaskManager::GarbageCollectDeadTasks (void)
 {
@@ -239,6 +303,10 @@ TaskManager::Start (void (*fn)(void*), void *context, uint32_t stackSize)
   task->m_extraContext = 0;
   task->m_switchNotifier = 0;
   task->m_switchNotifierContext = 0;
+  task->m_nice = 0;
+  task->m_vruntime = 0;
+  task->m_sequence = 0;
+  task->m_waitTimer.SetFunction (MakeCallback (&TaskManager::EndWait, this).Bind (task));
   Wakeup (task);
   return task;
 }
@@ -252,6 +320,10 @@ TaskManager::Clone (Task *task)
   clone->m_extraContext = 0;
   clone->m_switchNotifier = 0;
   clone->m_switchNotifierContext = 0;
+  clone->m_nice = task->m_nice;
+  clone->m_vruntime = task->m_vruntime;
+  clone->m_sequence = 0;
+  clone->m_waitTimer.SetFunction (MakeCallback (&TaskManager::EndWait, this).Bind (clone));
   struct Fiber *cloneFiber = m_fiberManager->Clone (task->m_fiber);
   NS_LOG_DEBUG ("clone " << clone << " fiber=" << cloneFiber);
   if (cloneFiber != 0)
@@ -337,7 +409,7 @@ TaskManager::Sleep (Time timeout)
   current->m_state = Task::BLOCKED;
   if (!timeout.IsZero ())
     {
-      m_waitQueue.push_back (Sleeper (current,timeout));
+      ScheduleTimer (&current->m_waitTimer, timeout);
     }
   Schedule ();
   current->m_waitTimer.Cancel ();
@@ -354,9 +426,8 @@ TaskManager::Yield (void)
   NS_LOG_FUNCTION (this << m_current);
   NS_ASSERT (m_current != 0);
   NS_ASSERT (m_current->m_state == Task::RUNNING);
-  // re-queue to make sure it will be handled.
+  // re-queued by Schedule once the cpu time of this slice is charged.
   m_current->m_state = Task::ACTIVE;
-  m_scheduler->Enqueue (m_current);
   Schedule ();
 }
 void
@@ -400,13 +471,12 @@ TaskManager *
 TaskManager::Current (void)
 {
   uint32_t nodeId = Simulator::GetContext ();
-  if (nodeId == 0xffffffff)
+  std::vector<TaskManager *> *managers = PeekManagers ();
+  if (nodeId >= managers->size ())
     {
       return 0;
     }
-  Ptr<Node> node = NodeList::GetNode (nodeId);
-  Ptr<TaskManager> manager = node->GetObject<TaskManager> ();
-  return PeekPointer (manager);
+  return (*managers)[nodeId];
 }
 
 void
@@ -461,11 +531,11 @@ again:
         {
           // but, we have nothing to schedule to.
         }
-      while (m_waitQueue.size () > 0)
+      if (m_timerPost >= 0)
         {
-          Sleeper s = m_waitQueue.front ();
-          s.m_task->m_waitTimer = Simulator::Schedule (s.m_timeout, &TaskManager::EndWait, this, s.m_task);
-          m_waitQueue.pop_front ();
+          int64_t deadline = m_timerPost;
+          m_timerPost = -1;
+          PostTimers (deadline);
         }
       GarbageCollectDeadTasks ();
     }
@@ -474,6 +544,12 @@ again:
       // we have something to schedule from.
       // but, we have nothing to schedule to so, we go back to the main task.
       Time delay = m_delayModel->RecordEnd ();
+      m_current->m_cpuTime += delay;
+      if (m_current->m_state == Task::ACTIVE)
+        {
+          // yielded: make sure it will be handled.
+          m_scheduler->Enqueue (m_current);
+        }
       struct Task *next = m_scheduler->PeekNext ();
       NS_LOG_DEBUG ("Leaving " << m_current << ", delay " << delay << " next = " << next << " entering main");
       if (next != 0)
@@ -526,6 +602,68 @@ TaskManager::EndWait (Task *task)
     }
 }
 
+TimerWheel *
+TaskManager::GetTimerWheel (void)
+{
+  if (m_timers == 0)
+    {
+      m_timers = new TimerWheel (m_timerResolution.GetNanoSeconds ());
+    }
+  return m_timers;
+}
+
+void
+TaskManager::ScheduleTimer (TimerWheel::Timer *timer, Time delay)
+{
+  NS_LOG_FUNCTION (this << timer << delay);
+  int64_t deadline = (Simulator::Now () + Max (delay, Time (0))).GetNanoSeconds ();
+  GetTimerWheel ()->Schedule (timer, deadline);
+  if (m_timerDeadline >= 0 && m_timerDeadline <= deadline)
+    {
+      // the event already posted expires first.
+      return;
+    }
+  if (m_current == 0)
+    {
+      PostTimers (deadline);
+    }
+  else if (m_timerPost < 0 || deadline < m_timerPost)
+    {
+      // posted by Schedule, once back on the main thread.
+      m_timerPost = deadline;
+    }
+}
+
+// Make sure an event expires the timers at deadline. The event posted for
+// a timer which was cancelled is not removed: it is cheaper to let it
+// expire for nothing than to post a new event each time the earliest
+// timer is re-armed.
+void
+TaskManager::PostTimers (int64_t deadline)
+{
+  if (m_timerDeadline >= 0 && m_timerDeadline <= deadline)
+    {
+      return;
+    }
+  m_timerEvent.Cancel ();
+  m_timerDeadline = deadline;
+  m_timerEvent = Simulator::Schedule (NanoSeconds (deadline) - Simulator::Now (),
+                                      &TaskManager::ExpireTimers, this);
+}
+
+void
+TaskManager::ExpireTimers (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_timerDeadline = -1;
+  m_timers->Expire (Simulator::Now ().GetNanoSeconds ());
+  int64_t next = m_timers->GetNextDeadline ();
+  if (next >= 0)
+    {
+      PostTimers (next);
+    }
+}
+
 void
 TaskManager::SetSwitchNotify (void (*fn)(void))
 {
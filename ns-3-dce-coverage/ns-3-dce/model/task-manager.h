@@ -6,7 +6,9 @@
 #include "ns3/event-id.h"
 #include "ns3/nstime.h"
 #include "task-scheduler.h"
+#include "timer-wheel.h"
 #include <list>
+#include <vector>
 #include "process-delay-model.h"
 
 namespace ns3 {
@@ -35,8 +37,15 @@ public:
   void * GetContext (void) const;
 
   void SetSwitchNotifier (void (*fn)(enum SwitchType, void *), void *context);
+  // Sum of the delays charged by the ProcessDelayModel to this task.
+  Time GetCpuTime (void) const;
+  // Nice value of this task, from -20 (highest priority) to 19.
+  // Only schedulers which support priorities take it into account.
+  void SetPriority (int nice);
+  int GetPriority (void) const;
 private:
   friend class TaskManager;
+  friend class CfsTaskScheduler;
   ~Task ();
   enum State
   {
@@ -47,22 +56,17 @@ private:
   };
   enum State m_state;
   Fiber *m_fiber;
-  EventId m_waitTimer;
+  TimerWheel::Timer m_waitTimer;
   void *m_context;
   void *m_extraContext;
   void (*m_switchNotifier)(enum SwitchType, void *);
   void *m_switchNotifierContext;
-};
-
-class Sleeper
-{
-public:
-  Sleeper (Task *t, Time to) : m_task (t),
-                               m_timeout (to)
-  {
-  }
-  Task * const m_task;
-  const Time m_timeout;
+  Time m_cpuTime;
+  int m_nice;
+  // Fair scheduling state, owned by CfsTaskScheduler.
+  int64_t m_vruntime;
+  Time m_accounted;
+  uint64_t m_sequence;
 };
 
 class TaskManager : public Object
@@ -156,6 +160,14 @@ public:
   void ExecOnMain (EventImpl *e);
   EventId ScheduleMain (Time const &time, EventImpl *e);
 
+  /**
+   * (Re)arm a timer of the timer wheel of this node, which expires
+   * after delay. Can be called from a task: only the earliest deadline
+   * of the wheel is posted to the simulator, from the main thread.
+   * The timer must be cancelled before the end of this task manager.
+   */
+  void ScheduleTimer (TimerWheel::Timer *timer, Time delay);
+
   bool GetNoSignal ();
 
 private:
@@ -171,12 +183,17 @@ private:
   };
 
   virtual void DoDispose (void);
+  virtual void NotifyNewAggregate (void);
   void Schedule (void);
   void SetFiberManagerType (enum FiberManagerType type);
   void GarbageCollectDeadTasks (void);
   void EndWait (Task *task);
+  TimerWheel * GetTimerWheel (void);
+  void PostTimers (int64_t deadline);
+  void ExpireTimers (void);
   static void Trampoline (void *context);
   static void MainSchedule (EventId *res,Time const &time, EventImpl *e);
+  static std::vector<TaskManager *> * PeekManagers (void);
 
 
   Task *m_current;
@@ -189,11 +206,16 @@ private:
   EventId m_nextSchedule;
   bool m_reSchedule;
   Time m_reScheduleTime;
-  std::list<Sleeper> m_waitQueue;
+  TimerWheel *m_timers;
+  Time m_timerResolution;
+  EventId m_timerEvent;
+  int64_t m_timerDeadline; // deadline of m_timerEvent, -1 when not posted.
+  int64_t m_timerPost; // deadline to post when back on main, -1 if none.
   std::list<Task *> m_deadTasks;
   EventImpl *m_todoOnMain;
   bool m_noSignal; // I am not come back from a real thread interruption do not run signal ....
   bool m_disposing; // In order to never loop while disposing me.
+  uint32_t m_nodeId; // Index in PeekManagers, 0xffffffff until aggregated to a node.
 };
 
 } // namespace
@@ -0,0 +1,388 @@
+/* -*-	Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "timer-wheel.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include <string.h>
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("TimerWheel");
+
+namespace ns3 {
+
+TimerWheel::Timer::Timer ()
+  : m_prev (0),
+    m_next (0),
+    m_wheel (0),
+    m_slot (0),
+    m_deadline (0),
+    m_sequence (0)
+{
+}
+TimerWheel::Timer::~Timer ()
+{
+  Cancel ();
+}
+void
+TimerWheel::Timer::SetFunction (Callback<void> function)
+{
+  m_function = function;
+}
+bool
+TimerWheel::Timer::IsPending (void) const
+{
+  return m_wheel != 0;
+}
+int64_t
+TimerWheel::Timer::GetDeadline (void) const
+{
+  NS_ASSERT (IsPending ());
+  return m_deadline;
+}
+void
+TimerWheel::Timer::Cancel (void)
+{
+  if (m_wheel != 0)
+    {
+      m_wheel->Cancel (this);
+    }
+}
+
+TimerWheel::TimerWheel (int64_t resolution)
+  : m_now (0),
+    m_resolution (resolution),
+    m_sequence (0),
+    m_size (0)
+{
+  NS_LOG_FUNCTION (this << resolution);
+  NS_ASSERT (resolution > 0);
+  memset (m_slots, 0, sizeof (m_slots));
+  memset (m_occupied, 0, sizeof (m_occupied));
+}
+TimerWheel::~TimerWheel ()
+{
+  NS_LOG_FUNCTION (this << m_size);
+  for (uint32_t i = 0; i <= OVERFLOW_SLOT; i++)
+    {
+      while (m_slots[i] != 0)
+        {
+          Cancel (m_slots[i]);
+        }
+    }
+}
+
+bool
+TimerWheel::Before (const Timer *a, const Timer *b)
+{
+  return a->m_deadline < b->m_deadline
+         || (a->m_deadline == b->m_deadline && a->m_sequence < b->m_sequence);
+}
+
+// The first non empty slot, starting from slot from, in the order of the
+// ticks they hold. -1 if all the slots are empty.
+int32_t
+TimerWheel::FirstSlot (uint64_t occupied, uint32_t from)
+{
+  if (occupied == 0)
+    {
+      return -1;
+    }
+  uint64_t rotated = occupied;
+  if (from != 0)
+    {
+      rotated = (occupied >> from) | (occupied << (SLOTS - from));
+    }
+  return (from + __builtin_ctzll (rotated)) & SLOT_MASK;
+}
+
+void
+TimerWheel::Link (Timer *timer, uint32_t slot)
+{
+  timer->m_slot = slot;
+  Timer *head = m_slots[slot];
+  if (head == 0)
+    {
+      timer->m_prev = timer;
+      timer->m_next = timer;
+      m_slots[slot] = timer;
+      if (slot < OVERFLOW_SLOT)
+        {
+          m_occupied[slot / SLOTS] |= ((uint64_t)1) << (slot & SLOT_MASK);
+        }
+      return;
+    }
+  Timer *prev = head->m_prev;
+  if (slot < SLOTS)
+    {
+      // the slots of the first level are sorted: the timers are usually
+      // scheduled in order so, look for the place from the end.
+      while (Before (timer, prev))
+        {
+          if (prev == head)
+            {
+              m_slots[slot] = timer;
+              prev = head->m_prev;
+              break;
+            }
+          prev = prev->m_prev;
+        }
+    }
+  timer->m_prev = prev;
+  timer->m_next = prev->m_next;
+  prev->m_next->m_prev = timer;
+  prev->m_next = timer;
+}
+
+void
+TimerWheel::Unlink (Timer *timer)
+{
+  uint32_t slot = timer->m_slot;
+  if (timer->m_next == timer)
+    {
+      m_slots[slot] = 0;
+      if (slot < OVERFLOW_SLOT)
+        {
+          m_occupied[slot / SLOTS] &= ~(((uint64_t)1) << (slot & SLOT_MASK));
+        }
+    }
+  else
+    {
+      if (m_slots[slot] == timer)
+        {
+          m_slots[slot] = timer->m_next;
+        }
+      timer->m_prev->m_next = timer->m_next;
+      timer->m_next->m_prev = timer->m_prev;
+    }
+  timer->m_prev = 0;
+  timer->m_next = 0;
+}
+
+void
+TimerWheel::Insert (Timer *timer)
+{
+  uint64_t tick = timer->m_deadline / m_resolution;
+  if (timer->m_deadline < 0 || tick < m_now)
+    {
+      // late: expire with the current tick.
+      tick = m_now;
+    }
+  uint64_t delta = tick - m_now;
+  for (uint32_t level = 0; level < LEVELS; level++)
+    {
+      if (delta < (((uint64_t)1) << (LEVEL_BITS * (level + 1))))
+        {
+          uint32_t index = (tick >> (LEVEL_BITS * level)) & SLOT_MASK;
+          Link (timer, level * SLOTS + index);
+          return;
+        }
+    }
+  Link (timer, OVERFLOW_SLOT);
+}
+
+void
+TimerWheel::Reinsert (uint32_t slot)
+{
+  Timer *timer = m_slots[slot];
+  if (timer == 0)
+    {
+      return;
+    }
+  // detach the whole list before sorting it again.
+  m_slots[slot] = 0;
+  if (slot < OVERFLOW_SLOT)
+    {
+      m_occupied[slot / SLOTS] &= ~(((uint64_t)1) << (slot & SLOT_MASK));
+    }
+  timer->m_prev->m_next = 0;
+  while (timer != 0)
+    {
+      Timer *next = timer->m_next;
+      Insert (timer);
+      timer = next;
+    }
+}
+
+// m_now just reached the first tick of a slot of the second level: move
+// down the timers of the slots which start at this tick.
+void
+TimerWheel::Cascade (void)
+{
+  for (uint32_t level = 1; level < LEVELS; level++)
+    {
+      uint32_t index = (m_now >> (LEVEL_BITS * level)) & SLOT_MASK;
+      Reinsert (level * SLOTS + index);
+      if (level == LEVELS - 1)
+        {
+          // the overflowing timers may now fit in the last level.
+          Reinsert (OVERFLOW_SLOT);
+        }
+      if (index != 0)
+        {
+          break;
+        }
+    }
+}
+
+// Move m_now forward, up to target, to the next tick which holds timers
+// or which starts a non empty slot of an upper level.
+void
+TimerWheel::Step (uint64_t target)
+{
+  NS_ASSERT (m_slots[m_now & SLOT_MASK] == 0);
+  uint64_t next = target;
+  int32_t slot = FirstSlot (m_occupied[0], (m_now + 1) & SLOT_MASK);
+  if (slot >= 0)
+    {
+      next = std::min (next, m_now + ((slot - m_now) & SLOT_MASK));
+    }
+  for (uint32_t level = 1; level < LEVELS; level++)
+    {
+      uint32_t shift = LEVEL_BITS * level;
+      uint64_t current = m_now >> shift;
+      slot = FirstSlot (m_occupied[level], (current + 1) & SLOT_MASK);
+      if (slot >= 0)
+        {
+          uint64_t offset = ((slot - current - 1) & SLOT_MASK) + 1;
+          next = std::min (next, (current + offset) << shift);
+        }
+    }
+  const Timer *head = m_slots[OVERFLOW_SLOT];
+  if (head != 0)
+    {
+      // the first slot of the last level from which the earliest
+      // overflowing timer fits in the wheel.
+      uint64_t first = head->m_deadline / m_resolution;
+      for (const Timer *timer = head->m_next; timer != head; timer = timer->m_next)
+        {
+          first = std::min (first, (uint64_t)(timer->m_deadline / m_resolution));
+        }
+      uint32_t shift = LEVEL_BITS * (LEVELS - 1);
+      uint64_t span = ((uint64_t)1) << (LEVEL_BITS * LEVELS);
+      uint64_t start = ((m_now >> shift) + 1) << shift;
+      if (first >= span)
+        {
+          start = std::max (start, (((first - span) >> shift) + 1) << shift);
+        }
+      next = std::min (next, start);
+    }
+  m_now = next;
+  if ((m_now & SLOT_MASK) == 0)
+    {
+      Cascade ();
+    }
+}
+
+void
+TimerWheel::Schedule (Timer *timer, int64_t deadline)
+{
+  NS_LOG_FUNCTION (this << timer << deadline);
+  if (timer->m_wheel != 0)
+    {
+      timer->m_wheel->Cancel (timer);
+    }
+  timer->m_wheel = this;
+  timer->m_deadline = deadline;
+  timer->m_sequence = m_sequence++;
+  m_size++;
+  Insert (timer);
+}
+
+void
+TimerWheel::Cancel (Timer *timer)
+{
+  NS_LOG_FUNCTION (this << timer);
+  NS_ASSERT (timer->m_wheel == this);
+  Unlink (timer);
+  timer->m_wheel = 0;
+  m_size--;
+}
+
+int64_t
+TimerWheel::GetNextDeadline (void) const
+{
+  if (m_size == 0)
+    {
+      return -1;
+    }
+  int64_t best = -1;
+  // the slots of the first level hold the next ticks, in order, and they
+  // are sorted.
+  int32_t slot = FirstSlot (m_occupied[0], m_now & SLOT_MASK);
+  if (slot >= 0)
+    {
+      best = m_slots[slot]->m_deadline;
+    }
+  for (uint32_t level = 1; level < LEVELS; level++)
+    {
+      uint32_t shift = LEVEL_BITS * level;
+      // the timers of this level expire after the current slot.
+      uint64_t start = ((m_now >> shift) + 1) << shift;
+      if (best >= 0 && (uint64_t)best < start * m_resolution)
+        {
+          return best;
+        }
+      slot = FirstSlot (m_occupied[level], ((m_now >> shift) + 1) & SLOT_MASK);
+      if (slot < 0)
+        {
+          continue;
+        }
+      const Timer *head = m_slots[level * SLOTS + slot];
+      const Timer *timer = head;
+      do
+        {
+          if (best < 0 || timer->m_deadline < best)
+            {
+              best = timer->m_deadline;
+            }
+          timer = timer->m_next;
+        }
+      while (timer != head);
+    }
+  const Timer *head = m_slots[OVERFLOW_SLOT];
+  if (head != 0)
+    {
+      const Timer *timer = head;
+      do
+        {
+          if (best < 0 || timer->m_deadline < best)
+            {
+              best = timer->m_deadline;
+            }
+          timer = timer->m_next;
+        }
+      while (timer != head);
+    }
+  return best;
+}
+
+void
+TimerWheel::Expire (int64_t now)
+{
+  NS_LOG_FUNCTION (this << now << m_size);
+  uint64_t target = now / m_resolution;
+  while (true)
+    {
+      uint32_t slot = m_now & SLOT_MASK;
+      while (m_slots[slot] != 0 && m_slots[slot]->m_deadline <= now)
+        {
+          Timer *timer = m_slots[slot];
+          Cancel (timer);
+          // the function may delete the timer.
+          Callback<void> function = timer->m_function;
+          function ();
+        }
+      if (m_now >= target)
+        {
+          break;
+        }
+      Step (target);
+    }
+}
+
+uint32_t
+TimerWheel::GetSize (void) const
+{
+  return m_size;
+}
+
+} // namespace ns3
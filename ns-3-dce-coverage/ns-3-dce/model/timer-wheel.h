@@ -0,0 +1,104 @@
+/* -*-	Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "ns3/callback.h"
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \brief Hierarchical timing wheel which keeps the timers of a node.
+ *
+ * The timers are sorted in LEVELS levels of SLOTS slots: the first level
+ * holds the timers which expire in the next SLOTS ticks (one slot per
+ * tick, the length of a tick being the resolution of the wheel), the
+ * second level holds the timers which expire in the next SLOTS * SLOTS
+ * ticks (one slot per SLOTS ticks), and so on. The timers of a slot of an
+ * upper level are moved down when the wheel reaches this slot, and the
+ * timers beyond the last level wait in an overflow list.
+ *
+ * Scheduling and cancelling a timer is O(1) (the slots of the first level
+ * are sorted so, it is O(n) with the number of timers of the same tick).
+ * The resolution only decides in which slot a timer is kept: the
+ * deadlines are exact, and the timers expire in the order of their
+ * deadline then of their scheduling, like simulator events.
+ *
+ * The wheel does not know the simulator: its owner asks for the earliest
+ * deadline, and calls Expire when it is reached.
+ */
+class TimerWheel
+{
+public:
+  class Timer
+  {
+  public:
+    Timer ();
+    // A pending timer is cancelled.
+    ~Timer ();
+    // Called when the timer expires.
+    void SetFunction (Callback<void> function);
+    bool IsPending (void) const;
+    // Absolute deadline, in nanoseconds, of a pending timer.
+    int64_t GetDeadline (void) const;
+    void Cancel (void);
+
+  private:
+    friend class TimerWheel;
+    Timer (const Timer &o);
+    Timer & operator = (const Timer &o);
+
+    // circular list of the timers of a slot.
+    Timer *m_prev;
+    Timer *m_next;
+    TimerWheel *m_wheel; // zero when not pending.
+    uint32_t m_slot;
+    int64_t m_deadline;
+    uint64_t m_sequence;
+    Callback<void> m_function;
+  };
+
+  // The resolution is in nanoseconds.
+  TimerWheel (int64_t resolution);
+  // The pending timers are cancelled.
+  ~TimerWheel ();
+
+  // (Re)arm the timer, which expires at deadline (nanoseconds).
+  void Schedule (Timer *timer, int64_t deadline);
+  void Cancel (Timer *timer);
+  // The earliest deadline, -1 if no timer is pending.
+  int64_t GetNextDeadline (void) const;
+  // Run the timers which expire at or before now (nanoseconds).
+  void Expire (int64_t now);
+  uint32_t GetSize (void) const;
+
+private:
+  enum
+  {
+    LEVEL_BITS = 6,
+    SLOTS = 1 << LEVEL_BITS,
+    SLOT_MASK = SLOTS - 1,
+    LEVELS = 4,
+    OVERFLOW_SLOT = LEVELS * SLOTS,
+  };
+
+  void Insert (Timer *timer);
+  void Link (Timer *timer, uint32_t slot);
+  void Unlink (Timer *timer);
+  void Reinsert (uint32_t slot);
+  void Cascade (void);
+  void Step (uint64_t target);
+  static bool Before (const Timer *a, const Timer *b);
+  static int32_t FirstSlot (uint64_t occupied, uint32_t from);
+
+  Timer *m_slots[OVERFLOW_SLOT + 1];
+  uint64_t m_occupied[LEVELS]; // one bit per non empty slot.
+  uint64_t m_now; // tick of the first slot of the first level.
+  int64_t m_resolution;
+  uint64_t m_sequence;
+  uint32_t m_size;
+};
+
+} // namespace ns3
+
+#endif /* TIMER_WHEEL_H */
@@ -13,6 +13,7 @@
 #include <malloc.h>
 #include <sys/mman.h>
 #include <link.h>
+#include <pthread.h>
 
 #ifdef HAVE_VALGRIND_H
 # include "valgrind/valgrind.h"
@@ -26,6 +27,8 @@ namespace ns3 {
 
 void *UcontextFiberManager::g_alternateSignalStack = 0;
 std::list<unsigned long> UcontextFiberManager::g_guardPages;
+// the managers of the nodes may run on several simulation threads.
+static pthread_mutex_t g_guardPagesMutex = PTHREAD_MUTEX_INITIALIZER;
 
 struct UcontextFiber : public Fiber
 {
@@ -44,6 +47,7 @@ UcontextFiberManager::SegfaultHandler (int sig, siginfo_t *si, void *unused)
     }
   unsigned long page = (unsigned long) si->si_addr;
   page = page - (page % pagesize);
+  pthread_mutex_lock (&g_guardPagesMutex);
   for (std::list<unsigned long>::iterator i = g_guardPages.begin ();
        i != g_guardPages.end (); ++i)
     {
@@ -57,6 +61,7 @@ UcontextFiberManager::SegfaultHandler (int sig, siginfo_t *si, void *unused)
           break;
         }
     }
+  pthread_mutex_unlock (&g_guardPagesMutex);
 }
 
 void
@@ -68,7 +73,8 @@ UcontextFiberManager::FreeAlternateSignalStack (void)
 void
 UcontextFiberManager::SetupSignalHandler (void)
 {
-  static bool alreadySetup = false;
+  // the alternate signal stack is a property of the calling thread.
+  static __thread bool alreadySetup = false;
   if (alreadySetup)
     {
       return;
@@ -92,6 +98,15 @@ UcontextFiberManager::SetupSignalHandler (void)
       NS_FATAL_ERROR ("Unable to setup an alternate signal stack handler, errno="
                       << strerror (errno));
     }
+
+  pthread_mutex_lock (&g_guardPagesMutex);
+  if (g_alternateSignalStack != 0)
+    {
+      // the handler is already there. The stacks of the other simulation
+      // threads live until the end of the program.
+      pthread_mutex_unlock (&g_guardPagesMutex);
+      return;
+    }
   g_alternateSignalStack = ss.ss_sp;
 
   atexit (&FreeAlternateSignalStack);
@@ -106,6 +121,7 @@ UcontextFiberManager::SetupSignalHandler (void)
       NS_FATAL_ERROR ("Unable to setup page fault handler, errno="
                       << strerror (errno));
     }
+  pthread_mutex_unlock (&g_guardPagesMutex);
 }
 
 uint32_t
@@ -152,7 +168,9 @@ UcontextFiberManager::AllocateStack (uint32_t size)
     {
       NS_FATAL_ERROR ("Unable to protect bottom of stack space, errno=" << strerror (errno));
     }
+  pthread_mutex_lock (&g_guardPagesMutex);
   g_guardPages.push_back ((unsigned long)stack);
+  pthread_mutex_unlock (&g_guardPagesMutex);
   return stack + pagesize;
 }
 void
@@ -171,7 +189,9 @@ UcontextFiberManager::DeallocateStack (uint8_t *buffer,
       NS_FATAL_ERROR ("Unable to unmap stack, errno=" << strerror (errno));
     }
   unsigned long guard = (unsigned long)(buffer - pagesize);
+  pthread_mutex_lock (&g_guardPagesMutex);
   g_guardPages.remove (guard);
+  pthread_mutex_unlock (&g_guardPagesMutex);
 }
 
 UcontextFiberManager::UcontextFiberManager ()
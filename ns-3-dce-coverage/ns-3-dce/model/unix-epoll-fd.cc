@@ -0,0 +1,405 @@
+#include "unix-epoll-fd.h"
+#include "utils.h"
+#include "process.h"
+#include "ns3/log.h"
+#include <errno.h>
+#include <sys/mman.h>
+#include <poll.h>
+
+NS_LOG_COMPONENT_DEFINE ("UnixEpollFd");
+
+namespace ns3 {
+
+EpollEntry::EpollEntry (UnixEpollFd *epoll, int fd, UnixFd *file,
+                        const struct epoll_event *event)
+  : m_epoll (epoll),
+    m_fd (fd),
+    m_file (file),
+    m_event (*event),
+    m_ready (false)
+{
+  m_file->Ref ();
+  // POLLERR and POLLHUP are always reported, as with poll.
+  SetEventMask ((m_event.events & 0xffff) | POLLERR | POLLHUP);
+}
+EpollEntry::~EpollEntry ()
+{
+  m_file->Unref ();
+}
+void
+EpollEntry::WakeUpCallback ()
+{
+  m_epoll->NotifyReady (this);
+}
+void
+EpollEntry::FileClosed (UnixFd *file)
+{
+  m_epoll->NotifyClosed (this);
+}
+
+UnixEpollFd::UnixEpollFd ()
+{
+}
+UnixEpollFd::~UnixEpollFd ()
+{
+  // Not closed when the process exits without a Current: drop the
+  // remaining interests so that the files do not point to us anymore.
+  Close ();
+}
+
+EpollEntry *
+UnixEpollFd::Add (int fd, UnixFd *file, struct epoll_event *event)
+{
+  EpollEntry *entry = new EpollEntry (this, fd, file, event);
+  m_interests[fd] = entry;
+  // The entry stays in the wait queues of the file until Remove, so
+  // that we get told about every readiness change of the file instead
+  // of polling all the interest set on each epoll_wait.
+  int ret = file->Poll (entry);
+  file->AddPersistentWait (entry);
+  if (ret & entry->GetEventMask ())
+    {
+      NotifyReady (entry);
+    }
+  return entry;
+}
+void
+UnixEpollFd::Remove (EpollEntry *entry)
+{
+  NS_LOG_FUNCTION (this << entry->m_fd);
+  m_interests.erase (entry->m_fd);
+  if (entry->m_ready)
+    {
+      m_ready.remove (entry);
+    }
+  entry->FreeWait ();
+  entry->m_file->RemovePersistentWait (entry);
+  delete entry;
+}
+int
+UnixEpollFd::Ctl (int op, int fd, UnixFd *file, struct epoll_event *event)
+{
+  NS_LOG_FUNCTION (this << op << fd << file << event);
+  Thread *current = Current ();
+  if (file == this)
+    {
+      current->err = EINVAL;
+      return -1;
+    }
+  std::map<int, EpollEntry *>::iterator i = m_interests.find (fd);
+  switch (op)
+    {
+    case EPOLL_CTL_ADD:
+      if (i != m_interests.end ())
+        {
+          current->err = EEXIST;
+          return -1;
+        }
+      if (event == 0)
+        {
+          current->err = EFAULT;
+          return -1;
+        }
+      Add (fd, file, event);
+      break;
+    case EPOLL_CTL_MOD:
+      if (i == m_interests.end ())
+        {
+          current->err = ENOENT;
+          return -1;
+        }
+      if (event == 0)
+        {
+          current->err = EFAULT;
+          return -1;
+        }
+      // The wanted events are part of the wait queue registration, so
+      // register again.
+      Remove (i->second);
+      Add (fd, file, event);
+      break;
+    case EPOLL_CTL_DEL:
+      if (i == m_interests.end ())
+        {
+          current->err = ENOENT;
+          return -1;
+        }
+      Remove (i->second);
+      break;
+    default:
+      current->err = EINVAL;
+      return -1;
+    }
+  return 0;
+}
+int
+UnixEpollFd::Collect (struct epoll_event *events, int maxevents)
+{
+  NS_LOG_FUNCTION (this << events << maxevents);
+  int count = 0;
+  // Level triggered entries which are still ready go back at the end of
+  // the list: do not look at them twice in the same call.
+  size_t todo = m_ready.size ();
+  while (todo > 0 && count < maxevents)
+    {
+      todo--;
+      EpollEntry *entry = m_ready.front ();
+      m_ready.pop_front ();
+      entry->m_ready = false;
+
+      short mask = entry->GetEventMask ();
+      int ret = entry->m_file->Poll (0) & mask;
+      if (ret == 0)
+        {
+          continue;
+        }
+      events[count].events = ret;
+      events[count].data = entry->m_event.data;
+      count++;
+      if (entry->m_event.events & EPOLLONESHOT)
+        {
+          // Disabled until the next EPOLL_CTL_MOD.
+          entry->SetEventMask (0);
+        }
+      else if (!(entry->m_event.events & EPOLLET))
+        {
+          entry->m_ready = true;
+          m_ready.push_back (entry);
+        }
+    }
+  return count;
+}
+void
+UnixEpollFd::NotifyReady (EpollEntry *entry)
+{
+  NS_LOG_FUNCTION (this << entry->m_fd);
+  if (entry->m_ready || entry->GetEventMask () == 0)
+    {
+      return;
+    }
+  entry->m_ready = true;
+  m_ready.push_back (entry);
+  short pi = POLLIN;
+  WakeWaiters (&pi);
+}
+void
+UnixEpollFd::NotifyClosed (EpollEntry *entry)
+{
+  // As with Linux, closing the last descriptor of a file removes it from
+  // all the interest sets.
+  Remove (entry);
+}
+int
+UnixEpollFd::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  while (!m_interests.empty ())
+    {
+      Remove (m_interests.begin ()->second);
+    }
+  return 0;
+}
+ssize_t
+UnixEpollFd::Write (const void *buf, size_t count)
+{
+  NS_LOG_FUNCTION (this << buf << count);
+  Thread *current = Current ();
+  current->err = EINVAL;
+  return -1;
+}
+ssize_t
+UnixEpollFd::Read (void *buf, size_t count)
+{
+  NS_LOG_FUNCTION (this << buf << count);
+  Thread *current = Current ();
+  current->err = EINVAL;
+  return -1;
+}
+ssize_t
+UnixEpollFd::Recvmsg (struct msghdr *msg, int flags)
+{
+  NS_LOG_FUNCTION (this << msg << flags);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+ssize_t
+UnixEpollFd::Sendmsg (const struct msghdr *msg, int flags)
+{
+  NS_LOG_FUNCTION (this << msg << flags);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+bool
+UnixEpollFd::Isatty (void) const
+{
+  return false;
+}
+int
+UnixEpollFd::Setsockopt (int level, int optname,
+                         const void *optval, socklen_t optlen)
+{
+  NS_LOG_FUNCTION (this << level << optname << optval << optlen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixEpollFd::Getsockopt (int level, int optname,
+                         void *optval, socklen_t *optlen)
+{
+  NS_LOG_FUNCTION (this << level << optname << optval << optlen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixEpollFd::Getsockname (struct sockaddr *name, socklen_t *namelen)
+{
+  NS_LOG_FUNCTION (this << name << namelen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixEpollFd::Getpeername (struct sockaddr *name, socklen_t *namelen)
+{
+  NS_LOG_FUNCTION (this << name << namelen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixEpollFd::Ioctl (unsigned long request, char *argp)
+{
+  NS_LOG_FUNCTION (this << request << argp);
+  Thread *current = Current ();
+  current->err = ENOTTY;
+  return -1;
+}
+int
+UnixEpollFd::Bind (const struct sockaddr *my_addr, socklen_t addrlen)
+{
+  NS_LOG_FUNCTION (this << my_addr << addrlen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixEpollFd::Connect (const struct sockaddr *my_addr, socklen_t addrlen)
+{
+  NS_LOG_FUNCTION (this << my_addr << addrlen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixEpollFd::Listen (int backlog)
+{
+  NS_LOG_FUNCTION (this << backlog);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixEpollFd::Shutdown (int how)
+{
+  NS_LOG_FUNCTION (this << how);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixEpollFd::Accept (struct sockaddr *my_addr, socklen_t *addrlen)
+{
+  NS_LOG_FUNCTION (this << my_addr << addrlen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+void *
+UnixEpollFd::Mmap (void *start, size_t length, int prot, int flags, off64_t offset)
+{
+  NS_LOG_FUNCTION (this << start << length << prot << flags << offset);
+  Thread *current = Current ();
+  current->err = EINVAL;
+  return MAP_FAILED;
+}
+off64_t
+UnixEpollFd::Lseek (off64_t offset, int whence)
+{
+  NS_LOG_FUNCTION (this << offset << whence);
+  Thread *current = Current ();
+  current->err = ESPIPE;
+  return -1;
+}
+int
+UnixEpollFd::Fxstat (int ver, struct ::stat *buf)
+{
+  NS_LOG_FUNCTION (this << buf);
+  return 0;
+}
+int
+UnixEpollFd::Fxstat64 (int ver, struct ::stat64 *buf)
+{
+  NS_LOG_FUNCTION (this << buf);
+  return 0;
+}
+int
+UnixEpollFd::Settime (int flags,
+                      const struct itimerspec *new_value,
+                      struct itimerspec *old_value)
+{
+  NS_LOG_FUNCTION (this << flags << new_value << old_value);
+  Thread *current = Current ();
+  current->err = EINVAL;
+  return -1;
+}
+int
+UnixEpollFd::Gettime (struct itimerspec *cur_value) const
+{
+  NS_LOG_FUNCTION (this << cur_value);
+  Thread *current = Current ();
+  current->err = EINVAL;
+  return -1;
+}
+int
+UnixEpollFd::Ftruncate (off_t length)
+{
+  NS_LOG_FUNCTION (this << length);
+  Thread *current = Current ();
+  current->err = EINVAL;
+  return -1;
+}
+bool
+UnixEpollFd::HangupReceived (void) const
+{
+  return false;
+}
+int
+UnixEpollFd::Poll (PollTable* ptable)
+{
+  int ret = 0;
+
+  if (!m_ready.empty ())
+    {
+      ret |= POLLIN;
+    }
+  if (ptable)
+    {
+      ptable->PollWait (this);
+    }
+
+  return ret;
+}
+int
+UnixEpollFd::Fsync (void)
+{
+  NS_LOG_FUNCTION (this);
+  Thread *current = Current ();
+  current->err = EINVAL;
+  return -1;
+}
+
+} // namespace ns3
@@ -0,0 +1,94 @@
+#ifndef UNIX_EPOLL_FD_H
+#define UNIX_EPOLL_FD_H
+
+#include "unix-fd.h"
+#include <sys/epoll.h>
+#include <map>
+#include <list>
+
+namespace ns3 {
+
+class UnixEpollFd;
+
+/**
+ * A file watched by an epoll instance.
+ *
+ * Unlike the poll table built by each poll call, it stays registered in
+ * the wait queues of the file until it is removed from the interest set,
+ * so that readiness changes are pushed to the epoll instance.
+ */
+class EpollEntry : public PollTable
+{
+public:
+  EpollEntry (UnixEpollFd *epoll, int fd, UnixFd *file, const struct epoll_event *event);
+  virtual ~EpollEntry ();
+
+  virtual void WakeUpCallback ();
+  virtual void FileClosed (UnixFd *file);
+
+  UnixEpollFd * const m_epoll;
+  int const m_fd;
+  UnixFd * const m_file;
+  struct epoll_event m_event;
+  bool m_ready; // true while in the ready list of m_epoll
+};
+
+class UnixEpollFd : public UnixFd
+{
+public:
+  UnixEpollFd ();
+  virtual ~UnixEpollFd ();
+
+  virtual int Close (void);
+  virtual ssize_t Write (const void *buf, size_t count);
+  virtual ssize_t Read (void *buf, size_t count);
+  virtual ssize_t Recvmsg (struct msghdr *msg, int flags);
+  virtual ssize_t Sendmsg (const struct msghdr *msg, int flags);
+  virtual bool Isatty (void) const;
+  virtual int Setsockopt (int level, int optname,
+                          const void *optval, socklen_t optlen);
+  virtual int Getsockopt (int level, int optname,
+                          void *optval, socklen_t *optlen);
+  virtual int Getsockname (struct sockaddr *name, socklen_t *namelen);
+  virtual int Getpeername (struct sockaddr *name, socklen_t *namelen);
+  virtual int Ioctl (unsigned long request, char *argp);
+  virtual int Bind (const struct sockaddr *my_addr, socklen_t addrlen);
+  virtual int Connect (const struct sockaddr *my_addr, socklen_t addrlen);
+  virtual int Listen (int backlog);
+  virtual int Shutdown (int how);
+  virtual int Accept (struct sockaddr *my_addr, socklen_t *addrlen);
+  virtual void * Mmap (void *start, size_t length, int prot, int flags, off64_t offset);
+  virtual off64_t Lseek (off64_t offset, int whence);
+  virtual int Fxstat (int ver, struct ::stat *buf);
+  virtual int Fxstat64 (int ver, struct ::stat64 *buf);
+  virtual int Settime (int flags,
+                       const struct itimerspec *new_value,
+                       struct itimerspec *old_value);
+  virtual int Gettime (struct itimerspec *cur_value) const;
+  virtual int Ftruncate (off_t length);
+  virtual bool HangupReceived (void) const;
+  virtual int Poll (PollTable* ptable);
+  virtual int Fsync (void);
+
+  // EPOLL_CTL_ADD, EPOLL_CTL_MOD or EPOLL_CTL_DEL file as fd.
+  int Ctl (int op, int fd, UnixFd *file, struct epoll_event *event);
+  // Fill events with up to maxevents ready files, never blocks.
+  int Collect (struct epoll_event *events, int maxevents);
+
+  void NotifyReady (EpollEntry *entry);
+  void NotifyClosed (EpollEntry *entry);
+
+private:
+  EpollEntry * Add (int fd, UnixFd *file, struct epoll_event *event);
+  void Remove (EpollEntry *entry);
+
+  // key is the fd
+  std::map<int, EpollEntry *> m_interests;
+  // Entries woken up since they were last reported. Only these are
+  // checked by Collect.
+  std::list<EpollEntry *> m_ready;
+};
+
+} // namespace ns3
+
+#endif /* UNIX_EPOLL_FD_H */
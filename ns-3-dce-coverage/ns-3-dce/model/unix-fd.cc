@@ -52,6 +52,27 @@ UnixFd::WakeWaiters (void* key)
     }
 }
 void
+UnixFd::AddPersistentWait (PollTable *table)
+{
+  m_persistentWaits.push_back (table);
+}
+void
+UnixFd::RemovePersistentWait (PollTable *table)
+{
+  m_persistentWaits.remove (table);
+}
+void
+UnixFd::ReleasePersistentWaits (void)
+{
+  // FileClosed is expected to call RemovePersistentWait.
+  std::list <PollTable*> tables = m_persistentWaits;
+  for (std::list<PollTable*>::iterator i = tables.begin ();
+       i != tables.end (); ++i)
+    {
+      (*i)->FileClosed (this);
+    }
+}
+void
 UnixFd::IncFdCount (void)
 {
   m_fdCount++;
@@ -60,6 +60,12 @@ public:
 
   virtual int Fsync (void) = 0;
 
+  // Long lived poll registrations (epoll interest sets) are tracked here
+  // so that they can be dropped before the file is really closed.
+  void AddPersistentWait (PollTable *table);
+  void RemovePersistentWait (PollTable *table);
+  void ReleasePersistentWaits (void);
+
   friend class PollTableEntry;
   friend class PollTable;
   friend class DceManager;
@@ -73,6 +79,7 @@ protected:
 
 private:
   std::list <WaitQueueEntry*> m_waitQueueList;
+  std::list <PollTable*> m_persistentWaits;
   // Number of FD referencing me
   int m_fdCount;
 };
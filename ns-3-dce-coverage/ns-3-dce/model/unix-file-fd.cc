@@ -2,6 +2,7 @@
 #include "process.h"
 #include "dce-manager.h"
 #include "utils.h"
+#include "cow-memory.h"
 #include "ns3/log.h"
 #include "ns3/assert.h"
 #include <unistd.h>
@@ -48,6 +49,7 @@ UnixFileFdBase::Read (void *buf, size_t count)
   Thread *current = Current ();
   NS_LOG_FUNCTION (this << current << buf << count);
   NS_ASSERT (current != 0);
+  CowMemory::PrepareWrite (buf, count);
   ssize_t result = ::read (m_realFd, buf, count);
   if (result == -1)
     {
@@ -206,6 +208,7 @@ UnixFileFdBase::Fxstat (int ver, struct ::stat *buf)
   Thread *current = Current ();
   NS_LOG_FUNCTION (this << current << buf);
   NS_ASSERT (current != 0);
+  CowMemory::PrepareWrite (buf, sizeof (*buf));
   int retval = ::__fxstat (ver, m_realFd, buf);
   if (retval == -1)
     {
@@ -219,6 +222,7 @@ UnixFileFdBase::Fxstat64 (int ver, struct ::stat64 *buf)
   Thread *current = Current ();
   NS_LOG_FUNCTION (this << current << buf);
   NS_ASSERT (current != 0);
+  CowMemory::PrepareWrite (buf, sizeof (*buf));
   int retval = ::__fxstat64 (ver, m_realFd, buf);
   if (retval == -1)
     {
@@ -232,6 +236,21 @@ UnixFileFdBase::Fcntl (int cmd, unsigned long arg)
   NS_LOG_FUNCTION (this << Current () << cmd << arg);
   NS_ASSERT (Current () != 0);
   Thread *current = Current ();
+  // the commands which write to the argument.
+  switch (cmd)
+    {
+    case F_GETLK:
+#ifdef F_OFD_GETLK
+    case F_OFD_GETLK:
+#endif
+      CowMemory::PrepareWrite ((void *)arg, sizeof (struct flock));
+      break;
+#ifdef F_GETOWN_EX
+    case F_GETOWN_EX:
+      CowMemory::PrepareWrite ((void *)arg, sizeof (struct f_owner_ex));
+      break;
+#endif
+    }
   int retval = ::fcntl (m_realFd, cmd, arg);
   if (retval == -1)
     {
@@ -488,6 +507,7 @@ UnixRandomFd::Fxstat (int ver, struct ::stat *buf)
     }
 
   NS_ASSERT (current != 0);
+  CowMemory::PrepareWrite (buf, sizeof (*buf));
   int retval = ::__fxstat (ver, tmpFd, buf);
   if (retval == -1)
     {
@@ -510,6 +530,7 @@ UnixRandomFd::Fxstat64 (int ver, struct ::stat64 *buf)
     }
 
   NS_ASSERT (current != 0);
+  CowMemory::PrepareWrite (buf, sizeof (*buf));
   int retval = ::__fxstat64 (ver, tmpFd, buf);
   if (retval == -1)
     {
@@ -0,0 +1,316 @@
+#include "unix-memory-file-fd.h"
+#include "utils.h"
+#include "process.h"
+#include "ns3/log.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <poll.h>
+
+NS_LOG_COMPONENT_DEFINE ("UnixMemoryFileFd");
+
+namespace ns3 {
+
+UnixMemoryFileFd::UnixMemoryFileFd (Ptr<MemoryFileSystem> fs, Ptr<MemoryFile> file, int flags)
+  : m_fs (fs),
+    m_file (file),
+    m_offset (0)
+{
+  NS_LOG_FUNCTION (this << flags);
+  m_statusFlags = flags & ~(O_CREAT | O_EXCL | O_NOCTTY | O_TRUNC);
+}
+UnixMemoryFileFd::~UnixMemoryFileFd ()
+{
+  NS_LOG_FUNCTION (this);
+}
+int
+UnixMemoryFileFd::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  return 0;
+}
+ssize_t
+UnixMemoryFileFd::Write (const void *buf, size_t count)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << current << buf << count);
+  NS_ASSERT (current != 0);
+  if ((m_statusFlags & O_ACCMODE) == O_RDONLY)
+    {
+      current->err = EBADF;
+      return -1;
+    }
+  if (count == 0)
+    {
+      return 0;
+    }
+  std::vector<uint8_t> &data = m_file->data;
+  if (m_statusFlags & O_APPEND)
+    {
+      m_offset = data.size ();
+    }
+  if (m_offset + count > data.size ())
+    {
+      data.resize (m_offset + count);
+    }
+  memcpy (&data[0] + m_offset, buf, count);
+  m_offset += count;
+  m_file->Touch (true);
+  m_fs->NotifyWrite (count);
+  return count;
+}
+ssize_t
+UnixMemoryFileFd::Read (void *buf, size_t count)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << current << buf << count);
+  NS_ASSERT (current != 0);
+  if ((m_statusFlags & O_ACCMODE) == O_WRONLY)
+    {
+      current->err = EBADF;
+      return -1;
+    }
+  const std::vector<uint8_t> &data = m_file->data;
+  if (m_offset >= (off64_t) data.size ())
+    {
+      return 0;
+    }
+  size_t l = std::min (count, (size_t)(data.size () - m_offset));
+  memcpy (buf, &data[0] + m_offset, l);
+  m_offset += l;
+  m_file->Touch (false);
+  m_fs->NotifyRead (l);
+  return l;
+}
+ssize_t
+UnixMemoryFileFd::Recvmsg (struct msghdr *msg, int flags)
+{
+  NS_LOG_FUNCTION (this << msg << flags);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+ssize_t
+UnixMemoryFileFd::Sendmsg (const struct msghdr *msg, int flags)
+{
+  NS_LOG_FUNCTION (this << msg << flags);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+bool
+UnixMemoryFileFd::Isatty (void) const
+{
+  return false;
+}
+int
+UnixMemoryFileFd::Setsockopt (int level, int optname,
+                              const void *optval, socklen_t optlen)
+{
+  NS_LOG_FUNCTION (this << level << optname << optval << optlen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixMemoryFileFd::Getsockopt (int level, int optname,
+                              void *optval, socklen_t *optlen)
+{
+  NS_LOG_FUNCTION (this << level << optname << optval << optlen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixMemoryFileFd::Getsockname (struct sockaddr *name, socklen_t *namelen)
+{
+  NS_LOG_FUNCTION (this << name << namelen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixMemoryFileFd::Getpeername (struct sockaddr *name, socklen_t *namelen)
+{
+  NS_LOG_FUNCTION (this << name << namelen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixMemoryFileFd::Ioctl (unsigned long request, char *argp)
+{
+  NS_LOG_FUNCTION (this << request << argp);
+  Thread *current = Current ();
+  current->err = ENOTTY;
+  return -1;
+}
+int
+UnixMemoryFileFd::Bind (const struct sockaddr *my_addr, socklen_t addrlen)
+{
+  NS_LOG_FUNCTION (this << my_addr << addrlen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixMemoryFileFd::Connect (const struct sockaddr *my_addr, socklen_t addrlen)
+{
+  NS_LOG_FUNCTION (this << my_addr << addrlen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixMemoryFileFd::Listen (int backlog)
+{
+  NS_LOG_FUNCTION (this << backlog);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixMemoryFileFd::Shutdown (int how)
+{
+  NS_LOG_FUNCTION (this << how);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+int
+UnixMemoryFileFd::Accept (struct sockaddr *my_addr, socklen_t *addrlen)
+{
+  NS_LOG_FUNCTION (this << my_addr << addrlen);
+  Thread *current = Current ();
+  current->err = ENOTSOCK;
+  return -1;
+}
+void *
+UnixMemoryFileFd::Mmap (void *start, size_t length, int prot, int flags, off64_t offset)
+{
+  NS_LOG_FUNCTION (this << start << length << prot << flags << offset);
+  // The content may move when the file grows.
+  Thread *current = Current ();
+  current->err = ENODEV;
+  return MAP_FAILED;
+}
+off64_t
+UnixMemoryFileFd::Lseek (off64_t offset, int whence)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << current << offset << whence);
+  NS_ASSERT (current != 0);
+  off64_t pos;
+  switch (whence)
+    {
+    case SEEK_SET:
+      pos = offset;
+      break;
+    case SEEK_CUR:
+      pos = m_offset + offset;
+      break;
+    case SEEK_END:
+      pos = m_file->data.size () + offset;
+      break;
+    default:
+      current->err = EINVAL;
+      return -1;
+    }
+  if (pos < 0)
+    {
+      current->err = EINVAL;
+      return -1;
+    }
+  m_offset = pos;
+  return m_offset;
+}
+int
+UnixMemoryFileFd::Fxstat (int ver, struct ::stat *buf)
+{
+  NS_LOG_FUNCTION (this << buf);
+  m_file->Stat (buf);
+  return 0;
+}
+int
+UnixMemoryFileFd::Fxstat64 (int ver, struct ::stat64 *buf)
+{
+  NS_LOG_FUNCTION (this << buf);
+  m_file->Stat (buf);
+  return 0;
+}
+int
+UnixMemoryFileFd::Fcntl (int cmd, unsigned long arg)
+{
+  NS_LOG_FUNCTION (this << cmd << arg);
+  switch (cmd)
+    {
+    case F_SETFL:
+      // Only the status flags can change, not the access mode.
+      m_statusFlags = (m_statusFlags & O_ACCMODE) | (arg & ~O_ACCMODE);
+      return 0;
+    case F_GETLK:
+    case F_SETLK:
+    case F_SETLKW:
+      // Nobody else can see the file: there is no contention.
+      return 0;
+    default:
+      return UnixFd::Fcntl (cmd, arg);
+    }
+}
+int
+UnixMemoryFileFd::Settime (int flags,
+                           const struct itimerspec *new_value,
+                           struct itimerspec *old_value)
+{
+  NS_LOG_FUNCTION (this << flags << new_value << old_value);
+  Thread *current = Current ();
+  current->err = EINVAL;
+  return -1;
+}
+int
+UnixMemoryFileFd::Gettime (struct itimerspec *cur_value) const
+{
+  NS_LOG_FUNCTION (this << cur_value);
+  Thread *current = Current ();
+  current->err = EINVAL;
+  return -1;
+}
+int
+UnixMemoryFileFd::Ftruncate (off_t length)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << current << length);
+  NS_ASSERT (current != 0);
+  if ((length < 0) || ((m_statusFlags & O_ACCMODE) == O_RDONLY))
+    {
+      current->err = EINVAL;
+      return -1;
+    }
+  m_file->data.resize (length);
+  m_file->Touch (true);
+  return 0;
+}
+bool
+UnixMemoryFileFd::HangupReceived (void) const
+{
+  return false;
+}
+int
+UnixMemoryFileFd::Poll (PollTable* ptable)
+{
+  // Regular files are always ready.
+  if (ptable)
+    {
+      ptable->PollWait (this);
+    }
+  return POLLIN | POLLOUT;
+}
+int
+UnixMemoryFileFd::Fsync (void)
+{
+  NS_LOG_FUNCTION (this);
+  return 0;
+}
+
+} // namespace ns3
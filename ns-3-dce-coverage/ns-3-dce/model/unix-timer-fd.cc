@@ -16,9 +16,9 @@ namespace ns3 {
 UnixTimerFd::UnixTimerFd (int clockid, int flags)
   : m_period (Seconds (0.0)),
     m_skipped (0),
-    m_timer (),
     m_waiter (0)
 {
+  m_timer.SetFunction (MakeCallback (&UnixTimerFd::TimerExpired, this));
 }
 
 int
@@ -208,9 +208,7 @@ UnixTimerFd::TimerExpired (void)
 {
   if (!m_period.IsZero ())
     {
-      m_timer = Simulator::Schedule (m_period,
-                                     &UnixTimerFd::TimerExpired,
-                                     this);
+      TaskManager::Current ()->ScheduleTimer (&m_timer, m_period);
     }
   m_skipped++;
   if (m_waiter != 0)
@@ -218,13 +216,6 @@ UnixTimerFd::TimerExpired (void)
       m_waiter->process->manager->Wakeup (m_waiter);
     }
 }
-void
-UnixTimerFd::SettimeMain (Time t)
-{
-  m_timer =  Simulator::Schedule (t,
-                                  &UnixTimerFd::TimerExpired,
-                                  this);
-}
 int
 UnixTimerFd::Settime (int flags,
                       const struct itimerspec *new_value,
@@ -241,22 +232,21 @@ UnixTimerFd::Settime (int flags,
   Time initial = UtilsTimespecToTime (new_value->it_value);
   if (!initial.IsZero ())
     {
-      TaskManager::Current ()->ExecOnMain (MakeEvent (&UnixTimerFd::SettimeMain,
-                                                      this, initial));
+      TaskManager::Current ()->ScheduleTimer (&m_timer, initial);
     }
   return 0;
 }
 int
 UnixTimerFd::Gettime (struct itimerspec *cur_value) const
 {
-  if (!m_timer.IsRunning ())
+  if (!m_timer.IsPending ())
     {
       cur_value->it_value.tv_sec = 0;
       cur_value->it_value.tv_nsec = 0;
     }
   else
     {
-      Time left = Simulator::GetDelayLeft (m_timer);
+      Time left = NanoSeconds (m_timer.GetDeadline ()) - Simulator::Now ();
       cur_value->it_value = UtilsTimeToTimespec (left);
     }
   cur_value->it_interval = UtilsTimeToTimespec (m_period);
@@ -4,7 +4,7 @@
 #include "unix-fd.h"
 #include "process.h"
 #include "ns3/nstime.h"
-#include "ns3/event-id.h"
+#include "timer-wheel.h"
 
 namespace ns3 {
 
@@ -50,11 +50,10 @@ public:
 
 private:
   void TimerExpired (void);
-  void SettimeMain (Time t);
 
   Time m_period;
   uint64_t m_skipped;
-  EventId m_timer;
+  TimerWheel::Timer m_timer;
   Thread * m_waiter;
 };
 
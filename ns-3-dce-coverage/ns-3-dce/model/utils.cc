@@ -17,6 +17,7 @@
 #include "file-usage.h"
 #include "ns3/global-value.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
 
 NS_LOG_COMPONENT_DEFINE ("ProcessUtils");
 
@@ -30,6 +31,13 @@ GlobalValue g_timeBase = GlobalValue ("SimulationTimeBase",
   //   unsigned long secondsSinceEpochOnFridayApril042008 = 1207284276;
   //   return secondsSinceEpochOnFridayApril042008;
 
+static GlobalValue g_rankRoots = GlobalValue ("DceRankRoots",
+                                              "Keep the files-<node> directories and the process "
+                                              "records of each rank of a distributed simulation "
+                                              "in its own rank-<system id> directory.",
+                                              BooleanValue (false),
+                                              MakeBooleanChecker ());
+
 uint32_t UtilsGetNodeId (void)
 {
   if (gDisposingThreadContext)
@@ -38,10 +46,31 @@ uint32_t UtilsGetNodeId (void)
     }
   return Simulator::GetContext ();
 }
+static std::string UtilsMakeRootDirectory (void)
+{
+  BooleanValue rankRoots;
+  g_rankRoots.GetValue (rankRoots);
+  if (!rankRoots.Get ())
+    {
+      return "";
+    }
+  std::ostringstream oss;
+  oss << "rank-" << Simulator::GetSystemId ();
+  UtilsEnsureDirectoryExists (oss.str ());
+  oss << "/";
+  return oss.str ();
+}
+std::string UtilsGetRootDirectory (void)
+{
+  // every path of a node goes through here: DceRankRoots is read, and
+  // the directory made, only the first time.
+  static const std::string root = UtilsMakeRootDirectory ();
+  return root;
+}
 static std::string UtilsGetRealFilePath (uint32_t node)
 {
   std::ostringstream oss;
-  oss << "files-" << node;
+  oss << UtilsGetRootDirectory () << "files-" << node;
   return oss.str ();
 }
 static std::string UtilsGetRealFilePath (void)
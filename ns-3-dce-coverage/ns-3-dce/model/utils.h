@@ -31,6 +31,10 @@ class Process;
 // Little hack in order to have a context usable when disposing the Task Manager and the hidden goal is to flush the open FILEs.
 extern Thread *gDisposingThreadContext;
 
+// The directory which holds the files of the nodes and the process
+// records, "" or rank-<system id>/ with DceRankRoots. DceRankRoots is
+// read the first time a file of a node is used, and never again.
+std::string UtilsGetRootDirectory (void);
 void UtilsEnsureDirectoryExists (std::string realPath);
 void UtilsEnsureAllDirectoriesExist (std::string realPath);
 std::string UtilsGetRealFilePath (std::string path);
@@ -179,6 +179,10 @@ PollTable::GetEventMask () const
 {
   return m_eventMask;
 }
+void
+PollTable::FileClosed (UnixFd *file)
+{
+}
 WaitQueueEntryTimeout::WaitQueueEntryTimeout (short em, Time to) : m_waitTask (0),
                                                                    m_eventMask (em)
 {
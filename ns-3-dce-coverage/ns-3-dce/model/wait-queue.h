@@ -120,7 +120,7 @@ public:
   // Stop the thread until a wakeup or timeout reached .
   // \param: time max to wait or 0 for no max
   WaitPoint::Result Wait (Time to);
-  void WakeUpCallback ();
+  virtual void WakeUpCallback ();
 
 private:
   Thread* m_waitTask;
@@ -132,7 +132,7 @@ class PollTable : public WaitPoint
 {
 public:
   PollTable ();
-  ~PollTable ();
+  virtual ~PollTable ();
 
   // Remove from every wait queues
   void FreeWait ();
@@ -141,6 +141,9 @@ public:
   void PollWait (void *ref, Callback<void, void*> cb);
   void SetEventMask (short e);
   short GetEventMask () const;
+  // Called when a file this table stays registered to (see UnixFd::AddPersistentWait)
+  // is about to be closed.
+  virtual void FileClosed (UnixFd *file);
 
 private:
   std::list <PollTableEntry*> m_pollEntryList;
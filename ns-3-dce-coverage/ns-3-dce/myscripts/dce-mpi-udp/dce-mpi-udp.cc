@@ -52,11 +52,15 @@ main (int argc, char *argv[])
   CommandLine cmd;
   cmd.Parse (argc, argv);
 
-  NodeContainer nodes;
-  Ptr<Node> node1 = CreateObject<Node> (0); // <------ for MPI, it goes to run in core_1 (process 1)
-  Ptr<Node> node2 = CreateObject<Node> (1); // <------ for MPI,                   "   _2          2
-  nodes.Add (node1);
-  nodes.Add (node2);
+  // each rank keeps its files-* directories and exitprocs in rank-<id>.
+  GlobalValue::Bind ("DceRankRoots", BooleanValue (true));
+
+  // the nodes go to the ranks by traffic: one per rank here.
+  DcePartitionHelper partition;
+  partition.AddTraffic (0, 1);
+  NodeContainer nodes = partition.Create (2, systemCount);
+  Ptr<Node> node1 = nodes.Get (0);
+  Ptr<Node> node2 = nodes.Get (1);
 
   InternetStackHelper stack;
   stack.Install (nodes);
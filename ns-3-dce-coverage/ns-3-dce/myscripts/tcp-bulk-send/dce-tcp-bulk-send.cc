@@ -101,8 +101,10 @@ main (int argc, char *argv[])
   LinuxStackHelper::RunIp (nodes.Get (0), MilliSeconds (300), "route show table all");
   LinuxStackHelper::RunIp (nodes.Get (0), MilliSeconds (400), "addr list");
   
-  stack.SysctlSet (nodes, ".net.dccp.default.rx_ccid", m_ccid);
-  stack.SysctlSet (nodes, ".net.dccp.default.tx_ccid", m_ccid);
+  std::vector<std::pair<std::string, std::string> > sysctl;
+  sysctl.push_back (std::make_pair (".net.dccp.default.rx_ccid", m_ccid));
+  sysctl.push_back (std::make_pair (".net.dccp.default.tx_ccid", m_ccid));
+  stack.SysctlSet (nodes, sysctl);
 
   ApplicationContainer apps;
   OnOffHelper onoff = OnOffHelper (proto_sw[m_proto],
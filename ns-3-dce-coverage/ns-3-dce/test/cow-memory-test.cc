@@ -0,0 +1,170 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "ns3/test.h"
+#include "ns3/abort.h"
+#include "ns3/cow-memory.h"
+#include <sys/mman.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace ns3;
+namespace ns3 {
+
+/**
+ * A parent image, its child and its grandchild each see their own
+ * writes, and cloning or switching between them copies the same number
+ * of pages whatever the size of the memory: clone none, a switch those
+ * written since the two images last shared them.
+ */
+class CowMemoryTestCase : public TestCase
+{
+public:
+  CowMemoryTestCase ();
+private:
+  virtual void DoRun (void);
+  std::vector<uint64_t> Run (uint32_t pages);
+  void Write (uint32_t page, char c);
+  void Check (uint32_t page, char c);
+  void Copied (CowMemory *memory, std::vector<uint64_t> *steps);
+
+  uint8_t *m_buffer;
+  size_t m_pageSize;
+  uint64_t m_copied;
+};
+
+CowMemoryTestCase::CowMemoryTestCase ()
+  : TestCase ("Check that fork copies a number of pages independent of the size of the heap")
+{
+}
+
+void
+CowMemoryTestCase::Write (uint32_t page, char c)
+{
+  memset (m_buffer + page * m_pageSize, c, m_pageSize);
+}
+
+void
+CowMemoryTestCase::Check (uint32_t page, char c)
+{
+  uint8_t *data = m_buffer + page * m_pageSize;
+  NS_TEST_EXPECT_MSG_EQ (data[0], c, "Wrong content at the start of page " << page);
+  NS_TEST_EXPECT_MSG_EQ (data[m_pageSize - 1], c, "Wrong content at the end of page " << page);
+}
+
+void
+CowMemoryTestCase::Copied (CowMemory *memory, std::vector<uint64_t> *steps)
+{
+  steps->push_back (memory->GetCopiedPages () - m_copied);
+  m_copied = memory->GetCopiedPages ();
+}
+
+std::vector<uint64_t>
+CowMemoryTestCase::Run (uint32_t pages)
+{
+  std::vector<uint64_t> steps;
+  m_pageSize = sysconf (_SC_PAGESIZE);
+  m_buffer = (uint8_t *)mmap (0, pages * m_pageSize, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  NS_ABORT_MSG_IF (m_buffer == MAP_FAILED, "Unable to map the memory");
+  memset (m_buffer, 'a', pages * m_pageSize);
+  m_copied = 0;
+
+  CowMemory *memory = new CowMemory (m_buffer, pages * m_pageSize);
+  CowMemory::Image *parent = memory->Attach ();
+  CowMemory::Image *child = memory->Clone (parent);
+  Copied (memory, &steps);
+  for (uint32_t i = 0; i < 8; i++)
+    {
+      Write (3 * i, 'p');
+    }
+  // the last page, to catch an off by one in the page runs.
+  Write (pages - 1, 'p');
+  Copied (memory, &steps);
+
+  memory->SwitchTo (child);
+  Copied (memory, &steps);
+  Check (0, 'a');
+  Check (pages - 1, 'a');
+  Check (pages / 2, 'a');
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      Write (i, 'c');
+    }
+  Copied (memory, &steps);
+
+  memory->SwitchTo (parent);
+  Copied (memory, &steps);
+  Check (0, 'p');
+  Check (1, 'a');
+  Check (3, 'p');
+  Check (pages - 1, 'p');
+  CowMemory::Image *grandchild = memory->Clone (parent);
+  Copied (memory, &steps);
+  Write (1, 'P');
+
+  memory->SwitchTo (grandchild);
+  Copied (memory, &steps);
+  Check (0, 'p');
+  Check (1, 'a');
+  Check (2, 'a');
+  Write (2, 'g');
+
+  memory->SwitchTo (child);
+  Copied (memory, &steps);
+  Check (0, 'c');
+  Check (3, 'c');
+  Check (6, 'a');
+  Check (pages - 1, 'a');
+  NS_TEST_EXPECT_MSG_EQ (memory->Release (child), false, "Images left");
+
+  memory->SwitchTo (grandchild);
+  Copied (memory, &steps);
+  Check (0, 'p');
+  Check (2, 'g');
+  memory->SwitchTo (parent);
+  Copied (memory, &steps);
+  Check (1, 'P');
+  Check (2, 'a');
+  Check (pages - 1, 'p');
+  NS_TEST_EXPECT_MSG_EQ (memory->Release (grandchild), false, "Images left");
+
+  // the parent is alone again: its memory is writable as before the fork.
+  Write (pages / 2, 'z');
+  Check (pages / 2, 'z');
+  NS_TEST_EXPECT_MSG_EQ (memory->Release (parent), true, "Images left");
+  delete memory;
+  munmap (m_buffer, pages * m_pageSize);
+  return steps;
+}
+
+void
+CowMemoryTestCase::DoRun (void)
+{
+  // 1MB and 64MB with 4KB pages.
+  std::vector<uint64_t> small = Run (256);
+  std::vector<uint64_t> large = Run (16384);
+  NS_TEST_ASSERT_MSG_EQ (small.size (), large.size (), "Not the same steps");
+  for (uint32_t i = 0; i < small.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (small[i], large[i], "Step " << i << " depends on the size of the memory");
+    }
+  NS_TEST_EXPECT_MSG_EQ (small[0], 0, "Clone copied pages");
+  NS_TEST_EXPECT_MSG_EQ (small[5], 0, "Second clone copied pages");
+  // the parent wrote 9 pages: saved once on write, then saved and
+  // restored by the switch.
+  NS_TEST_EXPECT_MSG_EQ (small[1], 9, "Write of shared pages");
+  NS_TEST_EXPECT_MSG_EQ (small[2], 18, "Switch to the child");
+}
+
+static class CowMemoryTestSuite : public TestSuite
+{
+public:
+  CowMemoryTestSuite ();
+} g_cowMemoryTests;
+
+CowMemoryTestSuite::CowMemoryTestSuite ()
+  : TestSuite ("dce-cow-memory", UNIT)
+{
+  AddTestCase (new CowMemoryTestCase (), TestCase::QUICK);
+}
+
+} // namespace ns3
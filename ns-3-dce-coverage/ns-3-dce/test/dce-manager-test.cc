@@ -9,6 +9,9 @@
 #include "ns3/ipv4-dce-routing-helper.h"
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
 //#include <mcheck.h>
 
 static std::string g_testError;
@@ -151,6 +154,98 @@ DceManagerTestCase::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ (status, 0, "Process did not return successfully: " << g_testError);
 }
 
+/**
+ * The test-memory-fs process prints the same results with the files of
+ * its node on the host and in a MemoryFileSystem, which leaves the host
+ * files untouched.
+ */
+class DceMemoryFileSystemTestCase : public TestCase
+{
+public:
+  DceMemoryFileSystemTestCase ();
+private:
+  virtual void DoRun (void);
+  static void Finished (uint16_t *ppid, int *pstatus, uint16_t pid, int status);
+  // Run the process, return its stdout.
+  std::string RunProcess (bool memory);
+  static std::string ReadFile (std::string path);
+};
+
+DceMemoryFileSystemTestCase::DceMemoryFileSystemTestCase ()
+  : TestCase ("Check that process \"test-memory-fs\" prints the same results "
+              "on the host and on the memory file systems")
+{
+}
+
+void
+DceMemoryFileSystemTestCase::Finished (uint16_t *ppid, int *pstatus, uint16_t pid, int status)
+{
+  *ppid = pid;
+  *pstatus = status;
+}
+
+std::string
+DceMemoryFileSystemTestCase::ReadFile (std::string path)
+{
+  std::ifstream file (path.c_str ());
+  std::ostringstream content;
+  content << file.rdbuf ();
+  return content.str ();
+}
+
+std::string
+DceMemoryFileSystemTestCase::RunProcess (bool memory)
+{
+  unlink ("files-0/tmp/mfs-a");
+  unlink ("files-0/tmp/mfs-b");
+  unlink ("files-0/tmp/mfs-moved");
+  std::ofstream lower ("files-0/tmp/mfs-lower");
+  lower << "lower";
+  lower.close ();
+
+  NodeContainer nodes;
+  nodes.Create (1);
+  DceManagerHelper dceManager;
+  if (memory)
+    {
+      dceManager.EnableMemoryFileSystem ();
+    }
+  dceManager.Install (nodes);
+
+  uint16_t pid = 0;
+  int status = -1;
+  DceApplicationHelper dce;
+  dce.SetBinary ("test-memory-fs");
+  dce.SetStackSize (1 << 20);
+  dce.ResetArguments ();
+  dce.ResetEnvironment ();
+  dce.SetFinishedCallback (MakeBoundCallback (&DceMemoryFileSystemTestCase::Finished, &pid, &status));
+  ApplicationContainer apps = dce.Install (nodes.Get (0));
+  apps.Start (Seconds (1.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (status, 0, "Process did not return successfully: " << g_testError);
+  std::ostringstream out;
+  out << "files-0/var/log/" << pid << "/stdout";
+  return ReadFile (out.str ());
+}
+
+void
+DceMemoryFileSystemTestCase::DoRun (void)
+{
+  struct stat st;
+  std::string host = RunProcess (false);
+  NS_TEST_EXPECT_MSG_EQ (stat ("files-0/tmp/mfs-lower", &st), -1, "Host file not unlinked");
+
+  std::string memory = RunProcess (true);
+  NS_TEST_EXPECT_MSG_NE (host, "", "No results on the host");
+  NS_TEST_EXPECT_MSG_EQ (memory, host, "Different results on the memory file system");
+  NS_TEST_EXPECT_MSG_EQ (ReadFile ("files-0/tmp/mfs-lower"), "lower", "Host file modified");
+  NS_TEST_EXPECT_MSG_EQ (stat ("files-0/tmp/mfs-moved", &st), -1, "Memory file written to the host");
+  unlink ("files-0/tmp/mfs-lower");
+}
+
 static class DceManagerTestSuite : public TestSuite
 {
 public:
@@ -201,6 +296,7 @@ DceManagerTestSuite::DceManagerTestSuite ()
     {  "test-random", 0, "", false, false, NS3_STACK|LINUX_STACK|FREEBSD_STACK},
     {  "test-local-socket", 0, "", false, false, NS3_STACK|LINUX_STACK|FREEBSD_STACK},
     {  "test-poll", 3200, "", true, false, NS3_STACK|LINUX_STACK},
+    {  "test-epoll", 0, "", false, false, NS3_STACK|LINUX_STACK|FREEBSD_STACK},
     {  "test-tcp-socket", 320, "", true, false, NS3_STACK|LINUX_STACK},
     {  "test-exec", 0, "", false, true, NS3_STACK|LINUX_STACK|FREEBSD_STACK},
     {  "test-raw-socket", 320, "", true, false, NS3_STACK|LINUX_STACK|FREEBSD_STACK},
@@ -213,6 +309,8 @@ DceManagerTestSuite::DceManagerTestSuite ()
     {  "test-tsearch", 0, "", false, false, NS3_STACK|LINUX_STACK|FREEBSD_STACK},
     {  "test-clock-gettime", 0, "", false, false, NS3_STACK|LINUX_STACK|FREEBSD_STACK},
     {  "test-gcc-builtin-apply", 0, "", false, false, NS3_STACK|LINUX_STACK|FREEBSD_STACK},
+    {  "test-nice", 0, "", false, true, NS3_STACK|LINUX_STACK|FREEBSD_STACK},
+    {  "test-process-lookup", 0, "", false, true, NS3_STACK|LINUX_STACK|FREEBSD_STACK},
     // XXX: not completely tested      {  "test-signal", 30, "" , false},
   };
 
@@ -257,6 +355,7 @@ DceManagerTestSuite::DceManagerTestSuite ()
                                            ),
                    TestCase::QUICK);
     }
+  AddTestCase (new DceMemoryFileSystemTestCase (), TestCase::QUICK);
 
   // linux stack
   TypeId tid;
@@ -0,0 +1,115 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "ns3/test.h"
+#include "ns3/dce-module.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/make-event.h"
+#include "ns3/kernel-socket-fd-factory.h"
+#include "ns3/task-manager.h"
+
+using namespace ns3;
+namespace ns3 {
+
+/**
+ * The deferred kernel callbacks start in the order they were scheduled,
+ * and one which blocks does not hold back the next ones: they run, and
+ * end, while it sleeps. This holds with the pool of worker tasks as with
+ * one task per callback (MaxIdleWorkers set to 0).
+ */
+class KernelDeferredTaskTestCase : public TestCase
+{
+public:
+  KernelDeferredTaskTestCase (bool skip, uint32_t maxIdleWorkers);
+private:
+  virtual void DoRun (void);
+  void Schedule (uint32_t first, uint32_t n);
+  void Callback (uint32_t i);
+
+  bool m_skip;
+  uint32_t m_maxIdleWorkers;
+  Ptr<KernelSocketFdFactory> m_kernel;
+  std::vector<uint32_t> m_started;
+  std::vector<uint32_t> m_ended;
+};
+
+KernelDeferredTaskTestCase::KernelDeferredTaskTestCase (bool skip, uint32_t maxIdleWorkers)
+  : TestCase (std::string (skip ? "(SKIP) " : "") +
+              "Check that a blocking deferred kernel callback keeps the order of the others, with MaxIdleWorkers=" +
+              (maxIdleWorkers ? "4" : "0")),
+    m_skip (skip),
+    m_maxIdleWorkers (maxIdleWorkers)
+{
+}
+
+void
+KernelDeferredTaskTestCase::Callback (uint32_t i)
+{
+  m_started.push_back (i);
+  if (i == 0)
+    {
+      TaskManager::Current ()->Sleep (Seconds (1.0));
+    }
+  m_ended.push_back (i);
+}
+
+void
+KernelDeferredTaskTestCase::Schedule (uint32_t first, uint32_t n)
+{
+  for (uint32_t i = first; i < first + n; i++)
+    {
+      m_kernel->ScheduleTask (MakeEvent (&KernelDeferredTaskTestCase::Callback, this, i));
+    }
+}
+
+void
+KernelDeferredTaskTestCase::DoRun (void)
+{
+  if (m_skip)
+    {
+      return;
+    }
+
+  NodeContainer nodes;
+  nodes.Create (1);
+  DceManagerHelper dceManager;
+  dceManager.SetNetworkStack ("ns3::LinuxSocketFdFactory", "Library", StringValue ("liblinux.so"));
+  dceManager.Install (nodes);
+  m_kernel = nodes.Get (0)->GetObject<KernelSocketFdFactory> ();
+  m_kernel->SetAttribute ("MaxIdleWorkers", UintegerValue (m_maxIdleWorkers));
+
+  // callback 0 sleeps until 3s: 1, 2 and 3 are queued behind it and 4
+  // comes while it sleeps.
+  Simulator::ScheduleWithContext (nodes.Get (0)->GetId (), Seconds (2.0),
+                                  &KernelDeferredTaskTestCase::Schedule, this, 0, 4);
+  Simulator::ScheduleWithContext (nodes.Get (0)->GetId (), Seconds (2.5),
+                                  &KernelDeferredTaskTestCase::Schedule, this, 4, 1);
+  Simulator::Stop (Seconds (4.0));
+  Simulator::Run ();
+  m_kernel = 0;
+  Simulator::Destroy ();
+
+  uint32_t ended[] = { 1, 2, 3, 4, 0 };
+  NS_TEST_ASSERT_MSG_EQ (m_started.size (), 5, "Callbacks not started");
+  NS_TEST_ASSERT_MSG_EQ (m_ended.size (), 5, "Callbacks not ended");
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_started[i], i, "Callback started out of order");
+      NS_TEST_EXPECT_MSG_EQ (m_ended[i], ended[i], "Callback held back by the blocking one");
+    }
+}
+
+static class KernelDeferredTaskTestSuite : public TestSuite
+{
+public:
+  KernelDeferredTaskTestSuite ();
+} g_kernelDeferredTaskTests;
+
+KernelDeferredTaskTestSuite::KernelDeferredTaskTestSuite ()
+  : TestSuite ("dce-kernel-deferred-task", UNIT)
+{
+  std::string filePath = SearchExecFile ("DCE_PATH", "liblinux.so", 0);
+  AddTestCase (new KernelDeferredTaskTestCase (filePath.length () <= 0, 4), TestCase::QUICK);
+  AddTestCase (new KernelDeferredTaskTestCase (filePath.length () <= 0, 0), TestCase::QUICK);
+}
+
+} // namespace ns3
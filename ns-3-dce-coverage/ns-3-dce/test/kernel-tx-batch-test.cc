@@ -0,0 +1,178 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "ns3/test.h"
+#include "ns3/dce-module.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/kernel-socket-fd-factory.h"
+
+using namespace ns3;
+namespace ns3 {
+
+/**
+ * With TxBatch, the packets the kernel sends on two links are handed to
+ * the device of their link, in the order they were sent, once per burst:
+ * the queue of a device goes out as soon as it holds TxMaxBurst packets,
+ * whatever the queue of the other device holds, and the rest at the end
+ * of the event which sent them.
+ */
+class KernelTxBatchTestCase : public TestCase
+{
+public:
+  KernelTxBatchTestCase (bool skip);
+private:
+  virtual void DoRun (void);
+  void Tx (uint32_t link, Ptr<const Packet> packet);
+  void Rx (uint32_t link, Ptr<const Packet> packet);
+  void SendBurst (void);
+  Ptr<Packet> Numbered (uint32_t seq);
+
+  bool m_skip;
+  Ptr<Socket> m_sockets[2];
+  // the sequence numbers handed to the device of each link.
+  std::vector<uint32_t> m_sent[2];
+  uint32_t m_received[2];
+};
+
+static const uint32_t BURST = 10;
+static const uint32_t MAX_BURST = 4;
+
+KernelTxBatchTestCase::KernelTxBatchTestCase (bool skip)
+  : TestCase (std::string (skip ? "(SKIP) " : "") +
+              "Check that the kernel packets are sent in order and in bursts on each device"),
+    m_skip (skip)
+{
+}
+
+Ptr<Packet>
+KernelTxBatchTestCase::Numbered (uint32_t seq)
+{
+  uint8_t buffer[64];
+  memset (buffer, 0, sizeof (buffer));
+  memcpy (buffer + sizeof (buffer) - sizeof (seq), &seq, sizeof (seq));
+  return Create<Packet> (buffer, sizeof (buffer));
+}
+
+void
+KernelTxBatchTestCase::Tx (uint32_t link, Ptr<const Packet> packet)
+{
+  // the number is at the end of the payload, after the ip and udp headers.
+  uint32_t size = packet->GetSize ();
+  NS_ASSERT (size >= 64);
+  uint8_t *buffer = new uint8_t[size];
+  packet->CopyData (buffer, size);
+  uint32_t seq;
+  memcpy (&seq, buffer + size - sizeof (seq), sizeof (seq));
+  delete[] buffer;
+  m_sent[link].push_back (seq);
+}
+
+void
+KernelTxBatchTestCase::Rx (uint32_t link, Ptr<const Packet> packet)
+{
+  m_received[link]++;
+}
+
+void
+KernelTxBatchTestCase::SendBurst (void)
+{
+  // the packets of the two links are interleaved: the devices do not
+  // share their queue.
+  for (uint32_t i = 1; i <= BURST; i++)
+    {
+      for (uint32_t link = 0; link < 2; link++)
+        {
+          uint32_t before = m_sent[link].size ();
+          NS_TEST_EXPECT_MSG_EQ (m_sockets[link]->Send (Numbered (i)), 64, "Send failed");
+          uint32_t sent = m_sent[link].size () - before;
+          NS_TEST_EXPECT_MSG_EQ (sent, ((i % MAX_BURST) == 0 ? MAX_BURST : 0),
+                                 "Packet " << i << " of link " << link << " not queued until TxMaxBurst");
+        }
+    }
+}
+
+void
+KernelTxBatchTestCase::DoRun (void)
+{
+  if (m_skip)
+    {
+      return;
+    }
+
+  NodeContainer nodes;
+  nodes.Create (2);
+  PointToPointHelper pointToPoint;
+  pointToPoint.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  pointToPoint.SetChannelAttribute ("Delay", StringValue ("1ms"));
+  NetDeviceContainer links[2];
+  links[0] = pointToPoint.Install (nodes);
+  links[1] = pointToPoint.Install (nodes);
+
+  DceManagerHelper dceManager;
+  dceManager.SetNetworkStack ("ns3::LinuxSocketFdFactory", "Library", StringValue ("liblinux.so"));
+  dceManager.Install (nodes);
+  LinuxStackHelper stack;
+  stack.Install (nodes);
+  Ptr<KernelSocketFdFactory> kernel = nodes.Get (0)->GetObject<KernelSocketFdFactory> ();
+  kernel->SetAttribute ("TxBatch", BooleanValue (true));
+  kernel->SetAttribute ("TxMaxBurst", UintegerValue (MAX_BURST));
+
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces0 = address.Assign (links[0]);
+  address.SetBase ("10.1.2.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces1 = address.Assign (links[1]);
+  Address peers[2];
+  peers[0] = InetSocketAddress (interfaces0.GetAddress (1), 9);
+  peers[1] = InetSocketAddress (interfaces1.GetAddress (1), 9);
+
+  for (uint32_t link = 0; link < 2; link++)
+    {
+      // the devices are told apart by their index in the node.
+      NS_TEST_ASSERT_MSG_EQ (links[link].Get (0)->GetIfIndex (), link, "Unexpected device index");
+      links[link].Get (0)->TraceConnectWithoutContext
+        ("MacTx", MakeCallback (&KernelTxBatchTestCase::Tx, this).Bind (link));
+      links[link].Get (1)->TraceConnectWithoutContext
+        ("MacRx", MakeCallback (&KernelTxBatchTestCase::Rx, this).Bind (link));
+      m_received[link] = 0;
+      m_sockets[link] = Socket::CreateSocket (nodes.Get (0), TypeId::LookupByName ("ns3::LinuxUdpSocketFactory"));
+      m_sockets[link]->Connect (peers[link]);
+    }
+
+  Simulator::ScheduleWithContext (nodes.Get (0)->GetId (), Seconds (2.0),
+                                  &KernelTxBatchTestCase::SendBurst, this);
+  Simulator::Stop (Seconds (3.0));
+  Simulator::Run ();
+  for (uint32_t link = 0; link < 2; link++)
+    {
+      m_sockets[link]->Close ();
+      m_sockets[link] = 0;
+    }
+  Simulator::Destroy ();
+
+  for (uint32_t link = 0; link < 2; link++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_sent[link].size (), BURST, "Wrong number of packets sent on link " << link);
+      for (uint32_t i = 0; i < BURST; i++)
+        {
+          NS_TEST_EXPECT_MSG_EQ (m_sent[link][i], i + 1, "Packet out of order on link " << link);
+        }
+      NS_TEST_EXPECT_MSG_EQ (m_received[link], BURST, "Wrong number of packets received on link " << link);
+    }
+}
+
+static class KernelTxBatchTestSuite : public TestSuite
+{
+public:
+  KernelTxBatchTestSuite ();
+} g_kernelTxBatchTests;
+
+KernelTxBatchTestSuite::KernelTxBatchTestSuite ()
+  : TestSuite ("dce-kernel-tx-batch", UNIT)
+{
+  std::string filePath = SearchExecFile ("DCE_PATH", "liblinux.so", 0);
+  AddTestCase (new KernelTxBatchTestCase (filePath.length () <= 0), TestCase::QUICK);
+}
+
+} // namespace ns3
@@ -0,0 +1,153 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "ns3/test.h"
+#include "ns3/dce-module.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+
+using namespace ns3;
+namespace ns3 {
+
+/**
+ * The addresses of the ns-3 helpers and the routes of
+ * LinuxStackHelper::PopulateRoutingTables reach the Linux kernels of a
+ * chain of four nodes through rtnetlink, without any ip process: the
+ * first node reaches the last one over IPv4 and IPv6.
+ */
+class LinuxNetlinkTestCase : public TestCase
+{
+public:
+  LinuxNetlinkTestCase (bool skip);
+private:
+  virtual void DoRun (void);
+  bool m_skip;
+};
+
+LinuxNetlinkTestCase::LinuxNetlinkTestCase (bool skip)
+  : TestCase (std::string (skip ? "(SKIP) " : "") +
+              "Check that the addresses and routes sent with rtnetlink carry traffic across three hops"),
+    m_skip (skip)
+{
+}
+
+void
+LinuxNetlinkTestCase::DoRun (void)
+{
+  if (m_skip)
+    {
+      return;
+    }
+
+  NodeContainer nodes;
+  nodes.Create (4);
+  DceManagerHelper dceManager;
+  dceManager.SetNetworkStack ("ns3::LinuxSocketFdFactory", "Library", StringValue ("liblinux.so"));
+  dceManager.Install (nodes);
+  LinuxStackHelper stack;
+  stack.Install (nodes);
+  stack.SysctlSet (nodes, ".net.ipv4.ip_forward", "1");
+  stack.SysctlSet (nodes, ".net.ipv6.conf.all.forwarding", "1");
+
+  PointToPointHelper pointToPoint;
+  pointToPoint.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
+  pointToPoint.SetChannelAttribute ("Delay", StringValue ("1ms"));
+  Ipv4AddressHelper address;
+  Ipv6AddressHelper address6;
+  std::vector<Ipv4InterfaceContainer> interfaces;
+  std::vector<Ipv6InterfaceContainer> interfaces6;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      NetDeviceContainer devices = pointToPoint.Install (nodes.Get (i), nodes.Get (i + 1));
+      std::ostringstream network;
+      network << "10.0." << i << ".0";
+      address.SetBase (network.str ().c_str (), "255.255.255.0");
+      interfaces.push_back (address.Assign (devices));
+      std::ostringstream network6;
+      network6 << "2001:" << i + 1 << "::";
+      address6.SetBase (Ipv6Address (network6.str ().c_str ()), Ipv6Prefix (64));
+      interfaces6.push_back (address6.Assign (devices));
+    }
+
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+  // there is no global routing for IPv6: each node goes through its
+  // neighbour on the way to the other end.
+  Ipv6StaticRoutingHelper routing6;
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      Ptr<Ipv6StaticRouting> routes = routing6.GetStaticRouting (nodes.Get (i)->GetObject<Ipv6> ());
+      for (uint32_t link = 0; link < 3; link++)
+        {
+          std::ostringstream network6;
+          network6 << "2001:" << link + 1 << "::";
+          if (link > i)
+            {
+              // interfaces6[i] holds node i at 0 and node i + 1 at 1.
+              routes->AddNetworkRouteTo (Ipv6Address (network6.str ().c_str ()), Ipv6Prefix (64),
+                                         interfaces6[i].GetAddress (1, 1), 1);
+            }
+          else if (link + 1 < i)
+            {
+              routes->AddNetworkRouteTo (Ipv6Address (network6.str ().c_str ()), Ipv6Prefix (64),
+                                         interfaces6[i - 1].GetAddress (0, 1), 0);
+            }
+        }
+    }
+  LinuxStackHelper::PopulateRoutingTables ();
+
+  Address sinks[2];
+  sinks[0] = InetSocketAddress (interfaces[2].GetAddress (1), 9);
+  sinks[1] = Inet6SocketAddress (interfaces6[2].GetAddress (1, 1), 9);
+  const char *factories[2] = { "ns3::LinuxUdpSocketFactory", "ns3::LinuxUdp6SocketFactory" };
+  Address any[2];
+  any[0] = InetSocketAddress (Ipv4Address::GetAny (), 9);
+  any[1] = Inet6SocketAddress (Ipv6Address::GetAny (), 9);
+  Ptr<PacketSink> received[2];
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      PacketSinkHelper sink (factories[i], any[i]);
+      ApplicationContainer apps = sink.Install (nodes.Get (3));
+      apps.Start (Seconds (4.0));
+      received[i] = apps.Get (0)->GetObject<PacketSink> ();
+
+      OnOffHelper onoff (factories[i], sinks[i]);
+      onoff.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
+      onoff.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
+      onoff.SetAttribute ("PacketSize", UintegerValue (100));
+      onoff.SetAttribute ("DataRate", StringValue ("8kbps"));
+      apps = onoff.Install (nodes.Get (0));
+      // once the IPv6 addresses are past duplicate address detection.
+      apps.Start (Seconds (5.0));
+      apps.Stop (Seconds (6.0));
+    }
+
+  Simulator::Stop (Seconds (8.0));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (DceManagerHelper::GetProcStatus ().size (), 0, "Processes started to configure the stack");
+  uint32_t totalRx[2];
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      totalRx[i] = received[i]->GetTotalRx ();
+      received[i] = 0;
+    }
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_GT (totalRx[0], 0, "No IPv4 packet across the chain");
+  NS_TEST_EXPECT_MSG_GT (totalRx[1], 0, "No IPv6 packet across the chain");
+}
+
+static class LinuxNetlinkTestSuite : public TestSuite
+{
+public:
+  LinuxNetlinkTestSuite ();
+} g_linuxNetlinkTests;
+
+LinuxNetlinkTestSuite::LinuxNetlinkTestSuite ()
+  : TestSuite ("dce-linux-netlink", UNIT)
+{
+  std::string filePath = SearchExecFile ("DCE_PATH", "liblinux.so", 0);
+  AddTestCase (new LinuxNetlinkTestCase (filePath.length () <= 0), TestCase::QUICK);
+}
+
+} // namespace ns3
@@ -0,0 +1,141 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "ns3/test.h"
+#include "ns3/dce-module.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+using namespace ns3;
+namespace ns3 {
+
+/**
+ * SysctlDiff reports the parameters whose value changed, appeared or
+ * disappeared between two snapshots, and only them.
+ */
+class SysctlDiffTestCase : public TestCase
+{
+public:
+  SysctlDiffTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+SysctlDiffTestCase::SysctlDiffTestCase ()
+  : TestCase ("Check that SysctlDiff reports the changed, added and removed parameters")
+{
+}
+
+void
+SysctlDiffTestCase::DoRun (void)
+{
+  std::map<std::string, std::string> before;
+  before[".a"] = "1";
+  before[".b"] = "2";
+  before[".c"] = "3";
+  std::map<std::string, std::string> after;
+  after[".b"] = "2";
+  after[".c"] = "4";
+  after[".d"] = "5";
+
+  std::map<std::string, std::pair<std::string, std::string> > diff =
+    LinuxStackHelper::SysctlDiff (before, after);
+  NS_TEST_ASSERT_MSG_EQ (diff.size (), 3, "Wrong number of differences");
+  NS_TEST_EXPECT_MSG_EQ (diff[".a"].first, "1", "Removed parameter");
+  NS_TEST_EXPECT_MSG_EQ (diff[".a"].second, "", "Removed parameter");
+  NS_TEST_EXPECT_MSG_EQ (diff[".c"].first, "3", "Changed parameter");
+  NS_TEST_EXPECT_MSG_EQ (diff[".c"].second, "4", "Changed parameter");
+  NS_TEST_EXPECT_MSG_EQ (diff[".d"].first, "", "Added parameter");
+  NS_TEST_EXPECT_MSG_EQ (diff[".d"].second, "5", "Added parameter");
+  NS_TEST_EXPECT_MSG_EQ (LinuxStackHelper::SysctlDiff (after, after).size (), 0, "Same snapshots differ");
+}
+
+/**
+ * The values given to SysctlSet are written in their order: the last
+ * value of a parameter set twice wins, and a snapshot taken after shows
+ * the new values, and only them, against a snapshot taken before.
+ */
+class SysctlSetTestCase : public TestCase
+{
+public:
+  SysctlSetTestCase (bool skip);
+private:
+  virtual void DoRun (void);
+  static void Snapshot (Ptr<Node> node, std::map<std::string, std::string> values);
+
+  bool m_skip;
+  static std::vector<std::map<std::string, std::string> > m_snapshots;
+};
+
+std::vector<std::map<std::string, std::string> > SysctlSetTestCase::m_snapshots;
+
+SysctlSetTestCase::SysctlSetTestCase (bool skip)
+  : TestCase (std::string (skip ? "(SKIP) " : "") +
+              "Check that SysctlSet writes the values in order and that the snapshots show them"),
+    m_skip (skip)
+{
+}
+
+void
+SysctlSetTestCase::Snapshot (Ptr<Node> node, std::map<std::string, std::string> values)
+{
+  m_snapshots.push_back (values);
+}
+
+void
+SysctlSetTestCase::DoRun (void)
+{
+  if (m_skip)
+    {
+      return;
+    }
+
+  NodeContainer nodes;
+  nodes.Create (1);
+  DceManagerHelper dceManager;
+  dceManager.SetNetworkStack ("ns3::LinuxSocketFdFactory", "Library", StringValue ("liblinux.so"));
+  dceManager.Install (nodes);
+  LinuxStackHelper stack;
+  stack.Install (nodes);
+
+  m_snapshots.clear ();
+  LinuxStackHelper::SysctlSnapshot (nodes.Get (0), Seconds (0.05), ".net.ipv4", &SysctlSetTestCase::Snapshot);
+  std::vector<std::pair<std::string, std::string> > values;
+  values.push_back (std::make_pair (".net.ipv4.tcp_syn_retries", "2"));
+  values.push_back (std::make_pair (".net.ipv4.tcp_fin_timeout", "20"));
+  values.push_back (std::make_pair (".net.ipv4.tcp_syn_retries", "3"));
+  // SysctlSet writes them at 0.1s.
+  stack.SysctlSet (nodes, values);
+  LinuxStackHelper::SysctlSnapshot (nodes.Get (0), Seconds (0.2), ".net.ipv4", &SysctlSetTestCase::Snapshot);
+
+  Simulator::Stop (Seconds (1.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_snapshots.size (), 2, "Snapshots not taken");
+  NS_TEST_ASSERT_MSG_NE (m_snapshots[0].size (), 0, "Empty snapshot");
+  std::map<std::string, std::pair<std::string, std::string> > diff =
+    LinuxStackHelper::SysctlDiff (m_snapshots[0], m_snapshots[1]);
+  NS_TEST_EXPECT_MSG_EQ (diff.size (), 2, "Other parameters changed");
+  // the kernel ends the values it reads with a new line.
+  NS_TEST_EXPECT_MSG_EQ (diff[".net.ipv4.tcp_syn_retries"].second, "3\n", "Values not written in order");
+  NS_TEST_EXPECT_MSG_EQ (diff[".net.ipv4.tcp_fin_timeout"].second, "20\n", "Value not written");
+  NS_TEST_EXPECT_MSG_EQ (diff[".net.ipv4.tcp_fin_timeout"].first,
+                         m_snapshots[0][".net.ipv4.tcp_fin_timeout"], "Wrong previous value");
+}
+
+static class LinuxSysctlTestSuite : public TestSuite
+{
+public:
+  LinuxSysctlTestSuite ();
+} g_linuxSysctlTests;
+
+LinuxSysctlTestSuite::LinuxSysctlTestSuite ()
+  : TestSuite ("dce-linux-sysctl", UNIT)
+{
+  AddTestCase (new SysctlDiffTestCase (), TestCase::QUICK);
+  TypeId tid;
+  bool kern_linux = TypeId::LookupByNameFailSafe ("ns3::LinuxSocketFdFactory", &tid);
+  std::string filePath = SearchExecFile ("DCE_PATH", "liblinux.so", 0);
+  AddTestCase (new SysctlSetTestCase (!kern_linux || filePath.length () <= 0), TestCase::QUICK);
+}
+
+} // namespace ns3
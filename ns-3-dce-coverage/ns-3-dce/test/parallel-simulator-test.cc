@@ -0,0 +1,433 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/nstime.h"
+#include "ns3/uinteger.h"
+#include "ns3/object-factory.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/dce-parallel-simulator-impl.h"
+#include "ns3/default-simulator-impl.h"
+#include "ns3/dce-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include <vector>
+#include <sstream>
+
+NS_LOG_COMPONENT_DEFINE ("ParallelSimulatorTest");
+
+using namespace ns3;
+namespace ns3 {
+
+/**
+ * A ring of nodes which pass messages to their neighbour, one lookahead
+ * ahead, and run local events in between, gives the same history to each
+ * node whatever the number of threads, and each event runs at its time on
+ * the partition of its node.
+ */
+class ParallelSimulatorRingTestCase : public TestCase
+{
+public:
+  ParallelSimulatorRingTestCase ();
+private:
+  struct Record
+  {
+    uint64_t ts;
+    uint32_t hop;
+    // a value of a random variable created by the event.
+    uint32_t draw;
+  };
+  virtual void DoRun (void);
+  std::vector<std::vector<struct Record> > RunRing (uint32_t threads);
+  void Receive (uint32_t node, uint32_t hop, uint64_t ts);
+  void Local (uint32_t node, uint32_t hop, uint64_t ts);
+
+  uint32_t m_nodes;
+  Time m_lookahead;
+  Ptr<DceParallelSimulatorImpl> m_impl;
+  // the history of each node, written by the partition of the node.
+  std::vector<std::vector<struct Record> > m_history;
+  std::vector<uint32_t> m_errors;
+};
+
+ParallelSimulatorRingTestCase::ParallelSimulatorRingTestCase ()
+  : TestCase ("Check that the nodes have the same history with one or several threads"),
+    m_nodes (16),
+    m_lookahead (MilliSeconds (2))
+{
+}
+
+void
+ParallelSimulatorRingTestCase::Local (uint32_t node, uint32_t hop, uint64_t ts)
+{
+  struct Record record;
+  record.ts = Simulator::Now ().GetTimeStep ();
+  record.hop = hop | 0x80000000;
+  record.draw = CreateObject<UniformRandomVariable> ()->GetInteger (0, 1 << 30);
+  m_history[node].push_back (record);
+  if (record.ts != ts || Simulator::GetContext () != node
+      || DceParallelSimulatorImpl::GetThreadPartition () == 0)
+    {
+      m_errors[node]++;
+    }
+}
+
+void
+ParallelSimulatorRingTestCase::Receive (uint32_t node, uint32_t hop, uint64_t ts)
+{
+  struct Record record;
+  record.ts = Simulator::Now ().GetTimeStep ();
+  record.hop = hop;
+  record.draw = CreateObject<UniformRandomVariable> ()->GetInteger (0, 1 << 30);
+  m_history[node].push_back (record);
+  if (record.ts != ts || Simulator::GetContext () != node)
+    {
+      m_errors[node]++;
+    }
+  if (hop == 200)
+    {
+      return;
+    }
+  // a few local events, from the same time to below the lookahead.
+  for (uint32_t i = 0; i < (hop + node) % 4; i++)
+    {
+      // one nanosecond off the microseconds of the messages: no tie.
+      Time delay = MicroSeconds ((hop * 7 + node * 13 + i * 331) % 2000) + NanoSeconds (1);
+      uint64_t at = (Simulator::Now () + delay).GetTimeStep ();
+      Simulator::Schedule (delay, &ParallelSimulatorRingTestCase::Local, this, node, hop, at);
+    }
+  Time delay = m_lookahead + MicroSeconds ((hop * 17 + node * 5) % 3000);
+  uint32_t next = (node + 1) % m_nodes;
+  uint64_t at = (Simulator::Now () + delay).GetTimeStep ();
+  Simulator::ScheduleWithContext (next, delay, &ParallelSimulatorRingTestCase::Receive,
+                                  this, next, hop + 1, at);
+}
+
+std::vector<std::vector<struct ParallelSimulatorRingTestCase::Record> >
+ParallelSimulatorRingTestCase::RunRing (uint32_t threads)
+{
+  Simulator::Destroy ();
+  ObjectFactory factory;
+  factory.SetTypeId ("ns3::DceParallelSimulatorImpl");
+  factory.Set ("Threads", UintegerValue (threads));
+  factory.Set ("Lookahead", TimeValue (m_lookahead));
+  m_impl = factory.Create<DceParallelSimulatorImpl> ();
+  Simulator::SetImplementation (m_impl);
+  m_history.clear ();
+  m_history.resize (m_nodes);
+  m_errors.clear ();
+  m_errors.resize (m_nodes);
+  for (uint32_t i = 0; i < m_nodes; i++)
+    {
+      Time delay = MicroSeconds (i * 100);
+      Simulator::ScheduleWithContext (i, delay, &ParallelSimulatorRingTestCase::Receive,
+                                      this, i, 0, delay.GetTimeStep ());
+    }
+  // a stop in the middle, then the end.
+  Simulator::Stop (MilliSeconds (100));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (Simulator::Now (), MilliSeconds (100), "Stopped at the wrong time");
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_impl->GetNPartitions (), threads, "Wrong number of partitions");
+  uint32_t ends = 0;
+  for (uint32_t i = 0; i < m_nodes; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_errors[i], 0, "Event of node " << i << " ran at the wrong time");
+      for (uint32_t j = 0; j < m_history[i].size (); j++)
+        {
+          ends += m_history[i][j].hop == 200;
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (ends, m_nodes, "Message lost");
+  m_impl = 0;
+  Simulator::Destroy ();
+  return m_history;
+}
+
+void
+ParallelSimulatorRingTestCase::DoRun (void)
+{
+  std::vector<std::vector<struct Record> > reference = RunRing (1);
+  uint32_t threads[] = { 2, 4, 5 };
+  for (uint32_t t = 0; t < sizeof (threads) / sizeof (threads[0]); t++)
+    {
+      std::vector<std::vector<struct Record> > history = RunRing (threads[t]);
+      for (uint32_t i = 0; i < m_nodes; i++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (history[i].size (), reference[i].size (),
+                                 "Different history for node " << i << " with " << threads[t] << " threads");
+          for (uint32_t j = 0; j < history[i].size (); j++)
+            {
+              NS_TEST_ASSERT_MSG_EQ (history[i][j].ts, reference[i][j].ts, "Different time");
+              NS_TEST_ASSERT_MSG_EQ (history[i][j].hop, reference[i][j].hop, "Different event");
+            }
+        }
+    }
+
+  // the streams of the random variables of a partition are numbered by
+  // the partition: the same with the same threads, whatever their order.
+  std::vector<std::vector<struct Record> > first = RunRing (4);
+  std::vector<std::vector<struct Record> > second = RunRing (4);
+  for (uint32_t i = 0; i < m_nodes; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (second[i].size (), first[i].size (), "Different history for node " << i);
+      for (uint32_t j = 0; j < first[i].size (); j++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (second[i][j].draw, first[i][j].draw,
+                                 "Different random value for node " << i);
+        }
+    }
+}
+
+/**
+ * Stop, and Stop with a delay below the lookahead, called by an event in
+ * the middle of a window stop its partition at that time, while the
+ * other partition runs the whole window, whatever the order of the
+ * threads. The next Run goes on from there.
+ */
+class ParallelSimulatorStopTestCase : public TestCase
+{
+public:
+  ParallelSimulatorStopTestCase ();
+private:
+  virtual void DoRun (void);
+  void RunStop (uint32_t threads, uint32_t caller, bool delay);
+  void Tick (uint32_t node);
+  void Stop (bool delay);
+
+  // the times of the ticks of each node.
+  std::vector<std::vector<Time> > m_ticks;
+};
+
+ParallelSimulatorStopTestCase::ParallelSimulatorStopTestCase ()
+  : TestCase ("Check that a stop within the lookahead stops its partition at its time")
+{
+}
+
+void
+ParallelSimulatorStopTestCase::Tick (uint32_t node)
+{
+  m_ticks[node].push_back (Simulator::Now ());
+  if (m_ticks[node].size () < 50)
+    {
+      Simulator::Schedule (MilliSeconds (1), &ParallelSimulatorStopTestCase::Tick, this, node);
+    }
+}
+
+void
+ParallelSimulatorStopTestCase::Stop (bool delay)
+{
+  if (delay)
+    {
+      Simulator::Stop (MicroSeconds (2000));
+    }
+  else
+    {
+      Simulator::Stop ();
+    }
+}
+
+void
+ParallelSimulatorStopTestCase::RunStop (uint32_t threads, uint32_t caller, bool delay)
+{
+  Simulator::Destroy ();
+  ObjectFactory factory;
+  factory.SetTypeId ("ns3::DceParallelSimulatorImpl");
+  factory.Set ("Threads", UintegerValue (threads));
+  factory.Set ("Lookahead", TimeValue (MilliSeconds (10)));
+  Simulator::SetImplementation (factory.Create<DceParallelSimulatorImpl> ());
+  m_ticks.clear ();
+  m_ticks.resize (2);
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Simulator::ScheduleWithContext (i, Seconds (0), &ParallelSimulatorStopTestCase::Tick, this, i);
+    }
+  // in the first window, [0, 10ms[.
+  Simulator::ScheduleWithContext (caller, MicroSeconds (3500),
+                                  &ParallelSimulatorStopTestCase::Stop, this, delay);
+  Simulator::Run ();
+
+  // the caller ticked at 0, 1, 2, 3ms, and at 4 and 5ms before a stop
+  // at 5.5ms.
+  uint32_t callerTicks = delay ? 6 : 4;
+  // the other partition ends the window, or is the same one.
+  uint32_t otherTicks = threads > 1 ? 10 : callerTicks;
+  NS_TEST_EXPECT_MSG_EQ (m_ticks[caller].size (), callerTicks,
+                         "Partition of the stop stopped at the wrong time with " << threads << " threads");
+  NS_TEST_EXPECT_MSG_EQ (m_ticks[1 - caller].size (), otherTicks,
+                         "Other partition stopped at the wrong time with " << threads << " threads");
+  if (delay && caller == 0)
+    {
+      NS_TEST_EXPECT_MSG_EQ (Simulator::Now (), MicroSeconds (5500), "Stopped at the wrong time");
+    }
+
+  Simulator::Run ();
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_ticks[i].size (), 50, "Ticks lost by node " << i);
+      for (uint32_t j = 0; j < m_ticks[i].size (); j++)
+        {
+          NS_TEST_EXPECT_MSG_EQ (m_ticks[i][j], MilliSeconds (j),
+                                 "Tick " << j << " of node " << i << " at the wrong time");
+        }
+    }
+  Simulator::Destroy ();
+}
+
+void
+ParallelSimulatorStopTestCase::DoRun (void)
+{
+  // a few times: a race shows up in some of them.
+  for (uint32_t k = 0; k < 10; k++)
+    {
+      for (uint32_t caller = 0; caller < 2; caller++)
+        {
+          RunStop (1, caller, true);
+          RunStop (1, caller, false);
+          RunStop (2, caller, true);
+          RunStop (2, caller, false);
+        }
+    }
+}
+
+/**
+ * DCE processes on nodes of two partitions, a udp client and an echo
+ * client on each side of a point to point link, receive the same
+ * packets at the same times as with the sequential simulator.
+ */
+class ParallelSimulatorDceTestCase : public TestCase
+{
+public:
+  ParallelSimulatorDceTestCase ();
+private:
+  struct Record
+  {
+    uint64_t ts;
+    uint32_t size;
+  };
+  virtual void DoRun (void);
+  std::vector<std::vector<struct Record> > RunNodes (Ptr<SimulatorImpl> impl);
+  static void Receive (std::vector<struct Record> *history, Ptr<const Packet> p);
+};
+
+ParallelSimulatorDceTestCase::ParallelSimulatorDceTestCase ()
+  : TestCase ("Check that DCE processes on two partitions exchange the packets of a sequential run")
+{
+}
+
+void
+ParallelSimulatorDceTestCase::Receive (std::vector<struct Record> *history, Ptr<const Packet> p)
+{
+  struct Record record;
+  record.ts = Simulator::Now ().GetTimeStep ();
+  record.size = p->GetSize ();
+  history->push_back (record);
+}
+
+std::vector<std::vector<struct ParallelSimulatorDceTestCase::Record> >
+ParallelSimulatorDceTestCase::RunNodes (Ptr<SimulatorImpl> impl)
+{
+  Simulator::Destroy ();
+  Simulator::SetImplementation (impl);
+
+  NodeContainer nodes;
+  nodes.Create (2);
+  PointToPointHelper pointToPoint;
+  pointToPoint.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
+  pointToPoint.SetChannelAttribute ("Delay", StringValue ("1ms"));
+  NetDeviceContainer devices = pointToPoint.Install (nodes);
+  InternetStackHelper stack;
+  stack.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+  DceManagerHelper dceManager;
+  dceManager.Install (nodes);
+
+  std::vector<std::vector<struct Record> > history (nodes.GetN ());
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      devices.Get (i)->TraceConnectWithoutContext
+        ("MacRx", MakeBoundCallback (&ParallelSimulatorDceTestCase::Receive, &history[i]));
+    }
+
+  std::ostringstream server;
+  std::ostringstream client;
+  interfaces.GetAddress (1).Print (server);
+  interfaces.GetAddress (0).Print (client);
+  DceApplicationHelper dce;
+  dce.SetStackSize (1 << 20);
+  ApplicationContainer apps;
+  // a packet a second from node 0 to node 1.
+  dce.SetBinary ("udp-server");
+  dce.ResetArguments ();
+  apps = dce.Install (nodes.Get (1));
+  apps.Start (Seconds (1.0));
+  dce.SetBinary ("udp-client");
+  dce.ResetArguments ();
+  dce.AddArgument (server.str ());
+  apps = dce.Install (nodes.Get (0));
+  apps.Start (Seconds (1.5));
+  // and an echo from node 0 to node 1 and back.
+  dce.SetBinary ("udp-echo-server");
+  dce.ResetArguments ();
+  apps = dce.Install (nodes.Get (0));
+  apps.Start (Seconds (1.0));
+  dce.SetBinary ("udp-echo-client");
+  dce.ResetArguments ();
+  dce.AddArgument (client.str ());
+  dce.AddArgument ("hello");
+  apps = dce.Install (nodes.Get (1));
+  apps.Start (Seconds (2.2));
+
+  Simulator::Stop (Seconds (20));
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return history;
+}
+
+void
+ParallelSimulatorDceTestCase::DoRun (void)
+{
+  std::vector<std::vector<struct Record> > reference = RunNodes (CreateObject<DefaultSimulatorImpl> ());
+  NS_TEST_ASSERT_MSG_GT (reference[1].size (), 10, "The udp client sent too few packets");
+  NS_TEST_ASSERT_MSG_GT (reference[0].size (), 0, "No echo");
+
+  ObjectFactory factory;
+  factory.SetTypeId ("ns3::DceParallelSimulatorImpl");
+  factory.Set ("Threads", UintegerValue (2));
+  Ptr<DceParallelSimulatorImpl> impl = factory.Create<DceParallelSimulatorImpl> ();
+  // node i runs on partition i % 2: each node has its own.
+  std::vector<std::vector<struct Record> > history = RunNodes (impl);
+  NS_TEST_EXPECT_MSG_EQ (impl->GetPartition (0), 0, "Node 0 on the wrong partition");
+  NS_TEST_EXPECT_MSG_EQ (impl->GetPartition (1), 1, "Node 1 on the wrong partition");
+  NS_TEST_EXPECT_MSG_EQ (impl->GetLookahead (), MilliSeconds (1), "The lookahead is not the delay of the link");
+  for (uint32_t i = 0; i < reference.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (history[i].size (), reference[i].size (),
+                             "Node " << i << " received other packets");
+      for (uint32_t j = 0; j < reference[i].size (); j++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (history[i][j].ts, reference[i][j].ts,
+                                 "Packet " << j << " of node " << i << " received at another time");
+          NS_TEST_ASSERT_MSG_EQ (history[i][j].size, reference[i][j].size,
+                                 "Packet " << j << " of node " << i << " of another size");
+        }
+    }
+}
+
+static class ParallelSimulatorTestSuite : public TestSuite
+{
+public:
+  ParallelSimulatorTestSuite ();
+} g_parallelSimulatorTests;
+
+ParallelSimulatorTestSuite::ParallelSimulatorTestSuite ()
+  : TestSuite ("dce-parallel-simulator", UNIT)
+{
+  AddTestCase (new ParallelSimulatorRingTestCase (), TestCase::QUICK);
+  AddTestCase (new ParallelSimulatorStopTestCase (), TestCase::QUICK);
+  AddTestCase (new ParallelSimulatorDceTestCase (), TestCase::QUICK);
+}
+
+} // namespace ns3
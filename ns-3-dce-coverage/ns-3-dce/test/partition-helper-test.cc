@@ -0,0 +1,180 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/uinteger.h"
+#include "ns3/object-factory.h"
+#include "ns3/dce-partition-helper.h"
+#include "ns3/dce-parallel-simulator-impl.h"
+#include <set>
+#include <algorithm>
+
+using namespace ns3;
+namespace ns3 {
+
+/**
+ * Groups of nodes which talk a lot to each other, and a little to the
+ * other groups, end up in partitions of their own, with the same number
+ * of nodes, whether the partitions are ranks or threads.
+ */
+class PartitionHelperTestCase : public TestCase
+{
+public:
+  PartitionHelperTestCase ();
+private:
+  virtual void DoRun (void);
+  void CheckGroups (const std::vector<uint32_t> &partition);
+};
+
+PartitionHelperTestCase::PartitionHelperTestCase ()
+  : TestCase ("Check that the nodes which talk the most share a partition")
+{
+}
+
+// node i belongs to group i % 4.
+void
+PartitionHelperTestCase::CheckGroups (const std::vector<uint32_t> &partition)
+{
+  NS_TEST_ASSERT_MSG_EQ (partition.size (), 16, "One partition per node");
+  std::set<uint32_t> used;
+  for (uint32_t group = 0; group < 4; group++)
+    {
+      for (uint32_t i = group; i < 16; i += 4)
+        {
+          NS_TEST_EXPECT_MSG_EQ (partition[i], partition[group], "Group " << group << " was split");
+        }
+      used.insert (partition[group]);
+    }
+  NS_TEST_EXPECT_MSG_EQ (used.size (), 4, "Two groups share a partition");
+}
+
+void
+PartitionHelperTestCase::DoRun (void)
+{
+  DcePartitionHelper helper;
+  for (uint32_t i = 0; i < 16; i++)
+    {
+      for (uint32_t j = i + 4; j < 16; j += 4)
+        {
+          helper.AddTraffic (i, j, 10);
+        }
+      // a ring between the groups.
+      helper.AddTraffic (i, (i + 1) % 16);
+    }
+  CheckGroups (helper.Partition (16, 4));
+
+  std::vector<uint32_t> halves = helper.Partition (16, 2);
+  uint32_t first = 0;
+  for (uint32_t i = 0; i < 16; i++)
+    {
+      first += halves[i] == 0;
+    }
+  NS_TEST_EXPECT_MSG_EQ (first, 8, "Unbalanced partitions");
+
+  NodeContainer nodes = helper.Create (16, 4);
+  std::vector<uint32_t> systems;
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      systems.push_back (nodes.Get (i)->GetSystemId ());
+    }
+  CheckGroups (systems);
+
+  Simulator::Destroy ();
+  ObjectFactory factory;
+  factory.SetTypeId ("ns3::DceParallelSimulatorImpl");
+  factory.Set ("Threads", UintegerValue (4));
+  Ptr<DceParallelSimulatorImpl> impl = factory.Create<DceParallelSimulatorImpl> ();
+  Simulator::SetImplementation (impl);
+  helper.Install (nodes);
+  std::vector<uint32_t> threads;
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      threads.push_back (impl->GetPartition (nodes.Get (i)->GetId ()));
+    }
+  CheckGroups (threads);
+  impl = 0;
+  Simulator::Destroy ();
+}
+
+/**
+ * A group which does not fit in the room left in a partition is split:
+ * the partitions have the same number of nodes, give or take one.
+ */
+class PartitionBalanceTestCase : public TestCase
+{
+public:
+  PartitionBalanceTestCase ();
+private:
+  virtual void DoRun (void);
+  void CheckBalance (const std::vector<uint32_t> &partition, uint32_t nPartitions);
+};
+
+PartitionBalanceTestCase::PartitionBalanceTestCase ()
+  : TestCase ("Check that the partitions have the same number of nodes, give or take one")
+{
+}
+
+void
+PartitionBalanceTestCase::CheckBalance (const std::vector<uint32_t> &partition, uint32_t nPartitions)
+{
+  std::vector<uint32_t> load (nPartitions, 0);
+  for (uint32_t i = 0; i < partition.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_LT (partition[i], nPartitions, "No such partition");
+      load[partition[i]]++;
+    }
+  uint32_t smallest = *std::min_element (load.begin (), load.end ());
+  uint32_t largest = *std::max_element (load.begin (), load.end ());
+  NS_TEST_EXPECT_MSG_LT_OR_EQ (largest - smallest, 1,
+                               partition.size () << " nodes in " << nPartitions << " unbalanced partitions");
+}
+
+void
+PartitionBalanceTestCase::DoRun (void)
+{
+  // groups of 3, 3 and 2 nodes, which take at most 4 nodes each: the
+  // group of 2 goes to both partitions.
+  DcePartitionHelper groups;
+  groups.AddTraffic (0, 1, 10);
+  groups.AddTraffic (1, 2, 10);
+  groups.AddTraffic (3, 4, 10);
+  groups.AddTraffic (4, 5, 10);
+  groups.AddTraffic (6, 7, 10);
+  groups.AddTraffic (2, 3);
+  groups.AddTraffic (5, 6);
+  std::vector<uint32_t> partition = groups.Partition (8, 2);
+  CheckBalance (partition, 2);
+  NS_TEST_EXPECT_MSG_EQ (partition[1], partition[0], "Group 0 was split");
+  NS_TEST_EXPECT_MSG_EQ (partition[2], partition[0], "Group 0 was split");
+  NS_TEST_EXPECT_MSG_EQ (partition[4], partition[3], "Group 1 was split");
+  NS_TEST_EXPECT_MSG_EQ (partition[5], partition[3], "Group 1 was split");
+  NS_TEST_EXPECT_MSG_NE (partition[0], partition[3], "Groups 0 and 1 share a partition");
+
+  // a chain, without traffic, and more partitions than nodes.
+  DcePartitionHelper chain;
+  for (uint32_t i = 0; i + 1 < 10; i++)
+    {
+      chain.AddTraffic (i, i + 1);
+    }
+  DcePartitionHelper none;
+  for (uint32_t nPartitions = 1; nPartitions <= 12; nPartitions++)
+    {
+      CheckBalance (chain.Partition (10, nPartitions), nPartitions);
+      CheckBalance (none.Partition (10, nPartitions), nPartitions);
+    }
+}
+
+static class PartitionHelperTestSuite : public TestSuite
+{
+public:
+  PartitionHelperTestSuite ();
+} g_partitionHelperTests;
+
+PartitionHelperTestSuite::PartitionHelperTestSuite ()
+  : TestSuite ("dce-partition-helper", UNIT)
+{
+  AddTestCase (new PartitionHelperTestCase (), TestCase::QUICK);
+  AddTestCase (new PartitionBalanceTestCase (), TestCase::QUICK);
+}
+
+} // namespace ns3
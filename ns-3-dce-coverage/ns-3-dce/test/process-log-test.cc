@@ -0,0 +1,134 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/config.h"
+#include "ns3/string.h"
+#include "ns3/process-log.h"
+#include "ns3/dce-manager-helper.h"
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+using namespace ns3;
+namespace ns3 {
+
+/**
+ * The records of the processes are kept until Simulator::Destroy, which
+ * writes them to exitprocs.bin, and read back unchanged by
+ * ProcessLog::Read.
+ */
+class ProcessLogTestCase : public TestCase
+{
+public:
+  ProcessLogTestCase ();
+private:
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+  void CheckEqual (const ProcessLog::Record &a, const ProcessLog::Record &b);
+};
+
+ProcessLogTestCase::ProcessLogTestCase ()
+  : TestCase ("Check that the process records written in the binary format read back unchanged")
+{
+}
+
+void
+ProcessLogTestCase::CheckEqual (const ProcessLog::Record &a, const ProcessLog::Record &b)
+{
+  NS_TEST_EXPECT_MSG_EQ (a.nodeId, b.nodeId, "Wrong node");
+  NS_TEST_EXPECT_MSG_EQ (a.pid, b.pid, "Wrong pid");
+  NS_TEST_EXPECT_MSG_EQ (a.ppid, b.ppid, "Wrong ppid");
+  NS_TEST_EXPECT_MSG_EQ (a.cause, b.cause, "Wrong cause");
+  NS_TEST_EXPECT_MSG_EQ (a.exitCode, b.exitCode, "Wrong exit code");
+  NS_TEST_EXPECT_MSG_EQ (a.ns3Start, b.ns3Start, "Wrong start");
+  NS_TEST_EXPECT_MSG_EQ (a.ns3End, b.ns3End, "Wrong end");
+  NS_TEST_EXPECT_MSG_EQ (a.realStart, b.realStart, "Wrong real start");
+  NS_TEST_EXPECT_MSG_EQ (a.realEnd, b.realEnd, "Wrong real end");
+  NS_TEST_EXPECT_MSG_EQ (a.cpuTime, b.cpuTime, "Wrong cpu time");
+  NS_TEST_EXPECT_MSG_EQ (a.cmdLine, b.cmdLine, "Wrong command line");
+}
+
+void
+ProcessLogTestCase::DoRun (void)
+{
+  Config::SetGlobal ("ProcessLogFormat", StringValue ("binary"));
+  unlink ("exitprocs.bin");
+
+  ProcessLog::Record exited;
+  exited.nodeId = 3;
+  exited.pid = 40000;
+  exited.ppid = 1;
+  exited.cause = ProcessLog::EXIT;
+  exited.exitCode = -2;
+  exited.ns3Start = 1000000000;
+  exited.ns3End = 5000000123LL;
+  exited.realStart = 1400000000;
+  exited.realEnd = 1400000007;
+  exited.cpuTime = 12345;
+  exited.cmdLine = "udp-perf --duration=10 ";
+  ProcessLog::AddRecord (exited);
+
+  ProcessLog::Record alive;
+  alive.nodeId = 0;
+  alive.pid = 2;
+  alive.ppid = 40000;
+  alive.cause = ProcessLog::NEVER_ENDED;
+  alive.exitCode = 0;
+  alive.ns3Start = 0;
+  alive.ns3End = 7000000000LL;
+  alive.realStart = 1400000001;
+  alive.realEnd = 1400000009;
+  alive.cpuTime = 0;
+  alive.cmdLine = "";
+  ProcessLog::AddRecord (alive);
+
+  std::vector<ProcessLog::Record> records = ProcessLog::GetRecords ();
+  NS_TEST_ASSERT_MSG_EQ (records.size (), 2, "Records not kept");
+  CheckEqual (records[0], exited);
+  CheckEqual (records[1], alive);
+  NS_TEST_EXPECT_MSG_EQ (DceManagerHelper::GetProcStatus ().size (), 1, "Exited processes");
+
+  Simulator::Destroy ();
+  NS_TEST_EXPECT_MSG_EQ (ProcessLog::GetRecords ().size (), 0, "Records kept after Simulator::Destroy");
+
+  std::vector<ProcessLog::Record> read = ProcessLog::Read ("exitprocs.bin");
+  NS_TEST_ASSERT_MSG_EQ (read.size (), 2, "Records not written");
+  for (uint32_t i = 0; i < read.size (); i++)
+    {
+      CheckEqual (read[i], records[i]);
+    }
+  std::vector<ProcStatus> status = DceManagerHelper::GetProcStatus ();
+  NS_TEST_ASSERT_MSG_EQ (status.size (), 1, "Exited processes not read back");
+  NS_TEST_EXPECT_MSG_EQ (status[0].GetPid (), 40000, "Wrong pid");
+
+  // a truncated file reads as no record.
+  std::ifstream in ("exitprocs.bin", std::ios::binary);
+  std::string content ((std::istreambuf_iterator<char> (in)), std::istreambuf_iterator<char> ());
+  in.close ();
+  std::ofstream out ("exitprocs.bin", std::ios::binary | std::ios::trunc);
+  out.write (content.c_str (), content.length () - 1);
+  out.close ();
+  NS_TEST_EXPECT_MSG_EQ (ProcessLog::Read ("exitprocs.bin").size (), 0, "Truncated log read");
+  NS_TEST_EXPECT_MSG_EQ (ProcessLog::Read ("process-log-test-missing").size (), 0, "Missing log read");
+}
+
+void
+ProcessLogTestCase::DoTeardown (void)
+{
+  Config::SetGlobal ("ProcessLogFormat", StringValue ("text"));
+  unlink ("exitprocs.bin");
+}
+
+static class ProcessLogTestSuite : public TestSuite
+{
+public:
+  ProcessLogTestSuite ();
+} g_processLogTests;
+
+ProcessLogTestSuite::ProcessLogTestSuite ()
+  : TestSuite ("dce-process-log", UNIT)
+{
+  AddTestCase (new ProcessLogTestCase (), TestCase::QUICK);
+}
+
+} // namespace ns3
@@ -0,0 +1,323 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/log.h"
+#include "ns3/string.h"
+#include "ns3/task-manager.h"
+#include "ns3/cfs-task-scheduler.h"
+#include "ns3/process-delay-model.h"
+#include <pthread.h>
+#include <time.h>
+
+NS_LOG_COMPONENT_DEFINE ("TaskSchedulerTest");
+
+using namespace ns3;
+namespace ns3 {
+
+// Every task slice costs one millisecond of simulated time.
+static Ptr<TaskManager>
+CreateTaskManager (Ptr<Node> node, std::string scheduler)
+{
+  ObjectFactory factory;
+  factory.SetTypeId (scheduler);
+  Ptr<RandomProcessDelayModel> delay = CreateObject<RandomProcessDelayModel> ();
+  delay->SetAttribute ("Variable", StringValue ("ns3::ConstantRandomVariable[Constant=0.001]"));
+  Ptr<TaskManager> taskManager = CreateObject<TaskManager> ();
+  taskManager->SetScheduler (factory.Create<TaskScheduler> ());
+  taskManager->SetDelayModel (delay);
+  node->AggregateObject (taskManager);
+  return taskManager;
+}
+
+struct BusyContext
+{
+  Time end;
+  int nice;
+  Task *task;
+};
+
+static void
+Busy (void *context)
+{
+  struct BusyContext *ctx = (struct BusyContext *)context;
+  TaskManager *manager = TaskManager::Current ();
+  manager->CurrentTask ()->SetPriority (ctx->nice);
+  while (Simulator::Now () < ctx->end)
+    {
+      manager->Yield ();
+    }
+  manager->Exit ();
+}
+
+/**
+ * A high priority task sleeps periodically while many cpu bound tasks
+ * compete with it, which is what a kernel timer does on a busy node.
+ * Measures how long it waits for the cpu once its timer expired.
+ */
+class TaskSchedulerLatencyTestCase : public TestCase
+{
+public:
+  TaskSchedulerLatencyTestCase ();
+private:
+  struct LatencyContext
+  {
+    uint32_t samples;
+    Time period;
+    Time total;
+    Time max;
+  };
+  virtual void DoRun (void);
+  static void Sleeper (void *context);
+  static void StartTasks (std::vector<struct BusyContext> *busy, struct LatencyContext *latency);
+  struct LatencyContext Run (std::string scheduler, uint32_t nTasks);
+};
+
+TaskSchedulerLatencyTestCase::TaskSchedulerLatencyTestCase ()
+  : TestCase ("Check the wakeup latency of a high priority task among many cpu bound tasks")
+{
+}
+void
+TaskSchedulerLatencyTestCase::Sleeper (void *context)
+{
+  struct LatencyContext *ctx = (struct LatencyContext *)context;
+  TaskManager *manager = TaskManager::Current ();
+  manager->CurrentTask ()->SetPriority (-10);
+  for (uint32_t i = 0; i < ctx->samples; i++)
+    {
+      Time expected = Simulator::Now () + ctx->period;
+      manager->Sleep (ctx->period);
+      Time latency = Simulator::Now () - expected;
+      ctx->total += latency;
+      ctx->max = Max (ctx->max, latency);
+    }
+  manager->Exit ();
+}
+void
+TaskSchedulerLatencyTestCase::StartTasks (std::vector<struct BusyContext> *busy,
+                                          struct LatencyContext *latency)
+{
+  TaskManager *manager = TaskManager::Current ();
+  for (std::vector<struct BusyContext>::iterator i = busy->begin (); i != busy->end (); ++i)
+    {
+      manager->Start (&Busy, &*i, 1 << 16);
+    }
+  manager->Start (&TaskSchedulerLatencyTestCase::Sleeper, latency, 1 << 16);
+}
+struct TaskSchedulerLatencyTestCase::LatencyContext
+TaskSchedulerLatencyTestCase::Run (std::string scheduler, uint32_t nTasks)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  CreateTaskManager (node, scheduler);
+
+  struct LatencyContext latency;
+  latency.samples = 50;
+  latency.period = MilliSeconds (10);
+  latency.total = Seconds (0);
+  latency.max = Seconds (0);
+  struct BusyContext ctx;
+  ctx.end = Seconds (2);
+  ctx.nice = 0;
+  std::vector<struct BusyContext> busy (nTasks, ctx);
+
+  Simulator::ScheduleWithContext (node->GetId (), Seconds (0),
+                                  &TaskSchedulerLatencyTestCase::StartTasks, &busy, &latency);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return latency;
+}
+void
+TaskSchedulerLatencyTestCase::DoRun (void)
+{
+  uint32_t nTasks = 64;
+  struct LatencyContext rr = Run ("ns3::RrTaskScheduler", nTasks);
+  struct LatencyContext cfs = Run ("ns3::CfsTaskScheduler", nTasks);
+  NS_LOG_INFO (nTasks << " tasks, mean/max wakeup latency:"
+               << " rr=" << (rr.total / (int64_t) rr.samples).GetMicroSeconds () << "us/"
+               << rr.max.GetMicroSeconds () << "us"
+               << " cfs=" << (cfs.total / (int64_t) cfs.samples).GetMicroSeconds () << "us/"
+               << cfs.max.GetMicroSeconds () << "us");
+
+  // round robin: the sleeper waits behind the busy tasks.
+  NS_TEST_ASSERT_MSG_GT (rr.max, MilliSeconds (nTasks / 4), "round robin should not favor the sleeper");
+  NS_TEST_ASSERT_MSG_LT (cfs.total, rr.total, "fair share should favor the sleeper");
+  // fair share: the sleeper runs at most one slice after its timer.
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (cfs.max, MilliSeconds (1), "sleeper delayed by the cpu bound tasks");
+}
+
+/**
+ * Cpu bound tasks share the cpu in proportion of the weight of their
+ * nice value.
+ */
+class TaskSchedulerShareTestCase : public TestCase
+{
+public:
+  TaskSchedulerShareTestCase ();
+private:
+  virtual void DoRun (void);
+  static void StartTasks (std::vector<struct BusyContext> *busy);
+};
+
+TaskSchedulerShareTestCase::TaskSchedulerShareTestCase ()
+  : TestCase ("Check that cpu time is shared according to nice values")
+{
+}
+void
+TaskSchedulerShareTestCase::StartTasks (std::vector<struct BusyContext> *busy)
+{
+  TaskManager *manager = TaskManager::Current ();
+  for (std::vector<struct BusyContext>::iterator i = busy->begin (); i != busy->end (); ++i)
+    {
+      i->task = manager->Start (&Busy, &*i, 1 << 16);
+    }
+}
+void
+TaskSchedulerShareTestCase::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<TaskManager> taskManager = CreateTaskManager (node, "ns3::CfsTaskScheduler");
+
+  std::vector<struct BusyContext> busy (3);
+  busy[0].nice = 0;
+  busy[1].nice = 0;
+  busy[2].nice = 5;
+  Time end = Seconds (1);
+  for (uint32_t i = 0; i < busy.size (); i++)
+    {
+      busy[i].end = end;
+    }
+  Simulator::ScheduleWithContext (node->GetId (), Seconds (0),
+                                  &TaskSchedulerShareTestCase::StartTasks, &busy);
+  Time cpu[3];
+  Simulator::Stop (end - MilliSeconds (1));
+  Simulator::Run ();
+  for (uint32_t i = 0; i < busy.size (); i++)
+    {
+      cpu[i] = busy[i].task->GetCpuTime ();
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  double expected = CfsTaskScheduler::GetWeight (0) / (double)CfsTaskScheduler::GetWeight (5);
+  NS_TEST_ASSERT_MSG_EQ_TOL (cpu[0].GetSeconds (), cpu[1].GetSeconds (), 0.002,
+                             "same nice, same share");
+  NS_TEST_ASSERT_MSG_EQ_TOL (cpu[0].GetSeconds () / cpu[2].GetSeconds (), expected, 0.1,
+                             "share does not follow the nice weights");
+}
+
+struct SpinContext
+{
+  uint32_t slices;
+  Time slice;
+  Time cpu;
+};
+
+static Time
+ThreadCpuTime (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+  return Seconds (ts.tv_sec) + NanoSeconds (ts.tv_nsec);
+}
+
+// Use slice of cpu, then let the others run, slices times.
+static void
+Spin (void *context)
+{
+  struct SpinContext *ctx = (struct SpinContext *)context;
+  TaskManager *manager = TaskManager::Current ();
+  for (uint32_t i = 0; i < ctx->slices; i++)
+    {
+      Time end = ThreadCpuTime () + ctx->slice;
+      while (ThreadCpuTime () < end)
+        {
+        }
+      manager->Yield ();
+    }
+  ctx->cpu = manager->CurrentTask ()->GetCpuTime ();
+  manager->Exit ();
+}
+
+static volatile bool g_spinning;
+
+// A busy host thread, which is not part of the simulation.
+static void *
+SpinHost (void *context)
+{
+  while (g_spinning)
+    {
+    }
+  return 0;
+}
+
+/**
+ * The CpuTimeProcessDelayModel charges a busy task with the cpu time it
+ * used, with both fiber managers, and not with the cpu time of the other
+ * threads of the host process.
+ */
+class TaskCpuTimeTestCase : public TestCase
+{
+public:
+  TaskCpuTimeTestCase (std::string fiberManager);
+private:
+  virtual void DoRun (void);
+  static void StartTask (struct SpinContext *spin);
+  std::string m_fiberManager;
+};
+
+TaskCpuTimeTestCase::TaskCpuTimeTestCase (std::string fiberManager)
+  : TestCase ("Check that a busy task is charged with its cpu time with the " + fiberManager),
+    m_fiberManager (fiberManager)
+{
+}
+void
+TaskCpuTimeTestCase::StartTask (struct SpinContext *spin)
+{
+  TaskManager::Current ()->Start (&Spin, spin, 1 << 16);
+}
+void
+TaskCpuTimeTestCase::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  ObjectFactory factory;
+  factory.SetTypeId ("ns3::TaskManager");
+  factory.Set ("FiberManagerType", StringValue (m_fiberManager));
+  Ptr<TaskManager> taskManager = factory.Create<TaskManager> ();
+  taskManager->SetScheduler (CreateObject<CfsTaskScheduler> ());
+  taskManager->SetDelayModel (CreateObject<CpuTimeProcessDelayModel> ());
+  node->AggregateObject (taskManager);
+
+  struct SpinContext spin;
+  spin.slices = 10;
+  spin.slice = MilliSeconds (5);
+  Simulator::ScheduleWithContext (node->GetId (), Seconds (0),
+                                  &TaskCpuTimeTestCase::StartTask, &spin);
+  g_spinning = true;
+  pthread_t host;
+  pthread_create (&host, 0, &SpinHost, 0);
+  Simulator::Run ();
+  g_spinning = false;
+  pthread_join (host, 0);
+  Simulator::Destroy ();
+
+  Time used = MilliSeconds (50);
+  NS_TEST_EXPECT_MSG_GT_OR_EQ (spin.cpu, used, "The task was charged less than it used");
+  NS_TEST_EXPECT_MSG_LT (spin.cpu, used + used / 2, "The task was charged with the cpu of another thread");
+}
+
+static class TaskSchedulerTestSuite : public TestSuite
+{
+public:
+  TaskSchedulerTestSuite ();
+} g_taskSchedulerTests;
+
+TaskSchedulerTestSuite::TaskSchedulerTestSuite ()
+  : TestSuite ("dce-task-scheduler", UNIT)
+{
+  AddTestCase (new TaskSchedulerShareTestCase (), TestCase::QUICK);
+  AddTestCase (new TaskSchedulerLatencyTestCase (), TestCase::QUICK);
+  AddTestCase (new TaskCpuTimeTestCase ("PthreadFiberManager"), TestCase::QUICK);
+  AddTestCase (new TaskCpuTimeTestCase ("UcontextFiberManager"), TestCase::QUICK);
+}
+
+} // namespace ns3
@@ -0,0 +1,274 @@
+#include "test-macros.h"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+static void
+test_ctl_errors (void)
+{
+  int fds[2];
+  struct epoll_event ev;
+  int ret;
+
+  int epfd = epoll_create (16);
+  TEST_ASSERT (epfd >= 0);
+  ret = pipe (fds);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  memset (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN;
+  ret = epoll_ctl (epfd, EPOLL_CTL_MOD, fds[0], &ev);
+  TEST_ASSERT_EQUAL (ret, -1);
+  TEST_ASSERT_EQUAL (errno, ENOENT);
+  ret = epoll_ctl (epfd, EPOLL_CTL_ADD, fds[0], &ev);
+  TEST_ASSERT_EQUAL (ret, 0);
+  ret = epoll_ctl (epfd, EPOLL_CTL_ADD, fds[0], &ev);
+  TEST_ASSERT_EQUAL (ret, -1);
+  TEST_ASSERT_EQUAL (errno, EEXIST);
+  ret = epoll_ctl (epfd, EPOLL_CTL_ADD, epfd, &ev);
+  TEST_ASSERT_EQUAL (ret, -1);
+  TEST_ASSERT_EQUAL (errno, EINVAL);
+  ret = epoll_ctl (epfd, EPOLL_CTL_ADD, 1000, &ev);
+  TEST_ASSERT_EQUAL (ret, -1);
+  TEST_ASSERT_EQUAL (errno, EBADF);
+  ret = epoll_ctl (epfd, EPOLL_CTL_DEL, fds[0], 0);
+  TEST_ASSERT_EQUAL (ret, 0);
+  ret = epoll_ctl (epfd, EPOLL_CTL_DEL, fds[0], 0);
+  TEST_ASSERT_EQUAL (ret, -1);
+  TEST_ASSERT_EQUAL (errno, ENOENT);
+
+  close (fds[0]);
+  close (fds[1]);
+  close (epfd);
+}
+
+static void
+test_level_triggered (void)
+{
+  int fds[2];
+  struct epoll_event ev;
+  struct epoll_event out[4];
+  char c;
+  int ret;
+
+  int epfd = epoll_create1 (0);
+  TEST_ASSERT (epfd >= 0);
+  ret = pipe (fds);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  memset (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN;
+  ev.data.u32 = 42;
+  ret = epoll_ctl (epfd, EPOLL_CTL_ADD, fds[0], &ev);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  ret = epoll_wait (epfd, out, 4, 0);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  ret = write (fds[1], "ab", 2);
+  TEST_ASSERT_EQUAL (ret, 2);
+  ret = epoll_wait (epfd, out, 4, 0);
+  TEST_ASSERT_EQUAL (ret, 1);
+  TEST_ASSERT (out[0].events & EPOLLIN);
+  TEST_ASSERT_EQUAL (out[0].data.u32, 42);
+
+  // Still readable: reported again.
+  ret = read (fds[0], &c, 1);
+  TEST_ASSERT_EQUAL (ret, 1);
+  ret = epoll_wait (epfd, out, 4, 0);
+  TEST_ASSERT_EQUAL (ret, 1);
+
+  ret = read (fds[0], &c, 1);
+  TEST_ASSERT_EQUAL (ret, 1);
+  ret = epoll_wait (epfd, out, 4, 0);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  close (fds[0]);
+  close (fds[1]);
+  close (epfd);
+}
+
+static void
+test_edge_triggered (void)
+{
+  int fds[2];
+  struct epoll_event ev;
+  struct epoll_event out[4];
+  int ret;
+
+  int epfd = epoll_create1 (0);
+  TEST_ASSERT (epfd >= 0);
+  ret = pipe (fds);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  memset (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN | EPOLLET;
+  ret = epoll_ctl (epfd, EPOLL_CTL_ADD, fds[0], &ev);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  ret = write (fds[1], "a", 1);
+  TEST_ASSERT_EQUAL (ret, 1);
+  ret = epoll_wait (epfd, out, 4, 0);
+  TEST_ASSERT_EQUAL (ret, 1);
+  // No new data: not reported again.
+  ret = epoll_wait (epfd, out, 4, 0);
+  TEST_ASSERT_EQUAL (ret, 0);
+  ret = write (fds[1], "a", 1);
+  TEST_ASSERT_EQUAL (ret, 1);
+  ret = epoll_wait (epfd, out, 4, 0);
+  TEST_ASSERT_EQUAL (ret, 1);
+
+  close (fds[0]);
+  close (fds[1]);
+  close (epfd);
+}
+
+static void
+test_oneshot (void)
+{
+  int fds[2];
+  struct epoll_event ev;
+  struct epoll_event out[4];
+  int ret;
+
+  int epfd = epoll_create1 (0);
+  TEST_ASSERT (epfd >= 0);
+  ret = pipe (fds);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  memset (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN | EPOLLONESHOT;
+  ret = epoll_ctl (epfd, EPOLL_CTL_ADD, fds[0], &ev);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  ret = write (fds[1], "a", 1);
+  TEST_ASSERT_EQUAL (ret, 1);
+  ret = epoll_wait (epfd, out, 4, 0);
+  TEST_ASSERT_EQUAL (ret, 1);
+  ret = write (fds[1], "a", 1);
+  TEST_ASSERT_EQUAL (ret, 1);
+  ret = epoll_wait (epfd, out, 4, 0);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  // Re-armed by EPOLL_CTL_MOD.
+  ret = epoll_ctl (epfd, EPOLL_CTL_MOD, fds[0], &ev);
+  TEST_ASSERT_EQUAL (ret, 0);
+  ret = epoll_wait (epfd, out, 4, 0);
+  TEST_ASSERT_EQUAL (ret, 1);
+
+  close (fds[0]);
+  close (fds[1]);
+  close (epfd);
+}
+
+static void
+test_many (void)
+{
+  const int n = 64;
+  int fds[n][2];
+  struct epoll_event ev;
+  struct epoll_event out[n];
+  int ret;
+
+  int epfd = epoll_create1 (0);
+  TEST_ASSERT (epfd >= 0);
+  for (int i = 0; i < n; i++)
+    {
+      ret = pipe (fds[i]);
+      TEST_ASSERT_EQUAL (ret, 0);
+      memset (&ev, 0, sizeof (ev));
+      ev.events = EPOLLIN;
+      ev.data.u32 = i;
+      ret = epoll_ctl (epfd, EPOLL_CTL_ADD, fds[i][0], &ev);
+      TEST_ASSERT_EQUAL (ret, 0);
+    }
+  ret = write (fds[7][1], "a", 1);
+  TEST_ASSERT_EQUAL (ret, 1);
+  ret = write (fds[33][1], "a", 1);
+  TEST_ASSERT_EQUAL (ret, 1);
+  ret = epoll_wait (epfd, out, n, 0);
+  TEST_ASSERT_EQUAL (ret, 2);
+  TEST_ASSERT_EQUAL (out[0].data.u32 + out[1].data.u32, 40);
+
+  // maxevents smaller than the number of ready files.
+  ret = epoll_wait (epfd, out, 1, 0);
+  TEST_ASSERT_EQUAL (ret, 1);
+
+  // A closed file leaves the interest set.
+  close (fds[7][0]);
+  ret = epoll_wait (epfd, out, n, 0);
+  TEST_ASSERT_EQUAL (ret, 1);
+  TEST_ASSERT_EQUAL (out[0].data.u32, 33);
+
+  for (int i = 0; i < n; i++)
+    {
+      if (i != 7)
+        {
+          close (fds[i][0]);
+        }
+      close (fds[i][1]);
+    }
+  close (epfd);
+}
+
+static int g_pipe[2];
+
+static void *
+writer (void *arg)
+{
+  sleep (1);
+  int ret = write (g_pipe[1], "a", 1);
+  TEST_ASSERT_EQUAL (ret, 1);
+  return 0;
+}
+
+static void
+test_blocking_wait (void)
+{
+  struct epoll_event ev;
+  struct epoll_event out[4];
+  pthread_t thread;
+  int ret;
+
+  int epfd = epoll_create1 (0);
+  TEST_ASSERT (epfd >= 0);
+  ret = pipe (g_pipe);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  memset (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN;
+  ret = epoll_ctl (epfd, EPOLL_CTL_ADD, g_pipe[0], &ev);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  // Timeout.
+  ret = epoll_wait (epfd, out, 4, 100);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  ret = pthread_create (&thread, 0, &writer, 0);
+  TEST_ASSERT_EQUAL (ret, 0);
+  ret = epoll_wait (epfd, out, 4, -1);
+  TEST_ASSERT_EQUAL (ret, 1);
+  TEST_ASSERT (out[0].events & EPOLLIN);
+  ret = pthread_join (thread, 0);
+  TEST_ASSERT_EQUAL (ret, 0);
+
+  close (g_pipe[0]);
+  close (g_pipe[1]);
+  close (epfd);
+}
+
+int
+main (int argc, char *argv[])
+{
+  test_ctl_errors ();
+  test_level_triggered ();
+  test_edge_triggered ();
+  test_oneshot ();
+  test_many ();
+  test_blocking_wait ();
+
+  return 0;
+}
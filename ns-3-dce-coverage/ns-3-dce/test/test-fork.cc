@@ -4,6 +4,9 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
 #include "test-macros.h"
 
 static int g_static;
@@ -64,6 +67,76 @@ static void test_fork (void)
     }
 }
 
+// The heap is shared with the child until one of them writes to it and
+// neither sees what the other writes. That fork copies a number of pages
+// independent of the size of the heap is checked by dce-cow-memory.
+static void test_fork_heap (void)
+{
+  for (int mb = 1; mb <= 64; mb *= 4)
+    {
+      int n = mb * 64;
+      char **blocks = (char **)malloc (n * sizeof (char *));
+      for (int i = 0; i < n; i++)
+        {
+          blocks[i] = (char *)malloc (16000);
+          memset (blocks[i], 'a', 16000);
+        }
+      pid_t pid = fork ();
+      if (pid == 0)
+        {
+          for (int i = 0; i < n; i++)
+            {
+              TEST_ASSERT_EQUAL (blocks[i][i % 16000], 'a');
+              blocks[i][i % 16000] = 'c';
+            }
+          sleep (1);
+          for (int i = 0; i < n; i++)
+            {
+              TEST_ASSERT_EQUAL (blocks[i][i % 16000], 'c');
+            }
+          exit (0);
+        }
+      for (int i = 0; i < n; i += 2)
+        {
+          blocks[i][i % 16000] = 'p';
+        }
+      int status;
+      waitpid (pid, &status, 0);
+      TEST_ASSERT_EQUAL (WEXITSTATUS (status), 0);
+      for (int i = 0; i < n; i++)
+        {
+          TEST_ASSERT_EQUAL (blocks[i][i % 16000], (i % 2) ? 'a' : 'p');
+          free (blocks[i]);
+        }
+      free (blocks);
+    }
+}
+
+// The host returns EFAULT instead of faulting when a system call writes
+// to a shared heap page, so the wrappers must copy it first.
+static void test_fork_syscall_output (void)
+{
+  struct rusage *usage = (struct rusage *)malloc (sizeof (struct rusage));
+  struct rlimit *limit = (struct rlimit *)malloc (sizeof (struct rlimit));
+  memset (usage, 0, sizeof (struct rusage));
+  memset (limit, 0, sizeof (struct rlimit));
+  pid_t pid = fork ();
+  if (pid == 0)
+    {
+      TEST_ASSERT_EQUAL (getrusage (RUSAGE_SELF, usage), 0);
+      TEST_ASSERT_EQUAL (getrlimit (RLIMIT_NOFILE, limit), 0);
+      TEST_ASSERT (limit->rlim_cur != 0);
+      exit (0);
+    }
+  int status;
+  waitpid (pid, &status, 0);
+  TEST_ASSERT_EQUAL (WEXITSTATUS (status), 0);
+  // the parent does not see the output of the child.
+  TEST_ASSERT_EQUAL (limit->rlim_cur, 0);
+  free (usage);
+  free (limit);
+}
+
 static void *
 test_wait_fork_thread (void *arg)
 {
@@ -315,6 +388,10 @@ int main (int argc, char *argv[])
 
       test_wait_fork ();
 
+      test_fork_heap ();
+
+      test_fork_syscall_output ();
+
       big_fork (0);
 
       printf ("pid: %d after \n",getpid ());
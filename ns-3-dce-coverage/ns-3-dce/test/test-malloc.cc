@@ -28,5 +28,19 @@ int main (int argc, char *argv[])
     }
   ptrs.clear ();
 
+  // grow a buffer across several size classes and check its content
+  // survives each move.
+  uint8_t *buffer = (uint8_t *)malloc (1);
+  buffer[0] = 0x42;
+  for (uint32_t size = 2; size < 200000; size = size * 3 / 2 + 1)
+    {
+      buffer = (uint8_t *)realloc (buffer, size);
+      if (buffer == 0 || buffer[0] != 0x42)
+        {
+          return 1;
+        }
+    }
+  free (buffer);
+
   return 0;
 }
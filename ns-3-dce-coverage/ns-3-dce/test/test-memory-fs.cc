@@ -0,0 +1,171 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <iostream>
+#include "test-macros.h"
+
+// The same operations give the same results, printed to stdout, with the
+// files of the node on the host or in a MemoryFileSystem. The host file
+// /tmp/mfs-lower is created by the test case with the content "lower".
+
+static std::string
+ReadAll (const char *path)
+{
+  int fd = open (path, O_RDONLY);
+  TEST_ASSERT (fd >= 0);
+  std::string content;
+  char buf[64];
+  ssize_t n;
+  while ((n = read (fd, buf, sizeof (buf))) > 0)
+    {
+      content.append (buf, n);
+    }
+  TEST_ASSERT_EQUAL (n, 0);
+  TEST_ASSERT_EQUAL (close (fd), 0);
+  return content;
+}
+
+static void
+List (const char *when)
+{
+  DIR *dir = opendir ("/tmp");
+  TEST_ASSERT (dir != 0);
+  std::vector<std::string> names;
+  struct dirent *entry;
+  while ((entry = readdir (dir)) != 0)
+    {
+      if (strncmp (entry->d_name, "mfs-", 4) == 0)
+        {
+          names.push_back (entry->d_name);
+        }
+    }
+  std::vector<std::string> again;
+  rewinddir (dir);
+  while ((entry = readdir (dir)) != 0)
+    {
+      if (strncmp (entry->d_name, "mfs-", 4) == 0)
+        {
+          again.push_back (entry->d_name);
+        }
+    }
+  TEST_ASSERT_EQUAL (closedir (dir), 0);
+  TEST_ASSERT (names == again);
+  std::sort (names.begin (), names.end ());
+  std::cout << when << ":";
+  for (std::vector<std::string>::iterator i = names.begin (); i != names.end (); ++i)
+    {
+      std::cout << " " << *i;
+    }
+  std::cout << std::endl;
+}
+
+static void
+test_write_read (void)
+{
+  int fd = open ("/tmp/mfs-a", O_CREAT | O_EXCL | O_RDWR, 0644);
+  TEST_ASSERT (fd >= 0);
+  TEST_ASSERT_EQUAL (write (fd, "hello world", 11), 11);
+  TEST_ASSERT_EQUAL (lseek (fd, 0, SEEK_CUR), 11);
+  TEST_ASSERT_EQUAL (lseek (fd, 6, SEEK_SET), 6);
+  TEST_ASSERT_EQUAL (write (fd, "there", 5), 5);
+  TEST_ASSERT_EQUAL (lseek (fd, 0, SEEK_END), 11);
+  // a hole, read back as zeros.
+  TEST_ASSERT_EQUAL (lseek (fd, 15, SEEK_SET), 15);
+  TEST_ASSERT_EQUAL (write (fd, "!", 1), 1);
+  TEST_ASSERT_EQUAL (lseek (fd, 0, SEEK_SET), 0);
+  char buf[32];
+  memset (buf, 'x', sizeof (buf));
+  TEST_ASSERT_EQUAL (read (fd, buf, sizeof (buf)), 16);
+  TEST_ASSERT_EQUAL (memcmp (buf, "hello there\0\0\0\0!", 16), 0);
+  TEST_ASSERT_EQUAL (read (fd, buf, sizeof (buf)), 0);
+
+  struct stat st;
+  TEST_ASSERT_EQUAL (fstat (fd, &st), 0);
+  TEST_ASSERT_EQUAL (st.st_size, 16);
+  TEST_ASSERT_EQUAL (ftruncate (fd, 11), 0);
+  TEST_ASSERT_EQUAL (close (fd), 0);
+  TEST_ASSERT_EQUAL (stat ("/tmp/mfs-a", &st), 0);
+  TEST_ASSERT (S_ISREG (st.st_mode));
+  TEST_ASSERT_EQUAL (st.st_size, 11);
+  TEST_ASSERT_EQUAL (st.st_mode & 0777, 0644);
+  std::cout << "a: " << ReadAll ("/tmp/mfs-a") << std::endl;
+
+  fd = open ("/tmp/mfs-a", O_CREAT | O_EXCL | O_WRONLY, 0644);
+  TEST_ASSERT_EQUAL (fd, -1);
+  TEST_ASSERT_EQUAL (errno, EEXIST);
+
+  fd = open ("/tmp/mfs-a", O_WRONLY | O_APPEND);
+  TEST_ASSERT (fd >= 0);
+  TEST_ASSERT_EQUAL (write (fd, "!", 1), 1);
+  TEST_ASSERT_EQUAL (close (fd), 0);
+  std::cout << "appended: " << ReadAll ("/tmp/mfs-a") << std::endl;
+  List ("written");
+}
+
+static void
+test_rename_unlink (void)
+{
+  TEST_ASSERT_EQUAL (rename ("/tmp/mfs-a", "/tmp/mfs-b"), 0);
+  struct stat st;
+  TEST_ASSERT_EQUAL (stat ("/tmp/mfs-a", &st), -1);
+  TEST_ASSERT_EQUAL (errno, ENOENT);
+  TEST_ASSERT_EQUAL (stat ("/tmp/mfs-b", &st), 0);
+  TEST_ASSERT_EQUAL (st.st_size, 12);
+  std::cout << "b: " << ReadAll ("/tmp/mfs-b") << std::endl;
+  List ("renamed");
+
+  // an open file stays readable once unlinked.
+  int fd = open ("/tmp/mfs-b", O_RDONLY);
+  TEST_ASSERT (fd >= 0);
+  TEST_ASSERT_EQUAL (unlink ("/tmp/mfs-b"), 0);
+  TEST_ASSERT_EQUAL (stat ("/tmp/mfs-b", &st), -1);
+  TEST_ASSERT_EQUAL (errno, ENOENT);
+  char buf[5];
+  TEST_ASSERT_EQUAL (read (fd, buf, 5), 5);
+  TEST_ASSERT_EQUAL (memcmp (buf, "hello", 5), 0);
+  TEST_ASSERT_EQUAL (close (fd), 0);
+  TEST_ASSERT_EQUAL (unlink ("/tmp/mfs-b"), -1);
+  TEST_ASSERT_EQUAL (errno, ENOENT);
+  TEST_ASSERT_EQUAL (open ("/tmp/mfs-b", O_RDONLY), -1);
+  TEST_ASSERT_EQUAL (errno, ENOENT);
+  List ("unlinked");
+}
+
+static void
+test_lower (void)
+{
+  std::cout << "lower: " << ReadAll ("/tmp/mfs-lower") << std::endl;
+  int fd = open ("/tmp/mfs-lower", O_WRONLY | O_APPEND);
+  TEST_ASSERT (fd >= 0);
+  TEST_ASSERT_EQUAL (write (fd, "+", 1), 1);
+  TEST_ASSERT_EQUAL (close (fd), 0);
+  std::cout << "lower appended: " << ReadAll ("/tmp/mfs-lower") << std::endl;
+
+  TEST_ASSERT_EQUAL (rename ("/tmp/mfs-lower", "/tmp/mfs-moved"), 0);
+  List ("lower renamed");
+  TEST_ASSERT_EQUAL (unlink ("/tmp/mfs-moved"), 0);
+  struct stat st;
+  TEST_ASSERT_EQUAL (stat ("/tmp/mfs-lower", &st), -1);
+  TEST_ASSERT_EQUAL (errno, ENOENT);
+  TEST_ASSERT_EQUAL (access ("/tmp/mfs-moved", F_OK), -1);
+  TEST_ASSERT_EQUAL (errno, ENOENT);
+  List ("lower unlinked");
+}
+
+int main (int argc, char *argv[])
+{
+  List ("start");
+  test_write_read ();
+  test_rename_unlink ();
+  test_lower ();
+
+  return 0;
+}
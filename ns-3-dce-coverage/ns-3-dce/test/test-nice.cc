@@ -0,0 +1,42 @@
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "test-macros.h"
+
+int main (int argc, char *argv[])
+{
+  errno = 0;
+  TEST_ASSERT_EQUAL (getpriority (PRIO_PROCESS, 0), 0);
+  TEST_ASSERT_EQUAL (errno, 0);
+
+  TEST_ASSERT_EQUAL (setpriority (PRIO_PROCESS, 0, 5), 0);
+  TEST_ASSERT_EQUAL (getpriority (PRIO_PROCESS, getpid ()), 5);
+  TEST_ASSERT_EQUAL (nice (2), 7);
+  // out of range values are clamped.
+  TEST_ASSERT_EQUAL (nice (100), 19);
+  TEST_ASSERT_EQUAL (setpriority (PRIO_PROCESS, 0, -30), 0);
+  TEST_ASSERT_EQUAL (getpriority (PRIO_PROCESS, 0), -20);
+
+  // only processes are supported.
+  TEST_ASSERT_EQUAL (setpriority (PRIO_PGRP, 0, 0), -1);
+  TEST_ASSERT_EQUAL (errno, EINVAL);
+  TEST_ASSERT_EQUAL (getpriority (PRIO_USER, 0), -1);
+  TEST_ASSERT_EQUAL (errno, EINVAL);
+
+  // children inherit the nice value of their parent.
+  TEST_ASSERT_EQUAL (setpriority (PRIO_PROCESS, 0, 3), 0);
+  pid_t pid = fork ();
+  if (pid == 0)
+    {
+      exit (getpriority (PRIO_PROCESS, 0));
+    }
+  int status;
+  TEST_ASSERT_EQUAL (waitpid (pid, &status, 0), pid);
+  TEST_ASSERT_EQUAL (WEXITSTATUS (status), 3);
+
+  exit (0);
+  // never reached.
+  return -1;
+}
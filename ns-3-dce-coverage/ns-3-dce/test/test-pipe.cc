@@ -8,6 +8,7 @@
 #include <pthread.h>
 #include <signal.h>
 #include <sys/select.h>
+#include <string.h>
 
 #define MAXLINE 4096
 
@@ -386,6 +387,55 @@ test6 ()
     }
 }
 
+// splice between two pipes
+void
+test7 ()
+{
+  int a[2], b[2];
+  char buf[MAXLINE];
+  int n;
+
+  if ((pipe (a) < 0) || (pipe (b) < 0))
+    {
+      err_sys ((char*)"pipe error");
+    }
+  memset (buf, 'x', sizeof (buf));
+  buf[0] = 'a';
+  buf[MAXLINE - 1] = 'z';
+  n = write (a[1], buf, MAXLINE);
+  TEST_ASSERT_EQUAL (n, MAXLINE);
+  n = write (a[1], "end", 3);
+  TEST_ASSERT_EQUAL (n, 3);
+
+  n = splice (a[0], 0, b[1], 0, MAXLINE + 1, 0);
+  TEST_ASSERT_EQUAL (n, MAXLINE + 1);
+  memset (buf, 0, sizeof (buf));
+  n = read (b[0], buf, MAXLINE + 1);
+  TEST_ASSERT_EQUAL (n, MAXLINE + 1);
+  TEST_ASSERT_EQUAL (buf[0], 'a');
+  TEST_ASSERT_EQUAL (buf[MAXLINE - 1], 'z');
+  TEST_ASSERT_EQUAL (buf[MAXLINE], 'e');
+  n = read (a[0], buf, 2);
+  TEST_ASSERT_EQUAL (n, 2);
+  TEST_ASSERT (buf[0] == 'n' && buf[1] == 'd');
+
+  // Nothing left to move.
+  n = splice (a[0], 0, b[1], 0, 10, SPLICE_F_NONBLOCK);
+  TEST_ASSERT_EQUAL (n, -1);
+  TEST_ASSERT_EQUAL (errno, EAGAIN);
+  n = splice (a[0], 0, a[1], 0, 10, 0);
+  TEST_ASSERT_EQUAL (n, -1);
+  TEST_ASSERT_EQUAL (errno, EINVAL);
+
+  // End of file once the writer is gone.
+  close (a[1]);
+  n = splice (a[0], 0, b[1], 0, 10, 0);
+  TEST_ASSERT_EQUAL (n, 0);
+
+  close (a[0]);
+  close (b[0]);
+  close (b[1]);
+}
 
 int
 main (int c, char **v)
@@ -396,6 +446,7 @@ main (int c, char **v)
   test4 ();
   test5 ();
   test6 ();
+  test7 ();
 
   return 0;
 }
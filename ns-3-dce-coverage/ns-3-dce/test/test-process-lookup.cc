@@ -0,0 +1,120 @@
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include "test-macros.h"
+
+#define N_PROCESSES 32
+#define N_THREADS 64
+#define ITERATIONS 100000
+
+static long
+cpu_usec (void)
+{
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+         + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static void *
+sleeper (void *arg)
+{
+  sleep (1000);
+  return 0;
+}
+
+static void *
+worker (void *arg)
+{
+  return arg;
+}
+
+// A stale handle must not designate the thread which got its tid.
+static void
+test_stale_handle (void)
+{
+  pthread_t old, young;
+  TEST_ASSERT_EQUAL (pthread_create (&old, 0, &worker, 0), 0);
+  TEST_ASSERT_EQUAL (pthread_join (old, 0), 0);
+  TEST_ASSERT_EQUAL (pthread_create (&young, 0, &sleeper, 0), 0);
+  TEST_ASSERT_EQUAL (pthread_kill (young, 0), 0);
+  TEST_ASSERT_EQUAL (pthread_kill (old, 0), ESRCH);
+  TEST_ASSERT_EQUAL (pthread_join (old, 0), ESRCH);
+  TEST_ASSERT_EQUAL (pthread_detach (young), 0);
+}
+
+// Every libc call looks up the current thread, some also look up a pid
+// or a tid: their cost should not grow with the number of processes and
+// threads.
+static void
+test_lookup_cost (void)
+{
+  pid_t children[N_PROCESSES];
+  pthread_t threads[N_THREADS];
+  for (int i = 0; i < N_PROCESSES; i++)
+    {
+      children[i] = fork ();
+      if (children[i] == 0)
+        {
+          sleep (1000);
+          exit (0);
+        }
+    }
+  for (int i = 0; i < N_THREADS; i++)
+    {
+      TEST_ASSERT_EQUAL (pthread_create (&threads[i], 0, &sleeper, 0), 0);
+    }
+
+  long start = cpu_usec ();
+  pid_t self = 0;
+  for (int i = 0; i < ITERATIONS; i++)
+    {
+      self += getpid () - getpid ();
+    }
+  long current = cpu_usec () - start;
+  TEST_ASSERT_EQUAL (self, 0);
+
+  start = cpu_usec ();
+  for (int i = 0; i < ITERATIONS; i++)
+    {
+      TEST_ASSERT_EQUAL (kill (children[i % N_PROCESSES], 0), 0);
+    }
+  long pid = cpu_usec () - start;
+
+  start = cpu_usec ();
+  for (int i = 0; i < ITERATIONS; i++)
+    {
+      TEST_ASSERT_EQUAL (pthread_kill (threads[i % N_THREADS], 0), 0);
+    }
+  long tid = cpu_usec () - start;
+
+  printf ("%d processes, %d threads, ns per call: getpid %ld, kill %ld, pthread_kill %ld\n",
+          N_PROCESSES, N_THREADS, current * 1000 / (2 * ITERATIONS),
+          pid * 1000 / ITERATIONS, tid * 1000 / ITERATIONS);
+
+  TEST_ASSERT_EQUAL (kill (32767, 0), -1);
+  TEST_ASSERT_EQUAL (errno, ESRCH);
+  for (int i = 0; i < N_PROCESSES; i++)
+    {
+      int status;
+      TEST_ASSERT_EQUAL (kill (children[i], SIGKILL), 0);
+      TEST_ASSERT_EQUAL (waitpid (children[i], &status, 0), children[i]);
+    }
+}
+
+int main (int argc, char *argv[])
+{
+  test_stale_handle ();
+  test_lookup_cost ();
+
+  exit (0);
+  // never reached.
+  return -1;
+}
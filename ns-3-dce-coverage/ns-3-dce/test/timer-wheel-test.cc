@@ -0,0 +1,242 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/log.h"
+#include "ns3/string.h"
+#include "ns3/object-factory.h"
+#include "ns3/task-manager.h"
+#include "ns3/process-delay-model.h"
+#include "ns3/timer-wheel.h"
+#include <algorithm>
+#include <stdlib.h>
+
+NS_LOG_COMPONENT_DEFINE ("TimerWheelTest");
+
+using namespace ns3;
+namespace ns3 {
+
+/**
+ * Timers scheduled, re-armed and cancelled at random, from a few
+ * nanoseconds to hours ahead, expire in the order of their deadline then
+ * of their scheduling.
+ */
+class TimerWheelOrderTestCase : public TestCase
+{
+public:
+  TimerWheelOrderTestCase ();
+private:
+  struct Entry
+  {
+    TimerWheel::Timer timer;
+    uint32_t index;
+    int64_t deadline;
+    uint64_t sequence;
+  };
+  typedef std::pair<std::pair<int64_t, uint64_t>, uint32_t> Key;
+  virtual void DoRun (void);
+  void Expired (struct Entry *entry);
+  int64_t m_now;
+  std::vector<uint32_t> m_expired;
+  bool m_early;
+};
+
+TimerWheelOrderTestCase::TimerWheelOrderTestCase ()
+  : TestCase ("Check that the timers of the timer wheel expire in order")
+{
+}
+void
+TimerWheelOrderTestCase::Expired (struct Entry *entry)
+{
+  m_early |= entry->deadline > m_now;
+  m_expired.push_back (entry->index);
+}
+void
+TimerWheelOrderTestCase::DoRun (void)
+{
+  const uint32_t nTimers = 256;
+  srandom (1);
+  int64_t resolutions[] = { 1, 1000, 1000000, 4000000 };
+  for (uint32_t r = 0; r < sizeof (resolutions) / sizeof (resolutions[0]); r++)
+    {
+      TimerWheel wheel (resolutions[r]);
+      std::vector<struct Entry *> entries;
+      for (uint32_t i = 0; i < nTimers; i++)
+        {
+          struct Entry *entry = new Entry ();
+          entry->index = i;
+          entry->timer.SetFunction (MakeCallback (&TimerWheelOrderTestCase::Expired, this).Bind (entry));
+          entries.push_back (entry);
+        }
+      uint64_t sequence = 0;
+      m_now = 0;
+      m_early = false;
+      for (uint32_t step = 0; step < 20000; step++)
+        {
+          struct Entry *entry = entries[random () % nTimers];
+          uint32_t op = random () % 10;
+          if (op < 5)
+            {
+              int64_t delay;
+              switch (random () % 3)
+                {
+                case 0:
+                  delay = random () % 10000000; // 10ms
+                  break;
+                case 1:
+                  delay = (random () % 1000) * resolutions[r];
+                  break;
+                default:
+                  delay = (int64_t)(random () % 100000) * 100000000; // up to 3 hours
+                  break;
+                }
+              entry->deadline = m_now + delay;
+              entry->sequence = sequence++;
+              wheel.Schedule (&entry->timer, entry->deadline);
+              continue;
+            }
+          if (op < 7)
+            {
+              entry->timer.Cancel ();
+              continue;
+            }
+          std::vector<Key> due;
+          int64_t next = -1;
+          for (uint32_t i = 0; i < nTimers; i++)
+            {
+              if (entries[i]->timer.IsPending ())
+                {
+                  next = next < 0 ? entries[i]->deadline : std::min (next, entries[i]->deadline);
+                }
+            }
+          NS_TEST_ASSERT_MSG_EQ (wheel.GetNextDeadline (), next, "wrong next deadline");
+          if (next < 0)
+            {
+              continue;
+            }
+          m_now = next + (random () % 2) * (random () % 50000000);
+          for (uint32_t i = 0; i < nTimers; i++)
+            {
+              if (entries[i]->timer.IsPending () && entries[i]->deadline <= m_now)
+                {
+                  due.push_back (Key (std::make_pair (entries[i]->deadline, entries[i]->sequence), i));
+                }
+            }
+          std::sort (due.begin (), due.end ());
+          m_expired.clear ();
+          wheel.Expire (m_now);
+          NS_TEST_ASSERT_MSG_EQ (m_expired.size (), due.size (), "wrong number of expired timers");
+          for (uint32_t i = 0; i < due.size (); i++)
+            {
+              NS_TEST_ASSERT_MSG_EQ (m_expired[i], due[i].second, "timers expired out of order");
+            }
+        }
+      NS_TEST_ASSERT_MSG_EQ (m_early, false, "a timer expired before its deadline");
+      for (uint32_t i = 0; i < nTimers; i++)
+        {
+          delete entries[i];
+        }
+      NS_TEST_ASSERT_MSG_EQ (wheel.GetSize (), 0, "deleted timers still pending");
+    }
+}
+
+/**
+ * Tasks which sleep periodically, with periods which are not multiples
+ * of the resolution of the timer wheel, wake up at their exact deadline.
+ */
+class TimerWheelSleepTestCase : public TestCase
+{
+public:
+  TimerWheelSleepTestCase ();
+private:
+  struct SleepContext
+  {
+    Time period;
+    uint32_t wakeups;
+    uint32_t late;
+  };
+  virtual void DoRun (void);
+  static void Sleeper (void *context);
+  static void StartTasks (std::vector<struct SleepContext> *sleepers);
+};
+
+TimerWheelSleepTestCase::TimerWheelSleepTestCase ()
+  : TestCase ("Check that sleeping tasks wake up at their deadline")
+{
+}
+void
+TimerWheelSleepTestCase::Sleeper (void *context)
+{
+  struct SleepContext *ctx = (struct SleepContext *)context;
+  TaskManager *manager = TaskManager::Current ();
+  while (Simulator::Now () < Seconds (1))
+    {
+      Time expected = Simulator::Now () + ctx->period;
+      manager->Sleep (ctx->period);
+      ctx->wakeups++;
+      if (Simulator::Now () != expected)
+        {
+          ctx->late++;
+        }
+    }
+  manager->Exit ();
+}
+void
+TimerWheelSleepTestCase::StartTasks (std::vector<struct SleepContext> *sleepers)
+{
+  TaskManager *manager = TaskManager::Current ();
+  for (std::vector<struct SleepContext>::iterator i = sleepers->begin (); i != sleepers->end (); ++i)
+    {
+      manager->Start (&TimerWheelSleepTestCase::Sleeper, &*i, 1 << 16);
+    }
+}
+void
+TimerWheelSleepTestCase::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<RandomProcessDelayModel> delay = CreateObject<RandomProcessDelayModel> ();
+  delay->SetAttribute ("Variable", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
+  Ptr<TaskManager> taskManager = CreateObject<TaskManager> ();
+  ObjectFactory factory;
+  factory.SetTypeId ("ns3::RrTaskScheduler");
+  taskManager->SetScheduler (factory.Create<TaskScheduler> ());
+  taskManager->SetDelayModel (delay);
+  node->AggregateObject (taskManager);
+
+  std::vector<struct SleepContext> sleepers;
+  for (uint32_t i = 0; i < 32; i++)
+    {
+      struct SleepContext ctx;
+      ctx.period = MicroSeconds (250 + 337 * i);
+      ctx.wakeups = 0;
+      ctx.late = 0;
+      sleepers.push_back (ctx);
+    }
+  Simulator::ScheduleWithContext (node->GetId (), Seconds (0),
+                                  &TimerWheelSleepTestCase::StartTasks, &sleepers);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  for (uint32_t i = 0; i < sleepers.size (); i++)
+    {
+      uint32_t expected = (Seconds (1).GetNanoSeconds () + sleepers[i].period.GetNanoSeconds () - 1)
+        / sleepers[i].period.GetNanoSeconds ();
+      NS_TEST_ASSERT_MSG_EQ (sleepers[i].wakeups, expected, "wrong number of wakeups");
+      NS_TEST_ASSERT_MSG_EQ (sleepers[i].late, 0, "woke up away from the deadline");
+    }
+}
+
+static class TimerWheelTestSuite : public TestSuite
+{
+public:
+  TimerWheelTestSuite ();
+} g_timerWheelTests;
+
+TimerWheelTestSuite::TimerWheelTestSuite ()
+  : TestSuite ("dce-timer-wheel", UNIT)
+{
+  AddTestCase (new TimerWheelOrderTestCase (), TestCase::QUICK);
+  AddTestCase (new TimerWheelSleepTestCase (), TestCase::QUICK);
+}
+
+} // namespace ns3
@@ -23,6 +23,7 @@
 #include "integer.h"
 #include "config.h"
 #include "log.h"
+#include "thread-safety.h"
 
 /**
  * \file
@@ -40,6 +41,12 @@ NS_LOG_COMPONENT_DEFINE ("RngSeedManager");
  * for automatic assignment.
  */
 static uint64_t g_nextStreamIndex = 0;
+/**
+ * \relates RngSeedManager
+ * The counter of the automatic stream numbers of the calling thread, if
+ * it has one.
+ */
+static __thread uint64_t *g_threadStreamIndex = 0;
 /**
  * \relates RngSeedManager
  * The random number generator seed number global value.
@@ -94,9 +101,17 @@ uint64_t RngSeedManager::GetRun ()
 uint64_t RngSeedManager::GetNextStreamIndex (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  uint64_t next = g_nextStreamIndex;
-  g_nextStreamIndex++;
-  return next;
+  if (g_threadStreamIndex != 0)
+    {
+      return (*g_threadStreamIndex)++;
+    }
+  return ThreadSafety::FetchAndIncrement (&g_nextStreamIndex);
+}
+
+void RngSeedManager::SetThreadStreamIndex (uint64_t *next)
+{
+  NS_LOG_FUNCTION (next);
+  g_threadStreamIndex = next;
 }
 
 } // namespace ns3
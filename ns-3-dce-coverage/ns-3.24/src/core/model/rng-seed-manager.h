@@ -105,6 +105,21 @@ public:
    */
   static uint64_t GetNextStreamIndex(void);
 
+  /**
+   * Number the automatic streams of the calling thread with a counter
+   * of its own.
+   *
+   * A simulator which runs the events of several partitions on their
+   * own threads gives each partition a counter, starting far from the
+   * others (at the partition number times 2^48, say): the streams of
+   * the objects created by the events of a partition then do not
+   * depend on the order in which the threads run.
+   *
+   * \param [in] next The counter, or zero for the counter shared by
+   *             all the threads.
+   */
+  static void SetThreadStreamIndex (uint64_t *next);
+
 };
 
 /** Alias for compatibility. */
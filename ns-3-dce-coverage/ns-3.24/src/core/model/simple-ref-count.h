@@ -25,6 +25,7 @@
 #include "empty.h"
 #include "default-deleter.h"
 #include "assert.h"
+#include "thread-safety.h"
 #include <stdint.h>
 #include <limits>
 
@@ -100,7 +101,7 @@ public:
   inline void Ref (void) const
   {
     NS_ASSERT (m_count < std::numeric_limits<uint32_t>::max());
-    m_count++;
+    ThreadSafety::Increment (&m_count);
   }
   /**
    * Decrement the reference count. This method should not be called
@@ -110,8 +111,7 @@ public:
    */
   inline void Unref (void) const
   {
-    m_count--;
-    if (m_count == 0)
+    if (ThreadSafety::Decrement (&m_count) == 0)
       {
         DELETER::Delete (static_cast<T*> (const_cast<SimpleRefCount *> (this)));
       }
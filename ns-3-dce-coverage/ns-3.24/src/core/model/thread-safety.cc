@@ -0,0 +1,41 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "thread-safety.h"
+#include "log.h"
+
+/**
+ * \file
+ * \ingroup thread
+ * ns3::ThreadSafety implementation.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ThreadSafety");
+
+bool ThreadSafety::m_enabled = false;
+
+void
+ThreadSafety::Enable (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_enabled = true;
+  // the threads started after this point see the flag.
+  __sync_synchronize ();
+}
+
+} // namespace ns3
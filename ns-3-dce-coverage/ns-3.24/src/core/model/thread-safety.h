@@ -0,0 +1,160 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef THREAD_SAFETY_H
+#define THREAD_SAFETY_H
+
+#include <stdint.h>
+
+/**
+ * \file
+ * \ingroup thread
+ * ns3::ThreadSafety declaration.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup thread
+ * \brief Switch of the reference counts shared by simulation threads.
+ *
+ * A simulation runs its events on a single thread so, the reference
+ * counts of ns3::SimpleRefCount and of the packet buffers, tags and
+ * metadata, and the free lists which recycle them, are not protected.
+ * A simulator implementation which runs the events of different nodes
+ * on several threads at once calls Enable before it starts its threads:
+ * from then on, these counts, and the sizes which the packets share to
+ * size their buffers, are updated with atomic instructions and the free
+ * lists are bypassed.
+ *
+ * Single threaded simulations only pay for a test of IsEnabled.
+ */
+class ThreadSafety
+{
+public:
+  /**
+   * Protect the shared counts until the end of the program.
+   * Must be called while a single thread runs the simulation.
+   */
+  static void Enable (void);
+  /**
+   * \returns true if the shared counts must be updated atomically.
+   */
+  static inline bool IsEnabled (void)
+  {
+    return m_enabled;
+  }
+  /**
+   * Increment a shared count.
+   * \param [in] count The count.
+   */
+  static inline void Increment (uint32_t *count)
+  {
+    if (m_enabled)
+      {
+        __sync_fetch_and_add (count, 1);
+      }
+    else
+      {
+        (*count)++;
+      }
+  }
+  /**
+   * Decrement a shared count.
+   * \param [in] count The count.
+   * \returns The count after the decrement: the caller which gets zero
+   *          is the last user of the counted object.
+   */
+  static inline uint32_t Decrement (uint32_t *count)
+  {
+    if (m_enabled)
+      {
+        return __sync_sub_and_fetch (count, 1);
+      }
+    return --(*count);
+  }
+  /**
+   * Increment a counter and return its previous value.
+   * \param [in] counter The counter.
+   * \returns The value of the counter before the increment.
+   */
+  static inline uint32_t FetchAndIncrement (uint32_t *counter)
+  {
+    if (m_enabled)
+      {
+        return __sync_fetch_and_add (counter, 1);
+      }
+    return (*counter)++;
+  }
+  /**
+   * Increment a 64 bit counter and return its previous value.
+   * \param [in] counter The counter.
+   * \returns The value of the counter before the increment.
+   */
+  static inline uint64_t FetchAndIncrement (uint64_t *counter)
+  {
+    if (m_enabled)
+      {
+        return __sync_fetch_and_add (counter, 1);
+      }
+    return (*counter)++;
+  }
+  /**
+   * Read a shared value which other threads may change.
+   * \param [in] value The value.
+   * \returns The value.
+   */
+  static inline uint32_t Load (uint32_t const *value)
+  {
+    if (m_enabled)
+      {
+        return __atomic_load_n (value, __ATOMIC_RELAXED);
+      }
+    return *value;
+  }
+  /**
+   * Raise a shared maximum.
+   * \param [in] maximum The maximum.
+   * \param [in] value The value which the maximum must not be below.
+   */
+  static inline void Maximize (uint32_t *maximum, uint32_t value)
+  {
+    if (m_enabled)
+      {
+        uint32_t current = __atomic_load_n (maximum, __ATOMIC_RELAXED);
+        while (current < value)
+          {
+            uint32_t seen = __sync_val_compare_and_swap (maximum, current, value);
+            if (seen == current)
+              {
+                break;
+              }
+            current = seen;
+          }
+      }
+    else if (*maximum < value)
+      {
+        *maximum = value;
+      }
+  }
+
+private:
+  /** Whether Enable was called. */
+  static bool m_enabled;
+};
+
+} // namespace ns3
+
+#endif /* THREAD_SAFETY_H */
@@ -17,8 +17,11 @@
  */
 
 #include <stdint.h>
+#include <algorithm>
+#include <cstdio>
 #include <string>
 #include <fstream>
+#include <locale>
 
 #include "ns3/abort.h"
 #include "ns3/assert.h"
@@ -177,6 +180,206 @@ PcapHelper::SinkWithHeader (Ptr<PcapFileWrapper> file, const Header &header, Ptr
   file->Write (Simulator::Now (), header, p);
 }
 
+namespace {
+
+/// Print a summary of the headers, see AsciiTraceHelper::SetHeaderSummary
+bool g_headerSummary = false;
+
+/**
+ * Write the current time in seconds as std::ostream writes a double in its
+ * default format, the printf "%g" format: six significant digits, without
+ * the trailing zeros.
+ *
+ * The digits are those of the time in nanoseconds, rounded as integers.
+ * The exponent notation (below 0.0001 or from 1e+06 seconds), another
+ * time resolution and the ties, where printf rounds the binary value of
+ * the double, are left to printf.
+ *
+ * \param p Where to write, with room for 32 characters.
+ * \returns The end of the characters written.
+ */
+char *
+FormatNow (char *p)
+{
+  Time now = Simulator::Now ();
+  if (Time::GetResolution () != Time::NS || !now.IsStrictlyPositive ())
+    {
+      return p + std::sprintf (p, "%g", now.GetSeconds ());
+    }
+
+  char digits[20];
+  uint64_t ns = now.GetNanoSeconds ();
+  int n = 0;
+  do
+    {
+      digits[n++] = '0' + ns % 10;
+      ns /= 10;
+    }
+  while (ns != 0);
+  for (int i = 0; i < n / 2; i++)
+    {
+      std::swap (digits[i], digits[n - 1 - i]);
+    }
+  int exponent = n - 1 - 9;
+  if (n > 6)
+    {
+      bool up = digits[6] > '5';
+      if (digits[6] == '5')
+        {
+          int i = 7;
+          while (i < n && digits[i] == '0')
+            {
+              i++;
+            }
+          if (i == n)
+            {
+              return p + std::sprintf (p, "%g", now.GetSeconds ());
+            }
+          up = true;
+        }
+      n = 6;
+      if (up)
+        {
+          int i = 5;
+          while (i >= 0 && digits[i] == '9')
+            {
+              digits[i--] = '0';
+            }
+          if (i < 0)
+            {
+              digits[0] = '1';
+              exponent++;
+            }
+          else
+            {
+              digits[i]++;
+            }
+        }
+    }
+  if (exponent < -4 || exponent >= 6)
+    {
+      return p + std::sprintf (p, "%g", now.GetSeconds ());
+    }
+  while (n > 1 && digits[n - 1] == '0')
+    {
+      n--;
+    }
+
+  if (exponent < 0)
+    {
+      *p++ = '0';
+      *p++ = '.';
+      for (int i = -1; i > exponent; i--)
+        {
+          *p++ = '0';
+        }
+      for (int i = 0; i < n; i++)
+        {
+          *p++ = digits[i];
+        }
+      return p;
+    }
+  for (int i = 0; i <= exponent; i++)
+    {
+      *p++ = i < n ? digits[i] : '0';
+    }
+  if (n > exponent + 1)
+    {
+      *p++ = '.';
+      for (int i = exponent + 1; i < n; i++)
+        {
+          *p++ = digits[i];
+        }
+    }
+  return p;
+}
+
+/**
+ * Print the names and sizes of the headers, trailers and payload of a
+ * packet, in the format of Packet::Print.
+ *
+ * \param os The stream.
+ * \param p The packet.
+ */
+void
+PrintHeaderSummary (std::ostream &os, Ptr<const Packet> p)
+{
+  PacketMetadata::ItemIterator i = p->BeginItem ();
+  while (i.HasNext ())
+    {
+      PacketMetadata::Item item = i.Next ();
+      if (item.type == PacketMetadata::Item::PAYLOAD)
+        {
+          os << "Payload";
+        }
+      else
+        {
+          os << item.tid.GetName ();
+        }
+      if (item.isFragment)
+        {
+          os << " Fragment [" << item.currentTrimedFromStart << ":"
+             << (item.currentTrimedFromStart + item.currentSize) << "]";
+        }
+      else
+        {
+          os << " (size=" << item.currentSize << ")";
+        }
+      if (i.HasNext ())
+        {
+          os << " ";
+        }
+    }
+}
+
+/**
+ * Write a line of the default trace sinks:
+ * "<operation> <time> [<context> ]<packet>".
+ *
+ * \param stream The stream.
+ * \param operation The character of the operation.
+ * \param context The context, or zero.
+ * \param p The packet.
+ */
+void
+WriteLine (Ptr<OutputStreamWrapper> stream, char operation, std::string const *context, Ptr<const Packet> p)
+{
+  std::ostream &os = *stream->GetStream ();
+  char line[40];
+  line[0] = operation;
+  line[1] = ' ';
+  std::ios::fmtflags const format = std::ios::floatfield | std::ios::showpoint
+    | std::ios::showpos | std::ios::uppercase;
+  if (os.precision () == 6 && (os.flags () & format) == 0 && os.width () == 0
+      && os.getloc () == std::locale::classic ())
+    {
+      char *end = FormatNow (line + 2);
+      *end++ = ' ';
+      os.write (line, end - line);
+    }
+  else
+    {
+      os.write (line, 2);
+      os << Simulator::Now ().GetSeconds () << ' ';
+    }
+  if (context != 0)
+    {
+      os.write (context->data (), context->size ());
+      os.put (' ');
+    }
+  if (g_headerSummary)
+    {
+      PrintHeaderSummary (os, p);
+    }
+  else
+    {
+      p->Print (os);
+    }
+  os.put ('\n');
+}
+
+} // anonymous namespace
+
 AsciiTraceHelper::AsciiTraceHelper ()
 {
   NS_LOG_FUNCTION_NOARGS ();
@@ -208,6 +411,13 @@ AsciiTraceHelper::CreateFileStream (std::string filename, std::ios::openmode fil
   return StreamWrapper;
 }
 
+void
+AsciiTraceHelper::SetHeaderSummary (bool summary)
+{
+  NS_LOG_FUNCTION (summary);
+  g_headerSummary = summary;
+}
+
 std::string
 AsciiTraceHelper::GetFilenameFromDevice (std::string prefix, Ptr<NetDevice> device, bool useObjectNames)
 {
@@ -310,14 +520,14 @@ void
 AsciiTraceHelper::DefaultEnqueueSinkWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "+ " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+  WriteLine (stream, '+', 0, p);
 }
 
 void
 AsciiTraceHelper::DefaultEnqueueSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "+ " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+  WriteLine (stream, '+', &context, p);
 }
 
 //
@@ -336,14 +546,14 @@ void
 AsciiTraceHelper::DefaultDropSinkWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+  WriteLine (stream, 'd', 0, p);
 }
 
 void
 AsciiTraceHelper::DefaultDropSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+  WriteLine (stream, 'd', &context, p);
 }
 
 //
@@ -363,14 +573,14 @@ void
 AsciiTraceHelper::DefaultDequeueSinkWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "- " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+  WriteLine (stream, '-', 0, p);
 }
 
 void
 AsciiTraceHelper::DefaultDequeueSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "- " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+  WriteLine (stream, '-', &context, p);
 }
 
 //
@@ -387,14 +597,14 @@ void
 AsciiTraceHelper::DefaultReceiveSinkWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "r " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+  WriteLine (stream, 'r', 0, p);
 }
 
 void
 AsciiTraceHelper::DefaultReceiveSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "r " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+  WriteLine (stream, 'r', &context, p);
 }
 
 void 
@@ -33,6 +33,16 @@ namespace ns3 {
  *
  * Handling pcap files is a common operation for ns-3 devices.  It is useful to
  * provide a common base class for dealing with these ops.
+ *
+ * The files are ns3::PcapFileWrapper objects, so their attributes set how
+ * every file is written, for instance:
+ * \code
+ *   Config::SetDefault ("ns3::PcapFileWrapper::Format", EnumValue (PcapWriter::PCAPNG));
+ *   Config::SetDefault ("ns3::PcapFileWrapper::Asynchronous", BooleanValue (true));
+ *   Config::SetDefault ("ns3::PcapFileWrapper::MaxFileSize", UintegerValue (100000000));
+ * \endcode
+ * writes the pcapng files on threads of their own, in files of at most
+ * 100 MB.
  */
 
 class PcapHelper
@@ -150,6 +160,13 @@ PcapHelper::HookDefaultSink (Ptr<T> object, std::string tracename, Ptr<PcapFileW
  *
  * Handling ascii trace files is a common operation for ns-3 devices.  It is 
  * useful to provide a common base class for dealing with these ops.
+ *
+ * The default trace sinks end their lines with '\n' rather than
+ * std::endl, so that the files are written by blocks, and format the time
+ * themselves when the stream keeps its default format and locale.  The
+ * last lines of a trace are therefore lost if the program crashes other
+ * than on an ns-3 fatal error; see OutputStreamWrapper for how to flush
+ * every line.
  */
 
 class AsciiTraceHelper
@@ -216,6 +233,22 @@ public:
   Ptr<OutputStreamWrapper> CreateFileStream (std::string filename, 
                                              std::ios::openmode filemode = std::ios::out);
 
+  /**
+   * @brief Print a summary of the headers of the packets in the default
+   * trace sinks.
+   *
+   * The default trace sinks print the packets with Packet::Print, which
+   * deserializes and prints every header and trailer.  The summary only
+   * gives their names and sizes, as in
+   * "ns3::Ipv4Header (size=20) ns3::UdpHeader (size=8) Payload (size=512)",
+   * and does not deserialize them.  As Packet::Print, it needs
+   * Packet::EnablePrinting.
+   *
+   * @param summary true to print the summary, false to print the packets
+   * in full (the default)
+   */
+  static void SetHeaderSummary (bool summary);
+
   /**
    * @brief Hook a trace source to the default enqueue operation trace sink that
    * does not accept nor log a trace context.
@@ -20,6 +20,10 @@
 #include "buffer.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
+#include "ns3/thread-safety.h"
+#include "ns3/global-value.h"
+#include "ns3/uinteger.h"
+#include "ns3/system-mutex.h"
 
 #define LOG_INTERNAL_STATE(y)                                                                    \
   NS_LOG_LOGIC (y << "start="<<m_start<<", end="<<m_end<<", zero start="<<m_zeroAreaStart<<              \
@@ -50,17 +54,64 @@ namespace ns3 {
 NS_LOG_COMPONENT_DEFINE ("Buffer");
 
 
+static GlobalValue g_bufferPoolBytes ("BufferPoolBytes",
+                                      "The maximum number of bytes of free buffer data kept "
+                                      "by each size class of the buffer pools",
+                                      UintegerValue (2 << 20),
+                                      MakeUintegerChecker<uint32_t> ());
+
 uint32_t Buffer::g_recommendedStart = 0;
+struct Buffer::PoolStats Buffer::g_stats = { 0, 0, 0, 0, 0 };
+
+void
+Buffer::CountBytes (int64_t size)
+{
+  if (ThreadSafety::IsEnabled ())
+    {
+      uint64_t live = __sync_add_and_fetch (&g_stats.liveBytes, size);
+      uint64_t peak = g_stats.peakBytes;
+      while (live > peak && !__sync_bool_compare_and_swap (&g_stats.peakBytes, peak, live))
+        {
+          peak = g_stats.peakBytes;
+        }
+    }
+  else
+    {
+      g_stats.liveBytes += size;
+      g_stats.peakBytes = std::max (g_stats.peakBytes, g_stats.liveBytes);
+    }
+}
+
+void
+Buffer::CountBuffers (int32_t delta)
+{
+  if (ThreadSafety::IsEnabled ())
+    {
+      __sync_fetch_and_add (&g_stats.liveBuffers, delta);
+    }
+  else
+    {
+      g_stats.liveBuffers += delta;
+    }
+}
+
+struct Buffer::PoolStats
+Buffer::GetPoolStats (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  return g_stats;
+}
+
 #ifdef BUFFER_FREE_LIST
 /* The following macros are pretty evil but they are needed to allow us to
- * keep track of 3 possible states for the g_freeList variable:
+ * keep track of 3 possible states for the g_pools variable:
  *  - uninitialized means that no one has created a buffer yet
- *    so no one has created the associated free list (it is created
+ *    so no one has created the associated pools (they are created
  *    on-demand when the first buffer is created)
- *  - initialized means that the free list exists and is valid
+ *  - initialized means that the pools exist and are valid
  *  - destroyed means that the static destructors of this compilation unit
- *    have run so, the free list has been cleared from its content
- * The key is that in destroyed state, we are careful not re-create it
+ *    have run so, the pools have been cleared from their content
+ * The key is that in destroyed state, we are careful not re-create them
  * which is a typical weakness of lazy evaluation schemes which use 
  * '0' as a special value to indicate both un-initialized and destroyed.
  * Note that it is important to use '0' as the marker for un-initialized state
@@ -70,75 +121,165 @@ uint32_t Buffer::g_recommendedStart = 0;
  * constructor orderings.
  */
 #define MAGIC_DESTROYED (~(long) 0)
-#define IS_UNINITIALIZED(x) (x == (Buffer::FreeList*)0)
-#define IS_DESTROYED(x) (x == (Buffer::FreeList*)MAGIC_DESTROYED)
+#define IS_UNINITIALIZED(x) (x == (Buffer::Pool*)0)
+#define IS_DESTROYED(x) (x == (Buffer::Pool*)MAGIC_DESTROYED)
 #define IS_INITIALIZED(x) (!IS_UNINITIALIZED (x) && !IS_DESTROYED (x))
-#define DESTROYED ((Buffer::FreeList*)MAGIC_DESTROYED)
-#define UNINITIALIZED ((Buffer::FreeList*)0)
-uint32_t Buffer::g_maxSize = 0;
-Buffer::FreeList *Buffer::g_freeList = 0;
+#define DESTROYED ((Buffer::Pool*)MAGIC_DESTROYED)
+#define UNINITIALIZED ((Buffer::Pool*)0)
+
+struct Buffer::Pool
+{
+  FreeList freeList;  //!< the free data storages
+  uint32_t capacity;  //!< maximum length of freeList
+  SystemMutex mutex;  //!< protects freeList when ThreadSafety is enabled
+};
+
+const uint32_t Buffer::g_poolSizes[Buffer::N_POOLS] = { 64, 256, 1536, 9216, 65536 };
+Buffer::Pool *Buffer::g_pools = 0;
 struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
 
 Buffer::LocalStaticDestructor::~LocalStaticDestructor(void)
 {
   NS_LOG_FUNCTION (this);
-  if (IS_INITIALIZED (g_freeList))
+  if (IS_INITIALIZED (g_pools))
     {
-      for (Buffer::FreeList::iterator i = g_freeList->begin ();
-           i != g_freeList->end (); i++)
+      Buffer::Pool *pools = g_pools;
+      g_pools = DESTROYED;
+      for (uint32_t i = 0; i < N_POOLS; i++)
         {
-          Buffer::Deallocate (*i);
+          for (Buffer::FreeList::iterator j = pools[i].freeList.begin ();
+               j != pools[i].freeList.end (); j++)
+            {
+              Buffer::Deallocate (*j);
+            }
         }
-      delete g_freeList;
-      g_freeList = DESTROYED;
+      delete [] pools;
+      NS_LOG_INFO ("allocations=" << g_stats.allocations << ", hits=" << g_stats.hits <<
+                   ", peak bytes=" << g_stats.peakBytes);
     }
 }
 
+uint32_t
+Buffer::GetPoolIndex (uint32_t size)
+{
+  uint32_t i = 0;
+  while (i < N_POOLS && g_poolSizes[i] < size)
+    {
+      i++;
+    }
+  return i;
+}
+
+Buffer::Pool *
+Buffer::GetPools (void)
+{
+  if (IS_UNINITIALIZED (g_pools))
+    {
+      UintegerValue bytes;
+      g_bufferPoolBytes.GetValue (bytes);
+      Buffer::Pool *pools = new Buffer::Pool [N_POOLS];
+      for (uint32_t i = 0; i < N_POOLS; i++)
+        {
+          pools[i].capacity = bytes.Get () / g_poolSizes[i];
+        }
+      /* two threads may get there first: only one set of pools is kept. */
+      if (!__sync_bool_compare_and_swap (&g_pools, UNINITIALIZED, pools))
+        {
+          delete [] pools;
+        }
+    }
+  return IS_DESTROYED (g_pools) ? 0 : g_pools;
+}
+
 void
 Buffer::Recycle (struct Buffer::Data *data)
 {
   NS_LOG_FUNCTION (data);
   NS_ASSERT (data->m_count == 0);
-  NS_ASSERT (!IS_UNINITIALIZED (g_freeList));
-  g_maxSize = std::max (g_maxSize, data->m_size);
-  /* feed into free list */
-  if (data->m_size < g_maxSize ||
-      IS_DESTROYED (g_freeList) ||
-      g_freeList->size () > 1000)
-    {
-      Buffer::Deallocate (data);
-    }
-  else
+  CountBuffers (-1);
+  /* feed into the pool of its size class */
+  uint32_t index = GetPoolIndex (data->m_size);
+  if (index < N_POOLS && data->m_size == g_poolSizes[index] &&
+      IS_INITIALIZED (g_pools))
     {
-      NS_ASSERT (IS_INITIALIZED (g_freeList));
-      g_freeList->push_back (data);
+      Buffer::Pool *pool = &g_pools[index];
+      bool shared = ThreadSafety::IsEnabled ();
+      bool kept = false;
+      if (shared)
+        {
+          pool->mutex.Lock ();
+        }
+      if (pool->freeList.size () < pool->capacity)
+        {
+          pool->freeList.push_back (data);
+          kept = true;
+        }
+      if (shared)
+        {
+          pool->mutex.Unlock ();
+        }
+      if (kept)
+        {
+          return;
+        }
     }
+  Buffer::Deallocate (data);
 }
 
 Buffer::Data *
 Buffer::Create (uint32_t dataSize)
 {
   NS_LOG_FUNCTION (dataSize);
-  /* try to find a buffer correctly sized. */
-  if (IS_UNINITIALIZED (g_freeList))
+  bool shared = ThreadSafety::IsEnabled ();
+  CountBuffers (1);
+  if (shared)
+    {
+      __sync_fetch_and_add (&g_stats.allocations, 1);
+    }
+  else
+    {
+      g_stats.allocations++;
+    }
+  uint32_t index = GetPoolIndex (dataSize);
+  if (index == N_POOLS)
     {
-      g_freeList = new Buffer::FreeList ();
+      /* too large for the pools. */
+      return Buffer::Allocate (dataSize);
     }
-  else if (IS_INITIALIZED (g_freeList))
+  Buffer::Pool *pools = GetPools ();
+  if (pools != 0)
     {
-      while (!g_freeList->empty ()) 
+      Buffer::Pool *pool = &pools[index];
+      struct Buffer::Data *data = 0;
+      if (shared)
         {
-          struct Buffer::Data *data = g_freeList->back ();
-          g_freeList->pop_back ();
-          if (data->m_size >= dataSize) 
+          pool->mutex.Lock ();
+        }
+      if (!pool->freeList.empty ())
+        {
+          data = pool->freeList.back ();
+          pool->freeList.pop_back ();
+        }
+      if (shared)
+        {
+          pool->mutex.Unlock ();
+          if (data != 0)
             {
-              data->m_count = 1;
-              return data;
+              __sync_fetch_and_add (&g_stats.hits, 1);
             }
-          Buffer::Deallocate (data);
+        }
+      else if (data != 0)
+        {
+          g_stats.hits++;
+        }
+      if (data != 0)
+        {
+          data->m_count = 1;
+          return data;
         }
     }
-  struct Buffer::Data *data = Buffer::Allocate (dataSize);
+  /* the whole class size is usable by the buffer. */
+  struct Buffer::Data *data = Buffer::Allocate (g_poolSizes[index]);
   NS_ASSERT (data->m_count == 1);
   return data;
 }
@@ -148,6 +289,7 @@ Buffer::Recycle (struct Buffer::Data *data)
 {
   NS_LOG_FUNCTION (data);
   NS_ASSERT (data->m_count == 0);
+  CountBuffers (-1);
   Deallocate (data);
 }
 
@@ -155,6 +297,8 @@ Buffer::Data *
 Buffer::Create (uint32_t size)
 {
   NS_LOG_FUNCTION (size);
+  CountBuffers (1);
+  g_stats.allocations++;
   return Allocate (size);
 }
 #endif /* BUFFER_FREE_LIST */
@@ -173,6 +317,7 @@ Buffer::Allocate (uint32_t reqSize)
   struct Buffer::Data *data = reinterpret_cast<struct Buffer::Data*>(b);
   data->m_size = reqSize;
   data->m_count = 1;
+  CountBytes (reqSize);
   return data;
 }
 
@@ -181,6 +326,7 @@ Buffer::Deallocate (struct Buffer::Data *data)
 {
   NS_LOG_FUNCTION (data);
   NS_ASSERT (data->m_count == 0);
+  CountBytes (-(int64_t)data->m_size);
   uint8_t *buf = reinterpret_cast<uint8_t *> (data);
   delete [] buf;
 }
@@ -244,8 +390,9 @@ void
 Buffer::Initialize (uint32_t zeroSize)
 {
   NS_LOG_FUNCTION (this << zeroSize);
-  m_data = Buffer::Create (0);
-  m_start = std::min (m_data->m_size, g_recommendedStart);
+  uint32_t recommendedStart = ThreadSafety::Load (&g_recommendedStart);
+  m_data = Buffer::Create (recommendedStart);
+  m_start = std::min (m_data->m_size, recommendedStart);
   m_maxZeroAreaStart = m_start;
   m_zeroAreaStart = m_start;
   m_zeroAreaEnd = m_zeroAreaStart + zeroSize;
@@ -262,15 +409,14 @@ Buffer::operator = (Buffer const&o)
   if (m_data != o.m_data) 
     {
       // not assignment to self.
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (ThreadSafety::Decrement (&m_data->m_count) == 0)
         {
           Recycle (m_data);
         }
       m_data = o.m_data;
-      m_data->m_count++;
+      ThreadSafety::Increment (&m_data->m_count);
     }
-  g_recommendedStart = std::max (g_recommendedStart, m_maxZeroAreaStart);
+  ThreadSafety::Maximize (&g_recommendedStart, m_maxZeroAreaStart);
   m_maxZeroAreaStart = o.m_maxZeroAreaStart;
   m_zeroAreaStart = o.m_zeroAreaStart;
   m_zeroAreaEnd = o.m_zeroAreaEnd;
@@ -284,9 +430,8 @@ Buffer::~Buffer ()
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (CheckInternalState ());
-  g_recommendedStart = std::max (g_recommendedStart, m_maxZeroAreaStart);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  ThreadSafety::Maximize (&g_recommendedStart, m_maxZeroAreaStart);
+  if (ThreadSafety::Decrement (&m_data->m_count) == 0)
     {
       Recycle (m_data);
     }
@@ -310,7 +455,10 @@ Buffer::AddAtStart (uint32_t start)
 {
   NS_LOG_FUNCTION (this << start);
   NS_ASSERT (CheckInternalState ());
-  bool isDirty = m_data->m_count > 1 && m_start > m_data->m_dirtyStart;
+  // the threads which share the data cannot agree on its dirty area: a
+  // shared buffer is always copied.
+  bool isDirty = m_data->m_count > 1
+    && (ThreadSafety::IsEnabled () || m_start > m_data->m_dirtyStart);
   if (m_start >= start && !isDirty)
     {
       /* enough space in the buffer and not dirty. 
@@ -328,8 +476,7 @@ Buffer::AddAtStart (uint32_t start)
       uint32_t newSize = GetInternalSize () + start;
       struct Buffer::Data *newData = Buffer::Create (newSize);
       memcpy (newData->m_data + start, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0)
+      if (ThreadSafety::Decrement (&m_data->m_count) == 0)
         {
           Buffer::Recycle (m_data);
         }
@@ -355,7 +502,8 @@ Buffer::AddAtEnd (uint32_t end)
 {
   NS_LOG_FUNCTION (this << end);
   NS_ASSERT (CheckInternalState ());
-  bool isDirty = m_data->m_count > 1 && m_end < m_data->m_dirtyEnd;
+  bool isDirty = m_data->m_count > 1
+    && (ThreadSafety::IsEnabled () || m_end < m_data->m_dirtyEnd);
   if (GetInternalEnd () + end <= m_data->m_size && !isDirty)
     {
       /* enough space in buffer and not dirty
@@ -373,8 +521,7 @@ Buffer::AddAtEnd (uint32_t end)
       uint32_t newSize = GetInternalSize () + end;
       struct Buffer::Data *newData = Buffer::Create (newSize);
       memcpy (newData->m_data, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (ThreadSafety::Decrement (&m_data->m_count) == 0)
         {
           Buffer::Recycle (m_data);
         }
@@ -38,9 +38,15 @@ namespace ns3 {
  * automatically adjusted to hold any data prepended
  * or appended by the user. Its implementation is optimized
  * to ensure that the number of buffer resizes is minimized,
- * by creating new Buffers of the maximum size ever used.
- * The correct maximum size is learned at runtime during use by 
- * recording the maximum size of each packet.
+ * by creating new Buffers with room for the largest headers ever
+ * used. The correct size is learned at runtime during use by
+ * recording the headers added to each packet.
+ *
+ * The data storages are rounded up to size classes of 64, 256, 1536,
+ * 9216 and 65536 bytes, and the free storages of each class are kept
+ * in a pool for the next buffers. The "BufferPoolBytes" GlobalValue
+ * sets how many bytes each pool may keep, and GetPoolStats returns
+ * the counters of the pools.
  *
  * \internal
  * The implementation of the Buffer class uses a COW (Copy On Write)
@@ -636,6 +642,23 @@ private:
    */
   Buffer (uint32_t dataSize, bool initialize);
   ~Buffer ();
+
+  /**
+   * \brief Counters of the data storage of all the buffers.
+   */
+  struct PoolStats
+  {
+    uint64_t allocations; //!< number of data storages requested
+    uint64_t hits;        //!< number of requests served by a pool
+    uint32_t liveBuffers; //!< number of data storages in use
+    uint64_t liveBytes;   //!< bytes of the data storages in use or pooled
+    uint64_t peakBytes;   //!< highest value of liveBytes
+  };
+  /**
+   * \brief Get the counters of the buffer pools.
+   * \returns the counters since the start of the program
+   */
+  static struct PoolStats GetPoolStats (void);
 private:
   /**
    * This data structure is variable-sized through its last member whose size
@@ -784,16 +807,44 @@ private:
    */
   uint32_t m_end;
 
+  /**
+   * \brief Account for a data storage in the counters
+   * \param size the size of the storage, negative when it is freed
+   */
+  static void CountBytes (int64_t size);
+  /**
+   * \brief Account for a data storage given to or taken from a buffer
+   * \param delta one when it is given, minus one when it is taken
+   */
+  static void CountBuffers (int32_t delta);
+  static struct PoolStats g_stats; //!< counters of the data storages
+
 #ifdef BUFFER_FREE_LIST
   /// Container for buffer data
   typedef std::vector<struct Buffer::Data*> FreeList;
+  /// Free data storages of one size class
+  struct Pool;
   /// Local static destructor structure
   struct LocalStaticDestructor 
   {
     ~LocalStaticDestructor ();
   };
-  static uint32_t g_maxSize; //!< Max observed data size
-  static FreeList *g_freeList; //!< Buffer data container
+  /**
+   * \brief Find the size class of a data storage
+   * \param size the requested size
+   * \returns the index of the smallest class which holds size bytes,
+   *          or N_POOLS if size is larger than the largest class
+   */
+  static uint32_t GetPoolIndex (uint32_t size);
+  /// Number of size classes
+  static const uint32_t N_POOLS = 5;
+  static const uint32_t g_poolSizes[N_POOLS]; //!< Size of each class
+  /**
+   * \brief Create the pools on first use
+   * \returns the pools, or zero once they are destroyed
+   */
+  static Pool *GetPools (void);
+  static Pool *g_pools; //!< Buffer data containers, one per size class
   static struct LocalStaticDestructor g_localStaticDestructor; //!< Local static destructor
 #endif
 };
@@ -801,6 +852,7 @@ private:
 } // namespace ns3
 
 #include "ns3/assert.h"
+#include "ns3/thread-safety.h"
 #include <cstring>
 
 namespace ns3 {
@@ -1049,7 +1101,7 @@ Buffer::Buffer (Buffer const&o)
     m_start (o.m_start),
     m_end (o.m_end)
 {
-  m_data->m_count++;
+  ThreadSafety::Increment (&m_data->m_count);
   NS_ASSERT (CheckInternalState ());
 }
 
@@ -19,6 +19,7 @@
  */
 #include "byte-tag-list.h"
 #include "ns3/log.h"
+#include "ns3/thread-safety.h"
 #include <vector>
 #include <cstring>
 
@@ -30,6 +31,8 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("ByteTagList");
 
+static uint32_t g_heapAllocations = 0; //!< ByteTagListData taken from the heap
+
 /**
  * \ingroup packet
  *
@@ -156,7 +159,7 @@ ByteTagList::ByteTagList (const ByteTagList &o)
   NS_LOG_FUNCTION (this << &o);
   if (m_data != 0)
     {
-      m_data->count++;
+      ThreadSafety::Increment (&m_data->count);
     }
 }
 ByteTagList &
@@ -175,7 +178,7 @@ ByteTagList::operator = (const ByteTagList &o)
   m_used = o.m_used;
   if (m_data != 0)
     {
-      m_data->count++;
+      ThreadSafety::Increment (&m_data->count);
     }
   return *this;
 }
@@ -199,7 +202,8 @@ ByteTagList::Add (TypeId tid, uint32_t bufferSize, int32_t start, int32_t end)
       m_used = 0;
     } 
   else if (m_data->size < spaceNeeded ||
-           (m_data->count != 1 && m_data->dirty != m_used))
+           (m_data->count != 1
+            && (ThreadSafety::IsEnabled () || m_data->dirty != m_used)))
     {
       struct ByteTagListData *newData = Allocate (spaceNeeded);
       std::memcpy (&newData->data, &m_data->data, m_used);
@@ -344,7 +348,7 @@ struct ByteTagListData *
 ByteTagList::Allocate (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
-  while (!g_freeList.empty ())
+  while (!ThreadSafety::IsEnabled () && !g_freeList.empty ())
     {
       struct ByteTagListData *data = g_freeList.back ();
       g_freeList.pop_back ();
@@ -358,10 +362,13 @@ ByteTagList::Allocate (uint32_t size)
       uint8_t *buffer = (uint8_t *)data;
       delete [] buffer;
     }
-  uint8_t *buffer = new uint8_t [std::max (size, g_maxSize) + sizeof (struct ByteTagListData) - 4];
+  // the data records its whole size, so that it stays in the free list.
+  uint32_t allocated = std::max (size, ThreadSafety::Load (&g_maxSize));
+  uint8_t *buffer = new uint8_t [allocated + sizeof (struct ByteTagListData) - 4];
+  ThreadSafety::Increment (&g_heapAllocations);
   struct ByteTagListData *data = (struct ByteTagListData *)buffer;
   data->count = 1;
-  data->size = size;
+  data->size = allocated;
   data->dirty = 0;
   return data;
 }
@@ -374,11 +381,11 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
     {
       return;
     }
-  g_maxSize = std::max (g_maxSize, data->size);
-  data->count--;
-  if (data->count == 0)
+  ThreadSafety::Maximize (&g_maxSize, data->size);
+  if (ThreadSafety::Decrement (&data->count) == 0)
     {
-      if (g_freeList.size () > FREE_LIST_SIZE ||
+      if (ThreadSafety::IsEnabled () ||
+          g_freeList.size () > FREE_LIST_SIZE ||
           data->size < g_maxSize)
         {
           uint8_t *buffer = (uint8_t *)data;
@@ -398,6 +405,7 @@ ByteTagList::Allocate (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
   uint8_t *buffer = new uint8_t [size + sizeof (struct ByteTagListData) - 4];
+  ThreadSafety::Increment (&g_heapAllocations);
   struct ByteTagListData *data = (struct ByteTagListData *)buffer;
   data->count = 1;
   data->size = size;
@@ -413,8 +421,7 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
     {
       return;
     }
-  data->count--;
-  if (data->count == 0)
+  if (ThreadSafety::Decrement (&data->count) == 0)
     {
       uint8_t *buffer = (uint8_t *)data;
       delete [] buffer;
@@ -423,5 +430,10 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
 
 #endif /* USE_FREE_LIST */
 
+uint32_t
+ByteTagList::GetHeapAllocations (void)
+{
+  return g_heapAllocations;
+}
 
 } // namespace ns3
@@ -59,6 +59,10 @@ struct ByteTagListData;
  *     the boundaries before returning item. However, when packet is extending,
  *     it calls ByteTagList::AddAtStart or ByteTagList::AddAtEnd to cut byte
  *     tags that will otherwise cover new bytes.
+ *
+ *   - The ByteTagListData released are kept in a free list and reused.
+ *     They are all allocated with the size of the largest one seen so
+ *     far, so that any of them fits the next list.
  */
 class ByteTagList
 {
@@ -225,6 +229,12 @@ private:
    */
   void AddAtStart (int32_t prependOffset);
 
+  /**
+   * \returns the number of ByteTagListData allocated on the heap because
+   *          no free one was large enough, since the start of the program.
+   */
+  static uint32_t GetHeapAllocations (void);
+
 private:
   /**
    * \brief Returns an iterator pointing to the very first tag in this list.
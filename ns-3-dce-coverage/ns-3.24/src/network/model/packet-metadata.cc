@@ -22,6 +22,7 @@
 #include "ns3/assert.h"
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
+#include "ns3/thread-safety.h"
 #include "packet-metadata.h"
 #include "buffer.h"
 #include "header.h"
@@ -33,10 +34,12 @@ NS_LOG_COMPONENT_DEFINE ("PacketMetadata");
 
 bool PacketMetadata::m_enable = false;
 bool PacketMetadata::m_enableChecking = false;
+bool PacketMetadata::m_enableCompact = false;
 bool PacketMetadata::m_metadataSkipped = false;
 uint32_t PacketMetadata::m_maxSize = 0;
 uint16_t PacketMetadata::m_chunkUid = 0;
 PacketMetadata::DataFreeList PacketMetadata::m_freeList;
+PacketMetadata::DeltaFreeList PacketMetadata::m_deltaFreeList;
 
 PacketMetadata::DataFreeList::~DataFreeList ()
 {
@@ -48,6 +51,23 @@ PacketMetadata::DataFreeList::~DataFreeList ()
   PacketMetadata::m_enable = false;
 }
 
+PacketMetadata::DeltaFreeList::~DeltaFreeList ()
+{
+  NS_LOG_FUNCTION (this);
+  // the blocks go only if none of their operations is still used.
+  if (size () == m_blocks.size () * DELTA_BLOCK)
+    {
+      for (iterator i = m_blocks.begin (); i != m_blocks.end (); i++)
+        {
+          delete [] *i;
+        }
+    }
+  clear ();
+  m_blocks.clear ();
+  // the operations released from now on are not kept.
+  PacketMetadata::m_enable = false;
+}
+
 void 
 PacketMetadata::Enable (void)
 {
@@ -70,6 +90,191 @@ PacketMetadata::EnableChecking (void)
   m_enableChecking = true;
 }
 
+void 
+PacketMetadata::EnableCompact (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Enable ();
+  m_enableCompact = true;
+}
+
+void
+PacketMetadata::DisableCompact (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_enableCompact = false;
+}
+
+struct PacketMetadata::Delta *
+PacketMetadata::CreateDelta (void)
+{
+  struct Delta *delta;
+  if (ThreadSafety::IsEnabled ())
+    {
+      delta = new struct Delta;
+      delta->m_block = 0;
+    }
+  else
+    {
+      if (m_deltaFreeList.empty ())
+        {
+          struct Delta *block = new struct Delta [DELTA_BLOCK];
+          m_deltaFreeList.m_blocks.push_back (block);
+          for (uint32_t i = DELTA_BLOCK; i > 0; i--)
+            {
+              block[i - 1].m_block = 1;
+              m_deltaFreeList.push_back (&block[i - 1]);
+            }
+        }
+      delta = m_deltaFreeList.back ();
+      m_deltaFreeList.pop_back ();
+    }
+  delta->m_prev = 0;
+  delta->m_u.item.size = 0;
+  delta->m_u.item.typeUid = 0;
+  delta->m_u.item.chunkUid = 0;
+  delta->m_count = 1;
+  delta->m_total = 0;
+  delta->m_type = REMOVE_AT_START;
+  return delta;
+}
+
+void
+PacketMetadata::ReleaseDelta (struct Delta *delta)
+{
+  // the history of a packet may be long: no recursion along it.
+  while (delta != 0 && ThreadSafety::Decrement (&delta->m_count) == 0)
+    {
+      struct Delta *prev = delta->m_prev;
+      if (delta->m_type == ADD_AT_END || delta->m_type == SNAPSHOT)
+        {
+          delete delta->m_u.other;
+        }
+      if (!delta->m_block)
+        {
+          delete delta;
+        }
+      else if (m_enable && !ThreadSafety::IsEnabled ())
+        {
+          m_deltaFreeList.push_back (delta);
+        }
+      // else the operation stays in its block until the end.
+      delta = prev;
+    }
+}
+
+void
+PacketMetadata::AddDelta (uint8_t type, uint16_t typeUid, uint32_t size, PacketMetadata *other)
+{
+  NS_LOG_FUNCTION (this << (uint32_t)type << typeUid << size << other);
+  struct Delta *delta = CreateDelta ();
+  uint32_t total = GetItemBytes ();
+  switch (type)
+    {
+    case ADD_HEADER:
+    case ADD_TRAILER:
+      delta->m_u.item.chunkUid = m_chunkUid;
+      m_chunkUid++;
+    // fall through
+    case ADD_AT_END:
+      total += size;
+      break;
+    case SNAPSHOT:
+      total = size;
+      break;
+    default:
+      total -= std::min (total, size);
+      break;
+    }
+  delta->m_type = type;
+  if (other != 0)
+    {
+      delta->m_u.other = other;
+    }
+  else
+    {
+      delta->m_u.item.typeUid = typeUid;
+      delta->m_u.item.size = size;
+    }
+  delta->m_total = total;
+  // the new operation takes over our reference to the previous one.
+  delta->m_prev = m_delta;
+  m_delta = delta;
+}
+
+uint32_t
+PacketMetadata::GetItemBytes (void) const
+{
+  if (m_data != 0)
+    {
+      return GetTotalSize ();
+    }
+  return m_delta == 0 ? 0 : m_delta->m_total;
+}
+
+PacketMetadata
+PacketMetadata::Materialize (void) const
+{
+  NS_LOG_FUNCTION (this);
+  if (m_data != 0)
+    {
+      return *this;
+    }
+  std::vector<const struct Delta *> history;
+  const struct Delta *delta = m_delta;
+  while (delta != 0 && delta->m_type != SNAPSHOT)
+    {
+      history.push_back (delta);
+      delta = delta->m_prev;
+    }
+  PacketMetadata items (m_packetUid, CLASSIC);
+  if (delta != 0)
+    {
+      items = *delta->m_u.other;
+      items.m_packetUid = m_packetUid;
+    }
+  for (std::vector<const struct Delta *>::reverse_iterator i = history.rbegin ();
+       i != history.rend (); i++)
+    {
+      items.Replay (*i);
+    }
+  return items;
+}
+
+void
+PacketMetadata::Replay (const struct Delta *delta)
+{
+  const struct DeltaItem &item = delta->m_u.item;
+  uint32_t uid = item.typeUid << 1;
+  switch (delta->m_type)
+    {
+    case ADD_HEADER:
+      DoAddHeader (uid, item.size, item.chunkUid);
+      break;
+    case REMOVE_HEADER:
+      DoRemoveHeader (uid, item.size);
+      break;
+    case ADD_TRAILER:
+      DoAddTrailer (uid, item.size, item.chunkUid);
+      break;
+    case REMOVE_TRAILER:
+      DoRemoveTrailer (uid, item.size);
+      break;
+    case REMOVE_AT_START:
+      RemoveAtStart (item.size);
+      break;
+    case REMOVE_AT_END:
+      RemoveAtEnd (item.size);
+      break;
+    case ADD_AT_END:
+      AddAtEnd (delta->m_u.other->Materialize ());
+      break;
+    default:
+      NS_ASSERT (false);
+      break;
+    }
+}
+
 void
 PacketMetadata::ReserveCopy (uint32_t size)
 {
@@ -77,8 +282,7 @@ PacketMetadata::ReserveCopy (uint32_t size)
   struct PacketMetadata::Data *newData = PacketMetadata::Create (m_used + size);
   memcpy (newData->m_data, m_data->m_data, m_used);
   newData->m_dirtyEnd = m_used;
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (ThreadSafety::Decrement (&m_data->m_count) == 0)
     {
       PacketMetadata::Recycle (m_data);
     }
@@ -100,10 +304,11 @@ PacketMetadata::Reserve (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
   NS_ASSERT (m_data != 0);
+  // the threads which share the data cannot agree on its dirty area.
   if (m_data->m_size >= m_used + size &&
-      (m_head == 0xffff ||
-       m_data->m_count == 1 ||
-       m_data->m_dirtyEnd == m_used))
+      (m_data->m_count == 1 ||
+       (!ThreadSafety::IsEnabled () &&
+        (m_head == 0xffff || m_data->m_dirtyEnd == m_used))))
     {
       /* enough room, not dirty. */
     }
@@ -133,6 +338,11 @@ bool
 PacketMetadata::IsStateOk (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_data == 0)
+    {
+      // a compact history has no list of items.
+      return true;
+    }
   bool ok = m_used <= m_data->m_size;
   ok &= IsPointerOk (m_head);
   ok &= IsPointerOk (m_tail);
@@ -381,9 +591,9 @@ PacketMetadata::AddSmall (const struct PacketMetadata::SmallItem *item)
   uint32_t sizeSize = GetUleb128Size (item->size);
   uint32_t n =  2 + 2 + typeUidSize + sizeSize + 2;
   if (m_used + n > m_data->m_size ||
-      (m_head != 0xffff &&
-       m_data->m_count != 1 &&
-       m_used != m_data->m_dirtyEnd))
+      (m_data->m_count != 1 &&
+       (ThreadSafety::IsEnabled () ||
+        (m_head != 0xffff && m_used != m_data->m_dirtyEnd))))
     {
       ReserveCopy (n);
     }
@@ -419,9 +629,9 @@ PacketMetadata::AddBig (uint32_t next, uint32_t prev,
   uint32_t n = 2 + 2 + typeUidSize + sizeSize + 2 + fragStartSize + fragEndSize + 4;
 
   if (m_used + n > m_data->m_size ||
-      (m_head != 0xffff &&
-       m_data->m_count != 1 &&
-       m_used != m_data->m_dirtyEnd))
+      (m_data->m_count != 1 &&
+       (ThreadSafety::IsEnabled () ||
+        (m_head != 0xffff && m_used != m_data->m_dirtyEnd))))
     {
       ReserveCopy (n);
     }
@@ -505,7 +715,7 @@ PacketMetadata::ReplaceTail (PacketMetadata::SmallItem *item,
    */
 
   // create a copy of the packet without its tail.
-  PacketMetadata h (m_packetUid, 0);
+  PacketMetadata h (m_packetUid, CLASSIC);
   uint16_t current = m_head;
   while (current != 0xffff && current != m_tail)
     {
@@ -576,7 +786,7 @@ PacketMetadata::Create (uint32_t size)
     {
       m_maxSize = size;
     }
-  while (!m_freeList.empty ()) 
+  while (!ThreadSafety::IsEnabled () && !m_freeList.empty ()) 
     {
       struct PacketMetadata::Data *data = m_freeList.back ();
       m_freeList.pop_back ();
@@ -604,7 +814,8 @@ PacketMetadata::Recycle (struct PacketMetadata::Data *data)
     } 
   NS_LOG_LOGIC ("recycle size="<<data->m_size<<", list="<<m_freeList.size ());
   NS_ASSERT (data->m_count == 0);
-  if (m_freeList.size () > 1000 ||
+  if (ThreadSafety::IsEnabled () ||
+      m_freeList.size () > 1000 ||
       data->m_size < m_maxSize) 
     {
       PacketMetadata::Deallocate (data);
@@ -669,14 +880,25 @@ PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
-
+  if (m_data == 0)
+    {
+      AddDelta (ADD_HEADER, uid >> 1, size, 0);
+      return;
+    }
+  uint16_t chunkUid = m_chunkUid;
+  m_chunkUid++;
+  DoAddHeader (uid, size, chunkUid);
+}
+void
+PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size, uint16_t chunkUid)
+{
+  NS_LOG_FUNCTION (this << uid << size << chunkUid);
   struct PacketMetadata::SmallItem item;
   item.next = m_head;
   item.prev = 0xffff;
   item.typeUid = uid;
   item.size = size;
-  item.chunkUid = m_chunkUid;
-  m_chunkUid++;
+  item.chunkUid = chunkUid;
   uint16_t written = AddSmall (&item);
   UpdateHead (written);
 }
@@ -691,6 +913,38 @@ PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  if (m_data == 0)
+    {
+      if (m_delta != 0 && m_delta->m_type == ADD_HEADER &&
+          m_delta->m_u.item.typeUid == uid >> 1 && m_delta->m_u.item.size == size)
+        {
+          // the header just added, which the checks accept: back to the
+          // operation before it.
+          struct Delta *last = m_delta;
+          m_delta = last->m_prev;
+          if (m_delta != 0)
+            {
+              ThreadSafety::Increment (&m_delta->m_count);
+            }
+          ReleaseDelta (last);
+        }
+      else
+        {
+          if (m_enableChecking)
+            {
+              Materialize ().DoRemoveHeader (uid, size);
+            }
+          AddDelta (REMOVE_HEADER, uid >> 1, size, 0);
+        }
+      return;
+    }
+  DoRemoveHeader (uid, size);
+  NS_ASSERT (IsStateOk ());
+}
+void
+PacketMetadata::DoRemoveHeader (uint32_t uid, uint32_t size)
+{
+  NS_LOG_FUNCTION (this << uid << size);
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_head, &item, &extraItem);
@@ -726,7 +980,6 @@ PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
     {
       m_head = item.next;
     }
-  NS_ASSERT (IsStateOk ());
 }
 void 
 PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
@@ -739,16 +992,28 @@ PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  if (m_data == 0)
+    {
+      AddDelta (ADD_TRAILER, uid >> 1, size, 0);
+      return;
+    }
+  uint16_t chunkUid = m_chunkUid;
+  m_chunkUid++;
+  DoAddTrailer (uid, size, chunkUid);
+  NS_ASSERT (IsStateOk ());
+}
+void
+PacketMetadata::DoAddTrailer (uint32_t uid, uint32_t size, uint16_t chunkUid)
+{
+  NS_LOG_FUNCTION (this << uid << size << chunkUid);
   struct PacketMetadata::SmallItem item;
   item.next = 0xffff;
   item.prev = m_tail;
   item.typeUid = uid;
   item.size = size;
-  item.chunkUid = m_chunkUid;
-  m_chunkUid++;
+  item.chunkUid = chunkUid;
   uint16_t written = AddSmall (&item);
   UpdateTail (written);
-  NS_ASSERT (IsStateOk ());
 }
 void 
 PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
@@ -761,6 +1026,38 @@ PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  if (m_data == 0)
+    {
+      if (m_delta != 0 && m_delta->m_type == ADD_TRAILER &&
+          m_delta->m_u.item.typeUid == uid >> 1 && m_delta->m_u.item.size == size)
+        {
+          // the trailer just added, which the checks accept: back to the
+          // operation before it.
+          struct Delta *last = m_delta;
+          m_delta = last->m_prev;
+          if (m_delta != 0)
+            {
+              ThreadSafety::Increment (&m_delta->m_count);
+            }
+          ReleaseDelta (last);
+        }
+      else
+        {
+          if (m_enableChecking)
+            {
+              Materialize ().DoRemoveTrailer (uid, size);
+            }
+          AddDelta (REMOVE_TRAILER, uid >> 1, size, 0);
+        }
+      return;
+    }
+  DoRemoveTrailer (uid, size);
+  NS_ASSERT (IsStateOk ());
+}
+void
+PacketMetadata::DoRemoveTrailer (uint32_t uid, uint32_t size)
+{
+  NS_LOG_FUNCTION (this << uid << size);
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_tail, &item, &extraItem);
@@ -796,7 +1093,6 @@ PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
     {
       m_tail = item.prev;
     }
-  NS_ASSERT (IsStateOk ());
 }
 void
 PacketMetadata::AddAtEnd (PacketMetadata const&o)
@@ -808,6 +1104,27 @@ PacketMetadata::AddAtEnd (PacketMetadata const&o)
       m_metadataSkipped = true;
       return;
     }
+  if (m_data == 0)
+    {
+      if (GetItemBytes () == 0)
+        {
+          // as below, equivalent to self-assignment.
+          *this = o;
+          return;
+        }
+      uint32_t size = o.GetItemBytes ();
+      if (size == 0)
+        {
+          return;
+        }
+      AddDelta (ADD_AT_END, 0, size, new PacketMetadata (o));
+      return;
+    }
+  if (o.m_data == 0)
+    {
+      AddAtEnd (o.Materialize ());
+      return;
+    }
   if (m_tail == 0xffff)
     {
       // We have no items so 'AddAtEnd' is 
@@ -896,6 +1213,14 @@ PacketMetadata::RemoveAtStart (uint32_t start)
       m_metadataSkipped = true;
       return;
     }
+  if (m_data == 0)
+    {
+      if (start > 0)
+        {
+          AddDelta (REMOVE_AT_START, 0, start, 0);
+        }
+      return;
+    }
   NS_ASSERT (m_data != 0);
   uint32_t leftToRemove = start;
   uint16_t current = m_head;
@@ -922,7 +1247,7 @@ PacketMetadata::RemoveAtStart (uint32_t start)
       else
         {
           // fragment the list item.
-          PacketMetadata fragment (m_packetUid, 0);
+          PacketMetadata fragment (m_packetUid, CLASSIC);
           extraItem.fragmentStart += leftToRemove;
           leftToRemove = 0;
           uint16_t written = fragment.AddBig (0xffff, fragment.m_tail,
@@ -959,6 +1284,14 @@ PacketMetadata::RemoveAtEnd (uint32_t end)
       m_metadataSkipped = true;
       return;
     }
+  if (m_data == 0)
+    {
+      if (end > 0)
+        {
+          AddDelta (REMOVE_AT_END, 0, end, 0);
+        }
+      return;
+    }
   NS_ASSERT (m_data != 0);
 
   uint32_t leftToRemove = end;
@@ -986,7 +1319,7 @@ PacketMetadata::RemoveAtEnd (uint32_t end)
       else
         {
           // fragment the list item.
-          PacketMetadata fragment (m_packetUid, 0);
+          PacketMetadata fragment (m_packetUid, CLASSIC);
           NS_ASSERT (extraItem.fragmentEnd > leftToRemove);
           extraItem.fragmentEnd -= leftToRemove;
           leftToRemove = 0;
@@ -1047,6 +1380,16 @@ PacketMetadata::ItemIterator
 PacketMetadata::BeginItem (Buffer buffer) const
 {
   NS_LOG_FUNCTION (this << &buffer);
+  if (m_data == 0)
+    {
+      // the iterator keeps the list of items built from the history.
+      struct Delta *view = CreateDelta ();
+      view->m_type = SNAPSHOT;
+      view->m_u.other = new PacketMetadata (Materialize ());
+      ItemIterator i (view->m_u.other, buffer);
+      i.m_view = view;
+      return i;
+    }
   return ItemIterator (this, buffer);
 }
 PacketMetadata::ItemIterator::ItemIterator (const PacketMetadata *metadata, Buffer buffer)
@@ -1054,10 +1397,44 @@ PacketMetadata::ItemIterator::ItemIterator (const PacketMetadata *metadata, Buff
     m_buffer (buffer),
     m_current (metadata->m_head),
     m_offset (0),
-    m_hasReadTail (false)
+    m_hasReadTail (false),
+    m_view (0)
 {
   NS_LOG_FUNCTION (this << metadata << &buffer);
 }
+PacketMetadata::ItemIterator::ItemIterator (const ItemIterator &o)
+  : m_metadata (o.m_metadata),
+    m_buffer (o.m_buffer),
+    m_current (o.m_current),
+    m_offset (o.m_offset),
+    m_hasReadTail (o.m_hasReadTail),
+    m_view (o.m_view)
+{
+  if (m_view != 0)
+    {
+      ThreadSafety::Increment (&m_view->m_count);
+    }
+}
+PacketMetadata::ItemIterator &
+PacketMetadata::ItemIterator::operator = (const ItemIterator &o)
+{
+  if (o.m_view != 0)
+    {
+      ThreadSafety::Increment (&o.m_view->m_count);
+    }
+  PacketMetadata::ReleaseDelta (m_view);
+  m_metadata = o.m_metadata;
+  m_buffer = o.m_buffer;
+  m_current = o.m_current;
+  m_offset = o.m_offset;
+  m_hasReadTail = o.m_hasReadTail;
+  m_view = o.m_view;
+  return *this;
+}
+PacketMetadata::ItemIterator::~ItemIterator ()
+{
+  PacketMetadata::ReleaseDelta (m_view);
+}
 bool
 PacketMetadata::ItemIterator::HasNext (void) const
 {
@@ -1150,6 +1527,10 @@ PacketMetadata::GetSerializedSize (void) const
     {
       return totalSize;
     }
+  if (m_data == 0)
+    {
+      return Materialize ().GetSerializedSize ();
+    }
 
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
@@ -1183,6 +1564,10 @@ uint32_t
 PacketMetadata::Serialize (uint8_t* buffer, uint32_t maxSize) const
 {
   NS_LOG_FUNCTION (this << &buffer << maxSize);
+  if (m_data == 0)
+    {
+      return Materialize ().Serialize (buffer, maxSize);
+    }
   uint8_t* start = buffer;
 
   buffer = AddToRawU64 (m_packetUid, start, buffer, maxSize);
@@ -1284,6 +1669,17 @@ uint32_t
 PacketMetadata::Deserialize (const uint8_t* buffer, uint32_t size)
 {
   NS_LOG_FUNCTION (this << &buffer << size);
+  if (m_data == 0)
+    {
+      // the history starts from the deserialized list of items.
+      PacketMetadata *items = new PacketMetadata (0, CLASSIC);
+      uint32_t ok = items->Deserialize (buffer, size);
+      ReleaseDelta (m_delta);
+      m_delta = 0;
+      m_packetUid = items->m_packetUid;
+      AddDelta (SNAPSHOT, 0, items->GetTotalSize (), items);
+      return ok;
+    }
   const uint8_t* start = buffer;
   uint32_t desSize = size - 4;
 
@@ -25,6 +25,7 @@
 #include <limits>
 #include "ns3/callback.h"
 #include "ns3/assert.h"
+#include "ns3/thread-safety.h"
 #include "ns3/type-id.h"
 #include "buffer.h"
 
@@ -74,9 +75,20 @@ class Trailer;
  * integers, and some others as variable-size 32-bit integers.
  * The variable-size 32 bit integers are stored using the uleb128
  * encoding.
+ *
+ * When EnableCompact is called instead of Enable, a packet does not
+ * keep this list. It only keeps the last of the operations performed
+ * on it, each of which points to the operation before it: copies of a
+ * packet share their common history and adding a header to one of
+ * them does not copy anything. Removing the header or trailer which
+ * was just added goes back to the previous operation. The list of
+ * items is built from the history only when it is needed: by
+ * BeginItem, by serialization and, in checking mode, to check the
+ * removal of a header or trailer other than the one just added.
  */
 class PacketMetadata 
 {
+  struct Delta;
 public:
 
   /**
@@ -133,6 +145,18 @@ public:
      * \param buffer the buffer the metadata refers to
      */
     ItemIterator (const PacketMetadata *metadata, Buffer buffer);
+    /**
+     * \brief Copy constructor
+     * \param o the iterator to copy
+     */
+    ItemIterator (const ItemIterator &o);
+    /**
+     * \brief Assignment
+     * \param o the iterator to copy
+     * \returns a reference to this iterator
+     */
+    ItemIterator &operator = (const ItemIterator &o);
+    ~ItemIterator ();
     /**
      * \brief Checks if there is another metadata item
      * \returns true if there is another item
@@ -144,11 +168,14 @@ public:
      */
     Item Next (void);
 private:
+    friend class PacketMetadata;
     const PacketMetadata *m_metadata; //!< pointer to the metadata
     Buffer m_buffer; //!< buffer the metadata refers to
     uint16_t m_current; //!< current position
     uint32_t m_offset; //!< offset
     bool m_hasReadTail; //!< true if the metadata tail has been read
+    /** the list of items built from a compact history, or zero */
+    struct Delta *m_view;
   };
 
   /**
@@ -159,6 +186,17 @@ private:
    * \brief Enable the packet metadata checking
    */
   static void EnableChecking (void);
+  /**
+   * \brief Enable the packet metadata, recorded as a compact history
+   */
+  static void EnableCompact (void);
+  /**
+   * \brief Record the metadata of the packets created afterwards as a
+   * list of items again
+   *
+   * The packets created before keep their compact history.
+   */
+  static void DisableCompact (void);
 
   /**
    * \brief Constructor
@@ -271,6 +309,112 @@ private:
   uint32_t Deserialize (const uint8_t* buffer, uint32_t size);
 
 private:
+  /// Tag of the constructor of a metadata which keeps its list of items
+  enum Classic
+  {
+    CLASSIC
+  };
+  /**
+   * \brief Constructor of a metadata which keeps its list of items,
+   * whether the history is compact or not
+   * \param uid packet uid
+   * \param tag CLASSIC
+   */
+  inline PacketMetadata (uint64_t uid, enum Classic tag);
+
+  /// The operations of a compact history
+  enum DeltaType
+  {
+    ADD_HEADER,
+    REMOVE_HEADER,
+    ADD_TRAILER,
+    REMOVE_TRAILER,
+    REMOVE_AT_START,
+    REMOVE_AT_END,
+    ADD_AT_END,
+    SNAPSHOT
+  };
+  /**
+   * \brief The header, trailer or bytes an operation adds or removes
+   */
+  struct DeltaItem
+  {
+    uint32_t size;     //!< size of the item or of the bytes removed
+    uint16_t typeUid;  //!< uid of the header or trailer type
+    uint16_t chunkUid; //!< chunk uid of the item added
+  };
+  /**
+   * \brief An operation of a compact history, shared by the copies of
+   * the packets which performed it.
+   *
+   * Small (32 bytes on 64 bit hosts) and allocated by blocks of
+   * DELTA_BLOCK.
+   */
+  struct Delta
+  {
+    struct Delta *m_prev; //!< previous operation, or zero
+    union
+    {
+      struct DeltaItem item; //!< the item of the other operations
+      /** the packet added at end (ADD_AT_END) or the list of items
+       * which the history starts from (SNAPSHOT) */
+      PacketMetadata *other;
+    } m_u; //!< what the operation adds or removes
+    uint32_t m_count;     //!< number of references to this operation
+    uint32_t m_total;     //!< bytes of the items after this operation
+    uint8_t m_type;       //!< a DeltaType
+    uint8_t m_block;      //!< allocated in a block, not by new
+  };
+  /// Number of operations allocated at once
+  enum
+  {
+    DELTA_BLOCK = 128
+  };
+  /**
+   * \brief Class to hold the free operations and the blocks they
+   * come from
+   */
+  class DeltaFreeList : public std::vector<struct Delta *>
+  {
+public:
+    ~DeltaFreeList ();
+    std::vector<struct Delta *> m_blocks; //!< the blocks of operations
+  };
+  /**
+   * \brief Record an operation in the compact history
+   * \param type the DeltaType
+   * \param typeUid uid of the header or trailer type
+   * \param size size of the item or of the bytes removed
+   * \param other the packet added at end, or zero
+   */
+  void AddDelta (uint8_t type, uint16_t typeUid, uint32_t size, PacketMetadata *other);
+  /**
+   * \brief Get a free operation
+   * \returns an operation with one reference
+   */
+  static struct Delta *CreateDelta (void);
+  /**
+   * \brief Drop a reference to an operation and to the operations
+   * before it which are no longer used
+   * \param delta the operation, or zero
+   */
+  static void ReleaseDelta (struct Delta *delta);
+  /**
+   * \brief Build the list of items of a compact history
+   * \returns a metadata which keeps its list of items
+   */
+  PacketMetadata Materialize (void) const;
+  /**
+   * \brief Get the bytes of the items, without building them
+   * \returns the total size of the items
+   */
+  uint32_t GetItemBytes (void) const;
+  /**
+   * \brief Apply an operation of a compact history to a list of items
+   * \param delta the operation
+   */
+  void Replay (const struct Delta *delta);
+
   /**
    * \brief Helper for the raw serialization.
    *
@@ -615,6 +759,32 @@ public:
    * \param size header serialized size
    */
   void DoAddHeader (uint32_t uid, uint32_t size);
+  /**
+   * \brief Add an header
+   * \param uid header's uid to add
+   * \param size header serialized size
+   * \param chunkUid chunk uid of the header
+   */
+  void DoAddHeader (uint32_t uid, uint32_t size, uint16_t chunkUid);
+  /**
+   * \brief Remove an header
+   * \param uid header's uid to remove
+   * \param size header serialized size
+   */
+  void DoRemoveHeader (uint32_t uid, uint32_t size);
+  /**
+   * \brief Add a trailer
+   * \param uid trailer's uid to add
+   * \param size trailer serialized size
+   * \param chunkUid chunk uid of the trailer
+   */
+  void DoAddTrailer (uint32_t uid, uint32_t size, uint16_t chunkUid);
+  /**
+   * \brief Remove a trailer
+   * \param uid trailer's uid to remove
+   * \param size trailer serialized size
+   */
+  void DoRemoveTrailer (uint32_t uid, uint32_t size);
   /**
    * \brief Check if the metadata state is ok
    * \returns true if the internal state is ok
@@ -657,8 +827,10 @@ public:
   static void Deallocate (struct PacketMetadata::Data *data);
 
   static DataFreeList m_freeList; //!< the metadata data storage
+  static DeltaFreeList m_deltaFreeList; //!< the free operations
   static bool m_enable; //!< Enable the packet metadata
   static bool m_enableChecking; //!< Enable the packet metadata checking
+  static bool m_enableCompact; //!< Record the metadata as a compact history
 
   /**
    * Set to true when adding metadata to a packet is skipped because
@@ -670,7 +842,8 @@ public:
   static uint32_t m_maxSize; //!< maximum metadata size
   static uint16_t m_chunkUid; //!< Chunk Uid
 
-  struct Data *m_data; //!< Metadata storage
+  struct Data *m_data; //!< Metadata storage, zero for a compact history
+  struct Delta *m_delta; //!< last operation of a compact history
   /*
      head -(next)-> tail
        ^             |
@@ -687,28 +860,49 @@ public:
 namespace ns3 {
 
 PacketMetadata::PacketMetadata (uint64_t uid, uint32_t size)
-  : m_data (PacketMetadata::Create (10)),
+  : m_data (m_enableCompact ? 0 : PacketMetadata::Create (10)),
+    m_delta (0),
     m_head (0xffff),
     m_tail (0xffff),
     m_used (0),
     m_packetUid (uid)
 {
-  memset (m_data->m_data, 0xff, 4);
+  if (m_data != 0)
+    {
+      memset (m_data->m_data, 0xff, 4);
+    }
   if (size > 0)
     {
       DoAddHeader (0, size);
     }
 }
+PacketMetadata::PacketMetadata (uint64_t uid, enum Classic tag)
+  : m_data (PacketMetadata::Create (10)),
+    m_delta (0),
+    m_head (0xffff),
+    m_tail (0xffff),
+    m_used (0),
+    m_packetUid (uid)
+{
+  memset (m_data->m_data, 0xff, 4);
+}
 PacketMetadata::PacketMetadata (PacketMetadata const &o)
   : m_data (o.m_data),
+    m_delta (o.m_delta),
     m_head (o.m_head),
     m_tail (o.m_tail),
     m_used (o.m_used),
     m_packetUid (o.m_packetUid)
 {
-  NS_ASSERT (m_data != 0);
-  NS_ASSERT (m_data->m_count < std::numeric_limits<uint32_t>::max());
-  m_data->m_count++;
+  if (m_data != 0)
+    {
+      NS_ASSERT (m_data->m_count < std::numeric_limits<uint32_t>::max());
+      ThreadSafety::Increment (&m_data->m_count);
+    }
+  else if (m_delta != 0)
+    {
+      ThreadSafety::Increment (&m_delta->m_count);
+    }
 }
 PacketMetadata &
 PacketMetadata::operator = (PacketMetadata const& o)
@@ -716,15 +910,25 @@ PacketMetadata::operator = (PacketMetadata const& o)
   if (m_data != o.m_data) 
     {
       // not self assignment
-      NS_ASSERT (m_data != 0);
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (m_data != 0 && ThreadSafety::Decrement (&m_data->m_count) == 0)
         {
           PacketMetadata::Recycle (m_data);
         }
       m_data = o.m_data;
-      NS_ASSERT (m_data != 0);
-      m_data->m_count++;
+      if (m_data != 0)
+        {
+          ThreadSafety::Increment (&m_data->m_count);
+        }
+    }
+  if (m_delta != o.m_delta)
+    {
+      struct Delta *old = m_delta;
+      m_delta = o.m_delta;
+      if (m_delta != 0)
+        {
+          ThreadSafety::Increment (&m_delta->m_count);
+        }
+      PacketMetadata::ReleaseDelta (old);
     }
   m_head = o.m_head;
   m_tail = o.m_tail;
@@ -734,11 +938,16 @@ PacketMetadata::operator = (PacketMetadata const& o)
 }
 PacketMetadata::~PacketMetadata ()
 {
-  NS_ASSERT (m_data != 0);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (m_data != 0)
+    {
+      if (ThreadSafety::Decrement (&m_data->m_count) == 0)
+        {
+          PacketMetadata::Recycle (m_data);
+        }
+    }
+  else if (m_delta != 0)
     {
-      PacketMetadata::Recycle (m_data);
+      PacketMetadata::ReleaseDelta (m_delta);
     }
 }
 
@@ -34,6 +34,64 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("PacketTagList");
 
+/// Number of free TagData kept for reuse
+#define FREE_LIST_SIZE 1000
+
+PacketTagList::TagDataFreeList PacketTagList::m_freeList;
+uint32_t PacketTagList::m_heapAllocations = 0;
+/// The free list is destroyed: the TagData freed from now on are deleted.
+static bool g_freeListDestroyed = false;
+
+PacketTagList::TagDataFreeList::~TagDataFreeList ()
+{
+  NS_LOG_FUNCTION (this);
+  for (iterator i = begin (); i != end (); i++)
+    {
+      delete *i;
+    }
+  clear ();
+  g_freeListDestroyed = true;
+}
+
+struct PacketTagList::TagData *
+PacketTagList::CreateTagData (void)
+{
+  struct TagData * data;
+  if (!ThreadSafety::IsEnabled () && !m_freeList.empty ())
+    {
+      data = m_freeList.back ();
+      m_freeList.pop_back ();
+    }
+  else
+    {
+      data = new struct TagData ();
+      ThreadSafety::Increment (&m_heapAllocations);
+    }
+  data->count = 1;
+  data->next = 0;
+  return data;
+}
+
+void
+PacketTagList::FreeTagData (struct TagData * data)
+{
+  if (ThreadSafety::IsEnabled () || g_freeListDestroyed ||
+      m_freeList.size () >= FREE_LIST_SIZE)
+    {
+      delete data;
+    }
+  else
+    {
+      m_freeList.push_back (data);
+    }
+}
+
+uint32_t
+PacketTagList::GetHeapAllocations (void)
+{
+  return m_heapAllocations;
+}
+
 bool
 PacketTagList::COWTraverse (Tag & tag, PacketTagList::COWWriter Writer)
 {
@@ -102,8 +160,9 @@ PacketTagList::COWTraverse (Tag & tag, PacketTagList::COWWriter Writer)
     }
 
   // At this point cur is a merge, but untested for tid
+  // (a list shared by threads may be left alone on a former merge)
   NS_ASSERT (cur != 0);
-  NS_ASSERT (cur->count > 1);
+  NS_ASSERT (cur->count > 1 || ThreadSafety::IsEnabled ());
 
   /*
      Walk the remainder of the list, copying, until we find tid
@@ -131,14 +190,13 @@ PacketTagList::COWTraverse (Tag & tag, PacketTagList::COWWriter Writer)
   while ( /* cur && */ cur->tid != tid)
     {
       NS_ASSERT (cur != 0);
-      NS_ASSERT (cur->count > 1);
-      cur->count--;                       // unmerge cur
-      struct TagData * copy = new struct TagData ();
+      NS_ASSERT (cur->count > 1 || ThreadSafety::IsEnabled ());
+      struct TagData * copy = CreateTagData ();
       copy->tid = cur->tid;
-      copy->count = 1;
       memcpy (copy->data, cur->data, TagData::MAX_SIZE);
       copy->next = cur->next;             // merge into tail
-      copy->next->count++;                // mark new merge
+      ThreadSafety::Increment (&copy->next->count); // mark new merge
+      Unmerge (cur);                      // unmerge cur
       *prevNext = copy;                   // point prior list at copy
       prevNext = &copy->next;             // advance
       cur      =  copy->next;
@@ -146,7 +204,7 @@ PacketTagList::COWTraverse (Tag & tag, PacketTagList::COWWriter Writer)
   // Sanity check:
   NS_ASSERT (cur != 0);                 // cur should be non-zero
   NS_ASSERT (cur->tid == tid);          // cur->tid should be tid
-  NS_ASSERT (cur->count > 1);           // cur should be a merge
+  NS_ASSERT (cur->count > 1 || ThreadSafety::IsEnabled ()); // cur should be a merge
 
   // link around tid, removing it from our list
   found = (this->*Writer)(tag, false, cur, prevNext);
@@ -177,22 +235,33 @@ PacketTagList::RemoveWriter (Tag & tag, bool preMerge,
   if (preMerge)
     {
       // found tid before first merge, so delete cur
-      delete cur;
+      FreeTagData (cur);
     }
   else
     {
       // cur is always a merge at this point
-      // unmerge cur, since we linked around it already
-      cur->count--;
       if (cur->next != 0)
         {
           // there's a next, so make it a merge
-          cur->next->count++;
+          ThreadSafety::Increment (&cur->next->count);
         }
+      // unmerge cur, since we linked around it already
+      Unmerge (cur);
     }
   return found;
 }
 
+void
+PacketTagList::Unmerge (struct PacketTagList::TagData * cur)
+{
+  while (cur != 0 && ThreadSafety::Decrement (&cur->count) == 0)
+    {
+      struct TagData * next = cur->next;
+      FreeTagData (cur);
+      cur = next;
+    }
+}
+
 bool
 PacketTagList::Replace (Tag & tag)
 {
@@ -224,17 +293,16 @@ PacketTagList::ReplaceWriter (Tag & tag, bool preMerge,
     {
       // cur is always a merge at this point
       // need to copy, replace, and link past cur
-      cur->count--;                     // unmerge cur
-      struct TagData * copy = new struct TagData ();
+      struct TagData * copy = CreateTagData ();
       copy->tid = tag.GetInstanceTypeId ();
-      copy->count = 1;
       tag.Serialize (TagBuffer (copy->data,
                                 copy->data + tag.GetSerializedSize ()));
       copy->next = cur->next;           // merge into tail
       if (copy->next != 0)
         {
-          copy->next->count++;          // mark new merge
+          ThreadSafety::Increment (&copy->next->count); // mark new merge
         }
+      Unmerge (cur);                    // unmerge cur
       *prevNext = copy;                 // point prior list at copy
     }
   return found;
@@ -249,9 +317,7 @@ PacketTagList::Add (const Tag &tag) const
     {
       NS_ASSERT (cur->tid != tag.GetInstanceTypeId ());
     }
-  struct TagData * head = new struct TagData ();
-  head->count = 1;
-  head->next = 0;
+  struct TagData * head = CreateTagData ();
   head->tid = tag.GetInstanceTypeId ();
   head->next = m_next;
   NS_ASSERT (tag.GetSerializedSize () <= TagData::MAX_SIZE);
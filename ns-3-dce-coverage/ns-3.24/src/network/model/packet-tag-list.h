@@ -27,7 +27,9 @@
 
 #include <stdint.h>
 #include <ostream>
+#include <vector>
 #include "ns3/type-id.h"
+#include "ns3/thread-safety.h"
 
 namespace ns3 {
 
@@ -124,6 +126,11 @@ class Tag;
  * \n
  * Packet tags must serialize to a finite maximum size, see TagData
  *
+ * The TagData freed are kept in a free list, and reused by the next
+ * #Add or copy-on-write: a packet which gets and loses a few tags at
+ * each hop does not go to the heap once the list is warm.
+ * GetHeapAllocations counts the TagData which had to be allocated.
+ *
  * This documentation entitles the original author to a free beer.
  */
 class PacketTagList 
@@ -238,7 +245,34 @@ public:
    */
   const struct PacketTagList::TagData *Head (void) const;
 
+  /**
+   * \returns The number of TagData allocated on the heap because the
+   *          free list was empty, since the start of the program.
+   */
+  static uint32_t GetHeapAllocations (void);
+
 private:
+  /**
+   * \brief Class to hold the free TagData
+   */
+  class TagDataFreeList : public std::vector<struct TagData *>
+  {
+public:
+    ~TagDataFreeList ();
+  };
+  /**
+   * Get a TagData from the free list or the heap.
+   *
+   * \returns A TagData with one incoming link.
+   */
+  static struct TagData * CreateTagData (void);
+  /**
+   * Give back a TagData which has no incoming link left.
+   *
+   * \param [in] data The TagData.
+   */
+  static void FreeTagData (struct TagData * data);
+
   /**
    * Typedef of method function pointer for copy-on-write operations
    *
@@ -286,11 +320,24 @@ private:
    * \returns True, since tag value will definitely be replaced.
    */
   bool ReplaceWriter (Tag & tag, bool preMerge, struct TagData * cur, struct TagData ** prevNext);
+  /**
+   * Drop the reference of a list which linked past a merge.
+   *
+   * When the lists are shared by threads, the other lists may have
+   * dropped their references meanwhile: the merge, and the tags only it
+   * references, are then deleted.
+   *
+   * \param [in] cur The merge.
+   */
+  static void Unmerge (struct TagData * cur);
 
   /**
    * Pointer to first \ref TagData on the list
    */
   struct TagData *m_next;
+
+  static TagDataFreeList m_freeList; //!< the free TagData
+  static uint32_t m_heapAllocations; //!< TagData taken from the heap
 };
 
 } // namespace ns3
@@ -311,7 +358,7 @@ PacketTagList::PacketTagList (PacketTagList const &o)
 {
   if (m_next != 0)
     {
-      m_next->count++;
+      ThreadSafety::Increment (&m_next->count);
     }
 }
 
@@ -327,7 +374,7 @@ PacketTagList::operator = (PacketTagList const &o)
   m_next = o.m_next;
   if (m_next != 0) 
     {
-      m_next->count++;
+      ThreadSafety::Increment (&m_next->count);
     }
   return *this;
 }
@@ -343,20 +390,19 @@ PacketTagList::RemoveAll (void)
   struct TagData *prev = 0;
   for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
     {
-      cur->count--;
-      if (cur->count > 0) 
+      if (ThreadSafety::Decrement (&cur->count) > 0)
         {
           break;
         }
       if (prev != 0) 
         {
-	  delete prev;
+	  FreeTagData (prev);
         }
       prev = cur;
     }
   if (prev != 0) 
     {
-      delete prev;
+      FreeTagData (prev);
     }
   m_next = 0;
 }
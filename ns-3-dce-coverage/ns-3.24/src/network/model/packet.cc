@@ -21,6 +21,7 @@
 #include "ns3/assert.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
+#include "ns3/thread-safety.h"
 #include <string>
 #include <cstdarg>
 
@@ -137,10 +138,9 @@ Packet::Packet ()
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, 0),
+    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | ThreadSafety::FetchAndIncrement (&m_globalUid), 0),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 
 Packet::Packet (const Packet &o)
@@ -179,10 +179,9 @@ Packet::Packet (uint32_t size)
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | ThreadSafety::FetchAndIncrement (&m_globalUid), size),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 Packet::Packet (uint8_t const *buffer, uint32_t size, bool magic)
   : m_buffer (0, false),
@@ -205,15 +204,30 @@ Packet::Packet (uint8_t const*buffer, uint32_t size)
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | ThreadSafety::FetchAndIncrement (&m_globalUid), size),
     m_nixVector (0)
 {
-  m_globalUid++;
   m_buffer.AddAtStart (size);
   Buffer::Iterator i = m_buffer.Begin ();
   i.Write (buffer, size);
 }
 
+Packet::Packet (uint8_t const*buffer, uint32_t size, uint32_t headroom, uint32_t tailroom)
+  : m_buffer (),
+    m_byteTagList (),
+    m_packetTagList (),
+    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | ThreadSafety::FetchAndIncrement (&m_globalUid), size),
+    m_nixVector (0)
+{
+  // one allocation for the whole frame: the reserved bytes are then
+  // given back at both ends, where the headers and trailers will go.
+  m_buffer.AddAtStart (headroom + size + tailroom);
+  m_buffer.RemoveAtStart (headroom);
+  m_buffer.RemoveAtEnd (tailroom);
+  Buffer::Iterator i = m_buffer.Begin ();
+  i.Write (buffer, size);
+}
+
 Packet::Packet (const Buffer &buffer,  const ByteTagList &byteTagList, 
                 const PacketTagList &packetTagList, const PacketMetadata &metadata)
   : m_buffer (buffer),
@@ -543,6 +557,13 @@ Packet::EnableChecking (void)
   PacketMetadata::EnableChecking ();
 }
 
+void
+Packet::EnableCompactPrinting (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  PacketMetadata::EnableCompact ();
+}
+
 uint32_t Packet::GetSerializedSize (void) const
 {
   uint32_t size = 0;
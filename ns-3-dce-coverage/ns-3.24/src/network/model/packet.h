@@ -280,6 +280,23 @@ public:
    * \param size the size of the input buffer.
    */
   Packet (uint8_t const*buffer, uint32_t size);
+  /**
+   * \brief Create a packet with payload filled with the content
+   * of this buffer, and room around it for the headers and trailers
+   * of the lower layers.
+   *
+   * The input data is copied once: adding up to headroom bytes of
+   * headers and up to tailroom bytes of trailers to this packet does
+   * not copy its payload again. This is meant for the bytes received
+   * from outside of the simulation, such as the frames of a real
+   * network stack, which go down to a NetDevice.
+   *
+   * \param buffer the data to store in the packet.
+   * \param size the size of the input buffer.
+   * \param headroom the space reserved before the payload.
+   * \param tailroom the space reserved after the payload.
+   */
+  Packet (uint8_t const*buffer, uint32_t size, uint32_t headroom, uint32_t tailroom);
   /**
    * \brief Create a new packet which contains a fragment of the original
    * packet.
@@ -501,6 +518,17 @@ public:
    * errors will be detected and will abort the program.
    */
   static void EnableChecking (void);
+  /**
+   * \brief Enable printing packets metadata, recorded as a compact
+   * history.
+   *
+   * Like EnablePrinting, but each packet only records the operations
+   * performed on it, shared with its copies, and the headers and
+   * trailers it contains are only worked out to print it. Packets which
+   * are copied or sent to many nodes cost much less memory, printing
+   * them costs more.
+   */
+  static void EnableCompactPrinting (void);
 
   /**
    * \brief Returns number of bytes required for packet
@@ -361,6 +361,49 @@ BufferTest::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ (val1, val2, "Bad ReadNtohU16()");
 }
 //-----------------------------------------------------------------------------
+class BufferPoolTest : public TestCase {
+public:
+  virtual void DoRun (void);
+  BufferPoolTest ();
+};
+
+BufferPoolTest::BufferPoolTest ()
+  : TestCase ("Check the buffer pools and their counters")
+{
+}
+
+void
+BufferPoolTest::DoRun (void)
+{
+  Buffer::PoolStats before = Buffer::GetPoolStats ();
+  {
+    Buffer buffer;
+    buffer.AddAtStart (1000);
+    NS_TEST_ASSERT_MSG_EQ (Buffer::GetPoolStats ().liveBuffers, before.liveBuffers + 1, "one buffer in use");
+  }
+  Buffer::PoolStats first = Buffer::GetPoolStats ();
+  NS_TEST_ASSERT_MSG_EQ (first.liveBuffers, before.liveBuffers, "buffer not given back");
+  NS_TEST_ASSERT_MSG_GT (first.allocations, before.allocations, "allocation not counted");
+  NS_TEST_ASSERT_MSG_GT_OR_EQ (first.peakBytes, first.liveBytes, "wrong peak");
+  {
+    // the storage of the first buffer is reused.
+    Buffer buffer;
+    buffer.AddAtStart (1000);
+  }
+  Buffer::PoolStats second = Buffer::GetPoolStats ();
+  NS_TEST_ASSERT_MSG_GT (second.hits, first.hits, "pooled storage not reused");
+  NS_TEST_ASSERT_MSG_EQ (second.liveBytes, first.liveBytes, "storage not pooled");
+  {
+    // too large for the pools: freed at once.
+    Buffer buffer;
+    buffer.AddAtEnd (100000);
+    Buffer::Iterator i = buffer.Begin ();
+    i.WriteU8 (1, 100000);
+    NS_TEST_ASSERT_MSG_GT_OR_EQ (Buffer::GetPoolStats ().liveBytes, first.liveBytes + 100000, "large storage not counted");
+  }
+  NS_TEST_ASSERT_MSG_EQ (Buffer::GetPoolStats ().liveBytes, second.liveBytes, "large storage kept");
+}
+//-----------------------------------------------------------------------------
 class BufferTestSuite : public TestSuite
 {
 public:
@@ -371,6 +414,7 @@ BufferTestSuite::BufferTestSuite ()
   : TestSuite ("buffer", UNIT)
 {
   AddTestCase (new BufferTest, TestCase::QUICK);
+  AddTestCase (new BufferPoolTest, TestCase::QUICK);
 }
 
 static BufferTestSuite g_bufferTestSuite;
@@ -19,6 +19,8 @@
 #include "ns3/test.h"
 #include "ns3/drop-tail-queue.h"
 #include "ns3/uinteger.h"
+#include "ns3/enum.h"
+#include <vector>
 
 using namespace ns3;
 
@@ -77,6 +79,98 @@ DropTailQueueTestCase::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ ((p == 0), true, "There are really no packets in there");
 }
 
+/**
+ * The packets stay in order when the ring of the queue wraps and grows,
+ * and the bursts dequeued are counted and traced as single packets.
+ */
+class DropTailQueueBurstTestCase : public TestCase
+{
+public:
+  DropTailQueueBurstTestCase ();
+  virtual void DoRun (void);
+
+private:
+  void Dequeued (Ptr<const Packet> p);
+
+  uint32_t m_dequeued;
+  Ptr<Queue> m_queue;
+  /// the packets and bytes in the queue seen by the Dequeue trace sink
+  std::vector<std::pair<uint32_t, uint32_t> > m_counts;
+};
+
+DropTailQueueBurstTestCase::DropTailQueueBurstTestCase ()
+  : TestCase ("Check the order of the packets and the bursts of the drop tail queue")
+{
+}
+
+void
+DropTailQueueBurstTestCase::Dequeued (Ptr<const Packet> p)
+{
+  m_dequeued++;
+  m_counts.push_back (std::make_pair (m_queue->GetNPackets (), m_queue->GetNBytes ()));
+}
+
+void
+DropTailQueueBurstTestCase::DoRun (void)
+{
+  m_dequeued = 0;
+  Ptr<DropTailQueue> queue = CreateObject<DropTailQueue> ();
+  m_queue = queue;
+  queue->SetAttribute ("Mode", EnumValue (DropTailQueue::QUEUE_MODE_BYTES));
+  queue->SetAttribute ("MaxBytes", UintegerValue (100000));
+  queue->TraceConnectWithoutContext ("Dequeue", MakeCallback (&DropTailQueueBurstTestCase::Dequeued, this));
+
+  // enqueue more than dequeued, so that the ring wraps and then grows.
+  std::vector<Ptr<Packet> > sent;
+  uint32_t next = 0;
+  for (uint32_t round = 0; round < 100; round++)
+    {
+      for (uint32_t i = 0; i < 5; i++)
+        {
+          sent.push_back (Create<Packet> (10 + sent.size () % 7));
+          NS_TEST_EXPECT_MSG_EQ (queue->Enqueue (sent.back ()), true, "Packet not enqueued");
+        }
+      for (uint32_t i = 0; i < 3; i++)
+        {
+          Ptr<Packet> p = queue->Dequeue ();
+          NS_TEST_ASSERT_MSG_EQ ((p != 0), true, "Packet lost");
+          NS_TEST_EXPECT_MSG_EQ (p->GetUid (), sent[next++]->GetUid (), "Packets out of order");
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNPackets (), 200, "Wrong number of packets in the queue");
+
+  // a burst, then the others.
+  uint32_t bytes = queue->GetNBytes ();
+  std::vector<Ptr<Packet> > burst;
+  m_counts.clear ();
+  NS_TEST_EXPECT_MSG_EQ (queue->Dequeue (&burst, 50), 50, "Wrong size of the burst");
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNPackets (), 150, "Burst not counted");
+  NS_TEST_ASSERT_MSG_EQ (m_counts.size (), 50, "Dequeue not traced for each packet of the burst");
+  for (uint32_t i = 0; i < burst.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (burst[i]->GetUid (), sent[next++]->GetUid (), "Burst out of order");
+      bytes -= burst[i]->GetSize ();
+      // the sink sees the queue without the packets traced so far.
+      NS_TEST_EXPECT_MSG_EQ (m_counts[i].first, 200 - i - 1, "Packets not counted per packet");
+      NS_TEST_EXPECT_MSG_EQ (m_counts[i].second, bytes, "Bytes not counted per packet");
+    }
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNBytes (), bytes, "Bytes of the burst not counted");
+  NS_TEST_EXPECT_MSG_EQ (queue->Dequeue (&burst, 1000), 150, "Wrong size of the last burst");
+  NS_TEST_EXPECT_MSG_EQ (burst.size (), 200, "Burst not appended");
+  NS_TEST_EXPECT_MSG_EQ (burst.back ()->GetUid (), sent.back ()->GetUid (), "Last packet out of order");
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNBytes (), 0, "Bytes left in an empty queue");
+  NS_TEST_EXPECT_MSG_EQ (m_dequeued, 500, "Dequeue not traced for each packet");
+  NS_TEST_EXPECT_MSG_EQ ((queue->Peek () == 0), true, "There are really no packets in there");
+
+  // a burst enqueued in a queue with room for part of it.
+  queue->SetAttribute ("Mode", EnumValue (DropTailQueue::QUEUE_MODE_PACKETS));
+  queue->SetAttribute ("MaxPackets", UintegerValue (10));
+  NS_TEST_EXPECT_MSG_EQ (queue->Enqueue (sent), 10, "Wrong number of packets enqueued");
+  NS_TEST_EXPECT_MSG_EQ (queue->GetTotalDroppedPackets (), sent.size () - 10, "Drops not counted");
+  queue->DequeueAll ();
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNPackets (), 0, "There should be no packets in there");
+}
+
 static class DropTailQueueTestSuite : public TestSuite
 {
 public:
@@ -84,5 +178,6 @@ public:
     : TestSuite ("drop-tail-queue", UNIT)
   {
     AddTestCase (new DropTailQueueTestCase (), TestCase::QUICK);
+    AddTestCase (new DropTailQueueBurstTestCase (), TestCase::QUICK);
   }
 } g_dropTailQueueTestSuite;
@@ -252,7 +252,7 @@ HistoryTrailer<N>::Deserialize (Buffer::Iterator start)
 
 class PacketMetadataTest : public TestCase {
 public:
-  PacketMetadataTest ();
+  PacketMetadataTest (std::string name = "Packet metadata");
   virtual ~PacketMetadataTest ();
   void CheckHistory (Ptr<Packet> p, const char *file, int line, uint32_t n, ...);
   virtual void DoRun (void);
@@ -260,8 +260,8 @@ private:
   Ptr<Packet> DoAddHeader (Ptr<Packet> p);
 };
 
-PacketMetadataTest::PacketMetadataTest ()
-  : TestCase ("Packet metadata")
+PacketMetadataTest::PacketMetadataTest (std::string name)
+  : TestCase (name)
 {
 }
 
@@ -823,6 +823,33 @@ PacketMetadataTest::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (msg, std::string ("hello world"), "Could not find original data in received packet");
 }
 //-----------------------------------------------------------------------------
+// The same checks, with the metadata recorded as a compact history.
+class PacketMetadataCompactTest : public PacketMetadataTest {
+public:
+  PacketMetadataCompactTest ();
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+};
+
+PacketMetadataCompactTest::PacketMetadataCompactTest ()
+  : PacketMetadataTest ("Compact packet metadata")
+{
+}
+
+void
+PacketMetadataCompactTest::DoRun (void)
+{
+  PacketMetadata::EnableCompact ();
+  PacketMetadataTest::DoRun ();
+}
+
+void
+PacketMetadataCompactTest::DoTeardown (void)
+{
+  // the suites run afterwards expect the default mode.
+  PacketMetadata::DisableCompact ();
+}
+//-----------------------------------------------------------------------------
 class PacketMetadataTestSuite : public TestSuite
 {
 public:
@@ -833,6 +860,7 @@ PacketMetadataTestSuite::PacketMetadataTestSuite ()
   : TestSuite ("packet-metadata", UNIT)
 {
   AddTestCase (new PacketMetadataTest, TestCase::QUICK);
+  AddTestCase (new PacketMetadataCompactTest, TestCase::QUICK);
 }
 
 PacketMetadataTestSuite g_packetMetadataTest;
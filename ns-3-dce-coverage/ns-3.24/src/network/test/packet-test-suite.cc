@@ -19,6 +19,7 @@
  */
 #include "ns3/packet.h"
 #include "ns3/packet-tag-list.h"
+#include "ns3/byte-tag-list.h"
 #include "ns3/test.h"
 #include "ns3/unused.h"
 #include <limits>     // std:numeric_limits
@@ -346,6 +347,20 @@ PacketTest::DoRun (void)
 
   NS_TEST_EXPECT_MSG_EQ (msg, "hello world", "trivial");
 
+  {
+    // the headers and trailers go in the reserved room, or beyond it.
+    Ptr<Packet> framed = Create<Packet> (reinterpret_cast<const uint8_t*> ("hello"), 5, 10, 4);
+    NS_TEST_EXPECT_MSG_EQ (framed->GetSize (), 5, "reserved room is not data");
+    framed->AddHeader (ATestHeader<10> ());
+    framed->AddTrailer (ATestTrailer<4> ());
+    framed->AddHeader (ATestHeader<2> ());
+    uint8_t expected[] = { 2, 2, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+                           'h', 'e', 'l', 'l', 'o', 4, 4, 4, 4 };
+    uint8_t data[sizeof (expected)];
+    NS_TEST_EXPECT_MSG_EQ (framed->CopyData (data, sizeof (data)), sizeof (expected), "wrong size");
+    NS_TEST_EXPECT_MSG_EQ (memcmp (data, expected, sizeof (expected)), 0, "wrong content");
+  }
+
 
   Ptr<const Packet> p = Create<Packet> (1000);
 
@@ -847,6 +862,79 @@ PacketTagListTest::DoRun (void)
     
 }
 
+//--------------------------------------
+/**
+ * Microbenchmark of the tag allocations: packets forwarded over a few
+ * hops get, replace and lose packet tags at each hop, the way a wifi
+ * or LTE stack does, and carry a byte tag, the way the flow monitor
+ * does. Once the free lists are warm, forwarding a packet takes no tag
+ * storage from the heap.
+ */
+class PacketTagAllocationTest : public TestCase
+{
+public:
+  PacketTagAllocationTest ();
+private:
+  void DoRun (void);
+  /**
+   * Forward packets over hops.
+   * \param packets The number of packets.
+   * \param hops The number of hops of each packet.
+   */
+  void Forward (uint32_t packets, uint32_t hops);
+};
+
+PacketTagAllocationTest::PacketTagAllocationTest ()
+  : TestCase ("PacketTagAllocationTest: ")
+{
+}
+
+void
+PacketTagAllocationTest::Forward (uint32_t packets, uint32_t hops)
+{
+  for (uint32_t i = 0; i < packets; ++i)
+    {
+      Ptr<Packet> p = Create<Packet> (512);
+      p->AddPacketTag (ATestTag<2> (1));   // flow id
+      p->AddByteTag (ATestTag<1> (1));     // flow monitor
+      for (uint32_t hop = 0; hop < hops; ++hop)
+        {
+          // the channel gives a copy to the receiver.
+          Ptr<Packet> copy = p->Copy ();
+          ATestTag<3> snr;
+          copy->RemovePacketTag (snr);
+          copy->AddPacketTag (ATestTag<3> (hop));
+          ATestTag<2> flow (hop);
+          copy->ReplacePacketTag (flow);
+          // a tag which only lives within the node.
+          copy->AddPacketTag (ATestTag<4> (hop));
+          ATestTag<4> qos;
+          copy->RemovePacketTag (qos);
+          p = copy;
+        }
+    }
+}
+
+void
+PacketTagAllocationTest::DoRun (void)
+{
+  const uint32_t packets = 1000;
+  const uint32_t hops = 4;
+  // warm up the free lists.
+  Forward (100, hops);
+  uint32_t packetTags = PacketTagList::GetHeapAllocations ();
+  uint32_t byteTags = ByteTagList::GetHeapAllocations ();
+  Forward (packets, hops);
+  packetTags = PacketTagList::GetHeapAllocations () - packetTags;
+  byteTags = ByteTagList::GetHeapAllocations () - byteTags;
+  std::cout << GetName () << "heap allocations per forwarded packet: "
+            << "packet tags " << std::setw (8) << (double)packetTags / packets
+            << ", byte tags " << std::setw (8) << (double)byteTags / packets
+            << std::endl;
+  NS_TEST_EXPECT_MSG_EQ (packetTags, 0, "packet tags allocated once warm");
+  NS_TEST_EXPECT_MSG_EQ (byteTags, 0, "byte tags allocated once warm");
+}
+
 //-----------------------------------------------------------------------------
 class PacketTestSuite : public TestSuite
 {
@@ -859,6 +947,7 @@ PacketTestSuite::PacketTestSuite ()
 {
   AddTestCase (new PacketTest, TestCase::QUICK);
   AddTestCase (new PacketTagListTest, TestCase::QUICK);
+  AddTestCase (new PacketTagAllocationTest, TestCase::QUICK);
 }
 
 static PacketTestSuite g_packetTestSuite;
@@ -21,10 +21,30 @@
 #include <cstdlib>
 #include <sstream>
 #include <cstring>
+#include <unistd.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 #include "ns3/log.h"
 #include "ns3/test.h"
 #include "ns3/pcap-file.h"
+#include "ns3/pcap-file-wrapper.h"
+#include "ns3/packet.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/enum.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "ns3/simulator.h"
+#include "ns3/pcap-reader.h"
+#include "ns3/pcap-replay.h"
+#include "ns3/node-container.h"
+#include "ns3/packet-socket-helper.h"
+#include "ns3/packet-socket-address.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simple-channel.h"
+#include "ns3/mac48-address.h"
 
 using namespace ns3;
 
@@ -1121,6 +1141,690 @@ DiffTestCase::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (usec, 3696, "Files are different from 2.3696 seconds");
 }
 
+// ===========================================================================
+// Test case to make sure that the files written by blocks, on a thread, in
+// the pcap or pcapng format and over several files hold the records given.
+// ===========================================================================
+class WriterTestCase : public TestCase
+{
+public:
+  WriterTestCase ();
+  virtual ~WriterTestCase ();
+
+private:
+  virtual void DoSetup (void);
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+
+  Ptr<PcapFileWrapper> CreateWrapper (std::string format, uint64_t maxFileSize);
+  Ptr<Packet> CreatePacket (uint32_t i);
+  void Gunzip (std::string from, std::string to);
+  uint32_t CheckPcap (std::string filename, uint32_t first);
+  void CheckPcapNg (std::string filename, uint32_t records);
+
+  std::string m_testFilename;
+  std::vector<std::string> m_files;
+};
+
+WriterTestCase::WriterTestCase ()
+  : TestCase ("Check that the PcapWriter writes the records given, in order")
+{
+}
+
+WriterTestCase::~WriterTestCase ()
+{
+}
+
+void
+WriterTestCase::DoSetup (void)
+{
+  std::stringstream filename;
+  uint32_t n = rand ();
+  filename << n;
+  m_testFilename = CreateTempDirFilename (filename.str () + ".pcap");
+}
+
+void
+WriterTestCase::DoTeardown (void)
+{
+  for (uint32_t i = 0; i < m_files.size (); i++)
+    {
+      if (remove (m_files[i].c_str ()))
+        {
+          NS_LOG_ERROR ("Failed to delete file " << m_files[i]);
+        }
+    }
+}
+
+Ptr<PcapFileWrapper>
+WriterTestCase::CreateWrapper (std::string format, uint64_t maxFileSize)
+{
+  Ptr<PcapFileWrapper> file = CreateObject<PcapFileWrapper> ();
+  file->SetAttribute ("Format", EnumValue (format == "PcapNg" ? PcapWriter::PCAPNG : PcapWriter::PCAP));
+  file->SetAttribute ("Asynchronous", BooleanValue (true));
+  file->SetAttribute ("BlockSize", UintegerValue (4096));
+  file->SetAttribute ("MaxBlocks", UintegerValue (2));
+  file->SetAttribute ("MaxFileSize", UintegerValue (maxFileSize));
+  return file;
+}
+
+Ptr<Packet>
+WriterTestCase::CreatePacket (uint32_t i)
+{
+  uint8_t data[300];
+  uint32_t size = 50 + i % 250;
+  for (uint32_t j = 0; j < size; j++)
+    {
+      data[j] = i + j;
+    }
+  return Create<Packet> (data, size);
+}
+
+void
+WriterTestCase::Gunzip (std::string from, std::string to)
+{
+#ifdef HAVE_ZLIB
+  gzFile gz = gzopen (from.c_str (), "rb");
+  NS_TEST_ASSERT_MSG_NE (gz, 0, "Unable to open " << from);
+  FILE *p = std::fopen (to.c_str (), "wb");
+  NS_TEST_ASSERT_MSG_NE (p, 0, "Unable to open " << to);
+  char buffer[4096];
+  int n;
+  while ((n = gzread (gz, buffer, sizeof (buffer))) > 0)
+    {
+      std::fwrite (buffer, 1, n, p);
+    }
+  std::fclose (p);
+  NS_TEST_EXPECT_MSG_EQ (n, 0, "Unable to read " << from);
+  // Z_BUF_ERROR when the stream stops before its end
+  NS_TEST_EXPECT_MSG_EQ (gzclose (gz), Z_OK, "Truncated gzip stream in " << from);
+#endif /* HAVE_ZLIB */
+}
+
+uint32_t
+WriterTestCase::CheckPcap (std::string filename, uint32_t first)
+{
+  PcapFile f;
+  f.Open (filename, std::ios::in);
+  NS_TEST_EXPECT_MSG_EQ (f.Fail (), false, "Open (" << filename << ", \"std::ios::in\") returns error");
+  if (f.Fail ())
+    {
+      return 0;
+    }
+  NS_TEST_EXPECT_MSG_EQ (f.GetDataLinkType (), 1, "Wrong data link type in " << filename);
+  uint32_t i = first;
+  while (true)
+    {
+      uint8_t data[300];
+      uint8_t expected[300];
+      uint32_t tsSec, tsUsec, inclLen, origLen, readLen;
+      f.Read (data, sizeof (data), tsSec, tsUsec, inclLen, origLen, readLen);
+      if (f.Fail ())
+        {
+          break;
+        }
+      uint32_t size = CreatePacket (i)->CopyData (expected, sizeof (expected));
+      NS_TEST_EXPECT_MSG_EQ (tsSec * 1000000 + tsUsec, i * 10, "Wrong time stamp of record " << i);
+      NS_TEST_EXPECT_MSG_EQ (readLen, size, "Wrong length of record " << i);
+      NS_TEST_EXPECT_MSG_EQ (std::memcmp (data, expected, size), 0, "Wrong data in record " << i);
+      i++;
+    }
+  f.Close ();
+  return i - first;
+}
+
+void
+WriterTestCase::CheckPcapNg (std::string filename, uint32_t records)
+{
+  FILE *p = std::fopen (filename.c_str (), "rb");
+  NS_TEST_ASSERT_MSG_NE (p, 0, "Unable to open " << filename);
+  std::vector<uint8_t> file;
+  uint8_t buffer[4096];
+  size_t n;
+  while ((n = std::fread (buffer, 1, sizeof (buffer), p)) > 0)
+    {
+      file.insert (file.end (), buffer, buffer + n);
+    }
+  std::fclose (p);
+
+  uint32_t offset = 0;
+  uint32_t blocks[7] = { 0 };
+  uint32_t linkTypes[2] = { 0 };
+  uint32_t interfaces = 0;
+  uint32_t i = 0;
+  while (offset + 12 <= file.size ())
+    {
+      uint32_t type, length;
+      std::memcpy (&type, &file[offset], 4);
+      std::memcpy (&length, &file[offset + 4], 4);
+      NS_TEST_ASSERT_MSG_EQ (length % 4, 0, "Block of unaligned length");
+      NS_TEST_ASSERT_MSG_LT_OR_EQ (offset + length, file.size (), "Truncated block");
+      uint32_t trailer;
+      std::memcpy (&trailer, &file[offset + length - 4], 4);
+      NS_TEST_ASSERT_MSG_EQ (trailer, length, "Wrong length at the end of a block");
+      if (type == 0x0a0d0d0a)
+        {
+          NS_TEST_EXPECT_MSG_EQ (offset, 0, "Section header not at the start");
+          blocks[0]++;
+        }
+      else if (type == 1)
+        {
+          uint16_t linkType;
+          std::memcpy (&linkType, &file[offset + 8], 2);
+          NS_TEST_ASSERT_MSG_LT (interfaces, 2, "Too many interfaces");
+          linkTypes[interfaces++] = linkType;
+          blocks[1]++;
+        }
+      else if (type == 6)
+        {
+          uint32_t interface, high, low, inclLen;
+          uint8_t expected[300];
+          std::memcpy (&interface, &file[offset + 8], 4);
+          std::memcpy (&high, &file[offset + 12], 4);
+          std::memcpy (&low, &file[offset + 16], 4);
+          std::memcpy (&inclLen, &file[offset + 20], 4);
+          NS_TEST_ASSERT_MSG_LT (interface, interfaces, "Record of an interface not described yet");
+          NS_TEST_EXPECT_MSG_EQ (interface, i % 2, "Record of the wrong interface");
+          uint64_t ns = ((uint64_t)high << 32) | low;
+          NS_TEST_EXPECT_MSG_EQ (ns, i * 10000, "Wrong time stamp of record " << i);
+          uint32_t size = CreatePacket (i)->CopyData (expected, sizeof (expected));
+          NS_TEST_EXPECT_MSG_EQ (inclLen, size, "Wrong length of record " << i);
+          NS_TEST_EXPECT_MSG_EQ (std::memcmp (&file[offset + 28], expected, size), 0, "Wrong data in record " << i);
+          i++;
+          blocks[6]++;
+        }
+      offset += length;
+    }
+  NS_TEST_EXPECT_MSG_EQ (offset, file.size (), "Trailing bytes");
+  NS_TEST_EXPECT_MSG_EQ (blocks[0], 1, "Expected a single section");
+  NS_TEST_EXPECT_MSG_EQ (blocks[1], 2, "Expected an interface per wrapper");
+  NS_TEST_EXPECT_MSG_EQ (linkTypes[0], 1, "Wrong link type of the first interface");
+  NS_TEST_EXPECT_MSG_EQ (linkTypes[1], 105, "Wrong link type of the second interface");
+  NS_TEST_EXPECT_MSG_EQ (blocks[6], records, "Wrong number of records");
+}
+
+void
+WriterTestCase::DoRun (void)
+{
+  const uint32_t records = 2000;
+
+  //
+  // A pcap file written on a thread, by blocks smaller than the records
+  // given, is the same as the one written by PcapFile.
+  //
+  Ptr<PcapFileWrapper> file = CreateWrapper ("Pcap", 0);
+  file->Open (m_testFilename, std::ios::out);
+  NS_TEST_ASSERT_MSG_EQ (file->Fail (), false, "Open (" << m_testFilename << ", \"std::ios::out\") returns error");
+  file->Init (1, 65535);
+  m_files.push_back (m_testFilename);
+  for (uint32_t i = 0; i < records; i++)
+    {
+      file->Write (MicroSeconds (i * 10), CreatePacket (i));
+    }
+  file->Close ();
+  NS_TEST_EXPECT_MSG_EQ (CheckPcap (m_testFilename, 0), records, "Wrong number of records");
+
+  //
+  // With a maximum size, the records continue in the next files, each a
+  // valid pcap file no larger than the maximum.
+  //
+  std::string rotated = m_testFilename + "-rotated";
+  file = CreateWrapper ("Pcap", 16384);
+  file->Open (rotated, std::ios::out);
+  file->Init (1, 65535);
+  for (uint32_t i = 0; i < records; i++)
+    {
+      file->Write (MicroSeconds (i * 10), CreatePacket (i));
+    }
+  file->Close ();
+  uint32_t found = 0;
+  for (uint32_t rank = 0; found < records; rank++)
+    {
+      std::ostringstream oss;
+      oss << rotated;
+      if (rank != 0)
+        {
+          oss << "." << rank;
+        }
+      if (!CheckFileExists (oss.str ()))
+        {
+          break;
+        }
+      m_files.push_back (oss.str ());
+      FILE *p = std::fopen (oss.str ().c_str (), "rb");
+      std::fseek (p, 0, SEEK_END);
+      NS_TEST_EXPECT_MSG_LT_OR_EQ (std::ftell (p), 16384, "File " << oss.str () << " too large");
+      std::fclose (p);
+      found += CheckPcap (oss.str (), found);
+    }
+  NS_TEST_EXPECT_MSG_EQ (found, records, "Records lost over the files");
+  NS_TEST_EXPECT_MSG_GT (m_files.size (), 3, "Expected several files");
+
+  //
+  // Two wrappers which open the same pcapng file each get an interface.
+  //
+  std::string shared = m_testFilename + "-shared";
+  Ptr<PcapFileWrapper> first = CreateWrapper ("PcapNg", 0);
+  Ptr<PcapFileWrapper> second = CreateWrapper ("PcapNg", 0);
+  first->Open (shared, std::ios::out);
+  first->Init (1, 65535);
+  second->Open (shared, std::ios::out);
+  second->Init (105, 65535);
+  m_files.push_back (shared);
+  for (uint32_t i = 0; i < records; i++)
+    {
+      Ptr<PcapFileWrapper> file = i % 2 ? second : first;
+      file->Write (MicroSeconds (i * 10), CreatePacket (i));
+    }
+  first->Close ();
+  second->Close ();
+  CheckPcapNg (shared, records);
+
+#ifdef HAVE_ZLIB
+  //
+  // A gzip file left open is closed, with the end of its stream, when its
+  // last wrapper goes away, as the files still open at exit are.
+  //
+  std::string compressed = m_testFilename + "-compressed";
+  file = CreateWrapper ("Pcap", 0);
+  file->SetAttribute ("Compression", EnumValue (PcapWriter::GZIP));
+  file->Open (compressed, std::ios::out);
+  NS_TEST_ASSERT_MSG_EQ (file->Fail (), false, "Open (" << compressed << ", \"std::ios::out\") returns error");
+  file->Init (1, 65535);
+  m_files.push_back (compressed + ".gz");
+  for (uint32_t i = 0; i < records; i++)
+    {
+      file->Write (MicroSeconds (i * 10), CreatePacket (i));
+    }
+  file = 0;
+  Gunzip (compressed + ".gz", compressed);
+  m_files.push_back (compressed);
+  NS_TEST_EXPECT_MSG_EQ (CheckPcap (compressed, 0), records, "Wrong number of records");
+#endif /* HAVE_ZLIB */
+}
+
+// ===========================================================================
+// Test case to make sure that the PcapReader reads in place the records of
+// pcap files in both byte orders and of pcapng files, and that
+// PcapFile::Diff, which uses it, still finds the differences.
+// ===========================================================================
+class ReaderTestCase : public TestCase
+{
+public:
+  ReaderTestCase ();
+  virtual ~ReaderTestCase ();
+
+private:
+  virtual void DoSetup (void);
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+
+  void WritePcap (std::string filename, bool swapMode, uint32_t records);
+  uint32_t CheckRecords (PcapReader &reader, uint32_t interfaces);
+
+  std::string m_testFilename;
+  std::vector<std::string> m_files;
+};
+
+ReaderTestCase::ReaderTestCase ()
+  : TestCase ("Check that the PcapReader reads the records of pcap and pcapng files")
+{
+}
+
+ReaderTestCase::~ReaderTestCase ()
+{
+}
+
+void
+ReaderTestCase::DoSetup (void)
+{
+  std::stringstream filename;
+  uint32_t n = rand ();
+  filename << n;
+  m_testFilename = CreateTempDirFilename (filename.str () + ".pcap");
+}
+
+void
+ReaderTestCase::DoTeardown (void)
+{
+  for (uint32_t i = 0; i < m_files.size (); i++)
+    {
+      if (remove (m_files[i].c_str ()))
+        {
+          NS_LOG_ERROR ("Failed to delete file " << m_files[i]);
+        }
+    }
+}
+
+static void
+FillRecord (uint32_t i, uint8_t *data, uint32_t *size)
+{
+  *size = 20 + i % 200;
+  for (uint32_t j = 0; j < *size; j++)
+    {
+      data[j] = i * 3 + j;
+    }
+}
+
+void
+ReaderTestCase::WritePcap (std::string filename, bool swapMode, uint32_t records)
+{
+  PcapFile f;
+  f.Open (filename, std::ios::out);
+  NS_TEST_ASSERT_MSG_EQ (f.Fail (), false, "Open (" << filename << ", \"std::ios::out\") returns error");
+  f.Init (1, 65535, 0, swapMode);
+  m_files.push_back (filename);
+  for (uint32_t i = 0; i < records; i++)
+    {
+      uint8_t data[256];
+      uint32_t size;
+      FillRecord (i, data, &size);
+      f.Write (1000 + i / 100, (i % 100) * 10000, data, size);
+    }
+  f.Close ();
+}
+
+uint32_t
+ReaderTestCase::CheckRecords (PcapReader &reader, uint32_t interfaces)
+{
+  PcapReader::Record record;
+  uint32_t i = 0;
+  while (reader.Read (&record))
+    {
+      uint8_t expected[256];
+      uint32_t size;
+      FillRecord (i, expected, &size);
+      uint64_t ns = (1000 + i / 100) * UINT64_C (1000000000) + (i % 100) * UINT64_C (10000000);
+      NS_TEST_EXPECT_MSG_EQ (record.interface, i % interfaces, "Wrong interface of record " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.timestamp, ns, "Wrong time stamp of record " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.inclLen, size, "Wrong length of record " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.origLen, size, "Wrong original length of record " << i);
+      NS_TEST_EXPECT_MSG_EQ (std::memcmp (record.data, expected, size), 0, "Wrong data in record " << i);
+      i++;
+    }
+  NS_TEST_EXPECT_MSG_EQ (reader.Fail (), false, "Valid file read as invalid");
+  return i;
+}
+
+void
+ReaderTestCase::DoRun (void)
+{
+  const uint32_t records = 500;
+
+  //
+  // A pcap file, in the byte order of the host and in the other one, is
+  // read from its start again after a Rewind.
+  //
+  for (uint32_t swapMode = 0; swapMode < 2; swapMode++)
+    {
+      std::string filename = m_testFilename + (swapMode ? "-swapped" : "");
+      WritePcap (filename, swapMode, records);
+      PcapReader reader;
+      reader.Open (filename);
+      NS_TEST_ASSERT_MSG_EQ (reader.Fail (), false, "Open (" << filename << ") returns error");
+      NS_TEST_EXPECT_MSG_EQ (reader.GetFormat (), PcapWriter::PCAP, "Wrong format");
+      NS_TEST_EXPECT_MSG_EQ (reader.GetSwapMode (), (swapMode != 0), "Wrong swap mode");
+      NS_TEST_EXPECT_MSG_EQ (reader.GetNInterfaces (), 1, "Expected a single interface");
+      NS_TEST_EXPECT_MSG_EQ (reader.GetDataLinkType (), 1, "Wrong data link type");
+      NS_TEST_EXPECT_MSG_EQ (reader.GetSnapLen (), 65535, "Wrong snap length");
+      NS_TEST_EXPECT_MSG_EQ (CheckRecords (reader, 1), records, "Wrong number of records");
+      reader.Rewind ();
+      NS_TEST_EXPECT_MSG_EQ (CheckRecords (reader, 1), records, "Wrong number of records after Rewind");
+    }
+
+  //
+  // The records of a pcapng file refer to their interface.
+  //
+  std::string shared = m_testFilename + "-shared";
+  Ptr<PcapFileWrapper> first = CreateObject<PcapFileWrapper> ();
+  Ptr<PcapFileWrapper> second = CreateObject<PcapFileWrapper> ();
+  first->SetAttribute ("Format", EnumValue (PcapWriter::PCAPNG));
+  second->SetAttribute ("Format", EnumValue (PcapWriter::PCAPNG));
+  first->Open (shared, std::ios::out);
+  first->Init (1, 65535);
+  second->Open (shared, std::ios::out);
+  second->Init (105, 1500);
+  m_files.push_back (shared);
+  for (uint32_t i = 0; i < records; i++)
+    {
+      uint8_t data[256];
+      uint32_t size;
+      FillRecord (i, data, &size);
+      Time t = Seconds (1000 + i / 100) + MilliSeconds ((i % 100) * 10);
+      (i % 2 ? second : first)->Write (t, data, size);
+    }
+  first->Close ();
+  second->Close ();
+  PcapReader reader;
+  reader.Open (shared);
+  NS_TEST_ASSERT_MSG_EQ (reader.Fail (), false, "Open (" << shared << ") returns error");
+  NS_TEST_EXPECT_MSG_EQ (reader.GetFormat (), PcapWriter::PCAPNG, "Wrong format");
+  NS_TEST_EXPECT_MSG_EQ (reader.GetNInterfaces (), 2, "Expected an interface per wrapper");
+  NS_TEST_EXPECT_MSG_EQ (reader.GetDataLinkType (0), 1, "Wrong data link type of the first interface");
+  NS_TEST_EXPECT_MSG_EQ (reader.GetDataLinkType (1), 105, "Wrong data link type of the second interface");
+  NS_TEST_EXPECT_MSG_EQ (reader.GetSnapLen (1), 1500, "Wrong snap length of the second interface");
+  NS_TEST_EXPECT_MSG_EQ (CheckRecords (reader, 2), records, "Wrong number of records");
+  reader.Rewind ();
+  NS_TEST_EXPECT_MSG_EQ (CheckRecords (reader, 2), records, "Wrong number of records after Rewind");
+  NS_TEST_EXPECT_MSG_EQ (reader.GetNInterfaces (), 2, "Interfaces described twice");
+  reader.Close ();
+
+  //
+  // Diff finds the same records in both byte orders, and the first
+  // difference of a truncated file.
+  //
+  uint32_t sec (0), usec (0), packets (0);
+  bool diff = PcapFile::Diff (m_testFilename, m_testFilename + "-swapped", sec, usec, packets);
+  NS_TEST_EXPECT_MSG_EQ (diff, false, "Same records in both byte orders");
+  NS_TEST_EXPECT_MSG_EQ (packets, records, "Wrong number of records compared");
+  diff = PcapFile::Diff (shared, shared, sec, usec, packets);
+  NS_TEST_EXPECT_MSG_EQ (diff, false, "PcapDiff(file, file) must always be false");
+
+  std::string shorter = m_testFilename + "-shorter";
+  WritePcap (shorter, false, 250);
+  packets = 0;
+  diff = PcapFile::Diff (m_testFilename, shorter, sec, usec, packets);
+  NS_TEST_EXPECT_MSG_EQ (diff, true, "Files with a different number of records are different");
+  NS_TEST_EXPECT_MSG_EQ (packets, 250, "Wrong number of records compared");
+
+  FILE *p = std::fopen (shorter.c_str (), "r+b");
+  NS_TEST_ASSERT_MSG_NE (p, 0, "Unable to open " << shorter);
+  std::fseek (p, 0, SEEK_END);
+  long length = std::ftell (p);
+  std::fclose (p);
+  NS_TEST_ASSERT_MSG_EQ (truncate (shorter.c_str (), length - 5), 0, "Unable to truncate " << shorter);
+  reader.Open (shorter);
+  PcapReader::Record record;
+  uint32_t n = 0;
+  while (reader.Read (&record))
+    {
+      n++;
+    }
+  NS_TEST_EXPECT_MSG_EQ (n, 249, "Wrong number of complete records");
+  NS_TEST_EXPECT_MSG_EQ (reader.Fail (), true, "Truncated record not detected");
+}
+
+// ===========================================================================
+// Test case to make sure that the PcapReplay sends the records of a file
+// to a device or to a socket, with their timing.
+// ===========================================================================
+class ReplayTestCase : public TestCase
+{
+public:
+  ReplayTestCase ();
+  virtual ~ReplayTestCase ();
+
+private:
+  virtual void DoSetup (void);
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+
+  bool Receive (Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t protocol, const Address &from);
+  void Replay (Ptr<PcapReplay> replay, uint32_t offset, double timeScale);
+
+  std::string m_testFilename;
+  Mac48Address m_source;
+  std::vector<Time> m_times;
+  std::vector<Ptr<const Packet> > m_packets;
+  std::vector<uint16_t> m_protocols;
+  std::vector<Mac48Address> m_sources;
+};
+
+ReplayTestCase::ReplayTestCase ()
+  : TestCase ("Check that the PcapReplay sends the records with their timing")
+{
+}
+
+ReplayTestCase::~ReplayTestCase ()
+{
+}
+
+void
+ReplayTestCase::DoSetup (void)
+{
+  std::stringstream filename;
+  uint32_t n = rand ();
+  filename << n;
+  m_testFilename = CreateTempDirFilename (filename.str () + ".pcap");
+}
+
+void
+ReplayTestCase::DoTeardown (void)
+{
+  if (remove (m_testFilename.c_str ()))
+    {
+      NS_LOG_ERROR ("Failed to delete file " << m_testFilename);
+    }
+}
+
+bool
+ReplayTestCase::Receive (Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t protocol, const Address &from)
+{
+  m_times.push_back (Simulator::Now ());
+  m_packets.push_back (p);
+  m_protocols.push_back (protocol);
+  m_sources.push_back (Mac48Address::ConvertFrom (from));
+  return true;
+}
+
+void
+ReplayTestCase::Replay (Ptr<PcapReplay> replay, uint32_t offset, double timeScale)
+{
+  const uint32_t records = 50;
+  m_times.clear ();
+  m_packets.clear ();
+  m_protocols.clear ();
+  m_sources.clear ();
+  replay->SetStartTime (Seconds (1));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_packets.size (), records, "Wrong number of records received");
+  NS_TEST_EXPECT_MSG_EQ (replay->GetSent (), records, "Wrong number of records sent");
+  for (uint32_t i = 0; i < records; i++)
+    {
+      Time expected = Seconds (1) + NanoSeconds (static_cast<int64_t> (i * 1000000 * timeScale));
+      NS_TEST_EXPECT_MSG_EQ (m_times[i], expected, "Record " << i << " received at the wrong time");
+      uint8_t data[256];
+      uint8_t expectedData[256];
+      uint32_t size;
+      FillRecord (i, expectedData, &size);
+      NS_TEST_EXPECT_MSG_EQ (m_packets[i]->GetSize (), size - offset, "Wrong size of record " << i);
+      m_packets[i]->CopyData (data, sizeof (data));
+      NS_TEST_EXPECT_MSG_EQ (std::memcmp (data, expectedData + offset, size - offset), 0,
+                             "Wrong data in record " << i);
+    }
+  Simulator::Destroy ();
+}
+
+void
+ReplayTestCase::DoRun (void)
+{
+  const uint32_t records = 50;
+
+  NodeContainer nodes;
+  nodes.Create (2);
+  PacketSocketHelper packetSocket;
+  packetSocket.Install (nodes);
+  Ptr<SimpleNetDevice> txDev = CreateObject<SimpleNetDevice> ();
+  Ptr<SimpleNetDevice> rxDev = CreateObject<SimpleNetDevice> ();
+  txDev->SetAddress (Mac48Address::Allocate ());
+  rxDev->SetAddress (Mac48Address::Allocate ());
+  nodes.Get (0)->AddDevice (txDev);
+  nodes.Get (1)->AddDevice (rxDev);
+  Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+  txDev->SetChannel (channel);
+  rxDev->SetChannel (channel);
+  rxDev->SetReceiveCallback (MakeCallback (&ReplayTestCase::Receive, this));
+
+  //
+  // Ethernet frames to the receiver, one every millisecond from a
+  // capture source address.
+  //
+  m_source = Mac48Address ("00:00:00:00:0a:0b");
+  PcapFile f;
+  f.Open (m_testFilename, std::ios::out);
+  NS_TEST_ASSERT_MSG_EQ (f.Fail (), false, "Open (" << m_testFilename << ", \"std::ios::out\") returns error");
+  f.Init (1);
+  for (uint32_t i = 0; i < records; i++)
+    {
+      uint8_t data[256];
+      uint32_t size;
+      FillRecord (i, data, &size);
+      Mac48Address::ConvertFrom (rxDev->GetAddress ()).CopyTo (data);
+      m_source.CopyTo (data + 6);
+      data[12] = 0x08;
+      data[13] = 0x00;
+      f.Write (1000, i * 1000, data, size);
+    }
+  f.Close ();
+
+  //
+  // To the device, twice as fast as the capture: the Ethernet header
+  // gives the addresses and the protocol.
+  //
+  Ptr<PcapReplay> replay = CreateObject<PcapReplay> ();
+  replay->SetAttribute ("File", StringValue (m_testFilename));
+  replay->SetAttribute ("TimeScale", DoubleValue (0.5));
+  replay->SetDevice (txDev);
+  nodes.Get (0)->AddApplication (replay);
+  Replay (replay, 14, 0.5);
+  for (uint32_t i = 0; i < m_protocols.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_protocols[i], 0x0800, "Wrong protocol of record " << i);
+      NS_TEST_EXPECT_MSG_EQ (m_sources[i], m_source, "Wrong source of record " << i);
+    }
+
+  //
+  // To a packet socket, with the timing of the capture, from an offset.
+  //
+  nodes = NodeContainer ();
+  nodes.Create (2);
+  packetSocket.Install (nodes);
+  txDev = CreateObject<SimpleNetDevice> ();
+  rxDev = CreateObject<SimpleNetDevice> ();
+  txDev->SetAddress (Mac48Address::Allocate ());
+  rxDev->SetAddress (Mac48Address::Allocate ());
+  nodes.Get (0)->AddDevice (txDev);
+  nodes.Get (1)->AddDevice (rxDev);
+  channel = CreateObject<SimpleChannel> ();
+  txDev->SetChannel (channel);
+  rxDev->SetChannel (channel);
+  rxDev->SetReceiveCallback (MakeCallback (&ReplayTestCase::Receive, this));
+  PacketSocketAddress remote;
+  remote.SetSingleDevice (txDev->GetIfIndex ());
+  remote.SetPhysicalAddress (rxDev->GetAddress ());
+  remote.SetProtocol (0x86dd);
+  replay = CreateObject<PcapReplay> ();
+  replay->SetAttribute ("File", StringValue (m_testFilename));
+  replay->SetAttribute ("Offset", UintegerValue (20));
+  replay->SetAttribute ("Remote", AddressValue (remote));
+  nodes.Get (0)->AddApplication (replay);
+  Replay (replay, 20, 1.0);
+  for (uint32_t i = 0; i < m_protocols.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_protocols[i], 0x86dd, "Wrong protocol of record " << i);
+    }
+}
+
 class PcapFileTestSuite : public TestSuite
 {
 public:
@@ -1138,6 +1842,9 @@ PcapFileTestSuite::PcapFileTestSuite ()
   AddTestCase (new RecordHeaderTestCase, TestCase::QUICK);
   AddTestCase (new ReadFileTestCase, TestCase::QUICK);
   AddTestCase (new DiffTestCase, TestCase::QUICK);
+  AddTestCase (new WriterTestCase, TestCase::QUICK);
+  AddTestCase (new ReaderTestCase, TestCase::QUICK);
+  AddTestCase (new ReplayTestCase, TestCase::QUICK);
 }
 
 static PcapFileTestSuite pcapFileTestSuite;
@@ -0,0 +1,174 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/ethernet-header.h"
+#include "ns3/llc-snap-header.h"
+#include "ns3/trace-helper.h"
+
+using namespace ns3;
+
+// ===========================================================================
+// Check that the default ascii trace sinks write the lines that the
+// std::ostream operators write, at times which exercise the formatting of
+// the seconds: exponents, ties and carries.
+// ===========================================================================
+class AsciiTraceLineTestCase : public TestCase
+{
+public:
+  AsciiTraceLineTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Trace a packet with every default sink, and write the expected lines.
+   * \param p The packet.
+   */
+  void Trace (Ptr<const Packet> p);
+
+  std::ostringstream m_trace;    //!< lines of the default sinks
+  std::ostringstream m_expected; //!< lines of the std::ostream operators
+  std::ostringstream m_precise;  //!< lines with a precision of 9
+};
+
+AsciiTraceLineTestCase::AsciiTraceLineTestCase ()
+  : TestCase ("Check the lines of the default ascii trace sinks")
+{
+}
+
+void
+AsciiTraceLineTestCase::Trace (Ptr<const Packet> p)
+{
+  Ptr<OutputStreamWrapper> stream = Create<OutputStreamWrapper> (&m_trace);
+  std::string context = "/NodeList/0/DeviceList/1";
+  AsciiTraceHelper::DefaultEnqueueSinkWithoutContext (stream, p);
+  AsciiTraceHelper::DefaultDequeueSinkWithContext (stream, context, p);
+  AsciiTraceHelper::DefaultDropSinkWithoutContext (stream, p);
+  AsciiTraceHelper::DefaultReceiveSinkWithContext (stream, context, p);
+
+  double now = Simulator::Now ().GetSeconds ();
+  m_expected << "+ " << now << " " << *p << std::endl;
+  m_expected << "- " << now << " " << context << " " << *p << std::endl;
+  m_expected << "d " << now << " " << *p << std::endl;
+  m_expected << "r " << now << " " << context << " " << *p << std::endl;
+
+  AsciiTraceHelper::DefaultEnqueueSinkWithoutContext (Create<OutputStreamWrapper> (&m_precise), p);
+}
+
+void
+AsciiTraceLineTestCase::DoRun (void)
+{
+  std::vector<uint64_t> times;
+  uint64_t const fixed[] = {
+    0, 1, 999, 99999, 100000, 123456, 999999, 1000000, 1000000000,
+    1000000500, 1000000501, 1000000499, 1999999500, 9999995000ULL,
+    9999996000ULL, 99999950000ULL, 99999960000ULL, 123456789012ULL,
+    999999500000000ULL, 999999600000000ULL, 1000000000000000ULL
+  };
+  times.insert (times.end (), fixed, fixed + sizeof (fixed) / sizeof (fixed[0]));
+  // times of every magnitude, with random digits
+  uint64_t x = 1;
+  for (uint32_t i = 0; i < 2000; i++)
+    {
+      x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+      uint64_t scale = 1;
+      for (uint32_t j = 0; j < i % 16; j++)
+        {
+          scale *= 10;
+        }
+      times.push_back ((x >> 20) % scale);
+    }
+
+  m_precise.precision (9);
+  Ptr<Packet> p = Create<Packet> (100);
+  for (std::vector<uint64_t>::const_iterator i = times.begin (); i != times.end (); ++i)
+    {
+      Simulator::Schedule (NanoSeconds (*i), &AsciiTraceLineTestCase::Trace, this, p);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_trace.str (), m_expected.str (), "The lines differ");
+
+  std::ostringstream precise;
+  precise.precision (9);
+  std::sort (times.begin (), times.end ());
+  for (std::vector<uint64_t>::const_iterator i = times.begin (); i != times.end (); ++i)
+    {
+      precise << "+ " << NanoSeconds (*i).GetSeconds () << " " << *p << std::endl;
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_precise.str (), precise.str (), "The format of the stream is not used");
+}
+
+// ===========================================================================
+// Check the summary of the headers.
+// ===========================================================================
+class AsciiTraceHeaderSummaryTestCase : public TestCase
+{
+public:
+  AsciiTraceHeaderSummaryTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AsciiTraceHeaderSummaryTestCase::AsciiTraceHeaderSummaryTestCase ()
+  : TestCase ("Check the summary of the headers in the ascii traces")
+{
+}
+
+void
+AsciiTraceHeaderSummaryTestCase::DoRun (void)
+{
+  PacketMetadata::Enable ();
+
+  Ptr<Packet> p = Create<Packet> (100);
+  p->AddHeader (LlcSnapHeader ());
+  p->AddHeader (EthernetHeader ());
+  Ptr<Packet> fragment = p->CreateFragment (10, 20);
+
+  std::ostringstream summary;
+  AsciiTraceHelper::SetHeaderSummary (true);
+  AsciiTraceHelper::DefaultEnqueueSinkWithoutContext (Create<OutputStreamWrapper> (&summary), p);
+  AsciiTraceHelper::DefaultEnqueueSinkWithoutContext (Create<OutputStreamWrapper> (&summary), fragment);
+  AsciiTraceHelper::SetHeaderSummary (false);
+
+  NS_TEST_EXPECT_MSG_EQ (summary.str (),
+                         "+ 0 ns3::EthernetHeader (size=14) ns3::LlcSnapHeader (size=8) Payload (size=100)\n"
+                         "+ 0 ns3::EthernetHeader Fragment [10:14] ns3::LlcSnapHeader (size=8) Payload Fragment [0:8]\n",
+                         "Wrong summary");
+}
+
+class TraceHelperTestSuite : public TestSuite
+{
+public:
+  TraceHelperTestSuite ();
+};
+
+TraceHelperTestSuite::TraceHelperTestSuite ()
+  : TestSuite ("trace-helper", UNIT)
+{
+  // first, to enable the metadata before any header is added
+  AddTestCase (new AsciiTraceHeaderSummaryTestCase, TestCase::QUICK);
+  AddTestCase (new AsciiTraceLineTestCase, TestCase::QUICK);
+}
+
+static TraceHelperTestSuite g_traceHelperTestSuite;
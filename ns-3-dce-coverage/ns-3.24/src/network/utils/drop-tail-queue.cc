@@ -16,6 +16,7 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
 #include "ns3/log.h"
 #include "ns3/enum.h"
 #include "ns3/uinteger.h"
@@ -55,10 +56,19 @@ TypeId DropTailQueue::GetTypeId (void)
   return tid;
 }
 
+namespace {
+
+/// The packets for which the ring is sized at first, at most
+const uint32_t PRESIZE_MAX_PACKETS = 1024;
+/// The packets for which the ring is sized at first, in bytes mode
+const uint32_t PRESIZE_BYTES_MODE = 64;
+
+} // anonymous namespace
+
 DropTailQueue::DropTailQueue () :
   Queue (),
-  m_packets (),
-  m_bytesInQueue (0)
+  m_ring (),
+  m_head (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -82,30 +92,62 @@ DropTailQueue::GetMode (void) const
   return m_mode;
 }
 
+void
+DropTailQueue::Grow (void)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t capacity = m_ring.size ();
+  uint32_t size;
+  if (capacity == 0)
+    {
+      size = m_mode == QUEUE_MODE_PACKETS
+        ? std::min (std::max (m_maxPackets, 1U), PRESIZE_MAX_PACKETS)
+        : PRESIZE_BYTES_MODE;
+    }
+  else
+    {
+      size = capacity * 2;
+    }
+  // unwrap the packets at the start of the new ring.
+  std::vector<Ptr<Packet> > ring (size);
+  for (uint32_t i = 0; i < m_nPackets; i++)
+    {
+      uint32_t j = m_head + i;
+      ring[i] = m_ring[j < capacity ? j : j - capacity];
+    }
+  m_ring.swap (ring);
+  m_head = 0;
+}
+
 bool 
 DropTailQueue::DoEnqueue (Ptr<Packet> p)
 {
   NS_LOG_FUNCTION (this << p);
 
-  if (m_mode == QUEUE_MODE_PACKETS && (m_packets.size () >= m_maxPackets))
+  // m_nPackets and m_nBytes do not count p yet.
+  if (m_mode == QUEUE_MODE_PACKETS && (m_nPackets >= m_maxPackets))
     {
       NS_LOG_LOGIC ("Queue full (at max packets) -- droppping pkt");
       Drop (p);
       return false;
     }
 
-  if (m_mode == QUEUE_MODE_BYTES && (m_bytesInQueue + p->GetSize () >= m_maxBytes))
+  if (m_mode == QUEUE_MODE_BYTES && (m_nBytes + p->GetSize () >= m_maxBytes))
     {
       NS_LOG_LOGIC ("Queue full (packet would exceed max bytes) -- droppping pkt");
       Drop (p);
       return false;
     }
 
-  m_bytesInQueue += p->GetSize ();
-  m_packets.push (p);
+  if (m_nPackets == m_ring.size ())
+    {
+      Grow ();
+    }
+  uint32_t tail = m_head + m_nPackets;
+  m_ring[tail < m_ring.size () ? tail : tail - m_ring.size ()] = p;
 
-  NS_LOG_LOGIC ("Number packets " << m_packets.size ());
-  NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
+  NS_LOG_LOGIC ("Number packets " << m_nPackets + 1);
+  NS_LOG_LOGIC ("Number bytes " << m_nBytes + p->GetSize ());
 
   return true;
 }
@@ -115,39 +157,64 @@ DropTailQueue::DoDequeue (void)
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_packets.empty ())
+  if (m_nPackets == 0)
     {
       NS_LOG_LOGIC ("Queue empty");
       return 0;
     }
 
-  Ptr<Packet> p = m_packets.front ();
-  m_packets.pop ();
-  m_bytesInQueue -= p->GetSize ();
+  Ptr<Packet> p = 0;
+  std::swap (p, m_ring[m_head]);
+  if (++m_head == m_ring.size ())
+    {
+      m_head = 0;
+    }
 
   NS_LOG_LOGIC ("Popped " << p);
 
-  NS_LOG_LOGIC ("Number packets " << m_packets.size ());
-  NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
+  NS_LOG_LOGIC ("Number packets " << m_nPackets - 1);
+  NS_LOG_LOGIC ("Number bytes " << m_nBytes - p->GetSize ());
 
   return p;
 }
 
+uint32_t
+DropTailQueue::DoDequeueBurst (std::vector<Ptr<Packet> > *packets, uint32_t maxPackets)
+{
+  NS_LOG_FUNCTION (this << maxPackets);
+
+  uint32_t n = std::min (maxPackets, m_nPackets);
+  packets->reserve (packets->size () + n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      packets->push_back (0);
+      std::swap (packets->back (), m_ring[m_head]);
+      if (++m_head == m_ring.size ())
+        {
+          m_head = 0;
+        }
+    }
+
+  NS_LOG_LOGIC ("Popped " << n << " packets");
+
+  return n;
+}
+
 Ptr<const Packet>
 DropTailQueue::DoPeek (void) const
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_packets.empty ())
+  if (m_nPackets == 0)
     {
       NS_LOG_LOGIC ("Queue empty");
       return 0;
     }
 
-  Ptr<Packet> p = m_packets.front ();
+  Ptr<Packet> p = m_ring[m_head];
 
-  NS_LOG_LOGIC ("Number packets " << m_packets.size ());
-  NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
+  NS_LOG_LOGIC ("Number packets " << m_nPackets);
+  NS_LOG_LOGIC ("Number bytes " << m_nBytes);
 
   return p;
 }
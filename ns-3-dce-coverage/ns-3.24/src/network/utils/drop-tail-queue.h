@@ -19,7 +19,7 @@
 #ifndef DROPTAIL_H
 #define DROPTAIL_H
 
-#include <queue>
+#include <vector>
 #include "ns3/packet.h"
 #include "ns3/queue.h"
 
@@ -31,6 +31,11 @@ class TraceContainer;
  * \ingroup queue
  *
  * \brief A FIFO packet queue that drops tail-end packets on overflow
+ *
+ * The packets are kept in a ring, sized for MaxPackets (up to 1024
+ * packets) when the first packet is enqueued, and which doubles when it
+ * is full: a busy queue allocates nothing. The number of packets and
+ * bytes are those counted by Queue.
  */
 class DropTailQueue : public Queue {
 public:
@@ -67,11 +72,17 @@ private:
   virtual bool DoEnqueue (Ptr<Packet> p);
   virtual Ptr<Packet> DoDequeue (void);
   virtual Ptr<const Packet> DoPeek (void) const;
+  virtual uint32_t DoDequeueBurst (std::vector<Ptr<Packet> > *packets, uint32_t maxPackets);
+
+  /**
+   * Make room in the ring for one more packet than it holds.
+   */
+  void Grow (void);
 
-  std::queue<Ptr<Packet> > m_packets; //!< the packets in the queue
+  std::vector<Ptr<Packet> > m_ring;   //!< the packets in the queue, from m_head
+  uint32_t m_head;                    //!< index of the first packet in the ring
   uint32_t m_maxPackets;              //!< max packets in the queue
   uint32_t m_maxBytes;                //!< max bytes in the queue
-  uint32_t m_bytesInQueue;            //!< actual bytes in the queue
   QueueMode m_mode;                   //!< queue mode (packets or bytes limited)
 };
 
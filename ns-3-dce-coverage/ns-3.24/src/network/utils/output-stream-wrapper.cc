@@ -21,25 +21,60 @@
 #include "ns3/fatal-impl.h"
 #include "ns3/abort.h"
 #include <fstream>
+#include <set>
+#include <cstdlib>
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("OutputStreamWrapper");
 
+namespace {
+
+/**
+ * The files opened by the wrappers, flushed when the program exits: a
+ * wrapper kept alive by a leaked trace source would otherwise lose its
+ * last block.  Allocated once and never deleted, so that the wrappers
+ * destroyed during the static destruction can still unregister.
+ */
+std::set<std::ostream *> *g_files = 0;
+
+/**
+ * Flush the files still open.
+ */
+void
+FlushFiles (void)
+{
+  for (std::set<std::ostream *>::iterator i = g_files->begin (); i != g_files->end (); ++i)
+    {
+      (*i)->flush ();
+    }
+}
+
+} // anonymous namespace
+
 OutputStreamWrapper::OutputStreamWrapper (std::string filename, std::ios::openmode filemode)
-  : m_destroyable (true)
+  : m_destroyable (true),
+    m_buffer (new char[BUFFER_SIZE])
 {
   NS_LOG_FUNCTION (this << filename << filemode);
   std::ofstream* os = new std::ofstream ();
+  // the buffer must be given before the file is opened.
+  os->rdbuf ()->pubsetbuf (m_buffer, BUFFER_SIZE);
   os->open (filename.c_str (), filemode);
   m_ostream = os;
   FatalImpl::RegisterStream (m_ostream);
+  if (g_files == 0)
+    {
+      g_files = new std::set<std::ostream *> ();
+      std::atexit (&FlushFiles);
+    }
+  g_files->insert (m_ostream);
   NS_ABORT_MSG_UNLESS (os->is_open (), "AsciiTraceHelper::CreateFileStream():  " <<
                        "Unable to Open " << filename << " for mode " << filemode);
 }
 
 OutputStreamWrapper::OutputStreamWrapper (std::ostream* os)
-  : m_ostream (os), m_destroyable (false)
+  : m_ostream (os), m_destroyable (false), m_buffer (0)
 {
   NS_LOG_FUNCTION (this << os);
   FatalImpl::RegisterStream (m_ostream);
@@ -50,7 +85,13 @@ OutputStreamWrapper::~OutputStreamWrapper ()
 {
   NS_LOG_FUNCTION (this);
   FatalImpl::UnregisterStream (m_ostream);
-  if (m_destroyable) delete m_ostream;
+  if (m_destroyable)
+    {
+      g_files->erase (m_ostream);
+      delete m_ostream;
+    }
+  // the file was closed by its destructor, the buffer is no longer used.
+  delete [] m_buffer;
   m_ostream = 0;
 }
 
@@ -64,12 +64,27 @@ namespace ns3 {
  * \endverbatim
  *
  *
+ * The files opened by the wrapper are written by blocks of
+ * BUFFER_SIZE bytes: a line ended by '\n' rather than std::endl costs no
+ * system call.  The blocks left are written when the wrapper is
+ * destroyed, when the program exits, and on the errors reported by
+ * NS_FATAL_ERROR, NS_ABORT and NS_ASSERT.  They are lost if the program
+ * crashes otherwise, for instance on a segmentation fault, an uncaught
+ * exception or a direct call to abort: to debug such a crash, write
+ * every output at once with
+ * \verbatim
+ *   stream->GetStream ()->setf (std::ios::unitbuf);
+ * \endverbatim
+ *
  * This class uses a basic ns-3 reference counting base class but is not 
  * an ns3::Object with attributes, TypeId, or aggregation.
  */
 class OutputStreamWrapper : public SimpleRefCount<OutputStreamWrapper>
 {
 public:
+  /// The size of the blocks written to the files
+  static const uint32_t BUFFER_SIZE = 65536;
+
   /**
    * Constructor
    * \param filename file name
@@ -95,6 +110,7 @@ public:
 private:
   std::ostream *m_ostream; //!< The output stream
   bool m_destroyable; //!< Can be destroyed
+  char *m_buffer; //!< The buffer of the file, if any
 };
 
 } // namespace ns3
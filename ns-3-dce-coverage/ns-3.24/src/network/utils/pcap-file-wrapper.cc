@@ -18,6 +18,8 @@
 
 #include "ns3/log.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
 #include "ns3/buffer.h"
 #include "ns3/header.h"
 #include "pcap-file-wrapper.h"
@@ -40,12 +42,51 @@ PcapFileWrapper::GetTypeId (void)
                    UintegerValue (PcapFile::SNAPLEN_DEFAULT),
                    MakeUintegerAccessor (&PcapFileWrapper::m_snapLen),
                    MakeUintegerChecker<uint32_t> (0, PcapFile::SNAPLEN_DEFAULT))
+    .AddAttribute ("Format",
+                   "Format of the files written",
+                   EnumValue (PcapWriter::PCAP),
+                   MakeEnumAccessor (&PcapFileWrapper::m_format),
+                   MakeEnumChecker (PcapWriter::PCAP, "Pcap",
+                                    PcapWriter::PCAPNG, "PcapNg"))
+    .AddAttribute ("Compression",
+                   "Compression of the files written (Gzip appends .gz to their name)",
+                   EnumValue (PcapWriter::NONE),
+                   MakeEnumAccessor (&PcapFileWrapper::m_compression),
+                   MakeEnumChecker (PcapWriter::NONE, "None",
+                                    PcapWriter::GZIP, "Gzip"))
+    .AddAttribute ("Asynchronous",
+                   "Write the records on a thread of their own",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PcapFileWrapper::m_asynchronous),
+                   MakeBooleanChecker ())
+    .AddAttribute ("BlockSize",
+                   "Size of the blocks of records written at once, when "
+                   "the file is written by blocks",
+                   UintegerValue (1 << 20),
+                   MakeUintegerAccessor (&PcapFileWrapper::m_blockSize),
+                   MakeUintegerChecker<uint32_t> (4096))
+    .AddAttribute ("MaxBlocks",
+                   "Number of full blocks which may wait for the thread "
+                   "before the simulation waits for it",
+                   UintegerValue (8),
+                   MakeUintegerAccessor (&PcapFileWrapper::m_maxBlocks),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MaxFileSize",
+                   "Size, before compression, beyond which the records go "
+                   "to a new file (name.1, name.2...), 0 for no limit",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PcapFileWrapper::m_maxFileSize),
+                   MakeUintegerChecker<uint64_t> ())
   ;
   return tid;
 }
 
 
 PcapFileWrapper::PcapFileWrapper ()
+  : m_interface (0),
+    m_dataLinkType (0),
+    m_writerSnapLen (0),
+    m_zone (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -57,10 +98,21 @@ PcapFileWrapper::~PcapFileWrapper ()
 }
 
 
+bool
+PcapFileWrapper::UseWriter (void) const
+{
+  return m_format != PcapWriter::PCAP || m_compression != PcapWriter::NONE ||
+         m_asynchronous || m_maxFileSize != 0;
+}
+
 bool 
 PcapFileWrapper::Fail (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      return m_writer->Fail ();
+    }
   return m_file.Fail ();
 }
 bool 
@@ -80,6 +132,8 @@ void
 PcapFileWrapper::Close (void)
 {
   NS_LOG_FUNCTION (this);
+  // the last wrapper of the file closes it.
+  m_writer = 0;
   m_file.Close ();
 }
 
@@ -87,6 +141,18 @@ void
 PcapFileWrapper::Open (std::string const &filename, std::ios::openmode mode)
 {
   NS_LOG_FUNCTION (this << filename << mode);
+  if ((mode & std::ios::out) && !(mode & std::ios::in) && UseWriter ())
+    {
+      struct PcapWriter::Options options;
+      options.format = m_format;
+      options.compression = m_compression;
+      options.asynchronous = m_asynchronous;
+      options.blockSize = m_blockSize;
+      options.maxBlocks = m_maxBlocks;
+      options.maxFileSize = m_maxFileSize;
+      m_writer = PcapWriter::Open (filename, options);
+      return;
+    }
   m_file.Open (filename, mode);
 }
 
@@ -99,6 +165,14 @@ PcapFileWrapper::Init (uint32_t dataLinkType, uint32_t snapLen, int32_t tzCorrec
   // a snaplen, we use the one provided.
   //
   NS_LOG_FUNCTION (this << dataLinkType << snapLen << tzCorrection);
+  if (m_writer != 0)
+    {
+      m_dataLinkType = dataLinkType;
+      m_writerSnapLen = snapLen != std::numeric_limits<uint32_t>::max () ? snapLen : m_snapLen;
+      m_zone = tzCorrection;
+      m_interface = m_writer->AddInterface (m_dataLinkType, m_writerSnapLen, m_zone);
+      return;
+    }
   if (snapLen != std::numeric_limits<uint32_t>::max ())
     {
       m_file.Init (dataLinkType, snapLen, tzCorrection);
@@ -113,6 +187,11 @@ void
 PcapFileWrapper::Write (Time t, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (this << t << p);
+  if (m_writer != 0)
+    {
+      m_writer->Write (m_interface, t, 0, p, 0, 0);
+      return;
+    }
   uint64_t current = t.GetMicroSeconds ();
   uint64_t s = current / 1000000;
   uint64_t us = current % 1000000;
@@ -124,6 +203,11 @@ void
 PcapFileWrapper::Write (Time t, const Header &header, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (this << t << &header << p);
+  if (m_writer != 0)
+    {
+      m_writer->Write (m_interface, t, &header, p, 0, 0);
+      return;
+    }
   uint64_t current = t.GetMicroSeconds ();
   uint64_t s = current / 1000000;
   uint64_t us = current % 1000000;
@@ -135,6 +219,11 @@ void
 PcapFileWrapper::Write (Time t, uint8_t const *buffer, uint32_t length)
 {
   NS_LOG_FUNCTION (this << t << &buffer << length);
+  if (m_writer != 0)
+    {
+      m_writer->Write (m_interface, t, 0, 0, buffer, length);
+      return;
+    }
   uint64_t current = t.GetMicroSeconds ();
   uint64_t s = current / 1000000;
   uint64_t us = current % 1000000;
@@ -146,6 +235,10 @@ uint32_t
 PcapFileWrapper::GetMagic (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      return m_writer->GetFormat () == PcapWriter::PCAP ? 0xa1b2c3d4 : 0x0a0d0d0a;
+    }
   return m_file.GetMagic ();
 }
 
@@ -153,6 +246,10 @@ uint16_t
 PcapFileWrapper::GetVersionMajor (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      return m_writer->GetFormat () == PcapWriter::PCAP ? 2 : 1;
+    }
   return m_file.GetVersionMajor ();
 }
 
@@ -160,6 +257,10 @@ uint16_t
 PcapFileWrapper::GetVersionMinor (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      return m_writer->GetFormat () == PcapWriter::PCAP ? 4 : 0;
+    }
   return m_file.GetVersionMinor ();
 }
 
@@ -167,6 +268,10 @@ int32_t
 PcapFileWrapper::GetTimeZoneOffset (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      return m_zone;
+    }
   return m_file.GetTimeZoneOffset ();
 }
 
@@ -174,6 +279,10 @@ uint32_t
 PcapFileWrapper::GetSigFigs (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      return 0;
+    }
   return m_file.GetSigFigs ();
 }
 
@@ -181,6 +290,10 @@ uint32_t
 PcapFileWrapper::GetSnapLen (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      return m_writerSnapLen;
+    }
   return m_file.GetSnapLen ();
 }
 
@@ -188,6 +301,10 @@ uint32_t
 PcapFileWrapper::GetDataLinkType (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      return m_dataLinkType;
+    }
   return m_file.GetDataLinkType ();
 }
 
@@ -27,6 +27,7 @@
 #include "ns3/object.h"
 #include "ns3/nstime.h"
 #include "pcap-file.h"
+#include "pcap-writer.h"
 
 namespace ns3 {
 
@@ -35,6 +36,13 @@ namespace ns3 {
  * ns-3 interface to the low-level public methods of PcapFile.  Users are
  * encouraged to use this object instead of class ns3::PcapFile in ns-3
  * public APIs.
+ *
+ * A file opened for writing only goes through a PcapWriter instead of a
+ * PcapFile when the Format, Compression, Asynchronous or MaxFileSize
+ * attributes differ from their defaults. The records are then buffered
+ * by blocks of BlockSize bytes and, if Asynchronous, written by a thread
+ * of their own. The wrappers which open the same pcapng file share it,
+ * each with an interface of its own.
  */
 class PcapFileWrapper : public Object
 {
@@ -213,8 +221,25 @@ public:
   uint32_t GetDataLinkType (void);
 
 private:
+  /**
+   * \returns true if the files opened for writing go through a PcapWriter.
+   */
+  bool UseWriter (void) const;
+
   PcapFile m_file; //!< Pcap file
   uint32_t m_snapLen; //!< max length of saved packets
+
+  enum PcapWriter::Format m_format;           //!< format of the files written
+  enum PcapWriter::Compression m_compression; //!< compression of the files written
+  bool m_asynchronous;        //!< write on a thread
+  uint32_t m_blockSize;       //!< size of the blocks of records
+  uint32_t m_maxBlocks;       //!< blocks which may wait to be written
+  uint64_t m_maxFileSize;     //!< size of a file before the next one
+  Ptr<PcapWriter> m_writer;   //!< writer of the file, if any
+  uint32_t m_interface;       //!< our interface in the file of the writer
+  uint32_t m_dataLinkType;    //!< data link type given to the writer
+  uint32_t m_writerSnapLen;   //!< snap length given to the writer
+  int32_t m_zone;             //!< time zone given to the writer
 };
 
 } // namespace ns3
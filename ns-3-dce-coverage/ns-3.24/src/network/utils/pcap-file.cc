@@ -20,6 +20,7 @@
 
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 #include "ns3/assert.h"
 #include "ns3/packet.h"
 #include "ns3/fatal-error.h"
@@ -27,6 +28,7 @@
 #include "ns3/header.h"
 #include "ns3/buffer.h"
 #include "pcap-file.h"
+#include "pcap-reader.h"
 #include "ns3/log.h"
 #include "ns3/build-profile.h"
 //
@@ -502,78 +504,67 @@ PcapFile::Diff (std::string const & f1, std::string const & f2,
                 uint32_t snapLen)
 {
   NS_LOG_FUNCTION (f1 << f2 << sec << usec << snapLen);
-  PcapFile pcap1, pcap2;
-  pcap1.Open (f1, std::ios::in);
-  pcap2.Open (f2, std::ios::in);
+  //
+  // The files are mapped in memory and compared in place, record by record.
+  //
+  PcapReader pcap1, pcap2;
+  pcap1.Open (f1);
+  pcap2.Open (f2);
   bool bad = pcap1.Fail () || pcap2.Fail ();
   if (bad)
     {
       return true;
     }
 
-  uint8_t *data1 = new uint8_t [snapLen] ();
-  uint8_t *data2 = new uint8_t [snapLen] ();
-  uint32_t tsSec1 = 0;
-  uint32_t tsSec2 = 0;
-  uint32_t tsUsec1 = 0;
-  uint32_t tsUsec2 = 0;
-  uint32_t inclLen1 = 0;
-  uint32_t inclLen2 = 0;
-  uint32_t origLen1 = 0;
-  uint32_t origLen2 = 0;
-  uint32_t readLen1 = 0;
-  uint32_t readLen2 = 0;
+  PcapReader::Record record1, record2;
+  record1.timestamp = 0;
   bool diff = false;
 
-  while (!pcap1.Eof () && !pcap2.Eof ())
+  while (true)
     {
-      pcap1.Read (data1, snapLen, tsSec1, tsUsec1, inclLen1, origLen1, readLen1);
-      pcap2.Read (data2, snapLen, tsSec2, tsUsec2, inclLen2, origLen2, readLen2);
+      bool more1 = pcap1.Read (&record1);
+      bool more2 = pcap2.Read (&record2);
 
-      bool same = pcap1.Fail () == pcap2.Fail ();
-      if (!same)
+      if (more1 != more2)
         {
-          diff = true;
+          diff = true; // One file has more packets than the other
           break;
         }
-      if (pcap1.Eof ())
+      if (!more1)
         {
           break;
         }
 
       ++packets;
-      
-      if (tsSec1 != tsSec2 || tsUsec1 != tsUsec2)
+
+      if (record1.timestamp != record2.timestamp)
         {
           diff = true; // Next packet timestamps do not match
           break;
         }
 
+      uint32_t readLen1 = std::min (snapLen, record1.inclLen);
+      uint32_t readLen2 = std::min (snapLen, record2.inclLen);
       if (readLen1 != readLen2)
         {
           diff = true; // Packet lengths do not match
           break;
         }
 
-      if (std::memcmp (data1, data2, readLen1) != 0)
+      if (std::memcmp (record1.data, record2.data, readLen1) != 0)
         {
           diff = true; // Packet data do not match
           break;
         }
     }
-  sec = tsSec1;
-  usec = tsUsec1;
+  sec = record1.timestamp / 1000000000;
+  usec = (record1.timestamp % 1000000000) / 1000;
 
-  bad = pcap1.Fail () || pcap2.Fail ();
-  bool eof = pcap1.Eof () && pcap2.Eof ();
-  if (bad && !eof)
+  if (pcap1.Fail () || pcap2.Fail ())
     {
       diff = true;
     }
 
-  delete[] data1;
-  delete[] data2;
-
   return diff;
 }
 
@@ -264,6 +264,9 @@ public:
   /**
    * \brief Compare two PCAP files packet-by-packet
    * 
+   * The files are read in place by a PcapReader, and may be pcap or
+   * pcapng files.
+   *
    * \return true if files are different, false otherwise
    * 
    * \param  f1         First PCAP file name
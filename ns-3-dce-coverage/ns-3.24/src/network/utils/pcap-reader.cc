@@ -0,0 +1,509 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "pcap-reader.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("PcapReader");
+
+namespace {
+
+const uint32_t MAGIC = 0xa1b2c3d4;            //!< pcap, microsecond time stamps
+const uint32_t SWAPPED_MAGIC = 0xd4c3b2a1;    //!< the same, other byte order
+const uint32_t NS_MAGIC = 0xa1b23cd4;         //!< pcap, nanosecond time stamps
+const uint32_t NS_SWAPPED_MAGIC = 0xd43cb2a1; //!< the same, other byte order
+
+const uint32_t SHB_TYPE = 0x0a0d0d0a;         //!< pcapng Section Header Block
+const uint32_t BYTE_ORDER_MAGIC = 0x1a2b3c4d; //!< pcapng byte order magic
+const uint32_t SWAPPED_BYTE_ORDER_MAGIC = 0x4d3c2b1a; //!< the same, other byte order
+const uint32_t IDB_TYPE = 1;                  //!< pcapng Interface Description Block
+const uint32_t SPB_TYPE = 3;                  //!< pcapng Simple Packet Block
+const uint32_t EPB_TYPE = 6;                  //!< pcapng Enhanced Packet Block
+const uint16_t OPT_ENDOFOPT = 0;              //!< pcapng end of the options
+const uint16_t IF_TSRESOL = 9;                //!< pcapng time stamp resolution option
+
+const uint32_t PCAP_FILE_HEADER_SIZE = 24;    //!< size of the pcap file header
+const uint32_t PCAP_RECORD_HEADER_SIZE = 16;  //!< size of a pcap record header
+
+/// Swap the byte order of a 16 bit value
+inline uint16_t
+Swap16 (uint16_t v)
+{
+  return (v >> 8) | (v << 8);
+}
+/// Swap the byte order of a 32 bit value
+inline uint32_t
+Swap32 (uint32_t v)
+{
+  return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+
+} // anonymous namespace
+
+PcapReader::PcapReader ()
+  : m_data (0),
+    m_size (0),
+    m_mapped (false),
+    m_fail (true),
+    m_swapMode (false),
+    m_nanoSeconds (false),
+    m_format (PcapWriter::PCAP),
+    m_offset (0),
+    m_section (0),
+    m_seen (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PcapReader::~PcapReader ()
+{
+  NS_LOG_FUNCTION (this);
+  Close ();
+}
+
+inline uint16_t
+PcapReader::Get16 (uint8_t const *p) const
+{
+  uint16_t v;
+  std::memcpy (&v, p, 2);
+  return m_swapMode ? Swap16 (v) : v;
+}
+
+inline uint32_t
+PcapReader::Get32 (uint8_t const *p) const
+{
+  uint32_t v;
+  std::memcpy (&v, p, 4);
+  return m_swapMode ? Swap32 (v) : v;
+}
+
+void
+PcapReader::Open (std::string const &filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  Close ();
+  m_filename = filename;
+
+  int fd = ::open (filename.c_str (), O_RDONLY);
+  if (fd < 0)
+    {
+      NS_LOG_WARN ("Unable to open " << filename);
+      return;
+    }
+  struct stat st;
+  if (::fstat (fd, &st) != 0 || st.st_size < 4)
+    {
+      ::close (fd);
+      return;
+    }
+  m_size = st.st_size;
+  void *map = ::mmap (0, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map != MAP_FAILED)
+    {
+      m_data = static_cast<uint8_t *> (map);
+      m_mapped = true;
+      ::madvise (map, m_size, MADV_SEQUENTIAL);
+    }
+  else
+    {
+      // not a regular file: read it at once.
+      m_data = static_cast<uint8_t *> (std::malloc (m_size));
+      uint64_t done = 0;
+      while (m_data != 0 && done < m_size)
+        {
+          ssize_t n = ::read (fd, m_data + done, m_size - done);
+          if (n <= 0)
+            {
+              break;
+            }
+          done += n;
+        }
+      m_size = done;
+    }
+  ::close (fd);
+  if (m_data == 0 || m_size < 4)
+    {
+      return;
+    }
+
+  uint32_t magic;
+  std::memcpy (&magic, m_data, 4);
+  if (magic == MAGIC || magic == SWAPPED_MAGIC || magic == NS_MAGIC || magic == NS_SWAPPED_MAGIC)
+    {
+      if (m_size < PCAP_FILE_HEADER_SIZE)
+        {
+          return;
+        }
+      m_format = PcapWriter::PCAP;
+      m_swapMode = magic == SWAPPED_MAGIC || magic == NS_SWAPPED_MAGIC;
+      m_nanoSeconds = magic == NS_MAGIC || magic == NS_SWAPPED_MAGIC;
+      struct Interface interface;
+      interface.snapLen = Get32 (m_data + 16);
+      interface.dataLinkType = Get32 (m_data + 20);
+      interface.resolution = m_nanoSeconds ? 9 : 6;
+      m_interfaces.push_back (interface);
+      m_seen = 1;
+      m_offset = PCAP_FILE_HEADER_SIZE;
+      m_fail = false;
+    }
+  else if (magic == SHB_TYPE)
+    {
+      m_format = PcapWriter::PCAPNG;
+      if (!ReadSection ())
+        {
+          return;
+        }
+      m_fail = false;
+      // the interfaces described before the first record.
+      ReadPcapNg (0);
+    }
+  else
+    {
+      NS_LOG_WARN (filename << " is not a pcap file");
+    }
+}
+
+void
+PcapReader::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_data != 0)
+    {
+      if (m_mapped)
+        {
+          ::munmap (m_data, m_size);
+        }
+      else
+        {
+          std::free (m_data);
+        }
+    }
+  m_data = 0;
+  m_size = 0;
+  m_mapped = false;
+  m_fail = true;
+  m_swapMode = false;
+  m_nanoSeconds = false;
+  m_format = PcapWriter::PCAP;
+  m_offset = 0;
+  m_interfaces.clear ();
+  m_section = 0;
+  m_seen = 0;
+}
+
+bool
+PcapReader::Fail (void) const
+{
+  return m_fail;
+}
+
+enum PcapWriter::Format
+PcapReader::GetFormat (void) const
+{
+  return m_format;
+}
+
+bool
+PcapReader::GetSwapMode (void) const
+{
+  return m_swapMode;
+}
+
+uint32_t
+PcapReader::GetNInterfaces (void) const
+{
+  return m_interfaces.size ();
+}
+
+uint32_t
+PcapReader::GetDataLinkType (uint32_t interface) const
+{
+  NS_ASSERT (interface < m_interfaces.size ());
+  return m_interfaces[interface].dataLinkType;
+}
+
+uint32_t
+PcapReader::GetSnapLen (uint32_t interface) const
+{
+  NS_ASSERT (interface < m_interfaces.size ());
+  return m_interfaces[interface].snapLen;
+}
+
+bool
+PcapReader::Read (struct Record *record)
+{
+  if (m_fail)
+    {
+      return false;
+    }
+  if (m_format == PcapWriter::PCAP)
+    {
+      return ReadPcap (record);
+    }
+  return ReadPcapNg (record);
+}
+
+void
+PcapReader::Rewind (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_data == 0)
+    {
+      return;
+    }
+  if (m_format == PcapWriter::PCAP)
+    {
+      if (!m_interfaces.empty ())
+        {
+          m_offset = PCAP_FILE_HEADER_SIZE;
+          m_fail = false;
+        }
+      return;
+    }
+  // from the first section, which gives the byte order again.
+  m_offset = 0;
+  m_seen = 0;
+  m_fail = !ReadSection ();
+  if (!m_fail)
+    {
+      ReadPcapNg (0);
+    }
+}
+
+bool
+PcapReader::ReadPcap (struct Record *record)
+{
+  if (m_offset + PCAP_RECORD_HEADER_SIZE > m_size)
+    {
+      // a partial record header is a truncated file.
+      m_fail = m_offset != m_size;
+      return false;
+    }
+  uint8_t const *header = m_data + m_offset;
+  uint32_t tsSec = Get32 (header);
+  uint32_t tsFraction = Get32 (header + 4);
+  record->interface = 0;
+  record->timestamp = tsSec * UINT64_C (1000000000) + tsFraction * (m_nanoSeconds ? 1 : 1000);
+  record->inclLen = Get32 (header + 8);
+  record->origLen = Get32 (header + 12);
+  record->data = header + PCAP_RECORD_HEADER_SIZE;
+  if (record->inclLen > m_size - m_offset - PCAP_RECORD_HEADER_SIZE)
+    {
+      NS_LOG_WARN ("Truncated record in " << m_filename);
+      m_fail = true;
+      return false;
+    }
+  m_offset += PCAP_RECORD_HEADER_SIZE + record->inclLen;
+  return true;
+}
+
+bool
+PcapReader::ReadSection (void)
+{
+  if (m_offset + 28 > m_size)
+    {
+      return false;
+    }
+  uint32_t bom;
+  std::memcpy (&bom, m_data + m_offset + 8, 4);
+  if (bom != BYTE_ORDER_MAGIC && bom != SWAPPED_BYTE_ORDER_MAGIC)
+    {
+      NS_LOG_WARN ("Bad byte order magic in " << m_filename);
+      return false;
+    }
+  m_swapMode = bom == SWAPPED_BYTE_ORDER_MAGIC;
+  if (Get16 (m_data + m_offset + 12) != 1)
+    {
+      NS_LOG_WARN ("Unknown pcapng version in " << m_filename);
+      return false;
+    }
+  uint32_t length = Get32 (m_data + m_offset + 4);
+  if (length < 28 || length % 4 != 0 || length > m_size - m_offset)
+    {
+      return false;
+    }
+  // the interfaces of the section are numbered from here.
+  m_section = m_seen;
+  m_offset += length;
+  return true;
+}
+
+void
+PcapReader::ReadInterfaceOptions (uint8_t const *options, uint8_t const *end,
+                                  struct Interface *interface) const
+{
+  while (options + 4 <= end)
+    {
+      uint16_t code = Get16 (options);
+      uint16_t length = Get16 (options + 2);
+      if (code == OPT_ENDOFOPT || options + 4 + length > end)
+        {
+          break;
+        }
+      if (code == IF_TSRESOL && length >= 1)
+        {
+          interface->resolution = options[4];
+        }
+      options += 4 + ((length + 3) & ~3);
+    }
+}
+
+uint64_t
+PcapReader::ToNanoSeconds (struct Interface const &interface, uint64_t ts)
+{
+  static const uint64_t powers[] = {
+    UINT64_C (1), UINT64_C (10), UINT64_C (100), UINT64_C (1000), UINT64_C (10000),
+    UINT64_C (100000), UINT64_C (1000000), UINT64_C (10000000), UINT64_C (100000000),
+    UINT64_C (1000000000)
+  };
+  uint8_t exponent = interface.resolution & 0x7f;
+  if (interface.resolution & 0x80)
+    {
+      // negative power of two.
+      if (exponent == 0)
+        {
+          return ts * powers[9];
+        }
+      if (exponent > 63)
+        {
+          return 0;
+        }
+      uint64_t seconds = ts >> exponent;
+      uint64_t fraction = ts & ((UINT64_C (1) << exponent) - 1);
+      return seconds * powers[9] + (uint64_t)((long double)fraction * powers[9] / (UINT64_C (1) << exponent));
+    }
+  if (exponent <= 9)
+    {
+      return ts * powers[9 - exponent];
+    }
+  uint64_t divider = 1;
+  for (uint8_t i = 9; i < exponent && divider < UINT64_C (10000000000000000000); i++)
+    {
+      divider *= 10;
+    }
+  return ts / divider;
+}
+
+bool
+PcapReader::ReadPcapNg (struct Record *record)
+{
+  while (m_offset + 12 <= m_size)
+    {
+      uint8_t const *block = m_data + m_offset;
+      uint32_t type;
+      std::memcpy (&type, block, 4);
+      if (type == SHB_TYPE)
+        {
+          // a new section, which may change the byte order.
+          if (!ReadSection ())
+            {
+              m_fail = true;
+              return false;
+            }
+          continue;
+        }
+      type = Get32 (block);
+      uint32_t length = Get32 (block + 4);
+      if (length < 12 || length % 4 != 0 || length > m_size - m_offset)
+        {
+          NS_LOG_WARN ("Bad block length in " << m_filename);
+          m_fail = true;
+          return false;
+        }
+      if (type == IDB_TYPE && length >= 20)
+        {
+          if (m_seen == m_interfaces.size ())
+            {
+              struct Interface interface;
+              interface.dataLinkType = Get16 (block + 8);
+              interface.snapLen = Get32 (block + 12);
+              interface.resolution = 6;
+              ReadInterfaceOptions (block + 16, block + length - 4, &interface);
+              m_interfaces.push_back (interface);
+            }
+          // else, described again after a Rewind.
+          m_seen++;
+        }
+      else if ((type == EPB_TYPE && length >= 32) || (type == SPB_TYPE && length >= 16))
+        {
+          if (record == 0)
+            {
+              return false;
+            }
+          uint32_t room;
+          if (type == EPB_TYPE)
+            {
+              uint32_t interface = m_section + Get32 (block + 8);
+              if (interface >= m_seen)
+                {
+                  NS_LOG_WARN ("Record of an unknown interface in " << m_filename);
+                  m_fail = true;
+                  return false;
+                }
+              uint64_t ts = ((uint64_t)Get32 (block + 12) << 32) | Get32 (block + 16);
+              record->interface = interface;
+              record->timestamp = ToNanoSeconds (m_interfaces[interface], ts);
+              record->inclLen = Get32 (block + 20);
+              record->origLen = Get32 (block + 24);
+              record->data = block + 28;
+              room = length - 32;
+            }
+          else
+            {
+              if (m_section >= m_seen)
+                {
+                  m_fail = true;
+                  return false;
+                }
+              record->interface = m_section;
+              record->timestamp = 0;
+              record->origLen = Get32 (block + 8);
+              record->inclLen = std::min (record->origLen, m_interfaces[m_section].snapLen);
+              record->data = block + 12;
+              room = length - 16;
+              if (m_interfaces[m_section].snapLen == 0)
+                {
+                  record->inclLen = std::min (record->origLen, room);
+                }
+            }
+          if (record->inclLen > room)
+            {
+              NS_LOG_WARN ("Truncated record in " << m_filename);
+              m_fail = true;
+              return false;
+            }
+          m_offset += length;
+          return true;
+        }
+      m_offset += length;
+    }
+  // a partial block header is a truncated file.
+  m_fail = m_offset != m_size;
+  return false;
+}
+
+} // namespace ns3
@@ -0,0 +1,188 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PCAP_READER_H
+#define PCAP_READER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "pcap-writer.h"
+
+namespace ns3 {
+
+/**
+ * \brief Reader of pcap and pcapng files, mapped in memory.
+ *
+ * The file is mapped once, and each record read points to its bytes in
+ * the mapping: nothing is copied, and the data of a record stays valid
+ * until the reader is closed. Both byte orders, the microsecond and
+ * nanosecond pcap formats and the pcapng Enhanced and Simple Packet
+ * Blocks are read; the time stamps are given in nanoseconds, whatever
+ * the resolution of the file.
+ *
+ * The interfaces of a pcapng file are numbered in the order of their
+ * Interface Description Blocks, across the sections of the file; a pcap
+ * file has the single interface 0, described by its file header.
+ * Compressed files are not read.
+ */
+class PcapReader
+{
+public:
+  /// A record of the file
+  struct Record
+  {
+    uint32_t interface;   //!< the interface of the record
+    uint64_t timestamp;   //!< nanoseconds since the epoch
+    uint32_t inclLen;     //!< bytes of the packet saved in the file
+    uint32_t origLen;     //!< bytes of the original packet
+    uint8_t const *data;  //!< the inclLen bytes of the packet
+  };
+
+  PcapReader ();
+  ~PcapReader ();
+
+  /**
+   * Map a file and read its headers, up to the first record.
+   *
+   * \param filename The name of the file.
+   */
+  void Open (std::string const &filename);
+  /**
+   * Unmap the file. The data of the records read are no longer valid.
+   */
+  void Close (void);
+
+  /**
+   * \returns true if the file could not be opened or is not valid.
+   */
+  bool Fail (void) const;
+  /**
+   * \returns The format of the file.
+   */
+  enum PcapWriter::Format GetFormat (void) const;
+  /**
+   * \returns true if the file is in the other byte order than the host.
+   */
+  bool GetSwapMode (void) const;
+  /**
+   * \returns The number of interfaces described so far.
+   */
+  uint32_t GetNInterfaces (void) const;
+  /**
+   * \param interface An interface described so far.
+   * \returns The data link type of the interface.
+   */
+  uint32_t GetDataLinkType (uint32_t interface = 0) const;
+  /**
+   * \param interface An interface described so far.
+   * \returns The maximum length of the records of the interface.
+   */
+  uint32_t GetSnapLen (uint32_t interface = 0) const;
+
+  /**
+   * Read the next record.
+   *
+   * \param record [out] The record.
+   * \returns false at the end of the file or if the file is not valid
+   * from there, when Fail is then true.
+   */
+  bool Read (struct Record *record);
+  /**
+   * Go back to the first record.
+   */
+  void Rewind (void);
+
+private:
+  /// An interface of the file
+  struct Interface
+  {
+    uint32_t dataLinkType; //!< data link type
+    uint32_t snapLen;      //!< maximum length of the records
+    uint8_t resolution;    //!< pcapng if_tsresol
+  };
+
+  /**
+   * Read a pcap record.
+   * \param record [out] The record.
+   * \returns false at the end of the file.
+   */
+  bool ReadPcap (struct Record *record);
+  /**
+   * Read pcapng blocks up to the next record.
+   * \param record [out] The record, or zero to stop before the first one.
+   * \returns false at the end of the file.
+   */
+  bool ReadPcapNg (struct Record *record);
+  /**
+   * Read a pcapng Section Header Block at the current offset.
+   * \returns false if the block is not valid.
+   */
+  bool ReadSection (void);
+  /**
+   * Read the options of a pcapng Interface Description Block.
+   * \param options The first option.
+   * \param end The end of the options.
+   * \param interface [out] The interface described.
+   */
+  void ReadInterfaceOptions (uint8_t const *options, uint8_t const *end,
+                             struct Interface *interface) const;
+  /**
+   * \param interface An interface of the file.
+   * \param ts A time stamp in the resolution of the interface.
+   * \returns The time stamp in nanoseconds.
+   */
+  static uint64_t ToNanoSeconds (struct Interface const &interface, uint64_t ts);
+  /**
+   * \param p Where to read.
+   * \returns The 16 bit value, in the byte order of the file.
+   */
+  uint16_t Get16 (uint8_t const *p) const;
+  /**
+   * \param p Where to read.
+   * \returns The 32 bit value, in the byte order of the file.
+   */
+  uint32_t Get32 (uint8_t const *p) const;
+
+  /**
+   * Copy constructor, not implemented.
+   * \param o The reader.
+   */
+  PcapReader (PcapReader const &o);
+  /**
+   * Assignment operator, not implemented.
+   * \param o The reader.
+   * \returns This reader.
+   */
+  PcapReader & operator = (PcapReader const &o);
+
+  std::string m_filename;       //!< name of the file
+  uint8_t *m_data;              //!< the file
+  uint64_t m_size;              //!< the size of the file
+  bool m_mapped;                //!< m_data is mapped, not allocated
+  bool m_fail;                  //!< the file is not valid
+  bool m_swapMode;              //!< the file is in the other byte order
+  bool m_nanoSeconds;           //!< pcap file with nanosecond time stamps
+  enum PcapWriter::Format m_format; //!< the format of the file
+  uint64_t m_offset;            //!< the next record or block
+  std::vector<struct Interface> m_interfaces; //!< interfaces described so far
+  uint32_t m_section;           //!< first interface of the current section
+  uint32_t m_seen;              //!< interfaces described before m_offset
+};
+
+} // namespace ns3
+
+#endif /* PCAP_READER_H */
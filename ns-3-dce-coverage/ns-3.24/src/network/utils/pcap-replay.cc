@@ -0,0 +1,269 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/socket-factory.h"
+#include "ns3/packet-socket-factory.h"
+#include "ns3/inet6-socket-address.h"
+#include "ns3/net-device.h"
+#include "ns3/mac48-address.h"
+#include "ns3/packet.h"
+#include "ns3/string.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/address.h"
+#include "ns3/fatal-error.h"
+#include "pcap-replay.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("PcapReplay");
+
+NS_OBJECT_ENSURE_REGISTERED (PcapReplay);
+
+namespace {
+
+const uint32_t DLT_EN10MB = 1;        //!< Ethernet
+const uint32_t DLT_RAW_BSD = 12;      //!< raw IP, on some systems
+const uint32_t LINKTYPE_RAW = 101;    //!< raw IP
+const uint32_t LINKTYPE_IPV4 = 228;   //!< raw IPv4
+const uint32_t LINKTYPE_IPV6 = 229;   //!< raw IPv6
+
+const uint32_t ETHERNET_HEADER_SIZE = 14; //!< addresses and type
+
+} // anonymous namespace
+
+TypeId
+PcapReplay::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::PcapReplay")
+    .SetParent<Application> ()
+    .SetGroupName("Network")
+    .AddConstructor<PcapReplay> ()
+    .AddAttribute ("File",
+                   "The pcap or pcapng file replayed.",
+                   StringValue (""),
+                   MakeStringAccessor (&PcapReplay::m_filename),
+                   MakeStringChecker ())
+    .AddAttribute ("TimeScale",
+                   "The factor of the time between the records: 1 for the timing of the capture, "
+                   "0 to send all the records at once.",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&PcapReplay::m_timeScale),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("Offset",
+                   "The first byte of the records sent to the socket.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PcapReplay::m_offset),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Protocol",
+                   "The type of the socket, when the records are not sent to a device.",
+                   TypeIdValue (PacketSocketFactory::GetTypeId ()),
+                   MakeTypeIdAccessor (&PcapReplay::m_tid),
+                   MakeTypeIdChecker ())
+    .AddAttribute ("Remote",
+                   "The address the records are sent to, when they are not sent to a device.",
+                   AddressValue (),
+                   MakeAddressAccessor (&PcapReplay::m_remote),
+                   MakeAddressChecker ())
+    .AddTraceSource ("Tx", "A record has been sent",
+                     MakeTraceSourceAccessor (&PcapReplay::m_txTrace),
+                     "ns3::Packet::TracedCallback")
+  ;
+  return tid;
+}
+
+PcapReplay::PcapReplay ()
+  : m_first (0),
+    m_sent (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PcapReplay::~PcapReplay ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+PcapReplay::SetDevice (Ptr<NetDevice> device)
+{
+  NS_LOG_FUNCTION (this << device);
+  m_device = device;
+}
+
+uint32_t
+PcapReplay::GetSent (void) const
+{
+  return m_sent;
+}
+
+void
+PcapReplay::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_device = 0;
+  m_socket = 0;
+  m_reader.Close ();
+  Application::DoDispose ();
+}
+
+void
+PcapReplay::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_reader.Open (m_filename);
+  if (m_reader.Fail ())
+    {
+      NS_FATAL_ERROR ("Unable to replay " << m_filename);
+    }
+  if (m_device == 0 && m_socket == 0)
+    {
+      m_socket = Socket::CreateSocket (GetNode (), m_tid);
+      if (Inet6SocketAddress::IsMatchingType (m_remote))
+        {
+          m_socket->Bind6 ();
+        }
+      else
+        {
+          m_socket->Bind ();
+        }
+      m_socket->Connect (m_remote);
+      m_socket->ShutdownRecv ();
+    }
+  if (!m_reader.Read (&m_record))
+    {
+      NS_LOG_WARN ("No record in " << m_filename);
+      return;
+    }
+  m_first = m_record.timestamp;
+  m_start = Simulator::Now ();
+  m_sendEvent = Simulator::ScheduleNow (&PcapReplay::Send, this);
+}
+
+void
+PcapReplay::StopApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+  Simulator::Cancel (m_sendEvent);
+  if (m_socket != 0)
+    {
+      m_socket->Close ();
+      m_socket = 0;
+    }
+  m_reader.Close ();
+}
+
+Time
+PcapReplay::GetSendTime (uint64_t timestamp) const
+{
+  // a record older than the first one is sent at once.
+  uint64_t delta = timestamp > m_first ? timestamp - m_first : 0;
+  if (m_timeScale == 1.0)
+    {
+      return m_start + NanoSeconds (delta);
+    }
+  return m_start + NanoSeconds (static_cast<int64_t> (delta * m_timeScale));
+}
+
+Ptr<Packet>
+PcapReplay::SendToDevice (uint32_t dataLinkType)
+{
+  uint8_t const *data = m_record.data;
+  uint32_t size = m_record.inclLen;
+  Ptr<Packet> p;
+  if (dataLinkType == DLT_EN10MB)
+    {
+      if (size < ETHERNET_HEADER_SIZE)
+        {
+          return 0;
+        }
+      Mac48Address destination, source;
+      destination.CopyFrom (data);
+      source.CopyFrom (data + 6);
+      uint16_t protocol = (data[12] << 8) | data[13];
+      p = Create<Packet> (data + ETHERNET_HEADER_SIZE, size - ETHERNET_HEADER_SIZE);
+      bool sent = m_device->SupportsSendFrom ()
+        ? m_device->SendFrom (p, source, destination, protocol)
+        : m_device->Send (p, destination, protocol);
+      return sent ? p : 0;
+    }
+  if (dataLinkType == DLT_RAW_BSD || dataLinkType == LINKTYPE_RAW
+      || dataLinkType == LINKTYPE_IPV4 || dataLinkType == LINKTYPE_IPV6)
+    {
+      if (size == 0)
+        {
+          return 0;
+        }
+      uint16_t protocol = (data[0] >> 4) == 6 ? 0x86dd : 0x0800;
+      p = Create<Packet> (data, size);
+      return m_device->Send (p, m_device->GetBroadcast (), protocol) ? p : 0;
+    }
+  NS_FATAL_ERROR ("Records of data link type " << dataLinkType << " cannot be replayed to a device");
+  return 0;
+}
+
+void
+PcapReplay::Send (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_sendEvent.IsExpired ());
+
+  Time next;
+  do
+    {
+      Ptr<Packet> p;
+      if (m_device != 0)
+        {
+          p = SendToDevice (m_reader.GetDataLinkType (m_record.interface));
+        }
+      else
+        {
+          uint32_t offset = std::min (m_offset, m_record.inclLen);
+          p = Create<Packet> (m_record.data + offset, m_record.inclLen - offset);
+          if (m_socket->Send (p) < 0)
+            {
+              p = 0;
+            }
+        }
+      if (p != 0)
+        {
+          NS_LOG_INFO ("TX " << p->GetSize () << " bytes, record " << m_sent
+                       << " Uid: " << p->GetUid ()
+                       << " Time: " << Simulator::Now ().GetSeconds ());
+          m_sent++;
+          m_txTrace (p);
+        }
+      else
+        {
+          NS_LOG_INFO ("Error while sending a record of " << m_record.inclLen << " bytes");
+        }
+      if (!m_reader.Read (&m_record))
+        {
+          NS_LOG_LOGIC ("End of " << m_filename);
+          return;
+        }
+      next = GetSendTime (m_record.timestamp);
+    }
+  while (next <= Simulator::Now ());
+
+  m_sendEvent = Simulator::Schedule (next - Simulator::Now (), &PcapReplay::Send, this);
+}
+
+} // Namespace ns3
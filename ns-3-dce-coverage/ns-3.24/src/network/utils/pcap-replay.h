@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PCAP_REPLAY_H
+#define PCAP_REPLAY_H
+
+#include <string>
+#include "ns3/application.h"
+#include "ns3/event-id.h"
+#include "ns3/ptr.h"
+#include "ns3/address.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
+#include "pcap-reader.h"
+
+namespace ns3 {
+
+class Socket;
+class Packet;
+class NetDevice;
+
+/**
+ * \ingroup socket
+ *
+ * \brief Send the records of a pcap file again, with their timing.
+ *
+ * The first record of `File' is sent when the application starts, and
+ * each of the next ones after the time between their time stamps,
+ * multiplied by `TimeScale': 1 keeps the timing of the capture, 0.5
+ * replays it twice as fast, and 0 sends all the records at once. The
+ * file is mapped in memory by a PcapReader, and read as the records are
+ * sent.
+ *
+ * With SetDevice, the records are given to the NetDevice as frames:
+ * the Ethernet header of the records of an Ethernet interface gives the
+ * addresses and the protocol (SendFrom is used if the device supports
+ * it), and the records of a raw IP interface (data link types 12, 101,
+ * 228 and 229) are sent to the broadcast address of the device. The
+ * other data link types are not replayed to a device.
+ *
+ * Otherwise, the records are sent to `Remote' through a socket of the
+ * `Protocol' factory, from their byte `Offset': for example, the UDP
+ * payload of an Ethernet, IPv4 and UDP capture without IP options starts
+ * at byte 42.
+ *
+ * Provides a "Tx" Traced Callback (the packets sent).
+ */
+class PcapReplay : public Application
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  PcapReplay ();
+
+  virtual ~PcapReplay ();
+
+  /**
+   * \brief Send the records to a device of the node, as frames.
+   * \param device The device.
+   */
+  void SetDevice (Ptr<NetDevice> device);
+
+  /**
+   * \returns The number of records sent.
+   */
+  uint32_t GetSent (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  /**
+   * \brief Send the records due, and schedule the next one.
+   */
+  void Send (void);
+  /**
+   * \param timestamp The time stamp of a record.
+   * \returns The time to send the record.
+   */
+  Time GetSendTime (uint64_t timestamp) const;
+  /**
+   * \brief Send the current record to the device.
+   * \param dataLinkType The data link type of the record.
+   * \returns The packet sent, or zero.
+   */
+  Ptr<Packet> SendToDevice (uint32_t dataLinkType);
+
+  std::string m_filename;   //!< File replayed
+  double m_timeScale;       //!< Factor of the time between the records
+  uint32_t m_offset;        //!< First byte of the records sent to a socket
+  TypeId m_tid;             //!< Type of the socket factory
+  Address m_remote;         //!< Remote address of the socket
+  Ptr<NetDevice> m_device;  //!< Device given the frames, if any
+
+  PcapReader m_reader;      //!< The file
+  PcapReader::Record m_record; //!< The next record
+  uint64_t m_first;         //!< Time stamp of the first record
+  Time m_start;             //!< Time of the first record
+  uint32_t m_sent;          //!< Counter for sent records
+  Ptr<Socket> m_socket;     //!< Socket
+  EventId m_sendEvent;      //!< Event to send the next record
+
+  /// Traced Callback: sent packets.
+  TracedCallback<Ptr<const Packet> > m_txTrace;
+};
+
+} // namespace ns3
+
+#endif /* PCAP_REPLAY_H */
@@ -0,0 +1,635 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <map>
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+#include "ns3/packet.h"
+#include "ns3/header.h"
+#include "ns3/buffer.h"
+#include "pcap-writer.h"
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("PcapWriter");
+
+namespace {
+
+const uint32_t MAGIC = 0xa1b2c3d4;           //!< pcap, microsecond time stamps
+const uint16_t VERSION_MAJOR = 2;            //!< pcap major version
+const uint16_t VERSION_MINOR = 4;            //!< pcap minor version
+
+const uint32_t SHB_TYPE = 0x0a0d0d0a;        //!< pcapng Section Header Block
+const uint32_t BYTE_ORDER_MAGIC = 0x1a2b3c4d; //!< pcapng byte order magic
+const uint32_t IDB_TYPE = 1;                 //!< pcapng Interface Description Block
+const uint32_t EPB_TYPE = 6;                 //!< pcapng Enhanced Packet Block
+const uint16_t IF_TSRESOL = 9;               //!< pcapng time stamp resolution option
+
+const uint32_t PCAP_FILE_HEADER_SIZE = 24;   //!< size of the pcap file header
+const uint32_t PCAP_RECORD_HEADER_SIZE = 16; //!< size of a pcap record header
+const uint32_t SHB_SIZE = 28;                //!< size of our Section Header Blocks
+const uint32_t IDB_SIZE = 32;                //!< size of our Interface Description Blocks
+const uint32_t EPB_OVERHEAD = 32;            //!< size of an EPB without its data
+
+/**
+ * The longest wait for a condition, in nanoseconds: a waiter which resets
+ * a condition may hide its signal from another waiter, which then only
+ * checks its state again after this time.
+ */
+const uint64_t WAIT_TIMEOUT = 10000000;
+
+/**
+ * Write a 16 bit value in the byte order of the host.
+ * \param buffer Where to write.
+ * \param v The value.
+ * \returns The buffer after the value.
+ */
+inline uint8_t *
+Put16 (uint8_t *buffer, uint16_t v)
+{
+  std::memcpy (buffer, &v, 2);
+  return buffer + 2;
+}
+/**
+ * Write a 32 bit value in the byte order of the host.
+ * \param buffer Where to write.
+ * \param v The value.
+ * \returns The buffer after the value.
+ */
+inline uint8_t *
+Put32 (uint8_t *buffer, uint32_t v)
+{
+  std::memcpy (buffer, &v, 4);
+  return buffer + 4;
+}
+
+/**
+ * The writers of the files open, by name: the PcapFileWrapper which open
+ * the same file share its writer, and the files still open are closed at
+ * the end of the program.
+ */
+class PcapWriterList : public std::map<std::string, PcapWriter *>
+{
+public:
+  ~PcapWriterList ()
+  {
+    // the writers left behind by objects never destroyed: a gzip file
+    // is only readable once closed.
+    for (iterator i = begin (); i != end (); i++)
+      {
+        i->second->Close ();
+      }
+    clear ();
+    m_destroyed = true;
+  }
+  static bool m_destroyed; //!< the list is gone
+  SystemMutex m_mutex;     //!< protects the list
+} g_writers;
+
+bool PcapWriterList::m_destroyed = false;
+
+} // anonymous namespace
+
+Ptr<PcapWriter>
+PcapWriter::Open (std::string const &filename, struct Options const &options)
+{
+  NS_LOG_FUNCTION (filename);
+  CriticalSection cs (g_writers.m_mutex);
+  PcapWriterList::iterator i = g_writers.find (filename);
+  if (i == g_writers.end ())
+    {
+      Ptr<PcapWriter> writer = Ptr<PcapWriter> (new PcapWriter (filename, options), false);
+      g_writers[filename] = PeekPointer (writer);
+      return writer;
+    }
+  Ptr<PcapWriter> writer = i->second;
+  struct Options const &current = writer->m_options;
+  if (options.format != current.format || options.compression != current.compression
+      || options.maxFileSize != current.maxFileSize)
+    {
+      NS_FATAL_ERROR ("The file " << filename << " is already open with another format, "
+                      "compression or maximum size");
+    }
+  if (options.asynchronous != current.asynchronous
+      || std::max (options.blockSize, 4096U) != current.blockSize
+      || std::max (options.maxBlocks, 1U) != current.maxBlocks)
+    {
+      NS_LOG_WARN ("The file " << filename << " is already open: its buffering is kept");
+    }
+  return writer;
+}
+
+PcapWriter::PcapWriter (std::string const &filename, struct Options const &options)
+  : m_filename (filename),
+    m_options (options),
+    m_current (0),
+    m_writing (0),
+    m_exit (false),
+    m_fail (false),
+    m_file (0),
+    m_fileBytes (0),
+    m_headerBytes (0),
+    m_rank (0)
+{
+  NS_LOG_FUNCTION (this << filename);
+#ifndef HAVE_ZLIB
+  if (m_options.compression == GZIP)
+    {
+      NS_FATAL_ERROR ("The network module was built without zlib: no gzip compression of " << filename);
+    }
+#endif
+  m_options.blockSize = std::max (m_options.blockSize, 4096U);
+  m_options.maxBlocks = std::max (m_options.maxBlocks, 1U);
+  OpenFile (0);
+  m_current = new struct Block;
+  m_current->data.resize (m_options.blockSize);
+  m_current->used = 0;
+  m_current->interfaces = 0;
+  if (m_options.asynchronous)
+    {
+      m_thread = Create<SystemThread> (MakeCallback (&PcapWriter::Run, this));
+      m_thread->Start ();
+    }
+}
+
+PcapWriter::~PcapWriter ()
+{
+  NS_LOG_FUNCTION (this);
+  if (!PcapWriterList::m_destroyed)
+    {
+      CriticalSection cs (g_writers.m_mutex);
+      PcapWriterList::iterator i = g_writers.find (m_filename);
+      if (i != g_writers.end () && i->second == this)
+        {
+          g_writers.erase (i);
+        }
+    }
+  Close ();
+  delete m_current;
+  for (std::vector<struct Block *>::iterator i = m_free.begin (); i != m_free.end (); i++)
+    {
+      delete *i;
+    }
+}
+
+void
+PcapWriter::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  Flush ();
+  m_mutex.Lock ();
+  bool asynchronous = m_options.asynchronous;
+  // the blocks given afterwards go to the closed file, which drops them.
+  m_options.asynchronous = false;
+  m_exit = true;
+  Signal (&m_ready);
+  m_mutex.Unlock ();
+  if (asynchronous)
+    {
+      m_thread->Join ();
+      m_thread = 0;
+    }
+  CloseFile ();
+}
+
+bool
+PcapWriter::Fail (void) const
+{
+  return m_fail;
+}
+
+enum PcapWriter::Format
+PcapWriter::GetFormat (void) const
+{
+  return m_options.format;
+}
+
+std::string
+PcapWriter::GetFilename (void) const
+{
+  return m_currentFilename;
+}
+
+uint32_t
+PcapWriter::AddInterface (uint32_t dataLinkType, uint32_t snapLen, int32_t timeZoneCorrection)
+{
+  NS_LOG_FUNCTION (this << dataLinkType << snapLen << timeZoneCorrection);
+  struct Interface interface;
+  interface.dataLinkType = dataLinkType;
+  interface.snapLen = snapLen;
+  interface.zone = timeZoneCorrection;
+  m_mutex.Lock ();
+  uint32_t index = m_interfaces.size ();
+  if (m_options.format == PCAP)
+    {
+      if (index != 0)
+        {
+          NS_FATAL_ERROR ("A pcap file has a single interface: use the pcapng format to write several to " << m_filename);
+        }
+      // the file header, which names the interface, is written with the
+      // first block.
+      m_interfaces.push_back (interface);
+    }
+  else
+    {
+      // the interface is described in the stream, before its records.
+      EncodeInterface (interface, Reserve (IDB_SIZE));
+      m_interfaces.push_back (interface);
+    }
+  m_mutex.Unlock ();
+  return index;
+}
+
+void
+PcapWriter::Write (uint32_t interface, Time t, Header const *header, Ptr<const Packet> p,
+                   uint8_t const *data, uint32_t length)
+{
+  NS_LOG_FUNCTION (this << interface << t << header << p << length);
+  uint32_t headerSize = header != 0 ? header->GetSerializedSize () : 0;
+  uint32_t totalLen = headerSize + (p != 0 ? p->GetSize () : length);
+  m_mutex.Lock ();
+  NS_ASSERT (interface < m_interfaces.size ());
+  uint32_t inclLen = std::min (totalLen, m_interfaces[interface].snapLen);
+  uint8_t *buffer;
+  if (m_options.format == PCAP)
+    {
+      uint64_t us = t.GetMicroSeconds ();
+      buffer = Reserve (PCAP_RECORD_HEADER_SIZE + inclLen);
+      buffer = Put32 (buffer, us / 1000000);
+      buffer = Put32 (buffer, us % 1000000);
+      buffer = Put32 (buffer, inclLen);
+      buffer = Put32 (buffer, totalLen);
+    }
+  else
+    {
+      uint64_t ns = t.GetNanoSeconds ();
+      uint32_t padded = (inclLen + 3) & ~3U;
+      uint32_t size = EPB_OVERHEAD + padded;
+      buffer = Reserve (size);
+      buffer = Put32 (buffer, EPB_TYPE);
+      buffer = Put32 (buffer, size);
+      buffer = Put32 (buffer, interface);
+      buffer = Put32 (buffer, ns >> 32);
+      buffer = Put32 (buffer, ns & 0xffffffff);
+      buffer = Put32 (buffer, inclLen);
+      buffer = Put32 (buffer, totalLen);
+      std::memset (buffer + inclLen, 0, padded - inclLen);
+      Put32 (buffer + padded, size);
+    }
+  uint32_t left = inclLen;
+  if (header != 0)
+    {
+      Buffer headerBuffer;
+      headerBuffer.AddAtStart (headerSize);
+      header->Serialize (headerBuffer.Begin ());
+      uint32_t copied = headerBuffer.CopyData (buffer, std::min (headerSize, left));
+      buffer += copied;
+      left -= copied;
+    }
+  if (p != 0)
+    {
+      p->CopyData (buffer, left);
+    }
+  else
+    {
+      std::memcpy (buffer, data, left);
+    }
+  m_mutex.Unlock ();
+}
+
+void
+PcapWriter::Flush (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_mutex.Lock ();
+  if (m_current->used != 0)
+    {
+      Queue ();
+    }
+  if (m_options.asynchronous)
+    {
+      while (!m_queue.empty () || m_writing != 0)
+        {
+          Wait (&m_done);
+        }
+    }
+  else
+    {
+      Drain ();
+    }
+  m_mutex.Unlock ();
+  if (m_file != 0 && m_options.compression == NONE)
+    {
+      std::fflush ((FILE *)m_file);
+    }
+}
+
+uint8_t *
+PcapWriter::Reserve (uint32_t size)
+{
+  if (m_current->used + size > m_current->data.size ())
+    {
+      if (m_current->used != 0)
+        {
+          Queue ();
+        }
+      if (size > m_current->data.size ())
+        {
+          m_current->data.resize (size);
+        }
+    }
+  uint8_t *buffer = &m_current->data[m_current->used];
+  m_current->used += size;
+  return buffer;
+}
+
+void
+PcapWriter::Queue (void)
+{
+  if (m_options.asynchronous)
+    {
+      while (m_queue.size () >= m_options.maxBlocks)
+        {
+          Wait (&m_done);
+        }
+    }
+  m_queue.push_back (m_current);
+  if (m_free.empty ())
+    {
+      m_current = new struct Block;
+      m_current->data.resize (m_options.blockSize);
+    }
+  else
+    {
+      m_current = m_free.back ();
+      m_free.pop_back ();
+    }
+  m_current->used = 0;
+  m_current->interfaces = m_interfaces.size ();
+  if (m_options.asynchronous)
+    {
+      Signal (&m_ready);
+    }
+  else if (m_queue.size () >= m_options.maxBlocks)
+    {
+      Drain ();
+    }
+}
+
+void
+PcapWriter::Drain (void)
+{
+  // another thread may be writing already: it writes our blocks too.
+  if (m_writing != 0)
+    {
+      return;
+    }
+  m_writing++;
+  while (!m_queue.empty ())
+    {
+      struct Block *block = m_queue.front ();
+      m_queue.pop_front ();
+      m_mutex.Unlock ();
+      WriteBlock (block);
+      m_mutex.Lock ();
+      m_free.push_back (block);
+    }
+  m_writing--;
+}
+
+void
+PcapWriter::Run (void)
+{
+  m_mutex.Lock ();
+  while (true)
+    {
+      while (m_queue.empty () && !m_exit)
+        {
+          Wait (&m_ready);
+        }
+      if (m_queue.empty ())
+        {
+          break;
+        }
+      struct Block *block = m_queue.front ();
+      m_queue.pop_front ();
+      m_writing++;
+      m_mutex.Unlock ();
+      WriteBlock (block);
+      m_mutex.Lock ();
+      m_writing--;
+      m_free.push_back (block);
+      Signal (&m_done);
+    }
+  m_mutex.Unlock ();
+}
+
+void
+PcapWriter::Wait (SystemCondition *condition)
+{
+  // reset with m_mutex locked, before the state signaled can change: a
+  // signal sent once m_mutex is unlocked is not lost.
+  condition->SetCondition (false);
+  m_mutex.Unlock ();
+  condition->TimedWait (WAIT_TIMEOUT);
+  m_mutex.Lock ();
+}
+
+void
+PcapWriter::Signal (SystemCondition *condition)
+{
+  condition->SetCondition (true);
+  condition->Broadcast ();
+}
+
+void
+PcapWriter::WriteBlock (struct Block *block)
+{
+  NS_LOG_FUNCTION (this << block->used);
+  if (m_file == 0)
+    {
+      return;
+    }
+  // a file gets at least one block, whatever its size.
+  if (m_options.maxFileSize != 0 && m_fileBytes > m_headerBytes &&
+      m_fileBytes + block->used > m_options.maxFileSize)
+    {
+      CloseFile ();
+      OpenFile (m_rank + 1);
+    }
+  if (m_fileBytes == 0)
+    {
+      // the header of a file is written with its first block: the pcap
+      // file header describes the interface, added after the open.
+      std::vector<uint8_t> header;
+      EncodeFileHeader (block->interfaces, &header);
+      WriteBytes (&header[0], header.size ());
+      m_headerBytes = header.size ();
+    }
+  WriteBytes (&block->data[0], block->used);
+}
+
+void
+PcapWriter::EncodeFileHeader (uint32_t interfaces, std::vector<uint8_t> *out)
+{
+  m_mutex.Lock ();
+  if (m_options.format == PCAP)
+    {
+      struct Interface interface = { 0, 65535, 0 };
+      if (!m_interfaces.empty ())
+        {
+          interface = m_interfaces[0];
+        }
+      out->resize (PCAP_FILE_HEADER_SIZE);
+      uint8_t *buffer = &(*out)[0];
+      buffer = Put32 (buffer, MAGIC);
+      buffer = Put16 (buffer, VERSION_MAJOR);
+      buffer = Put16 (buffer, VERSION_MINOR);
+      buffer = Put32 (buffer, interface.zone);
+      buffer = Put32 (buffer, 0);
+      buffer = Put32 (buffer, interface.snapLen);
+      Put32 (buffer, interface.dataLinkType);
+    }
+  else
+    {
+      out->resize (SHB_SIZE + interfaces * IDB_SIZE);
+      uint8_t *buffer = &(*out)[0];
+      buffer = Put32 (buffer, SHB_TYPE);
+      buffer = Put32 (buffer, SHB_SIZE);
+      buffer = Put32 (buffer, BYTE_ORDER_MAGIC);
+      buffer = Put16 (buffer, 1);
+      buffer = Put16 (buffer, 0);
+      // unknown section length
+      buffer = Put32 (buffer, 0xffffffff);
+      buffer = Put32 (buffer, 0xffffffff);
+      buffer = Put32 (buffer, SHB_SIZE);
+      for (uint32_t i = 0; i < interfaces; i++)
+        {
+          EncodeInterface (m_interfaces[i], buffer + i * IDB_SIZE);
+        }
+    }
+  m_mutex.Unlock ();
+}
+
+void
+PcapWriter::EncodeInterface (struct Interface const &interface, uint8_t *buffer)
+{
+  buffer = Put32 (buffer, IDB_TYPE);
+  buffer = Put32 (buffer, IDB_SIZE);
+  buffer = Put16 (buffer, interface.dataLinkType);
+  buffer = Put16 (buffer, 0);
+  buffer = Put32 (buffer, interface.snapLen);
+  // if_tsresol: nanoseconds
+  buffer = Put16 (buffer, IF_TSRESOL);
+  buffer = Put16 (buffer, 1);
+  buffer = Put32 (buffer, 9);
+  // opt_endofopt
+  buffer = Put32 (buffer, 0);
+  Put32 (buffer, IDB_SIZE);
+}
+
+void
+PcapWriter::OpenFile (uint32_t rank)
+{
+  std::ostringstream oss;
+  oss << m_filename;
+  if (rank != 0)
+    {
+      oss << "." << rank;
+    }
+  if (m_options.compression == GZIP)
+    {
+      oss << ".gz";
+    }
+  m_currentFilename = oss.str ();
+  m_rank = rank;
+  m_fileBytes = 0;
+  m_headerBytes = 0;
+  NS_LOG_LOGIC ("open " << m_currentFilename);
+#ifdef HAVE_ZLIB
+  if (m_options.compression == GZIP)
+    {
+      m_file = gzopen (m_currentFilename.c_str (), "wb");
+    }
+  else
+#endif
+    {
+      m_file = std::fopen (m_currentFilename.c_str (), "wb");
+    }
+  if (m_file == 0)
+    {
+      NS_LOG_WARN ("Unable to open " << m_currentFilename);
+      m_fail = true;
+    }
+}
+
+void
+PcapWriter::CloseFile (void)
+{
+  if (m_file == 0)
+    {
+      return;
+    }
+  if (m_fileBytes == 0)
+    {
+      // no record: still a valid file.
+      std::vector<uint8_t> header;
+      EncodeFileHeader (m_interfaces.size (), &header);
+      WriteBytes (&header[0], header.size ());
+    }
+#ifdef HAVE_ZLIB
+  if (m_options.compression == GZIP)
+    {
+      gzclose ((gzFile)m_file);
+    }
+  else
+#endif
+    {
+      std::fclose ((FILE *)m_file);
+    }
+  m_file = 0;
+}
+
+void
+PcapWriter::WriteBytes (uint8_t const *data, uint32_t size)
+{
+  size_t written;
+#ifdef HAVE_ZLIB
+  if (m_options.compression == GZIP)
+    {
+      written = size == 0 ? 0 : gzwrite ((gzFile)m_file, data, size);
+    }
+  else
+#endif
+    {
+      written = std::fwrite (data, 1, size, (FILE *)m_file);
+    }
+  if (written != size)
+    {
+      NS_LOG_WARN ("Unable to write " << m_currentFilename);
+      m_fail = true;
+    }
+  m_fileBytes += size;
+}
+
+} // namespace ns3
@@ -0,0 +1,260 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PCAP_WRITER_H
+#define PCAP_WRITER_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <stdint.h>
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/nstime.h"
+#include "ns3/system-mutex.h"
+#include "ns3/system-condition.h"
+#include "ns3/system-thread.h"
+
+namespace ns3 {
+
+class Packet;
+class Header;
+
+/**
+ * \brief Buffered writer of pcap and pcapng files.
+ *
+ * The records are encoded into large blocks of memory and the blocks are
+ * written to the file when they are full, by the caller or, when
+ * asynchronous, by a thread of the writer. The blocks waiting for this
+ * thread are bounded: a caller which fills a block when MaxBlocks are
+ * already waiting waits for one of them to be written.
+ *
+ * A file is written by a single writer, shared by all the
+ * PcapFileWrapper which open it. In the pcapng format, each of them adds
+ * an interface to the file (an Interface Description Block) and its
+ * records refer to it; in the pcap format, a file has a single interface.
+ *
+ * The file may be compressed with gzip, when the network module is built
+ * with zlib: ".gz" is then appended to the name of the file. When the
+ * file reaches MaxFileSize bytes, before compression, the next records
+ * go to a new file, named after the first one with a ".1", ".2"...
+ * suffix before the ".gz" suffix, and which starts with the same file
+ * header and interfaces.
+ *
+ * The file and the records are written in the byte order of the host,
+ * which their magic numbers give to the readers.
+ */
+class PcapWriter : public SimpleRefCount<PcapWriter>
+{
+public:
+  /// The format of the file
+  enum Format
+  {
+    PCAP,   //!< the libpcap format, microsecond time stamps
+    PCAPNG  //!< the pcapng format, nanosecond time stamps
+  };
+  /// The compression of the file
+  enum Compression
+  {
+    NONE,   //!< not compressed
+    GZIP    //!< gzip stream
+  };
+  /// The configuration of a writer
+  struct Options
+  {
+    enum Format format;           //!< the format of the file
+    enum Compression compression; //!< the compression of the file
+    bool asynchronous;            //!< write the blocks on a thread
+    uint32_t blockSize;           //!< size of the blocks
+    uint32_t maxBlocks;           //!< blocks which may wait to be written
+    uint64_t maxFileSize;         //!< size of a file before rotation, 0 for none
+  };
+
+  /**
+   * Get the writer of a file, created and opened if the file is not
+   * open yet.
+   *
+   * The file of an open writer cannot be written another way: opening it
+   * again with another format, compression or maximum size is a fatal
+   * error, and the buffering of the first opener is kept.
+   *
+   * \param filename The name of the file.
+   * \param options The configuration of the writer, if it is created.
+   * \returns The writer of the file.
+   */
+  static Ptr<PcapWriter> Open (std::string const &filename, struct Options const &options);
+
+  ~PcapWriter ();
+
+  /**
+   * \returns true if the file could not be opened or written.
+   */
+  bool Fail (void) const;
+  /**
+   * \returns The format of the file.
+   */
+  enum Format GetFormat (void) const;
+  /**
+   * \returns The name of the file being written.
+   */
+  std::string GetFilename (void) const;
+
+  /**
+   * Add an interface to the file.
+   *
+   * \param dataLinkType The data link type of its records.
+   * \param snapLen The maximum length of its records.
+   * \param timeZoneCorrection The time zone offset, in hours (pcap only).
+   * \returns The index of the interface in the file.
+   */
+  uint32_t AddInterface (uint32_t dataLinkType, uint32_t snapLen, int32_t timeZoneCorrection);
+
+  /**
+   * Write a record.
+   *
+   * \param interface The interface of the record.
+   * \param t The time stamp of the record.
+   * \param header An header written in front of the packet, or zero.
+   * \param p The packet, or zero.
+   * \param data The data written if there is no packet.
+   * \param length The length of data.
+   */
+  void Write (uint32_t interface, Time t, Header const *header, Ptr<const Packet> p,
+              uint8_t const *data, uint32_t length);
+
+  /**
+   * Write the records given so far, and wait for them to be written.
+   */
+  void Flush (void);
+  /**
+   * Write the records given so far and close the file. The records
+   * given afterwards are discarded.
+   */
+  void Close (void);
+
+private:
+  /// A block of records
+  struct Block
+  {
+    std::vector<uint8_t> data; //!< the records
+    uint32_t used;             //!< bytes of data used
+    uint32_t interfaces;       //!< interfaces added before the block
+  };
+  /// An interface of the file
+  struct Interface
+  {
+    uint32_t dataLinkType; //!< data link type
+    uint32_t snapLen;      //!< maximum length of the records
+    int32_t zone;          //!< time zone offset
+  };
+
+  /**
+   * \param filename The name of the file.
+   * \param options The configuration of the writer.
+   */
+  PcapWriter (std::string const &filename, struct Options const &options);
+
+  /**
+   * Reserve room for a record in the current block, queuing it if it is
+   * full. Called with the mutex held.
+   * \param size The size of the record.
+   * \returns Where to write the record.
+   */
+  uint8_t * Reserve (uint32_t size);
+  /**
+   * Queue the current block and take a new one. Called with the mutex
+   * held, may wait for room in the queue.
+   */
+  void Queue (void);
+  /**
+   * Write the queued blocks, on the calling thread. Called with the
+   * mutex held, which it releases while writing.
+   */
+  void Drain (void);
+  /**
+   * Write a block to the file, opening the next file if the current one
+   * is full. Called without the mutex.
+   * \param block The block.
+   */
+  void WriteBlock (struct Block *block);
+  /**
+   * Open the file of the given rank. Its header is written with its
+   * first block.
+   * \param rank 0 for the first file, then the rank of the rotation.
+   */
+  void OpenFile (uint32_t rank);
+  /**
+   * Close the current file.
+   */
+  void CloseFile (void);
+  /**
+   * Write raw bytes to the current file.
+   * \param data The bytes.
+   * \param size The number of bytes.
+   */
+  void WriteBytes (uint8_t const *data, uint32_t size);
+  /**
+   * Encode the header of a file.
+   * \param interfaces The number of interfaces to describe (pcapng).
+   * \param out The buffer to fill.
+   */
+  void EncodeFileHeader (uint32_t interfaces, std::vector<uint8_t> *out);
+  /**
+   * Encode an Interface Description Block.
+   * \param interface The interface.
+   * \param buffer Where to write the 32 bytes of the block.
+   */
+  static void EncodeInterface (struct Interface const &interface, uint8_t *buffer);
+  /**
+   * The body of the writer thread.
+   */
+  void Run (void);
+  /**
+   * Wait for a condition to be signaled, with m_mutex locked.
+   * \param condition The condition.
+   */
+  void Wait (SystemCondition *condition);
+  /**
+   * Signal a condition to its waiters, with m_mutex locked.
+   * \param condition The condition.
+   */
+  static void Signal (SystemCondition *condition);
+
+  std::string m_filename;            //!< name of the first file
+  std::string m_currentFilename;     //!< name of the file being written
+  struct Options m_options;          //!< configuration
+  std::vector<struct Interface> m_interfaces; //!< interfaces of the file
+  struct Block *m_current;           //!< the block being filled
+  std::list<struct Block *> m_queue; //!< the blocks to write
+  std::vector<struct Block *> m_free; //!< blocks to reuse
+  uint32_t m_writing;                //!< blocks being written
+  bool m_exit;                       //!< the thread must return
+  SystemMutex m_mutex;               //!< protects all of the above
+  SystemCondition m_ready;           //!< signaled when a block is queued
+  SystemCondition m_done;            //!< signaled when a block is written
+  Ptr<SystemThread> m_thread;        //!< writer thread, if asynchronous
+
+  // used by the thread which writes the blocks.
+  bool m_fail;                       //!< could not open or write
+  void *m_file;                      //!< FILE or gzFile
+  uint64_t m_fileBytes;              //!< bytes given to the current file
+  uint32_t m_headerBytes;            //!< bytes of the header of the current file
+  uint32_t m_rank;                   //!< rank of the current file
+};
+
+} // namespace ns3
+
+#endif /* PCAP_WRITER_H */
@@ -107,13 +107,65 @@ Queue::Dequeue (void)
   return packet;
 }
 
+uint32_t
+Queue::Enqueue (std::vector<Ptr<Packet> > const &packets)
+{
+  NS_LOG_FUNCTION (this << packets.size ());
+  uint32_t n = 0;
+  for (std::vector<Ptr<Packet> >::const_iterator i = packets.begin (); i != packets.end (); ++i)
+    {
+      n += Enqueue (*i);
+    }
+  return n;
+}
+
+uint32_t
+Queue::Dequeue (std::vector<Ptr<Packet> > *packets, uint32_t maxPackets)
+{
+  NS_LOG_FUNCTION (this << maxPackets);
+
+  uint32_t first = packets->size ();
+  uint32_t n = DoDequeueBurst (packets, maxPackets);
+  NS_ASSERT (n <= m_nPackets && packets->size () == first + n);
+
+  for (uint32_t i = first; i < first + n; i++)
+    {
+      Ptr<Packet> packet = (*packets)[i];
+      NS_ASSERT (m_nBytes >= packet->GetSize ());
+      m_nBytes -= packet->GetSize ();
+      m_nPackets--;
+      m_traceDequeue (packet);
+    }
+  return n;
+}
+
+uint32_t
+Queue::DoDequeueBurst (std::vector<Ptr<Packet> > *packets, uint32_t maxPackets)
+{
+  NS_LOG_FUNCTION (this << maxPackets);
+  uint32_t n = 0;
+  while (n < maxPackets)
+    {
+      Ptr<Packet> packet = DoDequeue ();
+      if (packet == 0)
+        {
+          break;
+        }
+      packets->push_back (packet);
+      n++;
+    }
+  return n;
+}
+
 void
 Queue::DequeueAll (void)
 {
   NS_LOG_FUNCTION (this);
+  std::vector<Ptr<Packet> > packets;
   while (!IsEmpty ())
     {
-      Dequeue ();
+      packets.clear ();
+      Dequeue (&packets, m_nPackets);
     }
 }
 
@@ -26,6 +26,7 @@
 
 #include <string>
 #include <list>
+#include <vector>
 #include "ns3/packet.h"
 #include "ns3/object.h"
 #include "ns3/traced-callback.h"
@@ -75,6 +76,24 @@ public:
    */
   Ptr<const Packet> Peek (void) const;
 
+  /**
+   * Place packets into the rear of the Queue, in order. The packets which
+   * do not fit are dropped, as with Enqueue.
+   * \param packets packets to enqueue
+   * \return The number of packets enqueued
+   */
+  uint32_t Enqueue (std::vector<Ptr<Packet> > const &packets);
+  /**
+   * Remove packets from the front of the Queue, for a device which
+   * drains a burst at once. The Dequeue trace is fired for each packet,
+   * with the packet and byte counts of the queue without the packets
+   * traced so far.
+   * \param packets [out] the packets removed are appended to it
+   * \param maxPackets the maximum number of packets to remove
+   * \return The number of packets removed
+   */
+  uint32_t Dequeue (std::vector<Ptr<Packet> > *packets, uint32_t maxPackets);
+
   /**
    * Flush the queue.
    */
@@ -171,6 +190,14 @@ private:
    * \return the packet.
    */
   virtual Ptr<const Packet> DoPeek (void) const = 0;
+  /**
+   * Pull packets off the front of the queue, by DoDequeue unless the
+   * subclass does better.
+   * \param packets [out] the packets removed are appended to it
+   * \param maxPackets the maximum number of packets to remove
+   * \return The number of packets removed
+   */
+  virtual uint32_t DoDequeueBurst (std::vector<Ptr<Packet> > *packets, uint32_t maxPackets);
 
 protected:
   /**
@@ -115,7 +115,6 @@ YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double
           double rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
           NS_LOG_DEBUG ("propagation: txPower=" << txPowerDbm << "dbm, rxPower=" << rxPowerDbm << "dbm, " <<
                         "distance=" << senderMobility->GetDistanceFrom (receiverMobility) << "m, delay=" << delay);
-          Ptr<Packet> copy = packet->Copy ();
           Ptr<Object> dstNetDevice = m_phyList[j]->GetDevice ();
           uint32_t dstNode;
           if (dstNetDevice == 0)
@@ -135,7 +134,7 @@ YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double
           parameters.preamble = preamble;
           
           // <M>
-          uint32_t packetUid = copy->GetUid ();
+          uint32_t packetUid = packet->GetUid ();
           bool isSymbolic = false;
           if (m_symPacketList != 0)
             {
@@ -148,7 +147,7 @@ YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double
             {
               delay = TimeStep (m_symPacketList->GetSymPacketDelay (packetUid));
               NS_LOG_DEBUG ("(Symbolic) Packet UID: " << packetUid <<
-                        ", Size: " << copy->GetSize () <<
+                        ", Size: " << packet->GetSize () <<
                         ", Dst: " << dstNode <<
                         ", Src: " << srcNode <<
                         ", Delay:" << delay);
@@ -164,21 +163,24 @@ YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double
                   delay = m_delay;
                 }*/
               NS_LOG_DEBUG ("Packet UID: " << packetUid <<
-                        ", Size: " << copy->GetSize () <<
+                        ", Size: " << packet->GetSize () <<
                         ", Dst: " << dstNode <<
                         ", Src: " << srcNode <<
                         ", Delay: " << delay);
             }
 
+          // the receivers share the packet, which they do not modify:
+          // YansWifiPhy::EndReceive copies it for the MAC of a receiver
+          // which decodes it.
           Simulator::ScheduleWithContext (dstNode,
                                           delay, &YansWifiChannel::Receive, this,
-                                          j, copy, parameters);
+                                          j, packet, parameters);
         }
     }
 }
 
 void
-YansWifiChannel::Receive (uint32_t i, Ptr<Packet> packet, struct Parameters parameters) const
+YansWifiChannel::Receive (uint32_t i, Ptr<const Packet> packet, struct Parameters parameters) const
 {
   m_phyList[i]->StartReceivePreambleAndHeader (packet, parameters.rxPowerDbm, parameters.txVector, parameters.preamble, parameters.aMpdu, parameters.duration);
 }